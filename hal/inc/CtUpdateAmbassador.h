@@ -52,7 +52,15 @@ public:
     CtUpdateAmbassador(const ::android::sp<::android::hardware::tetheroffload::control::V1_0::ITetheringOffloadCallback>& /* cb */);
     /* ------------------- CONNTRACK TIMEOUT UPDATER ------------------------ */
     void updateTimeout(IpaNatTimeoutUpdate /* update */);
+    void updateTimeouts(const std::vector<IpaNatTimeoutUpdate>& /* updates */);
 private:
+    /* Address last translated into a reused HAL pair, if still there */
+    typedef struct AddrCache {
+        bool valid;
+        uint32_t ipAddr;
+    } addrCache_t;
+    static bool translate(IpaIpAddrPortPair /* in */, HALIpAddrPortPair& /* out */,
+            AddrCache& /* cache */);
     static bool translate(IpaNatTimeoutUpdate /* in */, HALNatTimeoutUpdate& /* out */);
     static bool translate(IpaIpAddrPortPair /* in */, HALIpAddrPortPair& /* out */);
     static bool L4ToNetwork(IpaL4Protocol /* in */, NetworkProtocol& /* out */);
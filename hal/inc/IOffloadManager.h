@@ -31,6 +31,7 @@
 
 /* External Includes */
 #include <sys/types.h>
+#include <vector>
 
 /* Internal Includes */
 #include "OffloadStatistics.h"
@@ -165,6 +166,15 @@ public:
         } natTimeoutUpdate_t;
         virtual ~ConntrackTimeoutUpdater(){}
         virtual void updateTimeout(NatTimeoutUpdate /* update */) {}
+        /**
+         * Called once per aging pass with every connection to refresh.
+         * Unless overridden, each is passed to updateTimeout in turn.
+         */
+        virtual void updateTimeouts(const std::vector<NatTimeoutUpdate>& updates) {
+            for (const NatTimeoutUpdate& update : updates) {
+                updateTimeout(update);
+            }
+        }
     }; /* ConntrackTimeoutUpdater */
 
     /**
@@ -85,6 +85,47 @@ void CtUpdateAmbassador::updateTimeout(IpaNatTimeoutUpdate in) {
     }
 } /* updateTimeout */
 
+void CtUpdateAmbassador::updateTimeouts(const std::vector<IpaNatTimeoutUpdate>& in) {
+    /* The callback interface takes one update per call, so a batch still
+     * costs a oneway transaction per connection.  What it saves is the
+     * per-call dispatch and logging, and the formatting of an address
+     * that repeats from one update to the next, as a client's or the
+     * upstream address does over a pass.
+     */
+    HALNatTimeoutUpdate out;
+    AddrCache srcCache = {false, 0};
+    AddrCache dstCache = {false, 0};
+    size_t untranslated = 0;
+    size_t failed = 0;
+
+    if (DBG) {
+        ALOGD("updateTimeouts(%zu)", in.size());
+    }
+
+    for (const IpaNatTimeoutUpdate& update : in) {
+        if (!translate(update.src, out.src, srcCache)
+                || !translate(update.dst, out.dst, dstCache)
+                || !L4ToNetwork(update.proto, out.proto)) {
+            /* See updateTimeout for why the input is not logged */
+            untranslated++;
+            continue;
+        }
+
+        auto ret = mFramework->updateTimeout(out);
+        if (!ret.isOk()) {
+            failed++;
+        }
+    }
+
+    if (untranslated > 0) {
+        ALOGE("Failed to translate %zu of %zu timeout events :(", untranslated, in.size());
+    }
+    if (failed > 0) {
+        ALOGE("Triggering updateTimeout Callback failed for %zu of %zu events.",
+                failed, in.size());
+    }
+} /* updateTimeouts */
+
 bool CtUpdateAmbassador::translate(IpaNatTimeoutUpdate in, HALNatTimeoutUpdate &out) {
     return translate(in.src, out.src)
             && translate(in.dst, out.dst)
@@ -107,6 +148,20 @@ bool CtUpdateAmbassador::translate(IpaIpAddrPortPair in, HALIpAddrPortPair& out)
     return true;
 } /* translate */
 
+bool CtUpdateAmbassador::translate(IpaIpAddrPortPair in, HALIpAddrPortPair& out,
+        AddrCache& cache) {
+    if (cache.valid && cache.ipAddr == in.ipAddr) {
+        /* out.addr still holds it */
+        out.port = in.port;
+        return true;
+    }
+
+    cache.valid = translate(in, out);
+    cache.ipAddr = in.ipAddr;
+
+    return cache.valid;
+} /* translate */
+
 bool CtUpdateAmbassador::L4ToNetwork(IpaL4Protocol in, NetworkProtocol &out) {
     bool ret = false;
     switch(in) {
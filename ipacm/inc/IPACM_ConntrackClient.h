@@ -59,7 +59,6 @@ extern "C"
 
 using namespace std;
 
-#define UDP_TIMEOUT_UPDATE 20
 #define BROADCAST_IPV4_ADDR 0xFFFFFFFF
 
 class IPACM_ConntrackClient
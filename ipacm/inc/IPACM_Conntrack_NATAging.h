@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef IPACM_CONNTRACK_NATAGING_H
+#define IPACM_CONNTRACK_NATAGING_H
+
+#include <stdint.h>
+
+/* each level of the wheel has 64 buckets, each of its lower level's span */
+#define NAT_AGING_WHEEL_BITS   6
+#define NAT_AGING_WHEEL_SIZE   (1 << NAT_AGING_WHEEL_BITS)
+#define NAT_AGING_WHEEL_MASK   (NAT_AGING_WHEEL_SIZE - 1)
+#define NAT_AGING_WHEEL_LEVELS 4
+
+/*
+ * Hierarchical timer wheel over the slots of NatApp's connection
+ * cache, keyed on when each connection next needs looking at, in
+ * seconds.
+ *
+ * The lowest level's buckets are a second each, the next level's 64
+ * seconds, and so on, so the wheel reaches out a little over 194 days;
+ * a time further out is parked in the top level until it comes in
+ * range.  Scheduling and cancelling are O(1), and advancing only does
+ * work for the seconds passed and the connections falling due, as the
+ * higher levels' buckets are spread over the lower ones when reached.
+ */
+class NatAgingWheel
+{
+private:
+
+	int num_entries;
+
+	int *buckets[NAT_AGING_WHEEL_LEVELS];
+
+	int *next;
+	int *prev;
+	int *bucket_of;  /* level * NAT_AGING_WHEEL_SIZE + bucket, or -1 */
+	uint64_t *expires;
+
+	uint64_t current;  /* the next second to be advanced over */
+
+	void Link(int);
+	void Unlink(int);
+	int Cascade(int, int);
+
+public:
+	NatAgingWheel();
+	~NatAgingWheel();
+
+	/* for num_entries slots, with the wheel's clock starting at now */
+	int Init(int, uint64_t);
+
+	/* look at the slot at the given time, in place of any earlier one */
+	void Schedule(int, uint64_t);
+
+	void Cancel(int);
+
+	/*
+	 * move the clock on to now, filling in the slots fallen due, which
+	 * are no longer scheduled, and return how many
+	 */
+	int Advance(uint64_t, int *);
+
+	/*
+	 * the first second, before the given one, at which a slot may fall
+	 * due, or the given one when none will
+	 */
+	uint64_t NextExpiry(uint64_t);
+};
+
+#endif /* IPACM_CONNTRACK_NATAGING_H */
@@ -32,9 +32,17 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>  /* for stderror */
 #include <stdlib.h>
 #include <cstdio>  /* for perror */
+#include <pthread.h>
+#ifdef FEATURE_IPACM_HAL
+#include <vector>
+#include <IOffloadManager.h>
+#endif
 
 #include "IPACM_Config.h"
 #include "IPACM_Xml.h"
+#include "IPACM_Conntrack_NATCache.h"
+#include "IPACM_Conntrack_NATAging.h"
+#include "IPACM_Conntrack_NATCtBatch.h"
 
 extern "C"
 {
@@ -44,30 +52,24 @@ extern "C"
 
 #define MAX_TEMP_ENTRIES 25
 
-#define IPACM_TCP_FULL_FILE_NAME  "/proc/sys/net/ipv4/netfilter/ip_conntrack_tcp_timeout_established"
-#define IPACM_UDP_FULL_FILE_NAME   "/proc/sys/net/ipv4/netfilter/ip_conntrack_udp_timeout_stream"
+/* Most NAT rules moved by each periodic table compaction */
+#define NAT_COMPACT_MAX_MOVES 32
 
-typedef struct _nat_table_entry
-{
-	uint32_t private_ip;
-	uint16_t private_port;
+/* How long the IPA clock stays voted on after a NAT operation, in ms */
+#define NAT_CLK_VOTE_LINGER_MS 100
 
-	uint32_t target_ip;
-	uint16_t target_port;
+/* How many times its configured size a full DDR NAT table may grow to */
+#define NAT_DDR_GROW_FACTOR 2
 
-	uint32_t public_ip;
-	uint16_t public_port;
+/* Bounds on the period between aging passes, in seconds */
+#define NAT_AGING_MIN_PERIOD 2
+#define NAT_AGING_MAX_PERIOD 20
 
-	u_int8_t  protocol;
-	uint32_t timestamp;
+/* How long before its conntrack deadline a flow is looked at, in seconds */
+#define NAT_AGING_GUARD (2 * NAT_AGING_MAX_PERIOD)
 
-	bool dst_nat;
-	bool enabled;
-	uint32_t rule_hdl;
-
-	/* used for pcie-modem */
-	uint32_t rule_id;
-}nat_table_entry;
+#define IPACM_TCP_FULL_FILE_NAME  "/proc/sys/net/ipv4/netfilter/ip_conntrack_tcp_timeout_established"
+#define IPACM_UDP_FULL_FILE_NAME   "/proc/sys/net/ipv4/netfilter/ip_conntrack_udp_timeout_stream"
 
 #define CHK_TBL_HDL()  if(nat_table_hdl == 0){ return -1; }
 
@@ -78,7 +80,30 @@ private:
 	static NatApp *pInstance;
 
 	nat_table_entry *cache;
+	NatCacheIndex cache_idx;
 	nat_table_entry temp[MAX_TEMP_ENTRIES];
+
+	/* scratch space for harvesting rule timestamps in bulk */
+	uint32_t *ts_rule_hdls;
+	uint32_t *ts_values;
+	int *ts_cache_idx;
+
+	/* scratch space for updating one client's rules in bulk */
+	int *clnt_slots;
+	uint32_t *clnt_rule_hdls;
+	ipa_nat_ipv4_rule *clnt_rules;
+
+	/*
+	 * When each connection is next checked against its rule's time
+	 * stamp, and when conntrack will let it go unless refreshed (zero
+	 * until it first has been)
+	 */
+	NatAgingWheel aging;
+	uint64_t *ct_deadline;
+	uint32_t aging_period;
+
+	/* the aging thread's passes against the event thread's updates */
+	pthread_mutex_t cache_lock;
 	uint32_t pub_ip_addr;
 	uint32_t pub_ip_addr_pre;
 	uint32_t nat_table_hdl;
@@ -100,17 +125,33 @@ private:
 	struct nf_conntrack *ct;
 	struct nfct_handle *ct_hdl;
 
+	/* conntrack refreshes of an aging pass, and how each went */
+	NatCtBatch ct_batch;
+	int *ct_results;
+#ifdef FEATURE_IPACM_HAL
+	std::vector<IOffloadManager::ConntrackTimeoutUpdater::natTimeoutUpdate_t> ct_updates;
+#endif
+
 	int m_fd_ipa;
 
 	NatApp();
 	~NatApp();
 	int Init();
 
+#ifndef FEATURE_IPACM_HAL
+	int SetCTAttrs(const nat_table_entry *);
+#else
+	void SetCTUpdate(const nat_table_entry *,
+		IOffloadManager::ConntrackTimeoutUpdater::natTimeoutUpdate_t *);
+#endif
 	void UpdateCTUdpTs(nat_table_entry *, uint32_t);
+	void UpdateCTTimeouts(int);
 	bool ChkForDup(const nat_table_entry *);
 	bool isAlgPort(uint8_t, uint16_t);
 	void Reset();
 	bool isPwrSaveIf(uint32_t);
+	int DelClntRules(int);
+	void StartAging(int);
 	uint32_t GenerateMetdata(uint8_t mux_id);
 
 public:
@@ -127,7 +168,7 @@ public:
 	int AddConnection(const nat_table_entry *);
 	int DelConnection(const uint32_t);
 
-	void UpdateUDPTimeStamp();
+	uint32_t UpdateUDPTimeStamp();
 
 	int UpdatePwrSaveIf(uint32_t);
 	int ResetPwrSaveIf(uint32_t);
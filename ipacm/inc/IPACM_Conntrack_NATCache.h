@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef IPACM_CONNTRACK_NATCACHE_H
+#define IPACM_CONNTRACK_NATCACHE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct _nat_table_entry
+{
+	uint32_t private_ip;
+	uint16_t private_port;
+
+	uint32_t target_ip;
+	uint16_t target_port;
+
+	uint32_t public_ip;
+	uint16_t public_port;
+
+	u_int8_t  protocol;
+	uint32_t timestamp;
+
+	bool dst_nat;
+	bool enabled;
+	uint32_t rule_hdl;
+
+	/* used for pcie-modem */
+	uint32_t rule_id;
+}nat_table_entry;
+
+/* the addresses a connection can be found by, besides its 5-tuple */
+typedef enum
+{
+	NAT_CACHE_PRIVATE_IP = 0,  /* a LAN client's */
+	NAT_CACHE_TARGET_IP,       /* an STA mode client's */
+	NAT_CACHE_NUM_IP_KEYS
+} nat_cache_ip_key;
+
+/*
+ * Index over the slots of NatApp's connection cache.
+ *
+ * Slots holding a connection are found by their 5-tuple (private ip
+ * and port, target ip and port, protocol) through a hash table, and
+ * empty ones are kept on a free list, so neither a lookup nor finding
+ * room for a new connection has to walk the cache.  The two share one
+ * link array, since a slot is only ever on one of them.
+ *
+ * Connections are also listed by client address, so that those of a
+ * client that leaves or goes to power save are at hand without a walk
+ * of the cache.  Those lists are doubly linked, for O(1) removal.
+ */
+class NatCacheIndex
+{
+private:
+
+	nat_table_entry *entries;
+	int num_entries;
+
+	int *buckets;
+	int *links;
+	uint32_t bucket_mask;
+
+	int free_head;
+
+	int *ip_buckets[NAT_CACHE_NUM_IP_KEYS];
+	int *ip_prev[NAT_CACHE_NUM_IP_KEYS];
+	int *ip_next[NAT_CACHE_NUM_IP_KEYS];
+
+	uint32_t Hash(const nat_table_entry *) const;
+	uint32_t HashIp(uint32_t) const;
+	uint32_t EntryIp(int, int) const;
+	void LinkIp(int, int);
+	void UnlinkIp(int, int);
+	bool SameTuple(const nat_table_entry *, const nat_table_entry *) const;
+
+public:
+	NatCacheIndex();
+	~NatCacheIndex();
+
+	/* index the, as yet empty, entries[num_entries] */
+	int Init(nat_table_entry *, int);
+
+	/* slot holding the rule's 5-tuple, or -1 */
+	int Find(const nat_table_entry *) const;
+
+	/* slot the next Insert() should use, or -1 when the cache is full */
+	int NextFree() const;
+
+	/* index the slot NextFree() gave, once its 5-tuple is filled in */
+	void Insert(int);
+
+	/* clear the slot and put it back on the free list */
+	void Remove(int);
+
+	/* fill in the slots of the client's connections, return how many */
+	int FindByIp(nat_cache_ip_key, uint32_t, int *) const;
+};
+
+#endif /* IPACM_CONNTRACK_NATCACHE_H */
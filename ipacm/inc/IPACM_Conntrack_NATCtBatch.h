@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef IPACM_CONNTRACK_NATCTBATCH_H
+#define IPACM_CONNTRACK_NATCTBATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+extern "C"
+{
+#include <libnetfilter_conntrack/libnetfilter_conntrack.h>
+}
+
+/* netlink messages sent at a time; within the default socket buffers */
+#define NAT_CT_BATCH_BUF_SIZE (128 * 1024)
+
+/* room left for the next message, more than any conntrack update needs */
+#define NAT_CT_BATCH_MSG_ROOM 512
+
+/* an update whose outcome is unknown, for want of an answer */
+#define NAT_CT_BATCH_UNKNOWN 1
+
+/*
+ * Conntrack updates, sent many to a netlink message buffer.
+ *
+ * Only the last message of a buffer asks for an ACK: the kernel runs
+ * the messages in order as the buffer is sent, answering only those
+ * that fail, each by its sequence number, so once the last one's ACK
+ * is in, every update's outcome is known.  Refreshing thousands of
+ * connections so takes a few sends and receives rather than a round
+ * trip each.
+ */
+class NatCtBatch
+{
+private:
+
+	int fd;
+
+	char *buf;
+	size_t len;
+	struct nlmsghdr *last;
+
+	/* where the outcome of each queued message goes */
+	int *results;
+	int *result_idx;
+	int num_queued;
+	int max_queued;
+
+	uint32_t seq;
+	uint32_t first_seq;
+
+	int Open();
+	void Close();
+
+public:
+	NatCtBatch();
+	~NatCtBatch();
+
+	/*
+	 * queue an update of the conntrack entry, whose outcome is put in
+	 * results[idx] by Flush(): 0, a negative errno from the kernel, or
+	 * NAT_CT_BATCH_UNKNOWN.  Flushes when the buffer fills.
+	 */
+	int Update(const struct nf_conntrack *, int, int *);
+
+	/* send the updates queued, and collect their outcomes */
+	int Flush();
+};
+
+#endif /* IPACM_CONNTRACK_NATCTBATCH_H */
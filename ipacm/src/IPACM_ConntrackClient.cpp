@@ -405,8 +405,8 @@ void* IPACM_ConntrackClient::UDPConnTimeoutUpdate(void *ptr)
 
 	while(1)
 	{
-		nat_inst->UpdateUDPTimeStamp();
-		sleep(UDP_TIMEOUT_UPDATE);
+		/* each pass says how long until the next */
+		sleep(nat_inst->UpdateUDPTimeStamp());
 	} /* end of while(1) loop */
 
 #ifdef IPACM_DEBUG
@@ -0,0 +1,309 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_Conntrack_NATAging.cpp
+
+	@brief
+	Timer wheel scheduling the aging checks of NatApp's connections
+*/
+#include <stdlib.h>
+
+#include "IPACM_Conntrack_NATAging.h"
+
+#undef  LEVEL_SHIFT
+#define LEVEL_SHIFT(l) ((l) * NAT_AGING_WHEEL_BITS)
+
+/* the furthest a slot can be scheduled from the wheel's clock */
+#undef  WHEEL_SPAN
+#define WHEEL_SPAN ((uint64_t)1 << LEVEL_SHIFT(NAT_AGING_WHEEL_LEVELS))
+
+NatAgingWheel::NatAgingWheel()
+{
+	num_entries = 0;
+
+	for(int level = 0; level < NAT_AGING_WHEEL_LEVELS; level++)
+	{
+		buckets[level] = NULL;
+	}
+
+	next = NULL;
+	prev = NULL;
+	bucket_of = NULL;
+	expires = NULL;
+
+	current = 0;
+}
+
+NatAgingWheel::~NatAgingWheel()
+{
+	for(int level = 0; level < NAT_AGING_WHEEL_LEVELS; level++)
+	{
+		free(buckets[level]);
+	}
+
+	free(next);
+	free(prev);
+	free(bucket_of);
+	free(expires);
+}
+
+int NatAgingWheel::Init(int max_entries, uint64_t now)
+{
+	bool no_mem;
+	int cnt, level;
+
+	if(max_entries <= 0)
+	{
+		return -1;
+	}
+
+	next = (int *)malloc(sizeof(int) * max_entries);
+	prev = (int *)malloc(sizeof(int) * max_entries);
+	bucket_of = (int *)malloc(sizeof(int) * max_entries);
+	expires = (uint64_t *)malloc(sizeof(uint64_t) * max_entries);
+	no_mem = (next == NULL || prev == NULL || bucket_of == NULL || expires == NULL);
+
+	for(level = 0; level < NAT_AGING_WHEEL_LEVELS; level++)
+	{
+		buckets[level] = (int *)malloc(sizeof(int) * NAT_AGING_WHEEL_SIZE);
+		no_mem = no_mem || (buckets[level] == NULL);
+	}
+
+	if(no_mem)
+	{
+		return -1;
+	}
+
+	for(level = 0; level < NAT_AGING_WHEEL_LEVELS; level++)
+	{
+		for(cnt = 0; cnt < NAT_AGING_WHEEL_SIZE; cnt++)
+		{
+			buckets[level][cnt] = -1;
+		}
+	}
+
+	for(cnt = 0; cnt < max_entries; cnt++)
+	{
+		bucket_of[cnt] = -1;
+	}
+
+	num_entries = max_entries;
+	current = now;
+
+	return 0;
+}
+
+/*
+ * Put the slot in the bucket its expiry falls in: the lowest level
+ * whose reach, from the wheel's clock, covers it
+ */
+void NatAgingWheel::Link(int slot)
+{
+	uint64_t when = expires[slot];
+	uint64_t delta;
+	int level, bucket, *head;
+
+	if(when < current)
+	{
+		when = current;
+	}
+	else if(when - current >= WHEEL_SPAN)
+	{
+		when = current + WHEEL_SPAN - 1;
+	}
+
+	delta = when - current;
+
+	for(level = 0; level < NAT_AGING_WHEEL_LEVELS - 1; level++)
+	{
+		if(delta < ((uint64_t)1 << LEVEL_SHIFT(level + 1)))
+		{
+			break;
+		}
+	}
+
+	bucket = (int)((when >> LEVEL_SHIFT(level)) & NAT_AGING_WHEEL_MASK);
+	head = &buckets[level][bucket];
+
+	prev[slot] = -1;
+	next[slot] = *head;
+	if(*head != -1)
+	{
+		prev[*head] = slot;
+	}
+	*head = slot;
+
+	bucket_of[slot] = level * NAT_AGING_WHEEL_SIZE + bucket;
+}
+
+void NatAgingWheel::Unlink(int slot)
+{
+	int level = bucket_of[slot] / NAT_AGING_WHEEL_SIZE;
+	int bucket = bucket_of[slot] % NAT_AGING_WHEEL_SIZE;
+
+	if(prev[slot] == -1)
+	{
+		buckets[level][bucket] = next[slot];
+	}
+	else
+	{
+		next[prev[slot]] = next[slot];
+	}
+
+	if(next[slot] != -1)
+	{
+		prev[next[slot]] = prev[slot];
+	}
+
+	bucket_of[slot] = -1;
+}
+
+/*
+ * Spread a higher level's bucket over the levels below, returning the
+ * bucket's index, so the caller knows whether this level has wrapped
+ */
+int NatAgingWheel::Cascade(int level, int bucket)
+{
+	int slot = buckets[level][bucket];
+	int next_slot;
+
+	buckets[level][bucket] = -1;
+
+	for(; slot != -1; slot = next_slot)
+	{
+		next_slot = next[slot];
+		Link(slot);
+	}
+
+	return bucket;
+}
+
+void NatAgingWheel::Schedule(int slot, uint64_t when)
+{
+	if(slot < 0 || slot >= num_entries)
+	{
+		return;
+	}
+
+	if(bucket_of[slot] != -1)
+	{
+		Unlink(slot);
+	}
+
+	expires[slot] = when;
+	Link(slot);
+}
+
+void NatAgingWheel::Cancel(int slot)
+{
+	if(slot < 0 || slot >= num_entries || bucket_of[slot] == -1)
+	{
+		return;
+	}
+
+	Unlink(slot);
+}
+
+int NatAgingWheel::Advance(uint64_t now, int *due)
+{
+	int num_due = 0;
+	int level, bucket, slot;
+
+	if(num_entries == 0)
+	{
+		return 0;
+	}
+
+	while(current <= now)
+	{
+		bucket = (int)(current & NAT_AGING_WHEEL_MASK);
+
+		/* a level is brought down each time the one below it wraps */
+		for(level = 1; bucket == 0 && level < NAT_AGING_WHEEL_LEVELS; level++)
+		{
+			bucket = Cascade(level,
+				(int)((current >> LEVEL_SHIFT(level)) & NAT_AGING_WHEEL_MASK));
+		}
+
+		bucket = (int)(current & NAT_AGING_WHEEL_MASK);
+
+		while((slot = buckets[0][bucket]) != -1)
+		{
+			Unlink(slot);
+
+			/* parked past the wheel's reach, and not yet due */
+			if(expires[slot] > current)
+			{
+				Link(slot);
+				continue;
+			}
+
+			due[num_due++] = slot;
+		}
+
+		current++;
+	}
+
+	return num_due;
+}
+
+uint64_t NatAgingWheel::NextExpiry(uint64_t until)
+{
+	uint64_t when;
+	int level;
+
+	if(num_entries == 0)
+	{
+		return until;
+	}
+
+	for(when = current; when < until; when++)
+	{
+		/*
+		 * What a higher level brings down at a wrap may be due then;
+		 * it is not worth working out whether it is
+		 */
+		for(level = 1; level < NAT_AGING_WHEEL_LEVELS &&
+			((when >> LEVEL_SHIFT(level - 1)) & NAT_AGING_WHEEL_MASK) == 0; level++)
+		{
+			if(buckets[level][(when >> LEVEL_SHIFT(level)) & NAT_AGING_WHEEL_MASK] != -1)
+			{
+				return when;
+			}
+		}
+
+		if(buckets[0][when & NAT_AGING_WHEEL_MASK] != -1)
+		{
+			return when;
+		}
+	}
+
+	return until;
+}
@@ -47,15 +47,68 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 	( strcasesame(mem_type, "HYBRID" ) || \
 	  strcasesame(mem_type, "SRAM" ) )
 
+/* Holds the NatApp cache lock for as long as it is in scope */
+class NatCacheLock
+{
+private:
+	pthread_mutex_t *mutex;
+
+public:
+	NatCacheLock(pthread_mutex_t *m) : mutex(m)
+	{
+		if(pthread_mutex_lock(mutex) != 0)
+		{
+			IPACMERR("unable to lock nat cache\n");
+		}
+	}
+
+	~NatCacheLock()
+	{
+		if(pthread_mutex_unlock(mutex) != 0)
+		{
+			IPACMERR("unable to unlock nat cache\n");
+		}
+	}
+};
+
+static uint64_t AgingNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec;
+}
+
 /* NatApp class Implementation */
 NatApp *NatApp::pInstance = NULL;
 NatApp::NatApp()
 {
+	pthread_mutexattr_t attr;
+
 	max_entries = 0;
 	mem_type = NULL;
 
 	cache = NULL;
 
+	ts_rule_hdls = NULL;
+	ts_values = NULL;
+	ts_cache_idx = NULL;
+
+	clnt_slots = NULL;
+	clnt_rule_hdls = NULL;
+	clnt_rules = NULL;
+
+	ct_deadline = NULL;
+	ct_results = NULL;
+	aging_period = NAT_AGING_MIN_PERIOD;
+
+	/* an aging pass can delete an entry, and adding temp entries adds */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&cache_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
 	nat_table_hdl = 0;
 	pub_ip_addr = 0;
 	pub_mux_id = 0;
@@ -109,6 +162,39 @@ int NatApp::Init(void)
 	IPACMDBG("Allocated %d bytes for config manager nat cache\n", size);
 	memset(cache, 0, size);
 
+	if(cache_idx.Init(cache, max_entries))
+	{
+		IPACMERR("Unable to allocate memory for cache index\n");
+		goto fail;
+	}
+
+	ts_rule_hdls = (uint32_t *)malloc(sizeof(uint32_t) * max_entries);
+	ts_values = (uint32_t *)malloc(sizeof(uint32_t) * max_entries);
+	ts_cache_idx = (int *)malloc(sizeof(int) * max_entries);
+	if(ts_rule_hdls == NULL || ts_values == NULL || ts_cache_idx == NULL)
+	{
+		IPACMERR("Unable to allocate memory for timestamp harvest\n");
+		goto fail;
+	}
+
+	clnt_slots = (int *)malloc(sizeof(int) * max_entries);
+	clnt_rule_hdls = (uint32_t *)malloc(sizeof(uint32_t) * max_entries);
+	clnt_rules = (ipa_nat_ipv4_rule *)malloc(sizeof(ipa_nat_ipv4_rule) * max_entries);
+	if(clnt_slots == NULL || clnt_rule_hdls == NULL || clnt_rules == NULL)
+	{
+		IPACMERR("Unable to allocate memory for per client updates\n");
+		goto fail;
+	}
+
+	ct_deadline = (uint64_t *)calloc(max_entries, sizeof(uint64_t));
+	ct_results = (int *)malloc(sizeof(int) * max_entries);
+	if(ct_deadline == NULL || ct_results == NULL ||
+	   aging.Init(max_entries, AgingNow()))
+	{
+		IPACMERR("Unable to allocate memory for aging\n");
+		goto fail;
+	}
+
 	nALGPort = pConfig->GetAlgPortCnt();
 	if(nALGPort > 0)
 	{
@@ -141,6 +227,21 @@ fail:
 	{
 		free(cache);
 	}
+	free(ts_rule_hdls);
+	free(ts_values);
+	free(ts_cache_idx);
+	ts_rule_hdls = ts_values = NULL;
+	ts_cache_idx = NULL;
+	free(clnt_slots);
+	free(clnt_rule_hdls);
+	free(clnt_rules);
+	clnt_slots = NULL;
+	clnt_rule_hdls = NULL;
+	clnt_rules = NULL;
+	free(ct_deadline);
+	free(ct_results);
+	ct_deadline = NULL;
+	ct_results = NULL;
 	if(pALGPorts != NULL)
 	{
 		free(pALGPorts);
@@ -175,6 +276,7 @@ int NatApp::AddTable(uint32_t pub_ip, uint8_t mux_id)
 	int ret;
 	int cnt = 0;
 	ipa_nat_ipv4_rule nat_rule;
+	NatCacheLock lock(&cache_lock);
 	IPACMDBG_H("%s() %d\n", __FUNCTION__, __LINE__);
 
 	/* Not reset the cache wait it timeout by destroy event */
@@ -192,6 +294,19 @@ int NatApp::AddTable(uint32_t pub_ip, uint8_t mux_id)
 		IPACMERR("unable to create nat table Error:%d\n", ret);
 		return ret;
 	}
+
+	/* let bursts of rule updates and time stamp reads share a clock vote */
+	if(ipa_nat_set_vote_linger(NAT_CLK_VOTE_LINGER_MS))
+	{
+		IPACMERR("unable to set the clock vote linger period\n");
+	}
+
+	/* rather than refuse connections once hash collisions fill it up */
+	if(ipa_nat_set_ddr_grow_limit(NAT_DDR_GROW_FACTOR * max_entries))
+	{
+		IPACMERR("unable to set the nat table grow limit\n");
+	}
+
 	if(IPACM_Iface::ipacmcfg->GetIPAVer() >= IPA_HW_v4_0) {
 		/* modify PDN 0 so it will hold the mux ID in the src metadata field */
 		ipa_nat_pdn_entry entry;
@@ -225,11 +340,13 @@ int NatApp::AddTable(uint32_t pub_ip, uint8_t mux_id)
 				if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
 				{
 					IPACMERR("unable to add the rule delete from cache\n");
-					memset(&cache[cnt], 0, sizeof(cache[cnt]));
+					cache_idx.Remove(cnt);
+					aging.Cancel(cnt);
 					curCnt--;
 					continue;
 				}
 				cache[cnt].enabled = true;
+				StartAging(cnt);
 				/* send connections info to pcie modem only with DL direction */
 				if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP))
 				{
@@ -274,6 +391,7 @@ int NatApp::DeleteTable(uint32_t pub_ip)
 {
 	int cnt = 0;
 	int ret;
+	NatCacheLock lock(&cache_lock);
 	IPACMDBG_H("%s() %d\n", __FUNCTION__, __LINE__);
 
 	CHK_TBL_HDL();
@@ -289,6 +407,8 @@ int NatApp::DeleteTable(uint32_t pub_ip)
 	for(cnt = 0; cnt < max_entries; cnt++)
 	{
 		cache[cnt].enabled = false;
+		/* aged again once restored with the next table */
+		aging.Cancel(cnt);
 		/* send connections del info to pcie modem first */
 		if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
 
@@ -336,21 +456,13 @@ int NatApp::MoveTable(bool to_ddr)
 /* Check for duplicate entries */
 bool NatApp::ChkForDup(const nat_table_entry *rule)
 {
-	int cnt = 0;
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
 
-	for(; cnt < max_entries; cnt++)
+	if(cache_idx.Find(rule) >= 0)
 	{
-		if(cache[cnt].private_ip == rule->private_ip &&
-			 cache[cnt].target_ip == rule->target_ip &&
-			 cache[cnt].private_port ==  rule->private_port  &&
-			 cache[cnt].target_port == rule->target_port &&
-			 cache[cnt].protocol == rule->protocol)
-		{
-			log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
-			rule->target_port,"Duplicate Rule\n");
-			return true;
-		}
+		log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
+		rule->target_port,"Duplicate Rule\n");
+		return true;
 	}
 
 	return false;
@@ -359,56 +471,50 @@ bool NatApp::ChkForDup(const nat_table_entry *rule)
 /* Delete the entry from Nat table on connection close */
 int NatApp::DeleteEntry(const nat_table_entry *rule)
 {
-	int cnt = 0;
+	int cnt;
 	int ret = 0;
+	NatCacheLock lock(&cache_lock);
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
 
 	log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
 	rule->target_port,"for deletion\n");
 
 
-	for(; cnt < max_entries; cnt++)
+	cnt = cache_idx.Find(rule);
+	if(cnt >= 0)
 	{
-		if(cache[cnt].private_ip == rule->private_ip &&
-			 cache[cnt].target_ip == rule->target_ip &&
-			 cache[cnt].private_port ==  rule->private_port  &&
-			 cache[cnt].target_port == rule->target_port &&
-			 cache[cnt].protocol == rule->protocol)
+		if(cache[cnt].enabled == true)
 		{
-
-			if(cache[cnt].enabled == true)
+			/* send connections del info to pcie modem first */
+			if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
 			{
-				/* send connections del info to pcie modem first */
-				if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
+				ret = DelConnection(cache[cnt].rule_id);
+				if(ret)
 				{
-					ret = DelConnection(cache[cnt].rule_id);
-					if(ret)
-					{
-						IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
-					}
-					else
-					{
-						/* save the rule id for deletion */
-						cache[cnt].rule_id = 0;
-					}
+					IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
 				}
-
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+				else
 				{
-					IPACMERR("%s() %d deletion failed\n", __FUNCTION__, __LINE__);
+					/* save the rule id for deletion */
+					cache[cnt].rule_id = 0;
 				}
-
-				IPACMDBG_H("Deleted Nat entry(%d) Successfully\n", cnt);
 			}
-			else
+
+			if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
 			{
-				IPACMDBG_H("Deleted Nat entry(%d) only from cache\n", cnt);
+				IPACMERR("%s() %d deletion failed\n", __FUNCTION__, __LINE__);
 			}
 
-			memset(&cache[cnt], 0, sizeof(cache[cnt]));
-			curCnt--;
-			break;
+			IPACMDBG_H("Deleted Nat entry(%d) Successfully\n", cnt);
 		}
+		else
+		{
+			IPACMDBG_H("Deleted Nat entry(%d) only from cache\n", cnt);
+		}
+
+		cache_idx.Remove(cnt);
+		aging.Cancel(cnt);
+		curCnt--;
 	}
 
 	return 0;
@@ -420,6 +526,7 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 	int cnt = 0;
 	ipa_nat_ipv4_rule nat_rule;
 	int ret = 0;
+	NatCacheLock lock(&cache_lock);
 
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
 
@@ -445,19 +552,9 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 
 	if(!ChkForDup(rule))
 	{
-		for(; cnt < max_entries; cnt++)
-		{
-			if(cache[cnt].private_ip == 0 &&
-				 cache[cnt].target_ip == 0 &&
-				 cache[cnt].private_port == 0  &&
-				 cache[cnt].target_port == 0 &&
-				 cache[cnt].protocol == 0)
-			{
-				break;
-			}
-		}
+		cnt = cache_idx.NextFree();
 
-		if(max_entries == cnt)
+		if(cnt < 0)
 		{
 			IPACMERR("Error: Unable to add, reached maximum rules\n");
 			return -1;
@@ -514,6 +611,7 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 			cache[cnt].timestamp = 0;
 			cache[cnt].public_port = rule->public_port;
 			cache[cnt].dst_nat = rule->dst_nat;
+			cache_idx.Insert(cnt);
 			curCnt++;
 		}
 
@@ -526,6 +624,7 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 
 	if(cache[cnt].enabled == true)
 	{
+		StartAging(cnt);
 		IPACMDBG_H("Added rule(%d) successfully\n", cnt);
 	}
   else
@@ -666,35 +765,20 @@ fail:
 	return res;
 }
 
-void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
-{
-#ifdef FEATURE_IPACM_HAL
-	IOffloadManager::ConntrackTimeoutUpdater::natTimeoutUpdate_t entry;
-	IPACM_OffloadManager* OffloadMng;
-#endif
-	iptodot("Private IP:", rule->private_ip);
-	iptodot("Target IP:",  rule->target_ip);
-	IPACMDBG("Private Port: %d, Target Port: %d\n", rule->private_port, rule->target_port);
-
 #ifndef FEATURE_IPACM_HAL
-	int ret;
-	if(!ct_hdl)
-	{
-		ct_hdl = nfct_open(CONNTRACK, 0);
-		if(!ct_hdl)
-		{
-			PERROR("nfct_open");
-			return;
-		}
-	}
-
+/*
+ * Describe the connection of a rule, with the timeout to give it, in
+ * ct for a conntrack update
+ */
+int NatApp::SetCTAttrs(const nat_table_entry *rule)
+{
 	if(!ct)
 	{
 		ct = nfct_new();
 		if(!ct)
 		{
 			PERROR("nfct_new");
-			return;
+			return -1;
 		}
 	}
 
@@ -739,48 +823,89 @@ void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
 	IPACMDBG("updating %d connection with time: %d\n",
 					 rule->protocol, nfct_get_attr_u32(ct, ATTR_TIMEOUT));
 
-	ret = nfct_query(ct_hdl, NFCT_Q_UPDATE, ct);
-	if(ret == -1)
-	{
-		IPACMERR("unable to update time stamp");
-		DeleteEntry(rule);
-	}
-	else
-	{
-		rule->timestamp = new_ts;
-		IPACMDBG("Updated time stamp successfully\n");
-	}
+	return 0;
+}
 #else
+/*
+ * Describe the connection of a rule in entry, for the framework to
+ * refresh in conntrack
+ */
+void NatApp::SetCTUpdate(const nat_table_entry *rule,
+	IOffloadManager::ConntrackTimeoutUpdater::natTimeoutUpdate_t *entry)
+{
 	if(rule->protocol == IPPROTO_UDP)
 	{
-		entry.proto = IOffloadManager::ConntrackTimeoutUpdater::UDP;;
+		entry->proto = IOffloadManager::ConntrackTimeoutUpdater::UDP;
 	}
 	else
 	{
-		entry.proto = IOffloadManager::ConntrackTimeoutUpdater::TCP;
+		entry->proto = IOffloadManager::ConntrackTimeoutUpdater::TCP;
 	}
 
 	if(rule->dst_nat == false)
 	{
-		entry.src.ipAddr = htonl(rule->private_ip);
-		entry.src.port = rule->private_port;
-		entry.dst.ipAddr = htonl(rule->target_ip);
-		entry.dst.port = rule->target_port;
+		entry->src.ipAddr = htonl(rule->private_ip);
+		entry->src.port = rule->private_port;
+		entry->dst.ipAddr = htonl(rule->target_ip);
+		entry->dst.port = rule->target_port;
 		IPACMDBG("dst nat is not set\n");
 	}
 	else
 	{
-		entry.src.ipAddr = htonl(rule->target_ip);
-		entry.src.port = rule->target_port;
-		entry.dst.ipAddr = htonl(pub_ip_addr);
-		entry.dst.port = rule->public_port;
+		entry->src.ipAddr = htonl(rule->target_ip);
+		entry->src.port = rule->target_port;
+		entry->dst.ipAddr = htonl(pub_ip_addr);
+		entry->dst.port = rule->public_port;
 		IPACMDBG("dst nat is set\n");
 	}
 
-	iptodot("Source IP:", entry.src.ipAddr);
-	iptodot("Destination IP:",  entry.dst.ipAddr);
+	iptodot("Source IP:", entry->src.ipAddr);
+	iptodot("Destination IP:",  entry->dst.ipAddr);
 	IPACMDBG("Source Port: %d, Destination Port: %d\n",
-					entry.src.port, entry.dst.port);
+					entry->src.port, entry->dst.port);
+}
+#endif
+
+void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
+{
+#ifdef FEATURE_IPACM_HAL
+	IOffloadManager::ConntrackTimeoutUpdater::natTimeoutUpdate_t entry;
+	IPACM_OffloadManager* OffloadMng;
+#endif
+	iptodot("Private IP:", rule->private_ip);
+	iptodot("Target IP:",  rule->target_ip);
+	IPACMDBG("Private Port: %d, Target Port: %d\n", rule->private_port, rule->target_port);
+
+#ifndef FEATURE_IPACM_HAL
+	int ret;
+	if(!ct_hdl)
+	{
+		ct_hdl = nfct_open(CONNTRACK, 0);
+		if(!ct_hdl)
+		{
+			PERROR("nfct_open");
+			return;
+		}
+	}
+
+	if(SetCTAttrs(rule))
+	{
+		return;
+	}
+
+	ret = nfct_query(ct_hdl, NFCT_Q_UPDATE, ct);
+	if(ret == -1)
+	{
+		IPACMERR("unable to update time stamp");
+		DeleteEntry(rule);
+	}
+	else
+	{
+		rule->timestamp = new_ts;
+		IPACMDBG("Updated time stamp successfully\n");
+	}
+#else
+	SetCTUpdate(rule, &entry);
 
 	OffloadMng = IPACM_OffloadManager::GetInstance();
 	if (OffloadMng->touInstance == NULL) {
@@ -794,14 +919,151 @@ void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
 	return;
 }
 
-void NatApp::UpdateUDPTimeStamp()
+/*
+ * Refresh in conntrack the connections of the first num slots in
+ * ts_cache_idx, whose rules have the time stamps in ts_values.  A
+ * connection conntrack no longer has is deleted.  Those that can't be
+ * refreshed together are tried one at a time.  With the HAL, the
+ * framework is handed them all in one callback.
+ */
+void NatApp::UpdateCTTimeouts(int num)
 {
 	int cnt;
-	uint32_t ts;
-	bool read_to = false;
+	nat_table_entry *entry;
+
+#ifndef FEATURE_IPACM_HAL
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		entry = &cache[ts_cache_idx[cnt]];
+
+		iptodot("Private IP:", entry->private_ip);
+		iptodot("Target IP:",  entry->target_ip);
+		IPACMDBG("Private Port: %d, Target Port: %d\n", entry->private_port, entry->target_port);
+
+		if(SetCTAttrs(entry))
+		{
+			ct_results[cnt] = NAT_CT_BATCH_UNKNOWN;
+			continue;
+		}
+
+		ct_batch.Update(ct, cnt, ct_results);
+	}
+
+	if(ct_batch.Flush())
+	{
+		IPACMERR("unable to update time stamps of some of %d connections\n", num);
+	}
+
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		entry = &cache[ts_cache_idx[cnt]];
+
+		if(ct_results[cnt] == 0)
+		{
+			entry->timestamp = ts_values[cnt];
+		}
+		else if(ct_results[cnt] < 0)
+		{
+			IPACMERR("unable to update time stamp: %d\n", ct_results[cnt]);
+			DeleteEntry(entry);
+		}
+		else
+		{
+			UpdateCTUdpTs(entry, ts_values[cnt]);
+		}
+	}
+#else
+	IPACM_OffloadManager* OffloadMng = IPACM_OffloadManager::GetInstance();
+
+	if (OffloadMng->touInstance == NULL) {
+		IPACMERR("OffloadMng->touInstance is NULL, can't forward to framework!\n");
+		return;
+	}
+
+	ct_updates.resize(num);
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		entry = &cache[ts_cache_idx[cnt]];
+
+		iptodot("Private IP:", entry->private_ip);
+		iptodot("Target IP:",  entry->target_ip);
+		IPACMDBG("Private Port: %d, Target Port: %d\n", entry->private_port, entry->target_port);
+
+		SetCTUpdate(entry, &ct_updates[cnt]);
+	}
+
+	/* the whole pass is handed over at once */
+	OffloadMng->touInstance->updateTimeouts(ct_updates);
+	IPACMDBG("Updated time stamps of %d connections\n", num);
+
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		cache[ts_cache_idx[cnt]].timestamp = ts_values[cnt];
+	}
+#endif
+	return;
+}
+
+/*
+ * Have a newly enabled connection checked at the next pass or two.  Its
+ * conntrack deadline is unknown until it has been refreshed.
+ */
+void NatApp::StartAging(int slot)
+{
+	ct_deadline[slot] = 0;
+	aging.Schedule(slot, AgingNow() + aging_period);
+}
+
+/*
+ * Only the connections the aging wheel has due are checked against
+ * their rules' time stamps.  One whose rule has been hit is refreshed
+ * in conntrack, then left alone until shortly before that refresh runs
+ * out.  One whose rule hasn't, is checked each pass while its deadline
+ * is near or unknown, until conntrack lets it go.  Returns the seconds
+ * until the next pass.
+ */
+uint32_t NatApp::UpdateUDPTimeStamp()
+{
+	int cnt, num_due, num_hdls, num_changed = 0, slot;
+	uint32_t ts, num_moved = 0, timeout, sleep_secs;
+	uint64_t now, next;
 	bool keep_awake;
+	NatCacheLock lock(&cache_lock);
+
+	now = AgingNow();
+
+	/*
+	 * Gather the handles of those due, then read all of their
+	 * timestamps with a single call into the nat library.  A slot
+	 * disabled since it was scheduled is rescheduled when enabled.
+	 */
+	num_due = aging.Advance(now, ts_cache_idx);
+
+	num_hdls = 0;
+	for(cnt = 0; cnt < num_due; cnt++)
+	{
+		slot = ts_cache_idx[cnt];
 
-	keep_awake = ( max_entries && SRAM_IN_USE() && ipa_nat_is_sram_supported() );
+		if(cache[slot].enabled == true &&
+		   (cache[slot].private_ip != cache[slot].public_ip))
+		{
+			ts_rule_hdls[num_hdls] = cache[slot].rule_hdl;
+			/* a handle that can't be read then looks unchanged */
+			ts_values[num_hdls] = cache[slot].timestamp;
+			ts_cache_idx[num_hdls] = slot;
+			num_hdls++;
+		}
+	}
+
+	/*
+	 * Nothing due, nothing to wake the IPA for
+	 */
+	if(num_hdls == 0)
+	{
+		goto next_pass;
+	}
+
+	keep_awake = ( SRAM_IN_USE() && ipa_nat_is_sram_supported() );
 
 	if ( keep_awake )
 	{
@@ -810,40 +1072,103 @@ void NatApp::UpdateUDPTimeStamp()
 		if ( ipa_nat_vote_clock(IPA_APP_CLK_VOTE) != 0 )
 		{
 			IPACMERR("Voting clock on failed\n");
-			return;
+			for(cnt = 0; cnt < num_hdls; cnt++)
+			{
+				aging.Schedule(ts_cache_idx[cnt], now + aging_period);
+			}
+			num_hdls = 0;
+			goto next_pass;
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	if(ipa_nat_query_timestamps(nat_table_hdl, ts_rule_hdls, num_hdls, ts_values) < 0)
 	{
-		ts = 0;
-		if(cache[cnt].enabled == true &&
-		   (cache[cnt].private_ip != cache[cnt].public_ip))
+		IPACMERR("unable to retrieve timeout for some of %d rules\n", num_hdls);
+	}
+
+	/*
+	 * Those whose rules haven't been hit are set aside, so that the
+	 * rest, at the front, can be refreshed in conntrack together.
+	 */
+	for(cnt = 0; cnt < num_hdls; cnt++)
+	{
+		slot = ts_cache_idx[cnt];
+		nat_table_entry *entry = &cache[slot];
+
+		ts = ts_values[cnt];
+
+		if(entry->timestamp == ts)
 		{
-			IPACMDBG("\n");
-			if(ipa_nat_query_timestamp(nat_table_hdl, cache[cnt].rule_hdl, &ts) < 0)
+			IPACMDBG("No Change in Time Stamp: cahce:%d, ipahw:%d\n",
+							                  entry->timestamp, ts);
+
+			if(ct_deadline[slot] > now + NAT_AGING_GUARD)
 			{
-				IPACMERR("unable to retrieve timeout for rule hanle: %d\n", cache[cnt].rule_hdl);
-				continue;
+				aging.Schedule(slot, ct_deadline[slot] - NAT_AGING_GUARD);
 			}
-
-			if(cache[cnt].timestamp == ts)
+			else
 			{
-				IPACMDBG("No Change in Time Stamp: cahce:%d, ipahw:%d\n",
-								                  cache[cnt].timestamp, ts);
-				continue;
+				aging.Schedule(slot, now + aging_period);
 			}
+			continue;
+		}
 
-			if (read_to == false) {
-				read_to = true;
-				Read_TcpUdp_Timeout();
-			}
+		ts_cache_idx[num_changed] = slot;
+		ts_values[num_changed] = ts;
+		num_changed++;
+	}
 
-			UpdateCTUdpTs(&cache[cnt], ts);
-		} /* end of outer if */
+	if(num_changed > 0)
+	{
+		Read_TcpUdp_Timeout();
+		UpdateCTTimeouts(num_changed);
+	}
 
+	for(cnt = 0; cnt < num_changed; cnt++)
+	{
+		slot = ts_cache_idx[cnt];
+		nat_table_entry *entry = &cache[slot];
+
+		if(entry->enabled == false)
+		{
+			/* conntrack no longer has it, so nor does the cache */
+			continue;
+		}
+
+		if(entry->timestamp != ts_values[cnt])
+		{
+			/* not refreshed, so try again next pass */
+			aging.Schedule(slot, now + aging_period);
+			continue;
+		}
+
+		timeout = (entry->protocol == IPPROTO_UDP) ? udp_timeout : tcp_timeout;
+		ct_deadline[slot] = now + timeout;
+
+		if(timeout > NAT_AGING_GUARD + aging_period)
+		{
+			aging.Schedule(slot, ct_deadline[slot] - NAT_AGING_GUARD);
+		}
+		else
+		{
+			aging.Schedule(slot, now + aging_period);
+		}
 	} /* end of for loop */
 
+	/*
+	 * Otherwise idle, so shorten the lists that rule deletion has
+	 * left behind in the table.  Rule handles are unaffected.
+	 */
+	if(nat_table_hdl &&
+	   ipa_nat_compact_ipv4_tbl(nat_table_hdl, NAT_COMPACT_MAX_MOVES, &num_moved) < 0)
+	{
+		IPACMERR("unable to compact nat table\n");
+	}
+	else if(num_moved > 0)
+	{
+		IPACMDBG("Compaction moved %u nat rules\n", num_moved);
+	}
+
 	if ( keep_awake )
 	{
 		IPACMDBG("Voting clock off\n");
@@ -853,6 +1178,34 @@ void NatApp::UpdateUDPTimeStamp()
 			IPACMERR("Voting clock off failed\n");
 		}
 	}
+
+next_pass:
+	/*
+	 * A fuller table makes for costlier passes, so they are spaced
+	 * out; a pass that found most of its connections busy suggests
+	 * the rest are worth looking at sooner.
+	 */
+	aging_period = NAT_AGING_MIN_PERIOD +
+		((NAT_AGING_MAX_PERIOD - NAT_AGING_MIN_PERIOD) * curCnt) / max_entries;
+
+	if(num_hdls > 0 && num_changed * 2 > num_hdls)
+	{
+		aging_period = (aging_period / 2 > NAT_AGING_MIN_PERIOD) ?
+			aging_period / 2 : NAT_AGING_MIN_PERIOD;
+	}
+
+	/*
+	 * Sleep until something falls due, for no longer than the longest
+	 * period, so that an idle table wakes no more often than it did
+	 * before the wheel
+	 */
+	next = aging.NextExpiry(now + NAT_AGING_MAX_PERIOD);
+	sleep_secs = (next > now) ? (uint32_t)(next - now) : 1;
+
+	IPACMDBG("Checked %d of %d due, %d changed, next pass in %u seconds\n",
+			 num_hdls, num_due, num_changed, sleep_secs);
+
+	return sleep_secs;
 }
 
 bool NatApp::isAlgPort(uint8_t proto, uint16_t port)
@@ -888,7 +1241,8 @@ bool NatApp::isPwrSaveIf(uint32_t ip_addr)
 
 int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 {
-	int cnt, ret;
+	int cnt, num_slots;
+	NatCacheLock lock(&cache_lock);
 	IPACMDBG_H("Received IP address: 0x%x\n", client_lan_ip);
 
 	if(client_lan_ip == INVALID_IP_ADDR)
@@ -916,44 +1270,19 @@ int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
-	{
-		if(cache[cnt].private_ip == client_lan_ip &&
-			 cache[cnt].enabled == true)
-		{
-			/* send connections del info to pcie modem first */
-			if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
-			{
-				ret = DelConnection(cache[cnt].rule_id);
-				if(ret)
-				{
-					IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
-				}
-				else
-				{
-					/* save the rule id for deletion */
-					cache[cnt].rule_id = 0;
-				}
-			}
-
-			if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
-			{
-				IPACMERR("unable to delete the rule\n");
-				continue;
-			}
+	num_slots = cache_idx.FindByIp(NAT_CACHE_PRIVATE_IP, client_lan_ip, clnt_slots);
 
-			cache[cnt].enabled = false;
-			cache[cnt].rule_hdl = 0;
-		}
-	}
+	cnt = DelClntRules(num_slots);
+	IPACMDBG("Disabled %d of the client's %d entries\n", cnt, num_slots);
 
 	return 0;
 }
 
 int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 {
-	int cnt, ret;
-	ipa_nat_ipv4_rule nat_rule;
+	int cnt, num_slots, num_rules = 0, ret;
+	ipa_nat_ipv4_rule *nat_rule;
+	NatCacheLock lock(&cache_lock);
 
 	IPACMDBG_H("Received ip address: 0x%x\n", client_lan_ip);
 
@@ -972,54 +1301,85 @@ int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	/* the client's cached entries, to be added back in one go */
+	num_slots = cache_idx.FindByIp(NAT_CACHE_PRIVATE_IP, client_lan_ip, clnt_slots);
+
+	for(cnt = 0; cnt < num_slots; cnt++)
+	{
+		const nat_table_entry *entry = &cache[clnt_slots[cnt]];
+
+		IPACMDBG("cache (%d): enable %d, ip 0x%x\n", clnt_slots[cnt], entry->enabled, entry->private_ip);
+
+		if(entry->enabled == true)
+		{
+			continue;
+		}
+
+		nat_rule = &clnt_rules[num_rules];
+		memset(nat_rule, 0 , sizeof(*nat_rule));
+		nat_rule->private_ip = entry->private_ip;
+		nat_rule->target_ip = entry->target_ip;
+		nat_rule->target_port = entry->target_port;
+		nat_rule->private_port = entry->private_port;
+		nat_rule->public_port = entry->public_port;
+		nat_rule->protocol = entry->protocol;
+
+		clnt_slots[num_rules++] = clnt_slots[cnt];
+	}
+
+	if(num_rules == 0)
 	{
-		IPACMDBG("cache (%d): enable %d, ip 0x%x\n", cnt, cache[cnt].enabled, cache[cnt].private_ip);
+		return -1;
+	}
 
-		if(cache[cnt].private_ip == client_lan_ip &&
-			 cache[cnt].enabled == false)
+	/* a rule that could not be added is left with a zero handle */
+	memset(clnt_rule_hdls, 0, sizeof(uint32_t) * num_rules);
+
+	if(ipa_nat_add_ipv4_rules(nat_table_hdl, clnt_rules, num_rules, clnt_rule_hdls) < 0)
+	{
+		IPACMERR("unable to add some of %d rules\n", num_rules);
+	}
+
+	for(cnt = 0; cnt < num_rules; cnt++)
+	{
+		int slot = clnt_slots[cnt];
+
+		nat_rule = &clnt_rules[cnt];
+
+		if(clnt_rule_hdls[cnt] == 0)
+		{
+			IPACMERR("unable to add the rule delete from cache\n");
+			cache_idx.Remove(slot);
+			aging.Cancel(slot);
+			curCnt--;
+			continue;
+		}
+		cache[slot].rule_hdl = clnt_rule_hdls[cnt];
+		cache[slot].enabled = true;
+		StartAging(slot);
+		/* send connections info to pcie modem only with DL direction */
+		if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[slot].dst_nat == true || cache[slot].protocol == IPPROTO_TCP))
 		{
-			memset(&nat_rule, 0 , sizeof(nat_rule));
-			nat_rule.private_ip = cache[cnt].private_ip;
-			nat_rule.target_ip = cache[cnt].target_ip;
-			nat_rule.target_port = cache[cnt].target_port;
-			nat_rule.private_port = cache[cnt].private_port;
-			nat_rule.public_port = cache[cnt].public_port;
-			nat_rule.protocol = cache[cnt].protocol;
-
-			if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
+			ret = AddConnection(&cache[slot]);
+			if(ret > 0)
 			{
-				IPACMERR("unable to add the rule delete from cache\n");
-				memset(&cache[cnt], 0, sizeof(cache[cnt]));
-				curCnt--;
-				continue;
+				/* save the rule id for deletion */
+				cache[slot].rule_id = ret;
+				IPACMDBG_H("rule-id(%d)\n", cache[slot].rule_id);
 			}
-			cache[cnt].enabled = true;
-			/* send connections info to pcie modem only with DL direction */
-			if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP))
+			else
 			{
-				ret = AddConnection(&cache[cnt]);
-				if(ret > 0)
-				{
-					/* save the rule id for deletion */
-					cache[cnt].rule_id = ret;
-					IPACMDBG_H("rule-id(%d)\n", cache[cnt].rule_id);
-				}
-				else
-				{
-					IPACMERR("unable to add Connection to pcie modem: error:%d\n", ret);
-					cache[cnt].rule_id = 0;
-				}
+				IPACMERR("unable to add Connection to pcie modem: error:%d\n", ret);
+				cache[slot].rule_id = 0;
 			}
-
-			IPACMDBG("On power reset added below rule successfully\n");
-			iptodot("Private IP", nat_rule.private_ip);
-			iptodot("Target IP", nat_rule.target_ip);
-			IPACMDBG("Private Port:%d \t Target Port: %d\t", nat_rule.private_port, nat_rule.target_port);
-			IPACMDBG("Public Port:%d\n", nat_rule.public_port);
-			IPACMDBG("protocol: %d\n", nat_rule.protocol);
-
 		}
+
+		IPACMDBG("On power reset added below rule successfully\n");
+		iptodot("Private IP", nat_rule->private_ip);
+		iptodot("Target IP", nat_rule->target_ip);
+		IPACMDBG("Private Port:%d \t Target Port: %d\t", nat_rule->private_port, nat_rule->target_port);
+		IPACMDBG("Public Port:%d\n", nat_rule->public_port);
+		IPACMDBG("protocol: %d\n", nat_rule->protocol);
 	}
 
 	return -1;
@@ -1038,6 +1398,7 @@ uint32_t NatApp::GetTableHdl(uint32_t in_ip_addr)
 void NatApp::AddTempEntry(const nat_table_entry *new_entry)
 {
 	int cnt;
+	NatCacheLock lock(&cache_lock);
 
 	IPACMDBG("Received below Temp Nat entry\n");
 	iptodot("Private IP", new_entry->private_ip);
@@ -1088,6 +1449,7 @@ void NatApp::AddTempEntry(const nat_table_entry *new_entry)
 void NatApp::DeleteTempEntry(const nat_table_entry *entry)
 {
 	int cnt;
+	NatCacheLock lock(&cache_lock);
 
 	IPACMDBG("Received below nat entry\n");
 	iptodot("Private IP", entry->private_ip);
@@ -1118,6 +1480,7 @@ void NatApp::FlushTempEntries(uint32_t ip_addr, bool isAdd,
 {
 	int cnt;
 	int ret;
+	NatCacheLock lock(&cache_lock);
 
 	IPACMDBG_H("Received below with isAdd:%d ", isAdd);
 	iptodot("IP Address: ", ip_addr);
@@ -1154,9 +1517,59 @@ void NatApp::FlushTempEntries(uint32_t ip_addr, bool isAdd,
 	return;
 }
 
+/*
+ * Delete the NAT rules of the enabled entries among the first num_slots
+ * of clnt_slots, keeping the entries cached.  The rules all go in one
+ * batch.  Returns how many there were.
+ */
+int NatApp::DelClntRules(int num_slots)
+{
+	int cnt, slot, num_hdls = 0, ret;
+
+	for(cnt = 0; cnt < num_slots; cnt++)
+	{
+		slot = clnt_slots[cnt];
+
+		if(cache[slot].enabled == false)
+		{
+			continue;
+		}
+
+		/* send connections del info to pcie modem first */
+		if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[slot].dst_nat == true || cache[slot].protocol == IPPROTO_TCP) && (cache[slot].rule_id > 0))
+		{
+			ret = DelConnection(cache[slot].rule_id);
+			if(ret)
+			{
+				IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
+			}
+			else
+			{
+				/* save the rule id for deletion */
+				cache[slot].rule_id = 0;
+			}
+		}
+
+		clnt_rule_hdls[num_hdls++] = cache[slot].rule_hdl;
+
+		cache[slot].enabled = false;
+		aging.Cancel(slot);
+		cache[slot].rule_hdl = 0;
+	}
+
+	if(num_hdls > 0 &&
+	   ipa_nat_del_ipv4_rules(nat_table_hdl, clnt_rule_hdls, num_hdls) < 0)
+	{
+		IPACMERR("unable to delete some of %d rules\n", num_hdls);
+	}
+
+	return num_hdls;
+}
+
 int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 {
-	int cnt, tmp = 0, ret;
+	int cnt, num_slots, tmp;
+	NatCacheLock lock(&cache_lock);
 	IPACMDBG_H("Received IP address: 0x%x\n", ip_addr);
 
 	if(ip_addr == INVALID_IP_ADDR)
@@ -1175,42 +1588,9 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
-	{
-		if(cache[cnt].private_ip == ip_addr)
-		{
-			if(cache[cnt].enabled == true)
-			{
-				/* send connections del info to pcie modem first */
-				if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
-				{
-					ret = DelConnection(cache[cnt].rule_id);
-					if(ret)
-					{
-						IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
-					}
-					else
-					{
-						/* save the rule id for deletion */
-						cache[cnt].rule_id = 0;
-					}
-				}
+	num_slots = cache_idx.FindByIp(NAT_CACHE_PRIVATE_IP, ip_addr, clnt_slots);
 
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
-				{
-					IPACMERR("unable to delete the rule\n");
-					continue;
-				}
-				else
-				{
-					IPACMDBG("won't delete the rule\n");
-					cache[cnt].enabled = false;
-					tmp++;
-				}
-			}
-			IPACMDBG("won't delete the rule for entry %d, enabled %d\n",cnt, cache[cnt].enabled);
-		}
-	}
+	tmp = DelClntRules(num_slots);
 
 	IPACMDBG("Deleted (but cached) %d entries\n", tmp);
 	return 0;
@@ -1218,7 +1598,8 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 
 int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 {
-	int cnt, tmp = curCnt, ret;
+	int cnt, num_slots;
+	NatCacheLock lock(&cache_lock);
 	IPACMDBG_H("Received IP address: 0x%x\n", ip_addr);
 
 	if(ip_addr == INVALID_IP_ADDR)
@@ -1227,47 +1608,25 @@ int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 		return -1;
 	}
 
+	num_slots = cache_idx.FindByIp(NAT_CACHE_TARGET_IP, ip_addr, clnt_slots);
 
-	for(cnt = 0; cnt < max_entries; cnt++)
-	{
-		if(cache[cnt].target_ip == ip_addr)
-		{
-			if(cache[cnt].enabled == true)
-			{
-				/* send connections del info to pcie modem first */
-				if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
-				{
-					ret = DelConnection(cache[cnt].rule_id);
-					if(ret)
-					{
-						IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
-					}
-					else
-					{
-						/* save the rule id for deletion */
-						cache[cnt].rule_id = 0;
-					}
-				}
-
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
-				{
-					IPACMERR("unable to delete the rule\n");
-					continue;
-				}
-			}
+	DelClntRules(num_slots);
 
-			memset(&cache[cnt], 0, sizeof(cache[cnt]));
-			curCnt--;
-		}
+	for(cnt = 0; cnt < num_slots; cnt++)
+	{
+		cache_idx.Remove(clnt_slots[cnt]);
+		aging.Cancel(clnt_slots[cnt]);
+		curCnt--;
 	}
 
-	IPACMDBG("Deleted %d entries\n", (tmp - curCnt));
+	IPACMDBG("Deleted %d entries\n", num_slots);
 	return 0;
 }
 
 void NatApp::CacheEntry(const nat_table_entry *rule)
 {
 	int cnt;
+	NatCacheLock lock(&cache_lock);
 
 	if(rule->private_ip == 0 ||
 		 rule->target_ip == 0 ||
@@ -1281,19 +1640,9 @@ void NatApp::CacheEntry(const nat_table_entry *rule)
 
 	if(!ChkForDup(rule))
 	{
-		for(cnt=0; cnt < max_entries; cnt++)
-		{
-			if(cache[cnt].private_ip == 0 &&
-				 cache[cnt].target_ip == 0 &&
-				 cache[cnt].private_port == 0  &&
-				 cache[cnt].target_port == 0 &&
-				 cache[cnt].protocol == 0)
-			{
-				break;
-			}
-		}
+		cnt = cache_idx.NextFree();
 
-		if(max_entries == cnt)
+		if(cnt < 0)
 		{
 			IPACMERR("Error: Unable to add, reached maximum rules\n");
 			return;
@@ -1311,6 +1660,7 @@ void NatApp::CacheEntry(const nat_table_entry *rule)
 			cache[cnt].public_port = rule->public_port;
 			cache[cnt].public_ip = rule->public_ip;
 			cache[cnt].dst_nat = rule->dst_nat;
+			cache_idx.Insert(cnt);
 			curCnt++;
 		}
 
@@ -0,0 +1,310 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_Conntrack_NATCache.cpp
+
+	@brief
+	Hash index and free list over the NatApp connection cache
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "IPACM_Conntrack_NATCache.h"
+
+NatCacheIndex::NatCacheIndex()
+{
+	entries = NULL;
+	num_entries = 0;
+
+	buckets = NULL;
+	links = NULL;
+	bucket_mask = 0;
+
+	free_head = -1;
+
+	for(int key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+	{
+		ip_buckets[key] = NULL;
+		ip_prev[key] = NULL;
+		ip_next[key] = NULL;
+	}
+}
+
+NatCacheIndex::~NatCacheIndex()
+{
+	free(buckets);
+	free(links);
+
+	for(int key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+	{
+		free(ip_buckets[key]);
+		free(ip_prev[key]);
+		free(ip_next[key]);
+	}
+}
+
+int NatCacheIndex::Init(nat_table_entry *cache, int max_entries)
+{
+	uint32_t num_buckets = 1;
+	bool no_mem = false;
+	int cnt, key;
+
+	if(cache == NULL || max_entries <= 0)
+	{
+		return -1;
+	}
+
+	/* no more than one connection per bucket when full */
+	while(num_buckets < (uint32_t)max_entries)
+	{
+		num_buckets <<= 1;
+	}
+
+	buckets = (int *)malloc(sizeof(int) * num_buckets);
+	links = (int *)malloc(sizeof(int) * max_entries);
+	no_mem = (buckets == NULL || links == NULL);
+
+	for(key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+	{
+		ip_buckets[key] = (int *)malloc(sizeof(int) * num_buckets);
+		ip_prev[key] = (int *)malloc(sizeof(int) * max_entries);
+		ip_next[key] = (int *)malloc(sizeof(int) * max_entries);
+		no_mem = no_mem ||
+			(ip_buckets[key] == NULL || ip_prev[key] == NULL || ip_next[key] == NULL);
+	}
+
+	if(no_mem)
+	{
+		free(buckets);
+		free(links);
+		buckets = links = NULL;
+		for(key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+		{
+			free(ip_buckets[key]);
+			free(ip_prev[key]);
+			free(ip_next[key]);
+			ip_buckets[key] = ip_prev[key] = ip_next[key] = NULL;
+		}
+		return -1;
+	}
+
+	for(cnt = 0; cnt < (int)num_buckets; cnt++)
+	{
+		buckets[cnt] = -1;
+		for(key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+		{
+			ip_buckets[key][cnt] = -1;
+		}
+	}
+
+	/* lowest slots first, as the cache has always been filled */
+	for(cnt = 0; cnt < max_entries; cnt++)
+	{
+		links[cnt] = cnt + 1;
+	}
+	links[max_entries - 1] = -1;
+
+	entries = cache;
+	num_entries = max_entries;
+	bucket_mask = num_buckets - 1;
+	free_head = 0;
+
+	return 0;
+}
+
+uint32_t NatCacheIndex::Hash(const nat_table_entry *rule) const
+{
+	uint32_t h;
+
+	h  = rule->private_ip * 0x9E3779B1;
+	h ^= rule->target_ip + 0x7F4A7C15 + (h << 6) + (h >> 2);
+	h ^= (((uint32_t)rule->private_port << 16) | rule->target_port) + (h << 6) + (h >> 2);
+	h ^= rule->protocol;
+
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+
+	return h & bucket_mask;
+}
+
+uint32_t NatCacheIndex::HashIp(uint32_t ip_addr) const
+{
+	uint32_t h = ip_addr * 0x9E3779B1;
+
+	h ^= h >> 16;
+
+	return h & bucket_mask;
+}
+
+uint32_t NatCacheIndex::EntryIp(int key, int slot) const
+{
+	return (key == NAT_CACHE_PRIVATE_IP) ?
+		entries[slot].private_ip : entries[slot].target_ip;
+}
+
+void NatCacheIndex::LinkIp(int key, int slot)
+{
+	int *head = &ip_buckets[key][HashIp(EntryIp(key, slot))];
+
+	ip_prev[key][slot] = -1;
+	ip_next[key][slot] = *head;
+	if(*head != -1)
+	{
+		ip_prev[key][*head] = slot;
+	}
+	*head = slot;
+}
+
+void NatCacheIndex::UnlinkIp(int key, int slot)
+{
+	int prev = ip_prev[key][slot];
+	int next = ip_next[key][slot];
+
+	if(prev == -1)
+	{
+		ip_buckets[key][HashIp(EntryIp(key, slot))] = next;
+	}
+	else
+	{
+		ip_next[key][prev] = next;
+	}
+
+	if(next != -1)
+	{
+		ip_prev[key][next] = prev;
+	}
+}
+
+bool NatCacheIndex::SameTuple(const nat_table_entry *a, const nat_table_entry *b) const
+{
+	return (a->private_ip == b->private_ip &&
+			a->target_ip == b->target_ip &&
+			a->private_port == b->private_port &&
+			a->target_port == b->target_port &&
+			a->protocol == b->protocol);
+}
+
+int NatCacheIndex::Find(const nat_table_entry *rule) const
+{
+	int cnt;
+
+	if(buckets == NULL)
+	{
+		return -1;
+	}
+
+	for(cnt = buckets[Hash(rule)]; cnt != -1; cnt = links[cnt])
+	{
+		if(SameTuple(&entries[cnt], rule))
+		{
+			return cnt;
+		}
+	}
+
+	return -1;
+}
+
+int NatCacheIndex::NextFree() const
+{
+	return free_head;
+}
+
+void NatCacheIndex::Insert(int slot)
+{
+	uint32_t bucket;
+
+	if(slot < 0 || slot != free_head)
+	{
+		return;
+	}
+
+	free_head = links[slot];
+
+	bucket = Hash(&entries[slot]);
+	links[slot] = buckets[bucket];
+	buckets[bucket] = slot;
+
+	for(int key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+	{
+		LinkIp(key, slot);
+	}
+}
+
+void NatCacheIndex::Remove(int slot)
+{
+	int *prev;
+
+	if(slot < 0 || slot >= num_entries)
+	{
+		return;
+	}
+
+	for(prev = &buckets[Hash(&entries[slot])]; *prev != slot; prev = &links[*prev])
+	{
+		if(*prev == -1)
+		{
+			/* not holding a connection, so already free */
+			return;
+		}
+	}
+
+	*prev = links[slot];
+
+	for(int key = 0; key < NAT_CACHE_NUM_IP_KEYS; key++)
+	{
+		UnlinkIp(key, slot);
+	}
+
+	memset(&entries[slot], 0, sizeof(entries[slot]));
+
+	links[slot] = free_head;
+	free_head = slot;
+}
+
+int NatCacheIndex::FindByIp(nat_cache_ip_key key, uint32_t ip_addr, int *slots) const
+{
+	int cnt, num_slots = 0;
+
+	if(buckets == NULL || key >= NAT_CACHE_NUM_IP_KEYS)
+	{
+		return 0;
+	}
+
+	for(cnt = ip_buckets[key][HashIp(ip_addr)]; cnt != -1; cnt = ip_next[key][cnt])
+	{
+		if(EntryIp(key, cnt) == ip_addr)
+		{
+			slots[num_slots++] = cnt;
+		}
+	}
+
+	return num_slots;
+}
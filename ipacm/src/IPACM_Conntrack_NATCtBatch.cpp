@@ -0,0 +1,287 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_Conntrack_NATCtBatch.cpp
+
+	@brief
+	Batched conntrack updates over a single netlink socket
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+
+#include "IPACM_Conntrack_NATCtBatch.h"
+#include "IPACM_Log.h"
+
+/* how long to wait for the kernel's answers, in seconds */
+#define NAT_CT_BATCH_RECV_TIMEOUT 1
+
+NatCtBatch::NatCtBatch()
+{
+	fd = -1;
+
+	buf = NULL;
+	len = 0;
+	last = NULL;
+
+	results = NULL;
+	result_idx = NULL;
+	num_queued = 0;
+	max_queued = NAT_CT_BATCH_BUF_SIZE / NLMSG_SPACE(sizeof(struct nfgenmsg));
+
+	seq = (uint32_t)time(NULL);
+	first_seq = seq;
+}
+
+NatCtBatch::~NatCtBatch()
+{
+	Close();
+	free(buf);
+	free(result_idx);
+}
+
+int NatCtBatch::Open()
+{
+	struct sockaddr_nl addr;
+	struct timeval tv;
+	int bufsize = NAT_CT_BATCH_BUF_SIZE;
+	int on = 1;
+
+	if(buf == NULL)
+	{
+		buf = (char *)malloc(NAT_CT_BATCH_BUF_SIZE);
+		result_idx = (int *)malloc(sizeof(int) * max_queued);
+		if(buf == NULL || result_idx == NULL)
+		{
+			IPACMERR("Unable to allocate memory for conntrack batch\n");
+			free(buf);
+			free(result_idx);
+			buf = NULL;
+			result_idx = NULL;
+			return -1;
+		}
+	}
+
+	if(fd >= 0)
+	{
+		return 0;
+	}
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+	if(fd < 0)
+	{
+		IPACMERR("Unable to open conntrack netlink socket: %d\n", errno);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+
+	if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		IPACMERR("Unable to bind conntrack netlink socket: %d\n", errno);
+		Close();
+		return -1;
+	}
+
+	/* failures come back without the message that failed */
+#ifdef NETLINK_CAP_ACK
+	setsockopt(fd, SOL_NETLINK, NETLINK_CAP_ACK, &on, sizeof(on));
+#endif
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+	tv.tv_sec = NAT_CT_BATCH_RECV_TIMEOUT;
+	tv.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	return 0;
+}
+
+void NatCtBatch::Close()
+{
+	if(fd >= 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+}
+
+int NatCtBatch::Update(const struct nf_conntrack *ct, int idx, int *res)
+{
+	struct nlmsghdr *nlh;
+	struct nfgenmsg *nfg;
+
+	if(Open())
+	{
+		res[idx] = NAT_CT_BATCH_UNKNOWN;
+		return -1;
+	}
+
+	if((NAT_CT_BATCH_BUF_SIZE - len < NAT_CT_BATCH_MSG_ROOM ||
+		 num_queued == max_queued ||
+		 (results != NULL && results != res)) && Flush())
+	{
+		res[idx] = NAT_CT_BATCH_UNKNOWN;
+		return -1;
+	}
+
+	nlh = (struct nlmsghdr *)(buf + len);
+	memset(nlh, 0, NLMSG_SPACE(sizeof(struct nfgenmsg)));
+
+	/* an update is a NEW without NLM_F_CREATE, as nfct_query() sends it */
+	nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct nfgenmsg));
+	nlh->nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_NEW;
+	nlh->nlmsg_flags = NLM_F_REQUEST;
+	nlh->nlmsg_seq = ++seq;
+
+	nfg = (struct nfgenmsg *)NLMSG_DATA(nlh);
+	nfg->nfgen_family = AF_INET;
+	nfg->version = NFNETLINK_V0;
+	nfg->res_id = 0;
+
+	if(nfct_nlmsg_build(nlh, ct) < 0)
+	{
+		IPACMERR("Unable to build conntrack update\n");
+		res[idx] = NAT_CT_BATCH_UNKNOWN;
+		return -1;
+	}
+
+	if(num_queued == 0)
+	{
+		first_seq = nlh->nlmsg_seq;
+	}
+
+	len += NLMSG_ALIGN(nlh->nlmsg_len);
+	last = nlh;
+
+	results = res;
+	result_idx[num_queued++] = idx;
+
+	/* silence is success, once the last message's ACK is in */
+	res[idx] = 0;
+
+	return 0;
+}
+
+int NatCtBatch::Flush()
+{
+	char rbuf[8192];
+	struct nlmsghdr *nlh;
+	struct nlmsgerr *err;
+	uint32_t last_seq;
+	bool done = false, lost = false;
+	int cnt, ret = 0;
+	ssize_t rlen;
+
+	if(num_queued == 0)
+	{
+		return 0;
+	}
+
+	last->nlmsg_flags |= NLM_F_ACK;
+	last_seq = last->nlmsg_seq;
+
+	if(send(fd, buf, len, 0) != (ssize_t)len)
+	{
+		IPACMERR("Unable to send %d conntrack updates: %d\n", num_queued, errno);
+		ret = -1;
+	}
+
+	while(ret == 0 && !done)
+	{
+		rlen = recv(fd, rbuf, sizeof(rbuf), 0);
+		if(rlen < 0 && errno == ENOBUFS)
+		{
+			/* too many failures to hold, some of them now gone */
+			lost = true;
+			continue;
+		}
+		if(rlen < 0)
+		{
+			IPACMERR("No answer to %d conntrack updates: %d\n", num_queued, errno);
+			ret = -1;
+			break;
+		}
+
+		for(nlh = (struct nlmsghdr *)rbuf; NLMSG_OK(nlh, rlen); nlh = NLMSG_NEXT(nlh, rlen))
+		{
+			if(nlh->nlmsg_type != NLMSG_ERROR ||
+				 nlh->nlmsg_seq - first_seq >= (uint32_t)num_queued)
+			{
+				/* not an answer to this batch */
+				continue;
+			}
+
+			err = (struct nlmsgerr *)NLMSG_DATA(nlh);
+
+			results[result_idx[nlh->nlmsg_seq - first_seq]] = err->error;
+
+			if(nlh->nlmsg_seq == last_seq)
+			{
+				done = true;
+			}
+		}
+	}
+
+	if(ret || lost)
+	{
+		/* a failure may have been lost along with the rest */
+		for(cnt = 0; cnt < num_queued; cnt++)
+		{
+			if(results[result_idx[cnt]] == 0)
+			{
+				results[result_idx[cnt]] = NAT_CT_BATCH_UNKNOWN;
+			}
+		}
+	}
+
+	if(ret)
+	{
+		/* nor is there any telling what is still to come on the socket */
+		Close();
+	}
+
+	IPACMDBG("Sent %d conntrack updates in %u bytes\n", num_queued, (unsigned int)len);
+
+	len = 0;
+	last = NULL;
+	results = NULL;
+	num_queued = 0;
+
+	return ret;
+}
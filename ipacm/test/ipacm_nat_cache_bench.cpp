@@ -0,0 +1,366 @@
+/*
+Copyright (c) 2013-2021, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	ipacm_nat_cache_bench.cpp
+
+	@brief
+	Replays a conntrack churn through the NatApp connection cache.
+
+	A stream of NEW and DESTROY events is generated for a number of
+	distinct flows (50K by default), holding the cache at a given
+	occupancy, with some NEW events repeated as conntrack does for
+	flows it already reported.  Each event is handled the way NatApp
+	handles it: a NEW is checked for a duplicate, then given a free
+	slot; a DESTROY looks its flow up and empties the slot.
+
+	The stream is replayed twice, once against NatCacheIndex and once
+	against the full cache scans NatApp used before it, and the two are
+	checked to agree.  One CSV row is written per replay.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <netinet/in.h>
+
+#include "IPACM_Conntrack_NATCache.h"
+
+typedef enum
+{
+	CT_NEW,
+	CT_DESTROY
+} ct_event_type;
+
+typedef struct
+{
+	ct_event_type type;
+	int flow;
+} ct_event;
+
+static nat_table_entry *flows;
+static ct_event *events;
+static int num_events;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * A LAN of 64 clients talking to servers all over, as conntrack
+ * reports them
+ */
+static void make_flows(int num_flows)
+{
+	int cnt;
+
+	for(cnt = 0; cnt < num_flows; cnt++)
+	{
+		memset(&flows[cnt], 0, sizeof(flows[cnt]));
+
+		flows[cnt].private_ip = 0xC0A80102 + (rand() % 64);
+		flows[cnt].private_port = 1024 + (cnt % 64000);
+		flows[cnt].target_ip = ((uint32_t)rand() << 1) | 1;
+		flows[cnt].target_port = (rand() % 2) ? 443 : (1 + rand() % 65535);
+		flows[cnt].protocol = (rand() % 4) ? IPPROTO_TCP : IPPROTO_UDP;
+		flows[cnt].public_port = 1024 + cnt % 64000;
+	}
+}
+
+static void make_events(int num_flows, int num_live)
+{
+	int *live;
+	int live_cnt = 0;
+	int cnt, victim;
+
+	live = (int *)malloc(sizeof(int) * (num_live + 1));
+	if(live == NULL)
+	{
+		exit(1);
+	}
+
+	for(cnt = 0; cnt < num_flows; cnt++)
+	{
+		events[num_events].type = CT_NEW;
+		events[num_events++].flow = cnt;
+		live[live_cnt++] = cnt;
+
+		/* conntrack telling of a flow it already told of */
+		if((rand() % 4) == 0)
+		{
+			events[num_events].type = CT_NEW;
+			events[num_events++].flow = live[rand() % live_cnt];
+		}
+
+		if(live_cnt > num_live)
+		{
+			victim = rand() % live_cnt;
+			events[num_events].type = CT_DESTROY;
+			events[num_events++].flow = live[victim];
+			live[victim] = live[--live_cnt];
+		}
+	}
+
+	while(live_cnt > 0)
+	{
+		events[num_events].type = CT_DESTROY;
+		events[num_events++].flow = live[--live_cnt];
+	}
+
+	free(live);
+}
+
+static void fill_slot(nat_table_entry *slot, const nat_table_entry *rule)
+{
+	slot->private_ip = rule->private_ip;
+	slot->target_ip = rule->target_ip;
+	slot->target_port = rule->target_port;
+	slot->private_port = rule->private_port;
+	slot->protocol = rule->protocol;
+	slot->public_port = rule->public_port;
+}
+
+/*
+ * NatApp's ChkForDup(), AddEntry() and DeleteEntry() cache handling,
+ * through the index
+ */
+static uint64_t replay_indexed(nat_table_entry *cache, int max_entries, int *slots)
+{
+	NatCacheIndex idx;
+	uint64_t start;
+	int cnt, slot;
+
+	if(idx.Init(cache, max_entries))
+	{
+		return 0;
+	}
+
+	start = now_ns();
+
+	for(cnt = 0; cnt < num_events; cnt++)
+	{
+		const nat_table_entry *rule = &flows[events[cnt].flow];
+
+		slot = idx.Find(rule);
+
+		if(events[cnt].type == CT_NEW)
+		{
+			if(slot < 0 && (slot = idx.NextFree()) >= 0)
+			{
+				fill_slot(&cache[slot], rule);
+				idx.Insert(slot);
+			}
+		}
+		else if(slot >= 0)
+		{
+			idx.Remove(slot);
+		}
+
+		slots[cnt] = slot;
+	}
+
+	return now_ns() - start;
+}
+
+static int scan_tuple(const nat_table_entry *cache, int max_entries, const nat_table_entry *rule)
+{
+	int cnt;
+
+	for(cnt = 0; cnt < max_entries; cnt++)
+	{
+		if(cache[cnt].private_ip == rule->private_ip &&
+			 cache[cnt].target_ip == rule->target_ip &&
+			 cache[cnt].private_port ==  rule->private_port  &&
+			 cache[cnt].target_port == rule->target_port &&
+			 cache[cnt].protocol == rule->protocol)
+		{
+			return cnt;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * The same, scanning the whole cache as NatApp used to
+ */
+static uint64_t replay_scanned(nat_table_entry *cache, int max_entries, int *slots)
+{
+	nat_table_entry empty;
+	uint64_t start;
+	int cnt, slot;
+
+	memset(&empty, 0, sizeof(empty));
+
+	start = now_ns();
+
+	for(cnt = 0; cnt < num_events; cnt++)
+	{
+		const nat_table_entry *rule = &flows[events[cnt].flow];
+
+		slot = scan_tuple(cache, max_entries, rule);
+
+		if(events[cnt].type == CT_NEW)
+		{
+			if(slot < 0 && (slot = scan_tuple(cache, max_entries, &empty)) >= 0)
+			{
+				fill_slot(&cache[slot], rule);
+			}
+		}
+		else if(slot >= 0)
+		{
+			memset(&cache[slot], 0, sizeof(cache[slot]));
+		}
+
+		slots[cnt] = slot;
+	}
+
+	return now_ns() - start;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-f flows] [-m max_entries] [-o occupancy_pct] [-r seed] [-n]\n", prog);
+	printf("  -f  distinct flows replayed (default 50000)\n");
+	printf("  -m  cache size, as IPACM_cfg.xml MaxNatEntries (default 32768)\n");
+	printf("  -o  percentage of the cache kept live (default 75)\n");
+	printf("  -r  random seed (default 1)\n");
+	printf("  -n  skip the full scan replay\n");
+}
+
+int main(int argc, char **argv)
+{
+	nat_table_entry *cache;
+	int *idx_slots, *scan_slots;
+	int num_flows = 50000, max_entries = 32768, occupancy = 75;
+	unsigned int seed = 1;
+	bool do_scan = true;
+	uint64_t idx_ns, scan_ns = 0;
+	int opt, cnt, num_live;
+
+	while((opt = getopt(argc, argv, "f:m:o:r:nh")) != -1)
+	{
+		switch(opt)
+		{
+		case 'f':
+			num_flows = atoi(optarg);
+			break;
+		case 'm':
+			max_entries = atoi(optarg);
+			break;
+		case 'o':
+			occupancy = atoi(optarg);
+			break;
+		case 'r':
+			seed = (unsigned int)strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			do_scan = false;
+			break;
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if(num_flows <= 0 || max_entries <= 0 || occupancy <= 0 || occupancy > 100)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	srand(seed);
+
+	num_live = (int)(((int64_t)max_entries * occupancy) / 100);
+	num_live = (num_live > 0) ? num_live : 1;
+
+	flows = (nat_table_entry *)malloc(sizeof(nat_table_entry) * num_flows);
+	events = (ct_event *)malloc(sizeof(ct_event) * num_flows * 3);
+	cache = (nat_table_entry *)calloc(max_entries, sizeof(nat_table_entry));
+	idx_slots = (int *)malloc(sizeof(int) * num_flows * 3);
+	scan_slots = (int *)malloc(sizeof(int) * num_flows * 3);
+	if(flows == NULL || events == NULL || cache == NULL ||
+		 idx_slots == NULL || scan_slots == NULL)
+	{
+		fprintf(stderr, "Unable to allocate memory\n");
+		return 1;
+	}
+
+	make_flows(num_flows);
+	make_events(num_flows, num_live);
+
+	printf("method,flows,max_entries,live,events,total_ms,ns_per_event\n");
+
+	idx_ns = replay_indexed(cache, max_entries, idx_slots);
+	if(idx_ns == 0)
+	{
+		fprintf(stderr, "Unable to index the cache\n");
+		return 1;
+	}
+
+	printf("indexed,%d,%d,%d,%d,%.3f,%.1f\n",
+		   num_flows, max_entries, num_live, num_events,
+		   idx_ns / 1e6, (double)idx_ns / num_events);
+
+	if(do_scan)
+	{
+		memset(cache, 0, sizeof(nat_table_entry) * max_entries);
+
+		scan_ns = replay_scanned(cache, max_entries, scan_slots);
+
+		printf("scanned,%d,%d,%d,%d,%.3f,%.1f\n",
+			   num_flows, max_entries, num_live, num_events,
+			   scan_ns / 1e6, (double)scan_ns / num_events);
+
+		/* both hand out slots in a different order, so compare hits only */
+		for(cnt = 0; cnt < num_events; cnt++)
+		{
+			if((idx_slots[cnt] < 0) != (scan_slots[cnt] < 0))
+			{
+				fprintf(stderr, "Replays differ at event %d\n", cnt);
+				return 1;
+			}
+		}
+	}
+
+	free(flows);
+	free(events);
+	free(cache);
+	free(idx_slots);
+	free(scan_slots);
+
+	return 0;
+}
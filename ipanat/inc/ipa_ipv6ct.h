@@ -30,6 +30,7 @@
 #define IPA_IPV6CT_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * enum ipa_ipv6_ct_direction_settings_type - direction filter settings
@@ -80,6 +81,20 @@ typedef struct {
  */
 int ipa_ipv6ct_add_tbl(uint16_t number_of_entries, uint32_t* table_handle);
 
+/**
+ * ipa_ipv6ct_add_tbl_ext() - create IPv6CT table in a given memory
+ * @number_of_entries: [in] number of IPv6CT entries
+ * @mem_type_ptr: [in] type of memory table is to reside in, "DDR",
+ *                "SRAM" or "HYBRID", as for ipa_nat_add_ipv4_tbl()
+ * @table_handle: [out] handle of new IPv6CT table
+ *
+ * A hybrid table starts in SRAM and moves to DDR when SRAM is full.
+ * Its rule handles remain valid as it does.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_add_tbl_ext(uint16_t number_of_entries, const char* mem_type_ptr, uint32_t* table_handle);
+
 /**
  * ipa_ipv6ct_del_tbl() - delete IPv6CT table
  * @table_handle: [in] Handle of IPv6CT table
@@ -102,6 +117,22 @@ int ipa_ipv6ct_del_tbl(uint32_t table_handle);
  */
 int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule, uint32_t* rule_handle);
 
+/**
+ * ipa_ipv6ct_add_rules() - to insert many IPv6CT rules at once
+ * @table_handle: [in] handle of IPv6CT table
+ * @user_rules: [in] array of new rules
+ * @num_rules: [in] number of rules in the array
+ * @rule_handles: [out] array receiving the handle of each rule
+ *
+ * To insert new rules into a IPv6CT table under a single lock, with
+ * their table updates bundled into as few dma commands as possible.
+ * A rule that could not be added has its handle set to zero.
+ *
+ * Returns:	0  On Success (all rules added), negative on failure
+ */
+int ipa_ipv6ct_add_rules(uint32_t table_handle, const ipa_ipv6ct_rule* user_rules, uint32_t num_rules,
+	uint32_t* rule_handles);
+
 /**
  * ipa_ipv6ct_del_rule() - to delete IPv6CT rule
  * @table_handle: [in] handle of IPv6CT table
@@ -113,6 +144,20 @@ int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule,
  */
 int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle);
 
+/**
+ * ipa_ipv6ct_del_rules() - to delete many IPv6CT rules at once
+ * @table_handle: [in] handle of IPv6CT table
+ * @rule_handles: [in] array of IPv6CT rule handles
+ * @num_rules: [in] number of handles in the array
+ *
+ * To delete rules from a IPv6CT table under a single lock.  Deletes
+ * that land in distinct buckets share a dma command.  Every rule is
+ * attempted, even when some of them fail.
+ *
+ * Returns:	0  On Success (all rules deleted), negative on failure
+ */
+int ipa_ipv6ct_del_rules(uint32_t table_handle, const uint32_t* rule_handles, uint32_t num_rules);
+
 /**
  * ipa_ipv6ct_query_timestamp() - to query timestamp
  * @table_handle: [in] handle of IPv6CT table
@@ -125,6 +170,50 @@ int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle);
  */
 int ipa_ipv6ct_query_timestamp(uint32_t table_handle, uint32_t rule_handle, uint32_t* time_stamp);
 
+/**
+ * ipa_ipv6ct_query_timestamps() - to query many timestamps at once
+ * @table_handle: [in] handle of IPv6CT table
+ * @rule_handles: [in] array of IPv6CT rule handles
+ * @num_rules: [in] number of handles in the array
+ * @time_stamps: [out] array receiving the time stamp of each rule
+ *
+ * The bulk version of ipa_ipv6ct_query_timestamp().  The time stamp
+ * of a bad handle is left unmodified.
+ *
+ * Returns:	0  On Success (all handles read), negative on failure
+ */
+int ipa_ipv6ct_query_timestamps(uint32_t table_handle, const uint32_t* rule_handles, uint32_t num_rules,
+	uint32_t* time_stamps);
+
+/**
+ * struct ipa_ipv6ct_switch_stats - where an IPv6CT table lives
+ * @hybrid: table moves between SRAM and DDR
+ * @in_sram: the IPA is using the table in SRAM
+ * @num_rules: rules in the table being used
+ * @to_ddr_pass: moves from SRAM to DDR that worked
+ * @to_ddr_fail: moves from SRAM to DDR that failed
+ * @to_sram_pass: moves from DDR back to SRAM that worked
+ * @to_sram_fail: moves from DDR back to SRAM that failed
+ */
+typedef struct {
+	bool     hybrid;
+	bool     in_sram;
+	uint32_t num_rules;
+	uint32_t to_ddr_pass;
+	uint32_t to_ddr_fail;
+	uint32_t to_sram_pass;
+	uint32_t to_sram_fail;
+} ipa_ipv6ct_switch_stats;
+
+/**
+ * ipa_ipv6ct_get_switch_stats() - to query where a table lives
+ * @table_handle: [in] handle of IPv6CT table
+ * @stats: [out] the table's memory and switch counts
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_get_switch_stats(uint32_t table_handle, ipa_ipv6ct_switch_stats* stats);
+
 /**
  * ipa_ipv6ct_dump_table() - dumps IPv6CT table
  * @table_handle: [in] handle of IPv6CT table
@@ -32,6 +32,9 @@
 #include "ipa_table.h"
 #include "ipa_mem_descriptor.h"
 #include "ipa_nat_utils.h"
+#include "ipa_nat_drv.h"
+#include "ipa_nat_drvi.h"
+#include "ipa_nat_statemach.h"
 
 #define IPA_IPV6CT_MAX_TBLS   1
 
@@ -130,12 +133,41 @@ typedef struct
 	ipa_mem_descriptor mem_desc;
 	ipa_table table;
 	ipa_table_dma_cmd_helper table_dma_cmd_helpers[IPA_IPV6CT_TABLE_DMA_CMD_MAX];
+	/*
+	 * Set while the table is rebuilt behind the IPA's back, when dma
+	 * commands are applied by software rather than posted
+	 */
+	bool offline;
 }  ipa_ipv6ct_table;
 
+/*
+ * What the application knows as one IPv6CT table.  Like the IPv4 NAT
+ * table, it lives in DDR, in SRAM, or in both (ie. hybrid).  In hybrid
+ * mode the IPA uses the SRAM table until it fills, the rules are then
+ * moved to the DDR table, and back once few enough are left.  The
+ * state, hence the table in use, is kept as for IPv4 (see
+ * ipa_nat_statemach.h), and the arrays are indexed by DDR_SUB and
+ * SRAM_SUB.
+ */
+typedef struct
+{
+	ipa_nati_state prev_state;
+	ipa_nati_state curr_state;
+	ipa_ipv6ct_table sub_tables[2];
+	uint32_t tot_slots_in_sram;
+	uint32_t back_to_sram_thresh;
+	uint32_t tot_rules_in_table[2];
+	/*
+	 * Stable handles, used in the hybrid states only
+	 */
+	nati_hdl_tbl hdls;
+	nati_switch_stats sw_stats[2];
+} ipa_ipv6ct_obj;
+
 typedef struct
 {
 	ipa_descriptor* ipa_desc;
-	ipa_ipv6ct_table tables[IPA_IPV6CT_MAX_TBLS];
+	ipa_ipv6ct_obj tables[IPA_IPV6CT_MAX_TBLS];
 	uint8_t table_cnt;
 } ipa_ipv6ct;
 
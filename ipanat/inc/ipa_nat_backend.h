@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef IPA_NAT_BACKEND_H
+#define IPA_NAT_BACKEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Everything libipanat needs from the IPA kernel driver (opening its
+ * devices, ioctls, and mmaping the table memory) goes through a
+ * backend, so that something other than the kernel can stand in for
+ * it.
+ *
+ * Two backends exist:
+ *
+ *   IPA_NAT_BACKEND_KERNEL The real thing, a thin wrapper around the
+ *                          system calls.  This is the default.
+ *
+ *   IPA_NAT_BACKEND_SIM    An in-process simulation of the driver.  It
+ *                          allocates table memory from the heap,
+ *                          applies dma commands to it, and models a
+ *                          limited amount of SRAM.  It lets the library,
+ *                          ipanattest and the benchmarks run on a build
+ *                          host.  Nothing touches the tables behind the
+ *                          library's back (no time stamp updates, etc).
+ *                          Only built in with FEATURE_IPA_NAT_SIM, which
+ *                          the test-only libipanatsim defines.
+ *
+ * The backend is chosen with ipa_nat_set_backend(), before the first
+ * table is added.
+ */
+typedef struct
+{
+	const char* name;
+
+	int   (*open)(const char* path, int flags);
+	int   (*close)(int fd);
+	int   (*ioctl)(int fd, unsigned long req, void* arg);
+	void* (*mmap)(size_t len, int fd);
+	int   (*munmap)(void* addr, size_t len);
+} ipa_nat_backend;
+
+typedef enum
+{
+	IPA_NAT_BACKEND_KERNEL = 0,
+	IPA_NAT_BACKEND_SIM    = 1,
+
+	IPA_NAT_BACKEND_MAX
+} ipa_nat_backend_type;
+
+#define VALID_IPA_NAT_BACKEND_TYPE(t) \
+	( (t) >= IPA_NAT_BACKEND_KERNEL && (t) < IPA_NAT_BACKEND_MAX )
+
+extern const ipa_nat_backend ipa_nat_kernel_backend;
+#ifdef FEATURE_IPA_NAT_SIM
+extern const ipa_nat_backend ipa_nat_sim_backend;
+#endif
+
+/**
+ * ipa_nat_set_backend() - choose the driver backend
+ * @type: [in] the backend to use from now on
+ *
+ * Returns:	0 on success, -EBUSY if a device is still open on the
+ *		current backend, -ENOTSUP if the backend isn't built in,
+ *		otherwise a negative errno
+ */
+int ipa_nat_set_backend(
+	ipa_nat_backend_type type);
+
+ipa_nat_backend_type ipa_nat_get_backend(void);
+
+/*
+ * What the library calls in place of the system calls...
+ */
+int   ipa_nat_be_open(const char* path, int flags);
+int   ipa_nat_be_close(int fd);
+int   ipa_nat_be_ioctl(int fd, unsigned long req, void* arg);
+void* ipa_nat_be_mmap(size_t len, int fd);
+int   ipa_nat_be_munmap(void* addr, size_t len);
+
+/*
+ * Simulator knobs and counters.  The SRAM size is what the simulated
+ * driver reports as available for NAT; zero means no SRAM at all.
+ */
+#define IPA_NAT_SIM_DEFAULT_SRAM_SIZE (16 * 1024)
+
+typedef struct
+{
+	uint32_t ioctls;
+	uint32_t dma_cmds;
+	uint32_t dma_entries;
+	uint32_t inits;
+	uint32_t focus_changes;
+} ipa_nat_sim_stats;
+
+int ipa_nat_sim_set_sram_size(
+	uint32_t sram_size);
+
+void ipa_nat_sim_get_stats(
+	ipa_nat_sim_stats* stats_ptr);
+
+void ipa_nat_sim_reset_stats(void);
+
+#endif
@@ -105,6 +105,44 @@ typedef struct {
 	uint32_t dst_metadata;
 } ipa_nat_pdn_entry;
 
+/**
+ * struct ipa_nat_rule_time_stamp - a rule and its timestamp
+ * @rule_hdl: handle of the rule
+ * @time_stamp: last time the rule was hit
+ */
+typedef struct {
+	uint32_t rule_hdl;
+	uint32_t time_stamp;
+} ipa_nat_rule_time_stamp;
+
+/**
+ * struct ipa_nat_ts_shadow - the time stamps last seen by
+ * ipa_nat_query_changed_timestamps(); opaque to the caller
+ */
+typedef struct ipa_nat_ts_shadow ipa_nat_ts_shadow;
+
+/**
+ * struct ipa_nat_vote_stats - the clock vote lease's counters
+ * @votes: votes asked for through ipa_nat_vote_clock() and the library
+ * @devotes: devotes asked for likewise
+ * @votes_avoided: votes the clock was already on for
+ * @ioctls: votes and devotes that reached the kernel
+ * @expiries: devotes made when a linger period ran out
+ * @holders: votes currently outstanding
+ * @voted: whether the kernel currently holds the lease's vote
+ * @linger_ms: the current linger period
+ */
+typedef struct {
+	uint64_t votes;
+	uint64_t devotes;
+	uint64_t votes_avoided;
+	uint64_t ioctls;
+	uint64_t expiries;
+	uint32_t holders;
+	bool     voted;
+	uint32_t linger_ms;
+} ipa_nat_vote_stats;
+
 /**
  * ipa_nat_add_ipv4_tbl() - create ipv4 nat table
  * @public_ip_addr: [in] public ipv4 address
@@ -146,6 +184,25 @@ int ipa_nat_add_ipv4_rule(uint32_t table_handle,
 				const ipa_nat_ipv4_rule * rule,
 				uint32_t *rule_handle);
 
+/**
+ * ipa_nat_add_ipv4_rules() - to insert many ipv4 rules at once
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rules: [in] array of new rules
+ * @num_rules: [in] number of rules in the array
+ * @rule_handles: [out] array receiving the handle of each rule
+ *
+ * To insert new ipv4 nat rules into ipv4 nat table under a single
+ * lock, with their table updates bundled into as few dma commands
+ * as possible.  A rule that could not be added has its handle set
+ * to zero.
+ *
+ * Returns:	0  On Success (all rules added), negative on failure
+ */
+int ipa_nat_add_ipv4_rules(uint32_t table_handle,
+				const ipa_nat_ipv4_rule *rules,
+				uint32_t num_rules,
+				uint32_t *rule_handles);
+
 /**
  * ipa_nat_del_ipv4_rule() - to delete ipv4 nat rule
  * @table_handle: [in] handle of ipv4 nat table
@@ -158,6 +215,23 @@ int ipa_nat_add_ipv4_rule(uint32_t table_handle,
 int ipa_nat_del_ipv4_rule(uint32_t table_handle,
 				uint32_t rule_handle);
 
+/**
+ * ipa_nat_del_ipv4_rules() - to delete many ipv4 nat rules at once
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_handles: [in] array of ipv4 nat rule handles
+ * @num_rules: [in] number of handles in the array
+ *
+ * To delete ipv4 nat rules under a single lock.  Deletes that land
+ * in distinct buckets share a dma command, so tearing down many
+ * rules costs only a few ioctls.  Every rule is attempted, even when
+ * some of them fail.
+ *
+ * Returns:	0  On Success (all rules deleted), negative on failure
+ */
+int ipa_nat_del_ipv4_rules(uint32_t table_handle,
+				const uint32_t *rule_handles,
+				uint32_t num_rules);
+
 
 /**
  * ipa_nat_query_timestamp() - to query timestamp
@@ -174,6 +248,146 @@ int ipa_nat_query_timestamp(uint32_t  table_handle,
 				uint32_t  rule_handle,
 				uint32_t  *time_stamp);
 
+/**
+ * ipa_nat_query_timestamps() - to query many timestamps at once
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_handles: [in] array of ipv4 nat rule handles
+ * @num_rules: [in] number of handles in the array
+ * @time_stamps: [out] array receiving the time stamp of each rule
+ *
+ * The bulk version of ipa_nat_query_timestamp().  The time stamps
+ * are read straight from the table under a single lock.  The time
+ * stamp of a bad handle is left unmodified.
+ *
+ * Returns:	0  On Success (all handles read), negative on failure
+ */
+int ipa_nat_query_timestamps(uint32_t table_handle,
+				const uint32_t *rule_handles,
+				uint32_t num_rules,
+				uint32_t *time_stamps);
+
+/**
+ * ipa_nat_query_all_timestamps() - to query the timestamp of every rule
+ * @table_handle: [in] handle of ipv4 nat table
+ * @time_stamps: [out] array receiving rule handles and time stamps
+ * @max_rules: [in] number of elements in the array
+ * @num_rules: [out] number of elements filled in
+ *
+ * Reads all rules in the table in one pass.
+ *
+ * Returns:	0  On Success, -ENOSPC when the table holds more than
+ *		max_rules rules, other negative values on failure
+ */
+int ipa_nat_query_all_timestamps(uint32_t table_handle,
+				ipa_nat_rule_time_stamp *time_stamps,
+				uint32_t max_rules,
+				uint32_t *num_rules);
+
+/**
+ * ipa_nat_query_changed_timestamps() - to find the rules hit since last asked
+ * @table_handle: [in] handle of ipv4 nat table
+ * @shadow: [in/out] what the last call saw; *shadow is NULL the first time
+ * @time_stamps: [out] array receiving rule handles and time stamps
+ * @max_rules: [in] number of elements in the array
+ * @num_rules: [out] number of elements filled in
+ *
+ * Like ipa_nat_query_all_timestamps(), but only the rules whose time
+ * stamp differs from the one in *shadow are handed back, and *shadow
+ * is updated to match.  The first call, and any call after the rules
+ * have been moved to another table or the table has grown, hands back
+ * every rule.  When -ENOSPC is returned, another call hands back the
+ * rules that didn't fit.  Free *shadow with ipa_nat_free_ts_shadow().
+ *
+ * Returns:	0  On Success, -ENOSPC when more than max_rules rules
+ *		changed, other negative values on failure
+ */
+int ipa_nat_query_changed_timestamps(uint32_t table_handle,
+				ipa_nat_ts_shadow **shadow,
+				ipa_nat_rule_time_stamp *time_stamps,
+				uint32_t max_rules,
+				uint32_t *num_rules);
+
+/**
+ * ipa_nat_free_ts_shadow() - to free what ipa_nat_query_changed_timestamps()
+ * allocated
+ * @shadow: [in] the shadow, which may be NULL
+ */
+void ipa_nat_free_ts_shadow(ipa_nat_ts_shadow *shadow);
+
+/**
+ * ipa_nat_find_ipv4_rule() - to find the handle of an offloaded rule
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule: [in] rule to look for
+ * @rule_handle: [out] handle of the matching rule
+ *
+ * Rules are matched on private_ip, private_port, target_ip,
+ * target_port, protocol and pdn_index; other fields are ignored.
+ * The lookup uses an index kept by the library, hence it costs the
+ * same regardless of the number of rules in the table.
+ *
+ * Returns:	0  On Success, -ENOENT when no such rule exists,
+ *		other negative values on failure
+ */
+int ipa_nat_find_ipv4_rule(uint32_t table_handle,
+				const ipa_nat_ipv4_rule *rule,
+				uint32_t *rule_handle);
+
+/**
+ * ipa_nat_stale_cb() - receives rules found by ipa_nat_collect_stale()
+ * @stale: [in] the rules' handles and time stamps
+ * @num_stale: [in] number of elements in the array
+ * @arb_data_ptr: [in] as passed to ipa_nat_collect_stale()
+ *
+ * Returns:	0 for more rules, non-zero to stop being called
+ */
+typedef int (*ipa_nat_stale_cb)(const ipa_nat_rule_time_stamp *stale,
+				uint32_t num_stale,
+				void *arb_data_ptr);
+
+/**
+ * ipa_nat_collect_stale() - to find, and optionally delete, idle rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @older_than: [in] a time stamp, as the IPA writes them into rules
+ * @del_stale: [in] whether to delete the rules found
+ * @stale_cb: [in] called with the rules found, a batch at a time
+ * @arb_data_ptr: [in] passed, untouched, to stale_cb
+ *
+ * A rule is stale when it was last hit before older_than.  Time
+ * stamps are 24 bits wide and wrap, hence "before" means less than
+ * half their range (0x800000 ticks) behind.  The rules are found in
+ * one pass over the table.  When deleting, they are all deleted
+ * before stale_cb is called, with as few dma commands as the
+ * table allows, and the handles passed to stale_cb are no longer
+ * valid.  stale_cb may call back into this library.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_collect_stale(uint32_t table_handle,
+				uint32_t older_than,
+				bool del_stale,
+				ipa_nat_stale_cb stale_cb,
+				void *arb_data_ptr);
+
+/**
+ * ipa_nat_compact_ipv4_tbl() - to shorten rule lists in the table
+ * @table_handle: [in] handle of ipv4 nat table
+ * @max_moves: [in] most rules to move in this call
+ * @num_moved: [out] number of rules moved
+ *
+ * Deleting the first rule of a list leaves its base table slot in
+ * use.  This moves the next rule of such lists into the base table,
+ * freeing expansion table entries and shortening the IPA's lookups.
+ * Meant to be called when there's nothing else to do (eg. from a
+ * periodic timer); each call carries on from where the last one
+ * stopped.  Rule handles remain valid.  Nothing is moved when the
+ * table is in SRAM only.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_compact_ipv4_tbl(uint32_t table_handle,
+				uint32_t max_moves,
+				uint32_t *num_moved);
+
 
 /**
  * ipa_nat_modify_pdn() - modify single PDN entry in the PDN config table
@@ -246,6 +460,28 @@ void ipa_nat_dump_ipv4_table(uint32_t tbl_hdl);
 int ipa_nat_vote_clock(
 	enum ipa_app_clock_vote_type vote_type );
 
+/**
+ * ipa_nat_set_vote_linger() - how long the clock stays voted on after
+ * its last vote has been released
+ * @linger_ms: [in] linger period in milliseconds, 0 to devote at once
+ *
+ * Operations that follow one another inside the period share a single
+ * clock vote.  A vote lingering when this is called is released.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_vote_linger(
+	uint32_t linger_ms );
+
+/**
+ * ipa_nat_get_vote_stats() - get the clock vote lease's counters
+ * @stats_ptr: [out] where to put them
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_get_vote_stats(
+	ipa_nat_vote_stats* stats_ptr );
+
 /**
  * ipa_nat_switch_to() - While in HYBRID mode only, used for switching
  * from SRAM to DDR or the reverse.
@@ -257,5 +493,18 @@ int ipa_nat_switch_to(
 	enum ipa3_nat_mem_in nmi,
 	bool                 hold_state );
 
+/**
+ * ipa_nat_set_ddr_grow_limit() - let a full DDR table grow
+ * @max_entries: [in] the most entries it may grow to, 0 for none
+ *
+ * A DDR table whose expansion tables fill up is doubled in size, up
+ * to @max_entries, rather than have the add fail.  Tables don't grow
+ * unless this has been called.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_ddr_grow_limit(
+	uint32_t max_entries );
+
 #endif
 
@@ -249,6 +249,26 @@ struct ipa_nat_indx_tbl_meta_info {
 	uint16_t prev_index;
 };
 
+/*
+ * A rule's lookup key, as kept in a table's tuple index.  A zero
+ * rec_index marks an empty slot.
+ */
+struct ipa_nat_tuple {
+	uint32_t private_ip;
+	uint32_t target_ip;
+	uint16_t private_port;
+	uint16_t target_port;
+	uint8_t  protocol;
+	uint8_t  pdn_index;
+	uint16_t rec_index;
+};
+
+struct ipa_nat_tuple_index {
+	struct ipa_nat_tuple *slots;
+	uint32_t mask;
+	uint32_t count;
+};
+
 struct ipa_nat_ip4_table_cache {
 	uint32_t public_addr;
 	ipa_mem_descriptor mem_desc;
@@ -256,6 +276,17 @@ struct ipa_nat_ip4_table_cache {
 	ipa_table index_table;
 	struct ipa_nat_indx_tbl_meta_info *index_expn_table_meta;
 	ipa_table_dma_cmd_helper table_dma_cmd_helpers[IPA_NAT_TABLE_DMA_CMD_MAX];
+	struct ipa_nat_tuple_index tuple_index;
+	/*
+	 * Ordinary memory the tables are built in while they grow, before
+	 * they're given to the IPA.  See ipa_nati_grow_ipv4_tbl().
+	 */
+	void *staged_image;
+	/*
+	 * Where ipa_NATI_compact_ipv4_tbl() resumes its walk of the base
+	 * table
+	 */
+	uint16_t compact_cursor;
 };
 
 struct ipa_nat_cache {
@@ -263,6 +294,22 @@ struct ipa_nat_cache {
 	struct ipa_nat_ip4_table_cache ip4_tbl[IPA_NAT_MAX_IP4_TBLS];
 	uint8_t table_cnt;
 	enum ipa3_nat_mem_in nmi;
+	/*
+	 * Set while the IPA is not looking at this cache's tables (ie. a
+	 * hybrid mode migration target).  DMA commands are then applied
+	 * by software rather than posted to the kernel.
+	 */
+	bool offline;
+};
+
+/*
+ * A time stamp per record of the table with handle tbl_hdl, as last
+ * seen by ipa_NATI_query_changed_timestamps()
+ */
+struct ipa_nat_ts_shadow {
+	uint32_t tbl_hdl;
+	uint32_t tot_tbl_ents;
+	uint32_t *time_stamps;
 };
 
 int ipa_nati_add_ipv4_tbl(
@@ -294,6 +341,47 @@ int ipa_nati_add_ipv4_rule(uint32_t tbl_hdl,
 int ipa_nati_del_ipv4_rule(uint32_t tbl_hdl,
 				uint32_t rule_hdl);
 
+int ipa_nati_add_ipv4_rules(uint32_t tbl_hdl,
+				const ipa_nat_ipv4_rule *clnt_rules,
+				uint32_t num_rules,
+				uint32_t *rule_hdls);
+
+int ipa_nati_del_ipv4_rules(uint32_t tbl_hdl,
+				const uint32_t *rule_hdls,
+				uint32_t num_rules);
+
+int ipa_nati_query_timestamps(uint32_t tbl_hdl,
+				const uint32_t *rule_hdls,
+				uint32_t num_rules,
+				uint32_t *time_stamps);
+
+int ipa_nati_query_all_timestamps(uint32_t tbl_hdl,
+				ipa_nat_rule_time_stamp *time_stamps,
+				uint32_t max_rules,
+				uint32_t *num_rules);
+
+int ipa_nati_query_changed_timestamps(uint32_t tbl_hdl,
+				ipa_nat_ts_shadow **shadow,
+				ipa_nat_rule_time_stamp *time_stamps,
+				uint32_t max_rules,
+				uint32_t *num_rules);
+
+void ipa_nati_free_ts_shadow(ipa_nat_ts_shadow *shadow);
+
+int ipa_nati_find_ipv4_rule(uint32_t tbl_hdl,
+				const ipa_nat_ipv4_rule *clnt_rule,
+				uint32_t *rule_hdl);
+
+int ipa_nati_collect_stale(uint32_t tbl_hdl,
+				uint32_t older_than,
+				bool del_stale,
+				ipa_nat_stale_cb stale_cb,
+				void *arb_data_ptr);
+
+int ipa_nati_compact_ipv4_tbl(uint32_t tbl_hdl,
+				uint32_t max_moves,
+				uint32_t *num_moved);
+
 int ipa_nati_get_sram_size(
 	uint32_t* size_ptr);
 
@@ -305,6 +393,12 @@ int ipa_nati_copy_ipv4_tbl(
 	uint32_t          dst_tbl_hdl,
 	ipa_table_walk_cb copy_cb );
 
+int ipa_nati_grow_ipv4_tbl(
+	uint32_t          tbl_hdl,
+	uint16_t          number_of_entries,
+	ipa_table_walk_cb copy_cb,
+	void*             arb_data_ptr );
+
 typedef enum
 {
 	USE_NAT_TABLE   = 0,
@@ -347,6 +441,52 @@ int ipa_nati_ipv4_tbl_stats(
 int ipa_nati_vote_clock(
 	enum ipa_app_clock_vote_type vote_type );
 
+int ipa_nati_set_vote_linger(
+	uint32_t linger_ms );
+
+int ipa_nati_get_vote_stats(
+	ipa_nat_vote_stats* stats_ptr );
+
+/*
+ * What ipa_nati_scan_recs() looks for in a rule record.  All of them
+ * skip records that don't hold a live rule...
+ */
+typedef enum
+{
+	NATI_SCAN_LIVE    = 0, /* every live rule */
+	NATI_SCAN_CHANGED = 1, /* time stamp differs from a shadow copy */
+	NATI_SCAN_STALE   = 2, /* time stamp before a reference */
+} ipa_nati_scan_type;
+
+uint32_t ipa_nati_scan_recs(
+	const struct ipa_nat_rule* recs,
+	uint32_t                   num_recs,
+	ipa_nati_scan_type         type,
+	uint32_t                   ref,
+	const uint32_t*            shadow );
+
+/*
+ * Which of the scan kernels is in use ("avx2", "sse2", "neon" or
+ * "scalar"), and a way of forcing the scalar one, for comparison...
+ */
+const char* ipa_nati_scan_isa(void);
+
+void ipa_nati_scan_force_scalar(
+	bool force );
+
+/*
+ * Read side of the table sequence lock (see ipa_nat_statemach.c).  A
+ * lockless reader holds ipa_nati_read_lock() for as long as it looks
+ * at table memory, and repeats whatever it read between
+ * ipa_nati_read_begin() and ipa_nati_read_retry() until the latter
+ * returns false.  All of them are no-ops on a thread that is already
+ * inside the state machine as a writer.
+ */
+void     ipa_nati_read_lock(void);
+void     ipa_nati_read_unlock(void);
+uint32_t ipa_nati_read_begin(void);
+bool     ipa_nati_read_retry(uint32_t seq);
+
 int ipa_NATI_add_ipv4_tbl(
 	enum ipa3_nat_mem_in nmi,
 	uint32_t             public_ip_addr,
@@ -375,15 +515,65 @@ int ipa_NATI_query_timestamp(
 	uint32_t  rule_hdl,
 	uint32_t* time_stamp);
 
+int ipa_NATI_query_timestamps(
+	uint32_t        tbl_hdl,
+	const uint32_t* rule_hdls,
+	uint32_t        num_rules,
+	uint32_t*       time_stamps);
+
+int ipa_NATI_query_all_timestamps(
+	uint32_t                 tbl_hdl,
+	ipa_nat_rule_time_stamp* time_stamps,
+	uint32_t                 max_rules,
+	uint32_t*                num_rules_ptr);
+
+int ipa_NATI_collect_stale(
+	uint32_t                 tbl_hdl,
+	uint32_t                 older_than,
+	ipa_nat_rule_time_stamp* stale,
+	uint32_t                 max_rules,
+	uint32_t*                num_stale_ptr);
+
+int ipa_NATI_query_changed_timestamps(
+	uint32_t                 tbl_hdl,
+	ipa_nat_ts_shadow*       shadow,
+	ipa_nat_rule_time_stamp* time_stamps,
+	uint32_t                 max_rules,
+	uint32_t*                num_rules_ptr);
+
+int ipa_NATI_find_ipv4_rule(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl);
+
+int ipa_NATI_compact_ipv4_tbl(
+	uint32_t  tbl_hdl,
+	uint32_t  max_moves,
+	uint32_t* old_rule_hdls,
+	uint32_t* new_rule_hdls,
+	uint32_t* num_moved_ptr);
+
 int ipa_NATI_add_ipv4_rule(
 	uint32_t                 tbl_hdl,
 	const ipa_nat_ipv4_rule* clnt_rule,
 	uint32_t*                rule_hdl);
 
+int ipa_NATI_add_ipv4_rules(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rules,
+	uint32_t                 num_rules,
+	uint32_t*                rule_hdls);
+
 int ipa_NATI_del_ipv4_rule(
 	uint32_t tbl_hdl,
 	uint32_t rule_hdl);
 
+int ipa_NATI_del_ipv4_rules(
+	uint32_t        tbl_hdl,
+	const uint32_t* rule_hdls,
+	uint32_t        num_rules,
+	uint32_t*       num_deleted_ptr);
+
 int ipa_NATI_post_ipv4_init_cmd(
 	uint32_t tbl_hdl );
 
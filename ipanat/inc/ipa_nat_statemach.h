@@ -100,6 +100,14 @@ typedef enum {
 	NATI_TRIG_GOTO_DDR   =  9,
 	NATI_TRIG_GOTO_SRAM  = 10,
 	NATI_TRIG_GET_TSTAMP = 11,
+	NATI_TRIG_ADD_RULES  = 12,
+	NATI_TRIG_DEL_RULES  = 13,
+	NATI_TRIG_GET_TSTMPS = 14,
+	NATI_TRIG_FIND_RULE  = 15,
+	NATI_TRIG_TBL_GROW   = 16,
+	NATI_TRIG_TBL_PACK   = 17,
+	NATI_TRIG_GET_STALE  = 18,
+	NATI_TRIG_GET_CHNGD  = 19,
 
 	NATI_TRIG_LAST
 } ipa_nati_trigger;
@@ -116,16 +124,61 @@ typedef struct
 
 /******************************************************************************/
 /**
- * The following structure used to direct map usage.
+ * The following structures are used for the stable rule handles
+ * handed out whenever rules can move (ie. in hybrid mode, or when a
+ * DDR table can grow).
  *
- * Maps are needed to map rule handles..orig to new and new to orig.
- * See comments in ipa_nat_statemach.c on this topic...
+ * A stable handle names a slot.  The slot holds the rule's real
+ * handle in each memory type, and which of the two is current
+ * follows from the state (ie. the memory the IPA is using).  The
+ * generation is bumped each time the slot is freed, so that a stale
+ * stable handle is refused rather than finding a newer rule.  See
+ * comments in ipa_nat_statemach.c on this topic...
  */
 typedef struct
 {
-	uint32_t orig2new_map;
-	uint32_t new2orig_map;
-} nati_map_pair;
+	uint16_t gen;
+	uint16_t rule_hdl[2];
+} nati_hdl_slot;
+
+typedef struct
+{
+	nati_hdl_slot* slots;     /* slot zero never used */
+	uint16_t*      free_list;
+	uint16_t       free_cnt;
+	uint16_t*      slot_of;   /* real rule handle to slot */
+} nati_hdl_tbl;
+
+int  nati_hdls_create(nati_hdl_tbl* hdls);
+void nati_hdls_destroy(nati_hdl_tbl* hdls);
+void nati_hdls_reset(nati_hdl_tbl* hdls);
+
+int nati_hdl_alloc(
+	nati_hdl_tbl* hdls,
+	uint32_t      rule_hdl,
+	uint32_t*     stable_hdl_ptr );
+
+int nati_hdl_resolve(
+	nati_hdl_tbl* hdls,
+	uint32_t      sub,
+	uint32_t      stable_hdl,
+	uint32_t*     rule_hdl_ptr );
+
+int nati_hdl_free(
+	nati_hdl_tbl* hdls,
+	uint32_t      sub,
+	uint32_t      stable_hdl,
+	uint32_t*     rule_hdl_ptr );
+
+int nati_hdl_of(
+	nati_hdl_tbl* hdls,
+	uint32_t      rule_hdl,
+	uint32_t*     stable_hdl_ptr );
+
+int nati_hdl_move(
+	nati_hdl_tbl* hdls,
+	uint32_t      stable_hdl,
+	uint32_t      new_rule_hdl );
 
 /******************************************************************************/
 /**
@@ -140,6 +193,12 @@ typedef struct
 	ipa_nati_state state_to_hold;
 	uint32_t       ddr_tbl_hdl;
 	uint32_t       sram_tbl_hdl;
+	/*
+	 * What the DDR table was sized for, doubled each time it grows,
+	 * and how far it may grow (not at all when zero)
+	 */
+	uint16_t       ddr_tbl_ents;
+	uint32_t       ddr_grow_limit;
 	uint32_t       tot_slots_in_sram;
 	uint32_t       back_to_sram_thresh;
 	/*
@@ -148,10 +207,9 @@ typedef struct
 	 */
 	uint32_t       tot_rules_in_table[2];
 	/*
-	 * map_pairs[0] for ddr, and
-	 * map_pairs[1] for sram
+	 * Stable handles, used in all but NATI_STATE_SRAM_ONLY
 	 */
-	nati_map_pair  map_pairs[2];
+	nati_hdl_tbl   hdls;
 	/*
 	 * sw_stats[0] for ddr, and
 	 * sw_stats[1] for sram
@@ -168,6 +226,14 @@ typedef struct
 #define DDR_SUB  0
 #define SRAM_SUB 1
 
+/*
+ * The portion of SRAM's slots a DDR table must shrink to before
+ * moving back to SRAM
+ */
+#undef PRCNT_OF
+#define PRCNT_OF(v) \
+	((.25) * (v))
+
 #undef BACK2_UNSTARTED_STATE
 #define BACK2_UNSTARTED_STATE() \
 	nati_obj.prev_state = nati_obj.curr_state = NATI_STATE_NULL;
@@ -199,14 +265,19 @@ typedef struct
 	( nati_obj.curr_state == NATI_STATE_SRAM_ONLY || \
 	  nati_obj.curr_state == NATI_STATE_HYBRID )
 
+#undef  DDR_CURRENTLY_ACTIVE
+#define DDR_CURRENTLY_ACTIVE() \
+	( nati_obj.curr_state == NATI_STATE_DDR_ONLY || \
+	  nati_obj.curr_state == NATI_STATE_HYBRID_DDR )
+
 #define SRAM_TO_BE_ACCESSED(t) \
 	( SRAM_CURRENTLY_ACTIVE() || \
 	  (t) == NATI_TRIG_GOTO_SRAM || \
 	  (t) == NATI_TRIG_TBL_SWITCH )
 
 /*
- * NOTE: The exclusion of timestamp retrieval and table creation
- *       below.
+ * NOTE: The exclusion of timestamp retrieval, rule lookup and table
+ *       creation below.
  *
  * Why?
  *
@@ -216,6 +287,11 @@ typedef struct
  *   accesses, hence would lead to too many successive votes. Instead,
  *   it will be handled differently and in the app layer above.
  *
+ *  In re rule lookup:
+ *
+ *   Because it is answered from the tuple index, which lives in
+ *   ordinary memory, hence sram isn't accessed at all.
+ *
  *  In re table creation:
  *
  *    Because it can't be known, apriori, whether or not sram is
@@ -226,8 +302,45 @@ typedef struct
 #define VOTE_REQUIRED(t) \
 	( SRAM_TO_BE_ACCESSED(t) && \
 	  (t) != NATI_TRIG_GET_TSTAMP && \
+	  (t) != NATI_TRIG_GET_TSTMPS && \
+	  (t) != NATI_TRIG_GET_CHNGD && \
+	  (t) != NATI_TRIG_FIND_RULE && \
 	  (t) != NATI_TRIG_ADD_TABLE )
 
+/******************************************************************************/
+/**
+ * Triggers that only read tables.  These don't take nat_mutex (unless
+ * a writer is the one asking), so they never hold up rule insertion.
+ * NATI_TRIG_GET_CHNGD isn't one of them: it updates the caller's
+ * shadow as it reads, so can't be rerun...
+ */
+#undef  READ_ONLY_TRIGGER
+#define READ_ONLY_TRIGGER(t) \
+	( (t) == NATI_TRIG_GET_TSTAMP || \
+	  (t) == NATI_TRIG_GET_TSTMPS || \
+	  (t) == NATI_TRIG_WLK_TABLE  || \
+	  (t) == NATI_TRIG_TBL_STATS )
+
+/**
+ * ...of which these have no side effects, hence the state machine can
+ * simply rerun them when a writer got in.  The others copy the table
+ * out themselves, see ipa_NATI_walk_ipv4_tbl().
+ */
+#undef  RETRYABLE_TRIGGER
+#define RETRYABLE_TRIGGER(t) \
+	( (t) == NATI_TRIG_GET_TSTAMP || \
+	  (t) == NATI_TRIG_GET_TSTMPS )
+
+/**
+ * Triggers that map, unmap, allocate or free what lockless readers
+ * look at.  They wait for those readers to leave before running.
+ */
+#undef  EXCLUSIVE_TRIGGER
+#define EXCLUSIVE_TRIGGER(t) \
+	( (t) == NATI_TRIG_ADD_TABLE || \
+	  (t) == NATI_TRIG_DEL_TABLE || \
+	  (t) == NATI_TRIG_TBL_GROW )
+
 /******************************************************************************/
 /**
  * A helper macro for changing a nati object's state...
@@ -333,12 +446,34 @@ typedef struct
 	uint32_t*                rule_hdl;
 } rule_add_args;
 
+typedef struct
+{
+	uint32_t                 tbl_hdl;
+	const ipa_nat_ipv4_rule* clnt_rules;
+	uint32_t                 num_rules;
+	uint32_t*                rule_hdls;
+} rules_add_args;
+
 typedef struct
 {
 	uint32_t tbl_hdl;
 	uint32_t rule_hdl;
 } rule_del_args;
 
+typedef struct
+{
+	uint32_t                 tbl_hdl;
+	const ipa_nat_ipv4_rule* clnt_rule;
+	uint32_t*                rule_hdl;
+} rule_find_args;
+
+typedef struct
+{
+	uint32_t        tbl_hdl;
+	const uint32_t* rule_hdls;
+	uint32_t        num_rules;
+} rules_del_args;
+
 typedef struct
 {
 	uint32_t  tbl_hdl;
@@ -346,4 +481,41 @@ typedef struct
 	uint32_t* time_stamp;
 } timestap_query_args;
 
+typedef struct
+{
+	uint32_t  tbl_hdl;
+	uint32_t  max_moves;
+	uint32_t* num_moved_ptr;
+} table_compact_args;
+
+/*
+ * The stale rules are handed back in an array allocated by the state
+ * machine, which the caller frees...
+ */
+typedef struct
+{
+	uint32_t                  tbl_hdl;
+	uint32_t                  older_than;
+	bool                      del_stale;
+	ipa_nat_rule_time_stamp** stale_ptr;
+	uint32_t*                 num_stale_ptr;
+} stale_collect_args;
+
+/*
+ * When rule_hdls is NULL, the whole table is read into
+ * all_time_stamps, and num_rules is its size.  With a shadow, only
+ * the rules whose time stamp has changed are read (see
+ * NATI_TRIG_GET_CHNGD)...
+ */
+typedef struct
+{
+	uint32_t                 tbl_hdl;
+	const uint32_t*          rule_hdls;
+	uint32_t                 num_rules;
+	uint32_t*                time_stamps;
+	ipa_nat_rule_time_stamp* all_time_stamps;
+	uint32_t*                num_found_ptr;
+	ipa_nat_ts_shadow*       shadow;
+} timestamps_query_args;
+
 #endif /* #if !defined(_IPA_NAT_STATEMACH_H_) */
@@ -35,6 +35,8 @@
 #include <time.h>
 #include <linux/msm_ipa.h>
 
+#include "ipa_nat_backend.h"
+
 #ifndef FALSE
 #define FALSE 0
 #endif
@@ -52,21 +54,74 @@ size_t strlcpy(char* dst, const char* src, size_t size);
 #endif
 #endif
 
+/*
+ * Log levels, least verbose first.  IPAERR is always printed.  The
+ * others are checked against the run time level, see
+ * ipa_nat_set_log_level(), before any of their arguments are
+ * evaluated.  Hence a rule formatted for a message that isn't going
+ * to be printed is never formatted.
+ *
+ * IPADBG is only compiled in when NAT_DEBUG is defined.  Without it,
+ * IPADBG and its arguments are removed from the build entirely.
+ */
+typedef enum
+{
+	IPA_NAT_LOG_ERR  = 0,
+	IPA_NAT_LOG_WARN = 1,
+	IPA_NAT_LOG_INFO = 2,
+	IPA_NAT_LOG_DBG  = 3,
+} ipa_nat_log_level;
+
+#ifndef IPA_NAT_DEFAULT_LOG_LEVEL
+# ifdef NAT_DEBUG
+#  define IPA_NAT_DEFAULT_LOG_LEVEL IPA_NAT_LOG_DBG
+# else
+#  define IPA_NAT_DEFAULT_LOG_LEVEL IPA_NAT_LOG_INFO
+# endif
+#endif
+
+extern int ipa_nat_log_lvl;
+
+#undef IPA_NAT_LOG_ON
+#define IPA_NAT_LOG_ON(l) \
+	( (int) (l) <= ipa_nat_log_lvl )
+
 #define IPAERR(fmt, ...)  printf("ERR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
 
-#define IPAINFO(fmt, ...)  printf("INFO: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+#define IPAINFO(fmt, ...) \
+	do { \
+		if ( IPA_NAT_LOG_ON(IPA_NAT_LOG_INFO) ) \
+			printf("INFO: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+	} while ( 0 )
 
-#define IPAWARN(fmt, ...)  printf("WARN: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+#define IPAWARN(fmt, ...) \
+	do { \
+		if ( IPA_NAT_LOG_ON(IPA_NAT_LOG_WARN) ) \
+			printf("WARN: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+	} while ( 0 )
 
 #undef UNUSED
 #define UNUSED(v) (void)(v)
 
 #ifdef NAT_DEBUG
-#define IPADBG(fmt, ...) printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+#define IPADBG(fmt, ...) \
+	do { \
+		if ( IPA_NAT_LOG_ON(IPA_NAT_LOG_DBG) ) \
+			printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+	} while ( 0 )
 #else
 #define IPADBG(fmt, ...)
 #endif
 
+/**
+ * ipa_nat_set_log_level() - sets the run time log level
+ * @level: [in] the most verbose level to be printed
+ *
+ * Returns the previous level
+ */
+ipa_nat_log_level ipa_nat_set_log_level(
+	ipa_nat_log_level level);
+
 typedef struct
 {
 	int              fd;
@@ -62,6 +62,19 @@ typedef enum
 #define VALID_IPA_TABLE_DMA_TYPE(t) \
 	( (t) >= IPA_NAT_BASE_TBL && (t) <= IPA_IPV6CT_EXPN_TBL )
 
+/*
+ * The most dma entries adding or deleting one rule takes (an IPv4
+ * rule touches both the NAT and index tables)
+ */
+#define MAX_DMA_ENTRIES_FOR_ADD  4
+#define MAX_DMA_ENTRIES_FOR_DEL  3
+
+/*
+ * Upper bound on the dma entries bundled into a single
+ * IPA_IOC_TABLE_DMA_CMD by the bulk rule APIs
+ */
+#define MAX_DMA_ENTRIES_FOR_BATCH 64
+
 /*
  *    --------- NAT Rule Handle Entry ID structure ---------
  *
@@ -170,6 +183,34 @@ typedef struct
 	uint16_t                   cur_tbl_cnt;
 	uint16_t                   cur_expn_tbl_cnt;
 
+	/*
+	 * Stack of free expansion slots (absolute indices). When
+	 * allocated, it replaces the linear search for an open slot
+	 * during a tail insert.
+	 */
+	uint16_t*                  expn_free_list;
+	uint16_t                   expn_free_cnt;
+
+	/*
+	 * Per bucket book keeping, only maintained once
+	 * ipa_table_create_bucket_info() has been called.  A bucket is a
+	 * base table slot together with the expansion records chained off
+	 * of it, and a chain is a bucket holding two or more records.
+	 *
+	 * The tail of each bucket lets a collision be appended without
+	 * walking the chain.  The rest are chain statistics, kept current
+	 * as records come and go, so that reporting them doesn't mean
+	 * walking the table either.
+	 */
+	uint16_t*                  bucket_tail;    /* last record per bucket */
+	uint16_t*                  bucket_len;     /* records per bucket */
+	uint16_t*                  expn_bucket;    /* bucket per expansion slot */
+	uint32_t*                  chain_len_hist; /* buckets per record count */
+	uint32_t                   tot_chains;
+	uint32_t                   tot_chain_ents; /* records in all chains */
+	uint16_t                   min_chain_len;
+	uint16_t                   max_chain_len;
+
 	ipa_table_entry_interface* entry_interface;
 
 	ipa_table_dma_cmd_helper*  dma_help[HELP_UPDATE_MAX];
@@ -215,6 +256,29 @@ uint8_t* ipa_table_calculate_addresses(
 void ipa_table_reset(
 	ipa_table* table);
 
+int ipa_table_create_expn_free_list(
+	ipa_table* table);
+
+void ipa_table_destroy_expn_free_list(
+	ipa_table* table);
+
+int ipa_table_create_bucket_info(
+	ipa_table* table);
+
+void ipa_table_destroy_bucket_info(
+	ipa_table* table);
+
+int ipa_table_snapshot_alloc(
+	ipa_table* table,
+	ipa_table* snap);
+
+void ipa_table_snapshot_take(
+	ipa_table* table,
+	ipa_table* snap);
+
+void ipa_table_snapshot_free(
+	ipa_table* snap);
+
 int ipa_table_add_entry(
 	ipa_table*                  table,
 	void*                       user_data,
@@ -246,6 +310,10 @@ void* ipa_table_get_entry_by_index(
 	ipa_table* table,
 	uint16_t   index);
 
+uint32_t ipa_table_get_entry_hdl(
+	ipa_table* table,
+	uint16_t   index);
+
 void ipa_table_dma_cmd_helper_init(
 	ipa_table_dma_cmd_helper* dma_cmd_helper,
 	uint8_t                   table_indx,
@@ -279,6 +347,10 @@ int ipa_table_iterator_end(
 int ipa_table_iterator_is_head_with_tail(
 	ipa_table_iterator* iterator);
 
+uint16_t ipa_table_get_chain_head(
+	ipa_table* table,
+	uint16_t   index);
+
 int ipa_calc_num_sram_table_entries(
 	uint32_t  sram_size,
 	uint32_t  table1_ent_size,
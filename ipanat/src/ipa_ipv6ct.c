@@ -38,11 +38,78 @@
 #define IPA_IPV6CT_DEBUG_FILE_PATH "/sys/kernel/debug/ipa/ipv6ct"
 #define IPA_IPV6CT_TABLE_NAME "IPA IPv6CT table"
 
-static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t number_of_entries, uint8_t table_index);
+/*
+ * The table, of the two, that the IPA is using
+ */
+#undef  IPV6CT_CURR_SUB
+#define IPV6CT_CURR_SUB(o) \
+	( ((o)->curr_state == NATI_STATE_SRAM_ONLY || \
+	   (o)->curr_state == NATI_STATE_HYBRID) ? SRAM_SUB : DDR_SUB )
+
+#undef  IPV6CT_IN_HYBRID_STATE
+#define IPV6CT_IN_HYBRID_STATE(o) \
+	( (o)->curr_state == NATI_STATE_HYBRID || \
+	  (o)->curr_state == NATI_STATE_HYBRID_DDR )
+
+/*
+ * The following is handed to ipa_ipv6ct_migrate_rule() below
+ */
+typedef struct
+{
+	ipa_ipv6ct_obj* obj;
+	uint32_t dst_sub;
+} ipa_ipv6ct_migrate_args;
+
+/*
+ * Book keeping for a rule whose add has been staged into a dma
+ * command, but not yet posted
+ */
+typedef struct
+{
+	uint32_t rule_sub;    /* subscript into caller's rule array */
+	uint16_t bucket;
+	uint16_t entry_index;
+	uint32_t rule_handle;
+} ipa_ipv6ct_staged_add;
+
+#define MAX_STAGED_ADDS \
+	(MAX_DMA_ENTRIES_FOR_BATCH / MAX_DMA_ENTRIES_FOR_ADD)
+
+/*
+ * What is needed to delete a rule, from command generation through
+ * to the table clean up done after the dma command is posted
+ */
+typedef struct
+{
+	uint32_t rule_sub;    /* subscript into caller's handle array */
+	uint16_t bucket;
+	ipa_table_iterator table_iterator;
+} ipa_ipv6ct_staged_del;
+
+#define MAX_STAGED_DELS \
+	(MAX_DMA_ENTRIES_FOR_BATCH / MAX_DMA_ENTRIES_FOR_DEL)
+
+static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t number_of_entries, uint8_t table_index,
+	enum ipa3_nat_mem_in nmi);
+static int ipa_ipv6ct_create_sram_table(ipa_ipv6ct_obj* obj, uint8_t table_index);
 static int ipa_ipv6ct_destroy_table(ipa_ipv6ct_table* ipv6ct_table);
 static void ipa_ipv6ct_create_table_dma_cmd_helpers(ipa_ipv6ct_table* ipv6ct_table, uint8_t table_indx);
 static int ipa_ipv6ct_post_init_cmd(ipa_ipv6ct_table* ipv6ct_table, uint8_t tbl_index);
-static int ipa_ipv6ct_post_dma_cmd(struct ipa_ioc_nat_dma_cmd* cmd);
+static int ipa_ipv6ct_post_dma_cmd(ipa_ipv6ct_table* ipv6ct_table, struct ipa_ioc_nat_dma_cmd* cmd);
+static void ipa_ipv6ct_apply_dma_cmd(ipa_ipv6ct_table* ipv6ct_table, const struct ipa_ioc_nat_dma_cmd* cmd);
+static int ipa_ipv6ct_vote(ipa_ipv6ct_table* ipv6ct_table, enum ipa_app_clock_vote_type vote_type);
+static int ipa_ipv6ct_add_entry(ipa_ipv6ct_table* ipv6ct_table, const ipa_ipv6ct_rule* user_rule, uint32_t* rule_handle);
+static int ipa_ipv6ct_flush_staged_adds(ipa_ipv6ct_obj* obj, ipa_ipv6ct_table* ipv6ct_table,
+	struct ipa_ioc_nat_dma_cmd* cmd, ipa_ipv6ct_staged_add* staged, uint32_t* num_staged, uint32_t* rule_handles);
+static int ipa_ipv6ct_del_entry(ipa_ipv6ct_table* ipv6ct_table, uint32_t rule_handle);
+static int ipa_ipv6ct_locate_del(ipa_ipv6ct_table* ipv6ct_table, uint32_t rule_handle, ipa_ipv6ct_staged_del* del);
+static void ipa_ipv6ct_finish_del(ipa_ipv6ct_table* ipv6ct_table, ipa_ipv6ct_staged_del* del);
+static int ipa_ipv6ct_rule_added(ipa_ipv6ct_obj* obj, uint32_t real_rule_handle, uint32_t* rule_handle);
+static void ipa_ipv6ct_rule_deleted(ipa_ipv6ct_obj* obj, uint32_t rule_handle);
+static void ipa_ipv6ct_check_back_to_sram(ipa_ipv6ct_obj* obj);
+static int ipa_ipv6ct_switch_table(ipa_ipv6ct_obj* obj, uint32_t dst_sub);
+static int ipa_ipv6ct_migrate_rule(ipa_table* table_ptr, uint32_t tbl_rule_hdl, void* record_ptr,
+	uint16_t record_index, void* meta_record_ptr, uint16_t meta_record_index, void* arb_data_ptr);
 static uint16_t ipa_ipv6ct_hash(const ipa_ipv6ct_rule* rule, uint16_t size);
 static uint16_t ipa_ipv6ct_xor_segments(uint64_t num);
 
@@ -74,14 +141,36 @@ static ipa_table_entry_interface entry_interface =
  * @number_of_entries: [in] number of IPv6CT entries
  * @table_handle: [out] handle of new IPv6CT table
  *
- * This function creates new IPv6CT table and posts IPv6CT init command to HW
+ * This function creates new IPv6CT table in DDR and posts IPv6CT init
+ * command to HW
  *
  * Returns:	0  On Success, negative on failure
  */
 int ipa_ipv6ct_add_tbl(uint16_t number_of_entries, uint32_t* table_handle)
+{
+	return ipa_ipv6ct_add_tbl_ext(number_of_entries, NULL, table_handle);
+}
+
+/**
+ * ipa_ipv6ct_add_tbl_ext() - Adds a new IPv6CT table
+ * @number_of_entries: [in] number of IPv6CT entries
+ * @mem_type_ptr: [in] "DDR", "SRAM" or "HYBRID"; NULL means DDR
+ * @table_handle: [out] handle of new IPv6CT table
+ *
+ * This function creates the new IPv6CT table's SRAM and/or DDR tables
+ * and posts IPv6CT init command to HW for the one to be used first.
+ * When SRAM can hold number_of_entries, a hybrid table is kept in SRAM
+ * only, and when SRAM isn't available, in DDR only.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_add_tbl_ext(uint16_t number_of_entries, const char* mem_type_ptr, uint32_t* table_handle)
 {
 	int ret;
+	ipa_ipv6ct_obj* obj;
 	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_nati_state state;
+	uint8_t table_index;
 
 	IPADBG("\n");
 
@@ -93,10 +182,17 @@ int ipa_ipv6ct_add_tbl(uint16_t number_of_entries, uint32_t* table_handle)
 
 	*table_handle = 0;
 
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
 	if (ipv6ct.table_cnt >= IPA_IPV6CT_MAX_TBLS)
 	{
 		IPAERR("Can't add addition IPv6 connection tracking table. Maximum %d tables allowed\n", IPA_IPV6CT_MAX_TBLS);
-		return -EINVAL;
+		ret = -EINVAL;
+		goto unlock;
 	}
 
 	if (!ipv6ct.ipa_desc)
@@ -105,7 +201,8 @@ int ipa_ipv6ct_add_tbl(uint16_t number_of_entries, uint32_t* table_handle)
 		if (ipv6ct.ipa_desc == NULL)
 		{
 			IPAERR("failed to open IPA driver file descriptor\n");
-			return -EIO;
+			ret = -EIO;
+			goto unlock;
 		}
 	}
 
@@ -116,16 +213,64 @@ int ipa_ipv6ct_add_tbl(uint16_t number_of_entries, uint32_t* table_handle)
 		goto bail_ipa_desc;
 	}
 
-	ipv6ct_table = &ipv6ct.tables[ipv6ct.table_cnt];
-	ret = ipa_ipv6ct_create_table(ipv6ct_table, number_of_entries, ipv6ct.table_cnt);
-	if (ret)
+	table_index = ipv6ct.table_cnt;
+	obj = &ipv6ct.tables[table_index];
+	memset(obj, 0, sizeof(*obj));
+
+	state = mem_type_str_to_ipa_nati_state(mem_type_ptr);
+
+	if (state != NATI_STATE_DDR_ONLY)
 	{
-		IPAERR("unable to create ipv6ct table Error: %d\n", ret);
-		goto bail_ipa_desc;
+		ret = ipa_ipv6ct_create_sram_table(obj, table_index);
+		if (ret == 0)
+		{
+			if (state == NATI_STATE_HYBRID && obj->tot_slots_in_sram >= number_of_entries)
+			{
+				/* SRAM can hold all that was asked for, no need for DDR */
+				state = NATI_STATE_SRAM_ONLY;
+			}
+		}
+		else if (state == NATI_STATE_HYBRID)
+		{
+			IPAINFO("SRAM not available, IPv6CT table will be in DDR only\n");
+			state = NATI_STATE_DDR_ONLY;
+		}
+		else
+		{
+			IPAERR("unable to create ipv6ct table in SRAM Error: %d\n", ret);
+			goto bail_ipa_desc;
+		}
 	}
 
-	/* Initialize the ipa hw with ipv6ct table dimensions */
-	ret = ipa_ipv6ct_post_init_cmd(ipv6ct_table, ipv6ct.table_cnt);
+	if (state != NATI_STATE_SRAM_ONLY)
+	{
+		ret = ipa_ipv6ct_create_table(
+			&obj->sub_tables[DDR_SUB], number_of_entries, table_index, IPA_NAT_MEM_IN_DDR);
+		if (ret)
+		{
+			IPAERR("unable to create ipv6ct table Error: %d\n", ret);
+			goto bail_ipv6ct_table;
+		}
+	}
+
+	if (state == NATI_STATE_HYBRID)
+	{
+		ret = nati_hdls_create(&obj->hdls);
+		if (ret)
+			goto bail_ipv6ct_table;
+	}
+
+	SET_NATIOBJ_STATE(obj, state);
+
+	/* Initialize the ipa hw with the dimensions of the ipv6ct table to be used */
+	ipv6ct_table = &obj->sub_tables[IPV6CT_CURR_SUB(obj)];
+
+	ret = ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_VOTE);
+	if (ret == 0)
+	{
+		ret = ipa_ipv6ct_post_init_cmd(ipv6ct_table, table_index);
+		ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_DEVOTE);
+	}
 	if (ret)
 	{
 		IPAERR("unable to post ipv6ct_init command Error %d\n", ret);
@@ -136,23 +281,37 @@ int ipa_ipv6ct_add_tbl(uint16_t number_of_entries, uint32_t* table_handle)
 	++ipv6ct.table_cnt;
 	*table_handle = ipv6ct.table_cnt;
 
-	IPADBG("Returning table handle 0x%x\n", *table_handle);
-	return 0;
+	IPADBG("Returning table handle 0x%x in state %s\n", *table_handle, ipa_nati_state_as_str(obj->curr_state));
+	goto unlock;
 
 bail_ipv6ct_table:
-	ipa_ipv6ct_destroy_table(ipv6ct_table);
+	if (obj->sub_tables[SRAM_SUB].mem_desc.valid)
+		ipa_ipv6ct_destroy_table(&obj->sub_tables[SRAM_SUB]);
+	if (obj->sub_tables[DDR_SUB].mem_desc.valid)
+		ipa_ipv6ct_destroy_table(&obj->sub_tables[DDR_SUB]);
+	nati_hdls_destroy(&obj->hdls);
+	memset(obj, 0, sizeof(*obj));
 bail_ipa_desc:
 	if (!ipv6ct.table_cnt) {
 		ipa_descriptor_close(ipv6ct.ipa_desc);
 		ipv6ct.ipa_desc = NULL;
 	}
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
 	return ret;
 }
 
 int ipa_ipv6ct_del_tbl(uint32_t table_handle)
 {
+	ipa_ipv6ct_obj* obj;
 	ipa_ipv6ct_table* ipv6ct_table;
-	int ret;
+	uint32_t sub;
+	bool in_sram;
+	int ret = 0, del_ret;
 
 	IPADBG("\n");
 
@@ -175,21 +334,43 @@ int ipa_ipv6ct_del_tbl(uint32_t table_handle)
 		return -EINVAL;
 	}
 
-	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
-	if (!ipv6ct_table->mem_desc.valid)
+	obj = &ipv6ct.tables[table_handle - 1];
+	if (!obj->sub_tables[IPV6CT_CURR_SUB(obj)].mem_desc.valid)
 	{
 		IPAERR("invalid table handle %d\n", table_handle);
 		ret = -EINVAL;
 		goto unlock;
 	}
 
-	ret = ipa_ipv6ct_destroy_table(ipv6ct_table);
-	if (ret)
+	for (sub = DDR_SUB; sub <= SRAM_SUB; sub++)
 	{
-		IPAERR("unable to delete IPV6CT table with handle %d\n", table_handle);
-		goto unlock;
+		ipv6ct_table = &obj->sub_tables[sub];
+		if (!ipv6ct_table->mem_desc.valid)
+			continue;
+
+		/* The table is gone once destroyed, hence remember where it was */
+		in_sram = ipv6ct_table->mem_desc.sram_to_be_used;
+
+		if (in_sram && ipa_nat_vote_clock(IPA_APP_CLK_VOTE))
+			IPAWARN("Voting clock on failed\n");
+
+		del_ret = ipa_ipv6ct_destroy_table(ipv6ct_table);
+		if (del_ret)
+		{
+			IPAERR("unable to delete IPV6CT table with handle %d\n", table_handle);
+			ret = (ret) ? ret : del_ret;
+		}
+
+		if (in_sram && ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE))
+			IPAWARN("Voting clock off failed\n");
 	}
 
+	if (ret)
+		goto unlock;
+
+	nati_hdls_destroy(&obj->hdls);
+	memset(obj, 0, sizeof(*obj));
+
 	if (!--ipv6ct.table_cnt) {
 		ipa_descriptor_close(ipv6ct.ipa_desc);
 		ipv6ct.ipa_desc = NULL;
@@ -209,15 +390,104 @@ unlock:
 int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule, uint32_t* rule_handle)
 {
 	int ret;
+	ipa_ipv6ct_obj* obj;
 	ipa_ipv6ct_table* ipv6ct_table;
-	uint16_t new_entry_index;
 	uint32_t new_entry_handle;
+
+	IPADBG("In\n");
+
+	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
+	{
+		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
+		return -EINVAL;
+	}
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		rule_handle == NULL || user_rule == NULL)
+	{
+		IPAERR("Invalid parameters table_handle=%d rule_handle=%pK user_rule=%pK\n",
+			table_handle, rule_handle, user_rule);
+		return -EINVAL;
+	}
+	IPADBG("Passed Table handle: 0x%x\n", table_handle);
+
+	if (user_rule->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+	{
+		IPAERR("invalid parameter protocol=%d\n", user_rule->protocol);
+		return -EINVAL;
+	}
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	obj = &ipv6ct.tables[table_handle - 1];
+	ipv6ct_table = &obj->sub_tables[IPV6CT_CURR_SUB(obj)];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_VOTE);
+	if (ret)
+	{
+		IPAERR("Voting clock on failed\n");
+		goto unlock;
+	}
+
+	ret = ipa_ipv6ct_add_entry(ipv6ct_table, user_rule, &new_entry_handle);
+
+	if (ret && obj->curr_state == NATI_STATE_HYBRID)
+	{
+		/*
+		 * The SRAM table is full. Move the rules to DDR, and try
+		 * again there...
+		 */
+		IPAINFO("Add of rule failed...attempting table switch\n");
+
+		ret = ipa_ipv6ct_switch_table(obj, DDR_SUB);
+		if (ret == 0)
+			ret = ipa_ipv6ct_add_entry(&obj->sub_tables[DDR_SUB], user_rule, &new_entry_handle);
+	}
+
+	if (ret == 0)
+		ret = ipa_ipv6ct_rule_added(obj, new_entry_handle, rule_handle);
+
+	if (ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_DEVOTE))
+		IPAWARN("Voting clock off failed\n");
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+
+	return ret;
+}
+
+int ipa_ipv6ct_add_rules(uint32_t table_handle, const ipa_ipv6ct_rule* user_rules, uint32_t num_rules,
+	uint32_t* rule_handles)
+{
+	ipa_ipv6ct_obj* obj;
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_ipv6ct_table* vote_table;
+	ipa_ipv6ct_staged_add staged[MAX_STAGED_ADDS];
+	uint32_t num_staged = 0;
 	uint32_t cmd_sz =
 		sizeof(struct ipa_ioc_nat_dma_cmd) +
-		(MAX_DMA_ENTRIES_FOR_ADD * sizeof(struct ipa_ioc_nat_dma_one));
+		(MAX_DMA_ENTRIES_FOR_BATCH * sizeof(struct ipa_ioc_nat_dma_one));
 	char cmd_buf[cmd_sz];
 	struct ipa_ioc_nat_dma_cmd* cmd =
 		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+	uint32_t i, j;
+	int ret = 0, rule_ret;
 
 	IPADBG("In\n");
 
@@ -230,19 +500,153 @@ int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule,
 	}
 
 	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
-		rule_handle == NULL || user_rule == NULL)
+		user_rules == NULL || num_rules == 0 || rule_handles == NULL)
 	{
-		IPAERR("Invalid parameters table_handle=%d rule_handle=%pK user_rule=%pK\n",
-			table_handle, rule_handle, user_rule);
+		IPAERR("Invalid parameters table_handle=%d user_rules=%pK num_rules=%u rule_handles=%pK\n",
+			table_handle, user_rules, num_rules, rule_handles);
 		return -EINVAL;
 	}
-	IPADBG("Passed Table handle: 0x%x\n", table_handle);
+	IPADBG("Passed Table handle: 0x%x num_rules: %u\n", table_handle, num_rules);
 
-	if (user_rule->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+	memset(rule_handles, 0, num_rules * sizeof(uint32_t));
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
 	{
-		IPAERR("invalid parameter protocol=%d\n", user_rule->protocol);
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	obj = &ipv6ct.tables[table_handle - 1];
+	ipv6ct_table = vote_table = &obj->sub_tables[IPV6CT_CURR_SUB(obj)];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = ipa_ipv6ct_vote(vote_table, IPA_APP_CLK_VOTE);
+	if (ret)
+	{
+		IPAERR("Voting clock on failed\n");
+		goto unlock;
+	}
+
+	for (i = 0; i < num_rules; i++)
+	{
+		const ipa_ipv6ct_rule* user_rule = &user_rules[i];
+		ipa_ipv6ct_staged_add* add;
+		uint16_t bucket;
+		bool collides = false;
+
+		if (user_rule->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+		{
+			IPAERR("rule %u rejected, invalid protocol=%d\n", i, user_rule->protocol);
+			ret = -EINVAL;
+			continue;
+		}
+
+		bucket = ipa_ipv6ct_hash(user_rule, ipv6ct_table->table.table_entries - 1);
+
+		/*
+		 * A staged rule's linkage is only written by the IPA when the
+		 * dma command is posted, hence the bucket of a staged rule
+		 * can't be trusted until then...
+		 */
+		for (j = 0; j < num_staged && !collides; j++)
+			collides = (staged[j].bucket == bucket);
+
+		if (collides || num_staged == MAX_STAGED_ADDS ||
+			cmd->entries + MAX_DMA_ENTRIES_FOR_ADD > MAX_DMA_ENTRIES_FOR_BATCH)
+		{
+			rule_ret = ipa_ipv6ct_flush_staged_adds(obj, ipv6ct_table, cmd, staged, &num_staged, rule_handles);
+			ret = (rule_ret) ? rule_ret : ret;
+		}
+
+		add = &staged[num_staged];
+		add->rule_sub = i;
+		add->bucket = add->entry_index = bucket;
+
+		rule_ret = ipa_table_add_entry(
+			&ipv6ct_table->table, (void*)user_rule, &add->entry_index, &add->rule_handle, cmd);
+
+		if (rule_ret && obj->curr_state == NATI_STATE_HYBRID)
+		{
+			/*
+			 * The SRAM table is full.  Post what is staged, move the
+			 * rules to DDR, and carry on there...
+			 */
+			IPAINFO("Add of rule %u failed...attempting table switch\n", i);
+
+			rule_ret = ipa_ipv6ct_flush_staged_adds(obj, ipv6ct_table, cmd, staged, &num_staged, rule_handles);
+			ret = (rule_ret) ? rule_ret : ret;
+
+			rule_ret = ipa_ipv6ct_switch_table(obj, DDR_SUB);
+			if (rule_ret == 0)
+			{
+				ipv6ct_table = &obj->sub_tables[DDR_SUB];
+
+				add = &staged[num_staged];
+				add->rule_sub = i;
+				add->bucket = add->entry_index =
+					ipa_ipv6ct_hash(user_rule, ipv6ct_table->table.table_entries - 1);
+
+				rule_ret = ipa_table_add_entry(
+					&ipv6ct_table->table, (void*)user_rule, &add->entry_index, &add->rule_handle, cmd);
+			}
+		}
+
+		if (rule_ret)
+		{
+			IPAERR("failed to add IPV6CT rule %u\n", i);
+			ret = rule_ret;
+			continue;
+		}
+
+		num_staged++;
+	}
+
+	rule_ret = ipa_ipv6ct_flush_staged_adds(obj, ipv6ct_table, cmd, staged, &num_staged, rule_handles);
+	ret = (rule_ret) ? rule_ret : ret;
+
+	if (ipa_ipv6ct_vote(vote_table, IPA_APP_CLK_DEVOTE))
+		IPAWARN("Voting clock off failed\n");
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+
+	return ret;
+}
+
+int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle)
+{
+	ipa_ipv6ct_obj* obj;
+	ipa_ipv6ct_table* ipv6ct_table;
+	uint32_t real_rule_handle = rule_handle;
+	uint32_t sub;
+	int ret;
+
+	IPADBG("In\n");
+
+	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
+	{
+		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
+		return -EINVAL;
+	}
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		rule_handle == IPA_TABLE_INVALID_ENTRY)
+	{
+		IPAERR("Invalid parameters table_handle=%d rule_handle=%d\n", table_handle, rule_handle);
 		return -EINVAL;
 	}
+	IPADBG("Passed Table: 0x%x and rule handle 0x%x\n", table_handle, rule_handle);
 
 	if (pthread_mutex_lock(&ipv6ct_mutex))
 	{
@@ -250,7 +654,9 @@ int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule,
 		return -EINVAL;
 	}
 
-	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
+	obj = &ipv6ct.tables[table_handle - 1];
+	sub = IPV6CT_CURR_SUB(obj);
+	ipv6ct_table = &obj->sub_tables[sub];
 	if (!ipv6ct_table->mem_desc.valid)
 	{
 		IPAERR("invalid table handle %d\n", table_handle);
@@ -258,52 +664,563 @@ int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule,
 		goto unlock;
 	}
 
-	new_entry_index = ipa_ipv6ct_hash(user_rule, ipv6ct_table->table.table_entries - 1);
+	if (IPV6CT_IN_HYBRID_STATE(obj) &&
+		nati_hdl_resolve(&obj->hdls, sub, rule_handle, &real_rule_handle))
+	{
+		IPAERR("invalid rule handle %d\n", rule_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
 
-	ret = ipa_table_add_entry(&ipv6ct_table->table, (void*)user_rule, &new_entry_index, &new_entry_handle, cmd);
+	ret = ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_VOTE);
 	if (ret)
 	{
-		IPAERR("failed to add a new IPV6CT entry\n");
+		IPAERR("Voting clock on failed\n");
 		goto unlock;
 	}
 
-	ret = ipa_ipv6ct_post_dma_cmd(cmd);
+	ret = ipa_ipv6ct_del_entry(ipv6ct_table, real_rule_handle);
+
+	if (ret == 0)
+	{
+		ipa_ipv6ct_rule_deleted(obj, rule_handle);
+		ipa_ipv6ct_check_back_to_sram(obj);
+	}
+
+	if (ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_DEVOTE))
+		IPAWARN("Voting clock off failed\n");
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+
+	return ret;
+}
+
+int ipa_ipv6ct_del_rules(uint32_t table_handle, const uint32_t* rule_handles, uint32_t num_rules)
+{
+	ipa_ipv6ct_obj* obj;
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_ipv6ct_staged_del staged[MAX_STAGED_DELS];
+	uint32_t num_staged;
+	uint8_t* done_list = NULL;
+	uint32_t num_done = 0;
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_BATCH * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+	uint32_t real_rule_handle;
+	uint32_t sub, i, j;
+	int ret = 0, rule_ret;
+
+	IPADBG("In\n");
+
+	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
+	{
+		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
+		return -EINVAL;
+	}
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		rule_handles == NULL || num_rules == 0)
+	{
+		IPAERR("Invalid parameters table_handle=%d rule_handles=%pK num_rules=%u\n",
+			table_handle, rule_handles, num_rules);
+		return -EINVAL;
+	}
+	IPADBG("Passed Table: 0x%x num_rules: %u\n", table_handle, num_rules);
+
+	done_list = calloc(num_rules, sizeof(uint8_t));
+	if (done_list == NULL)
+	{
+		IPAERR("unable to allocate done list for %u rules\n", num_rules);
+		return -ENOMEM;
+	}
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		free(done_list);
+		return -EINVAL;
+	}
+
+	obj = &ipv6ct.tables[table_handle - 1];
+	sub = IPV6CT_CURR_SUB(obj);
+	ipv6ct_table = &obj->sub_tables[sub];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_VOTE);
+	if (ret)
+	{
+		IPAERR("Voting clock on failed\n");
+		goto unlock;
+	}
+
+	/*
+	 * Each pass stages at most one delete per bucket, since a delete
+	 * relies on list linkage that only the IPA writes when the dma
+	 * command is posted.  Rules sharing a bucket with an already
+	 * staged rule wait for a later pass...
+	 */
+	while (num_done < num_rules)
+	{
+		memset(cmd_buf, 0, sizeof(cmd_buf));
+
+		num_staged = 0;
+
+		for (i = 0; i < num_rules && num_staged < MAX_STAGED_DELS; i++)
+		{
+			ipa_ipv6ct_staged_del* del = &staged[num_staged];
+			bool collides = false;
+
+			if (done_list[i])
+				continue;
+
+			real_rule_handle = rule_handles[i];
+
+			rule_ret = (IPV6CT_IN_HYBRID_STATE(obj)) ?
+				nati_hdl_resolve(&obj->hdls, sub, rule_handles[i], &real_rule_handle) : 0;
+
+			if (rule_ret == 0)
+				rule_ret = ipa_ipv6ct_locate_del(ipv6ct_table, real_rule_handle, del);
+
+			if (rule_ret)
+			{
+				IPAERR("invalid rule handle %d\n", rule_handles[i]);
+				done_list[i] = 1;
+				num_done++;
+				ret = -EINVAL;
+				continue;
+			}
+
+			for (j = 0; j < num_staged && !collides; j++)
+				collides = (staged[j].bucket == del->bucket);
+
+			if (collides)
+				continue;
+
+			done_list[i] = 1;
+			num_done++;
+
+			del->rule_sub = i;
+
+			ipa_table_create_delete_command(&ipv6ct_table->table, cmd, &del->table_iterator);
+
+			num_staged++;
+		}
+
+		if (num_staged == 0)
+			continue;
+
+		rule_ret = ipa_ipv6ct_post_dma_cmd(ipv6ct_table, cmd);
+		if (rule_ret)
+		{
+			IPAERR("unable to post dma command for %u deletes\n", num_staged);
+			ret = rule_ret;
+			continue;
+		}
+
+		for (i = 0; i < num_staged; i++)
+		{
+			ipa_ipv6ct_finish_del(ipv6ct_table, &staged[i]);
+			ipa_ipv6ct_rule_deleted(obj, rule_handles[staged[i].rule_sub]);
+		}
+	}
+
+	ipa_ipv6ct_check_back_to_sram(obj);
+
+	if (ipa_ipv6ct_vote(ipv6ct_table, IPA_APP_CLK_DEVOTE))
+		IPAWARN("Voting clock off failed\n");
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+	free(done_list);
+
+	IPADBG("return\n");
+
+	return ret;
+}
+
+int ipa_ipv6ct_query_timestamp(uint32_t table_handle, uint32_t rule_handle, uint32_t* time_stamp)
+{
+	int ret;
+	ipa_ipv6ct_obj* obj;
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_ipv6ct_hw_entry *entry;
+	uint32_t real_rule_handle = rule_handle;
+	uint32_t sub;
+
+	IPADBG("\n");
+
+	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
+	{
+		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
+		return -EINVAL;
+	}
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		rule_handle == IPA_TABLE_INVALID_ENTRY || time_stamp == NULL)
+	{
+		IPAERR("invalid parameters passed table_handle=%d rule_handle=%d time_stamp=%pK\n",
+			table_handle, rule_handle, time_stamp);
+		return -EINVAL;
+	}
+	IPADBG("Passed Table: %d and rule handle %d\n", table_handle, rule_handle);
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	obj = &ipv6ct.tables[table_handle - 1];
+	sub = IPV6CT_CURR_SUB(obj);
+	ipv6ct_table = &obj->sub_tables[sub];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * No clock vote here, for the same reason as with IPv4 (see
+	 * VOTE_REQUIRED in ipa_nat_statemach.h)
+	 */
+	if (IPV6CT_IN_HYBRID_STATE(obj) &&
+		nati_hdl_resolve(&obj->hdls, sub, rule_handle, &real_rule_handle))
+	{
+		IPAERR("invalid rule handle %d\n", rule_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = ipa_table_get_entry(&ipv6ct_table->table, real_rule_handle, (void**)&entry, NULL);
+	if (ret)
+	{
+		IPAERR("unable to retrive the entry with handle=%d in IPV6CT table with handle=%d\n",
+			rule_handle, table_handle);
+		goto unlock;
+	}
+
+	*time_stamp = entry->time_stamp;
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+int ipa_ipv6ct_query_timestamps(uint32_t table_handle, const uint32_t* rule_handles, uint32_t num_rules,
+	uint32_t* time_stamps)
+{
+	ipa_ipv6ct_obj* obj;
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_ipv6ct_hw_entry *entry;
+	uint32_t real_rule_handle;
+	uint32_t sub, i;
+	int ret = 0;
+
+	IPADBG("\n");
+
+	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
+	{
+		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
+		return -EINVAL;
+	}
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		rule_handles == NULL || num_rules == 0 || time_stamps == NULL)
+	{
+		IPAERR("invalid parameters passed table_handle=%d rule_handles=%pK num_rules=%u time_stamps=%pK\n",
+			table_handle, rule_handles, num_rules, time_stamps);
+		return -EINVAL;
+	}
+	IPADBG("Passed Table: %d num_rules: %u\n", table_handle, num_rules);
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	obj = &ipv6ct.tables[table_handle - 1];
+	sub = IPV6CT_CURR_SUB(obj);
+	ipv6ct_table = &obj->sub_tables[sub];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	for (i = 0; i < num_rules; i++)
+	{
+		real_rule_handle = rule_handles[i];
+
+		if ((IPV6CT_IN_HYBRID_STATE(obj) &&
+			 nati_hdl_resolve(&obj->hdls, sub, rule_handles[i], &real_rule_handle)) ||
+			ipa_table_get_entry(&ipv6ct_table->table, real_rule_handle, (void**)&entry, NULL))
+		{
+			IPAERR("unable to retrive the entry with handle=%d in IPV6CT table with handle=%d\n",
+				rule_handles[i], table_handle);
+			ret = -EINVAL;
+			continue;
+		}
+
+		time_stamps[i] = entry->time_stamp;
+	}
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+int ipa_ipv6ct_get_switch_stats(uint32_t table_handle, ipa_ipv6ct_switch_stats* stats)
+{
+	ipa_ipv6ct_obj* obj;
+	ipa_ipv6ct_table* ipv6ct_table;
+	int ret = 0;
+
+	IPADBG("\n");
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS || stats == NULL)
+	{
+		IPAERR("invalid parameters passed table_handle=%d stats=%pK\n", table_handle, stats);
+		return -EINVAL;
+	}
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	obj = &ipv6ct.tables[table_handle - 1];
+	ipv6ct_table = &obj->sub_tables[IPV6CT_CURR_SUB(obj)];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	stats->hybrid       = IPV6CT_IN_HYBRID_STATE(obj);
+	stats->in_sram      = ipv6ct_table->mem_desc.sram_to_be_used;
+	stats->num_rules    = obj->tot_rules_in_table[IPV6CT_CURR_SUB(obj)];
+	stats->to_ddr_pass  = obj->sw_stats[SRAM_SUB].pass;
+	stats->to_ddr_fail  = obj->sw_stats[SRAM_SUB].fail;
+	stats->to_sram_pass = obj->sw_stats[DDR_SUB].pass;
+	stats->to_sram_fail = obj->sw_stats[DDR_SUB].fail;
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_add_entry() - Adds a rule to one of the tables
+ * @ipv6ct_table: [in] IPv6CT table
+ * @user_rule: [in] the rule
+ * @rule_handle: [out] the rule's handle in this table
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_add_entry(ipa_ipv6ct_table* ipv6ct_table, const ipa_ipv6ct_rule* user_rule, uint32_t* rule_handle)
+{
+	int ret;
+	uint16_t new_entry_index;
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_ADD * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	IPADBG("In\n");
+
+	memset(cmd_buf, 0, sizeof(cmd_buf));
+
+	new_entry_index = ipa_ipv6ct_hash(user_rule, ipv6ct_table->table.table_entries - 1);
+
+	ret = ipa_table_add_entry(&ipv6ct_table->table, (void*)user_rule, &new_entry_index, rule_handle, cmd);
+	if (ret)
+	{
+		IPAERR("failed to add a new IPV6CT entry\n");
+		goto bail;
+	}
+
+	ret = ipa_ipv6ct_post_dma_cmd(ipv6ct_table, cmd);
+	if (ret)
+	{
+		IPAERR("unable to post dma command\n");
+		ipa_table_erase_entry(&ipv6ct_table->table, new_entry_index);
+	}
+
+bail:
+	IPADBG("return\n");
+
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_flush_staged_adds() - Posts the dma command of staged adds
+ * @obj: [in] the table
+ * @ipv6ct_table: [in] the table, of the two, the adds were staged in
+ * @cmd: [in] the dma command
+ * @staged: [in] the staged adds
+ * @num_staged: [in/out] the number of staged adds, zeroed on return
+ * @rule_handles: [out] the caller's handle array
+ *
+ * On success, the rules' handles are handed back to the caller.  On
+ * failure, every staged rule is removed from the table.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_flush_staged_adds(ipa_ipv6ct_obj* obj, ipa_ipv6ct_table* ipv6ct_table,
+	struct ipa_ioc_nat_dma_cmd* cmd, ipa_ipv6ct_staged_add* staged, uint32_t* num_staged, uint32_t* rule_handles)
+{
+	uint32_t i;
+	int ret = 0, rule_ret;
+
+	IPADBG("In\n");
+
+	if (*num_staged == 0)
+		goto bail;
+
+	ret = ipa_ipv6ct_post_dma_cmd(ipv6ct_table, cmd);
+	if (ret)
+	{
+		IPAERR("unable to post dma command for %u rules\n", *num_staged);
+
+		for (i = *num_staged; i > 0; i--)
+			ipa_table_erase_entry(&ipv6ct_table->table, staged[i - 1].entry_index);
+	}
+	else
+	{
+		for (i = 0; i < *num_staged; i++)
+		{
+			rule_ret = ipa_ipv6ct_rule_added(
+				obj, staged[i].rule_handle, &rule_handles[staged[i].rule_sub]);
+			ret = (rule_ret) ? rule_ret : ret;
+		}
+	}
+
+	*num_staged = 0;
+	cmd->entries = 0;
+
+bail:
+	IPADBG("return\n");
+
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_locate_del() - Finds a rule to be deleted from a table
+ * @ipv6ct_table: [in] IPv6CT table
+ * @rule_handle: [in] the rule's handle in this table
+ * @del: [out] the rule, and the bucket it hangs off
+ *
+ * The table isn't touched.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_locate_del(ipa_ipv6ct_table* ipv6ct_table, uint32_t rule_handle, ipa_ipv6ct_staged_del* del)
+{
+	ipa_ipv6ct_hw_entry* entry;
+	uint16_t index;
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_table_get_entry(&ipv6ct_table->table, rule_handle, (void**)&entry, &index);
 	if (ret)
 	{
-		IPAERR("unable to post dma command\n");
+		IPAERR("unable to retrive the entry with handle=%d in IPV6CT table\n", rule_handle);
 		goto bail;
 	}
 
-	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	ret = ipa_table_iterator_init(&del->table_iterator, &ipv6ct_table->table, entry, index);
+	if (ret)
 	{
-		IPAERR("unable to unlock the ipv6ct mutex\n");
-		return -EPERM;
+		IPAERR("unable to create iterator which points to the entry index=%d in IPV6CT table\n", index);
+		goto bail;
 	}
 
-	*rule_handle = new_entry_handle;
-
-	IPADBG("return\n");
-
-	return 0;
+	del->bucket = ipa_table_get_chain_head(&ipv6ct_table->table, index);
+	if (!VALID_INDEX(del->bucket))
+		ret = -EPERM;
 
 bail:
-	ipa_table_erase_entry(&ipv6ct_table->table, new_entry_index);
-
-unlock:
-	if (pthread_mutex_unlock(&ipv6ct_mutex))
-		IPAERR("unable to unlock the ipv6ct mutex\n");
-
 	IPADBG("return\n");
 
 	return ret;
 }
 
-int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle)
+/**
+ * ipa_ipv6ct_finish_del() - Releases a deleted rule's entry
+ * @ipv6ct_table: [in] IPv6CT table
+ * @del: [in] the rule
+ *
+ * Only once the IPA has seen the delete's dma command.
+ */
+static void ipa_ipv6ct_finish_del(ipa_ipv6ct_table* ipv6ct_table, ipa_ipv6ct_staged_del* del)
 {
-	ipa_ipv6ct_table* ipv6ct_table;
-	ipa_table_iterator table_iterator;
-	ipa_ipv6ct_hw_entry* entry;
-	uint16_t index;
+	ipa_table_iterator* table_iterator = &del->table_iterator;
+
+	if (!ipa_table_iterator_is_head_with_tail(table_iterator))
+	{
+		/* The entry can be deleted */
+		uint8_t is_prev_empty = (table_iterator->prev_entry != NULL &&
+			((ipa_ipv6ct_hw_entry*)table_iterator->prev_entry)->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP);
+		ipa_table_delete_entry(&ipv6ct_table->table, table_iterator, is_prev_empty);
+	}
+}
+
+/**
+ * ipa_ipv6ct_del_entry() - Deletes a rule from one of the tables
+ * @ipv6ct_table: [in] IPv6CT table
+ * @rule_handle: [in] the rule's handle in this table
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_del_entry(ipa_ipv6ct_table* ipv6ct_table, uint32_t rule_handle)
+{
+	ipa_ipv6ct_staged_del del;
 	uint32_t cmd_sz =
 		sizeof(struct ipa_ioc_nat_dma_cmd) +
 		(MAX_DMA_ENTRIES_FOR_DEL * sizeof(struct ipa_ioc_nat_dma_one));
@@ -316,134 +1233,263 @@ int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle)
 
 	memset(cmd_buf, 0, sizeof(cmd_buf));
 
-	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
-	{
-		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
-		return -EINVAL;
-	}
+	ret = ipa_ipv6ct_locate_del(ipv6ct_table, rule_handle, &del);
+	if (ret)
+		goto bail;
 
-	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
-		rule_handle == IPA_TABLE_INVALID_ENTRY)
-	{
-		IPAERR("Invalid parameters table_handle=%d rule_handle=%d\n", table_handle, rule_handle);
-		return -EINVAL;
-	}
-	IPADBG("Passed Table: 0x%x and rule handle 0x%x\n", table_handle, rule_handle);
+	ipa_table_create_delete_command(&ipv6ct_table->table, cmd, &del.table_iterator);
 
-	if (pthread_mutex_lock(&ipv6ct_mutex))
+	ret = ipa_ipv6ct_post_dma_cmd(ipv6ct_table, cmd);
+	if (ret)
 	{
-		IPAERR("unable to lock the ipv6ct mutex\n");
-		return -EINVAL;
+		IPAERR("unable to post dma command\n");
+		goto bail;
 	}
 
-	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
-	if (!ipv6ct_table->mem_desc.valid)
+	ipa_ipv6ct_finish_del(ipv6ct_table, &del);
+
+bail:
+	IPADBG("return\n");
+
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_rule_added() - Book keeping for a rule just added
+ * @obj: [in] the table
+ * @real_rule_handle: [in] the rule's handle in the table being used
+ * @rule_handle: [out] the handle for the application
+ *
+ * In the hybrid states, the rule can and will move between SRAM and
+ * DDR, hence the application is handed a stable handle instead (see
+ * STABLE RULE HANDLES in ipa_nat_statemach.c).  Should none be left,
+ * the rule is deleted again.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_rule_added(ipa_ipv6ct_obj* obj, uint32_t real_rule_handle, uint32_t* rule_handle)
+{
+	uint32_t sub = IPV6CT_CURR_SUB(obj);
+	int ret = 0;
+
+	obj->tot_rules_in_table[sub]++;
+
+	if (IPV6CT_IN_HYBRID_STATE(obj))
 	{
-		IPAERR("invalid table handle %d\n", table_handle);
-		ret = -EINVAL;
-		goto unlock;
+		ret = nati_hdl_alloc(&obj->hdls, real_rule_handle, rule_handle);
+		if (ret)
+		{
+			ipa_ipv6ct_del_entry(&obj->sub_tables[sub], real_rule_handle);
+			obj->tot_rules_in_table[sub]--;
+		}
 	}
-
-	ret = ipa_table_get_entry(&ipv6ct_table->table, rule_handle, (void**)&entry, &index);
-	if (ret)
+	else
 	{
-		IPAERR("unable to retrive the entry with handle=%d in IPV6CT table with handle=%d\n",
-			rule_handle, table_handle);
-		goto unlock;
+		*rule_handle = real_rule_handle;
 	}
 
-	ret = ipa_table_iterator_init(&table_iterator, &ipv6ct_table->table, entry, index);
-	if (ret)
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_rule_deleted() - Book keeping for a rule just deleted
+ * @obj: [in] the table
+ * @rule_handle: [in] the application's handle of the rule
+ */
+static void ipa_ipv6ct_rule_deleted(ipa_ipv6ct_obj* obj, uint32_t rule_handle)
+{
+	uint32_t sub = IPV6CT_CURR_SUB(obj);
+	uint32_t real_rule_handle;
+
+	if (IPV6CT_IN_HYBRID_STATE(obj))
+		nati_hdl_free(&obj->hdls, sub, rule_handle, &real_rule_handle);
+
+	if (obj->tot_rules_in_table[sub])
+		obj->tot_rules_in_table[sub]--;
+}
+
+/**
+ * ipa_ipv6ct_check_back_to_sram() - Moves a hybrid table that has
+ * shrunk enough back to SRAM
+ * @obj: [in] the table
+ *
+ * Should the move fail, the table stays in DDR, and the next delete
+ * will try again.
+ */
+static void ipa_ipv6ct_check_back_to_sram(ipa_ipv6ct_obj* obj)
+{
+	if (obj->curr_state == NATI_STATE_HYBRID_DDR &&
+		obj->tot_rules_in_table[DDR_SUB] <= obj->back_to_sram_thresh)
 	{
-		IPAERR("unable to create iterator which points to the entry index=%d in IPV6CT table with handle=%d\n",
-			index, table_handle);
-		goto unlock;
+		IPAINFO("Switch back to SRAM threshold has been reached -> "
+				"Total rules in DDR(%u) <= SRAM THRESH(%u)\n",
+				obj->tot_rules_in_table[DDR_SUB],
+				obj->back_to_sram_thresh);
+
+		ipa_ipv6ct_switch_table(obj, SRAM_SUB);
 	}
+}
+
+/**
+ * ipa_ipv6ct_switch_table() - Moves a hybrid table to the other memory
+ * @obj: [in] the table
+ * @dst_sub: [in] DDR_SUB or SRAM_SUB, the memory to move to
+ *
+ * The destination is rebuilt from the source's rules while the IPA is
+ * still using the source, hence without posting anything to the
+ * kernel, then the IPA is told to use it with a single init command.
+ * Each rule's stable handle follows it.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_switch_table(ipa_ipv6ct_obj* obj, uint32_t dst_sub)
+{
+	uint32_t src_sub = (dst_sub == DDR_SUB) ? SRAM_SUB : DDR_SUB;
+	ipa_ipv6ct_table* src_table = &obj->sub_tables[src_sub];
+	ipa_ipv6ct_table* dst_table = &obj->sub_tables[dst_sub];
+	nati_switch_stats* sw_stats_ptr = &obj->sw_stats[src_sub];
+	const char* mig_dir_ptr = (dst_sub == DDR_SUB) ? "SRAM -> DDR" : "DDR -> SRAM";
+	ipa_ipv6ct_migrate_args args = { obj, dst_sub };
+	uint64_t start, stop;
+	int ret;
 
-	ipa_table_create_delete_command(&ipv6ct_table->table, cmd, &table_iterator);
+	IPADBG("In\n");
 
-	ret = ipa_ipv6ct_post_dma_cmd(cmd);
+	/* One of the two is in SRAM */
+	ret = ipa_ipv6ct_vote(&obj->sub_tables[SRAM_SUB], IPA_APP_CLK_VOTE);
 	if (ret)
 	{
-		IPAERR("unable to post dma command\n");
-		goto unlock;
+		IPAERR("Voting clock on failed\n");
+		goto bail;
 	}
 
-	if (!ipa_table_iterator_is_head_with_tail(&table_iterator))
+	currTimeAs(TimeAsNanSecs, &start);
+
+	ipa_table_reset(&dst_table->table);
+	dst_table->table.cur_tbl_cnt = dst_table->table.cur_expn_tbl_cnt = 0;
+	obj->tot_rules_in_table[dst_sub] = 0;
+
+	dst_table->offline = true;
+
+	ret = ipa_table_walk(&src_table->table, 0, WHEN_SLOT_FILLED, ipa_ipv6ct_migrate_rule, (void*) &args);
+
+	dst_table->offline = false;
+
+	if (ret == 0)
+		ret = ipa_ipv6ct_post_init_cmd(dst_table, dst_table->mem_desc.table_index);
+
+	currTimeAs(TimeAsNanSecs, &stop);
+
+	if (ret == 0)
 	{
-		/* The entry can be deleted */
-		uint8_t is_prev_empty = (table_iterator.prev_entry != NULL &&
-			((ipa_ipv6ct_hw_entry*)table_iterator.prev_entry)->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP);
-		ipa_table_delete_entry(&ipv6ct_table->table, &table_iterator, is_prev_empty);
-	}
+		SET_NATIOBJ_STATE(obj, (dst_sub == DDR_SUB) ? NATI_STATE_HYBRID_DDR : NATI_STATE_HYBRID);
 
-unlock:
-	if (pthread_mutex_unlock(&ipv6ct_mutex))
+		sw_stats_ptr->pass += 1;
+
+		IPADBG("Transition %s took %f microseconds (%u rules, one focus change)\n",
+			   mig_dir_ptr,
+			   (float) (stop - start) / 1000.0,
+			   obj->tot_rules_in_table[dst_sub]);
+	}
+	else
 	{
-		IPAERR("unable to unlock the ipv6ct mutex\n");
-		return (ret) ? ret : -EPERM;
+		IPAERR("Transition %s failed Error: %d\n", mig_dir_ptr, ret);
+
+		sw_stats_ptr->fail += 1;
 	}
 
-	IPADBG("return\n");
+	IPADBG("Transition pass/fail counts (%s) PASS: %u FAIL: %u\n",
+		   mig_dir_ptr,
+		   sw_stats_ptr->pass,
+		   sw_stats_ptr->fail);
+
+	if (ipa_ipv6ct_vote(&obj->sub_tables[SRAM_SUB], IPA_APP_CLK_DEVOTE))
+		IPAWARN("Voting clock off failed\n");
+
+bail:
+	IPADBG("Out\n");
 
 	return ret;
 }
 
-int ipa_ipv6ct_query_timestamp(uint32_t table_handle, uint32_t rule_handle, uint32_t* time_stamp)
+/**
+ * ipa_ipv6ct_migrate_rule() - ipa_table_walk() callback copying a rule
+ * to the destination table of ipa_ipv6ct_switch_table()
+ *
+ * The rule keeps its time stamp, and its stable handle is told of its
+ * handle in the destination.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_migrate_rule(
+	ipa_table* table_ptr,
+	uint32_t tbl_rule_hdl,
+	void* record_ptr,
+	uint16_t record_index,
+	void* meta_record_ptr,
+	uint16_t meta_record_index,
+	void* arb_data_ptr)
 {
-	int ret;
-	ipa_ipv6ct_table* ipv6ct_table;
-	ipa_ipv6ct_hw_entry *entry;
+	ipa_ipv6ct_migrate_args* args = (ipa_ipv6ct_migrate_args*) arb_data_ptr;
+	ipa_ipv6ct_hw_entry* entry = (ipa_ipv6ct_hw_entry*) record_ptr;
+	ipa_ipv6ct_table* dst_table = &args->obj->sub_tables[args->dst_sub];
+	ipa_ipv6ct_hw_entry* new_entry;
+	ipa_ipv6ct_rule rule;
+	uint32_t stable_hdl, new_rule_hdl;
+	int ret = 0;
+
+	UNUSED(table_ptr);
+	UNUSED(record_index);
+	UNUSED(meta_record_ptr);
+	UNUSED(meta_record_index);
 
-	IPADBG("\n");
+	IPADBG("In\n");
 
-	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
-	{
-		IPAERR("IPv6 connection tracking isn't supported for IPA version %d\n", ipv6ct.ipa_desc->ver);
-		return -EINVAL;
-	}
+	/* A deleted head, kept only for the sake of its tail */
+	if (entry->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+		goto bail;
 
-	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
-		rule_handle == IPA_TABLE_INVALID_ENTRY || time_stamp == NULL)
+	ret = nati_hdl_of(&args->obj->hdls, tbl_rule_hdl, &stable_hdl);
+	if (ret)
 	{
-		IPAERR("invalid parameters passed table_handle=%d rule_handle=%d time_stamp=%pK\n",
-			table_handle, rule_handle, time_stamp);
-		return -EINVAL;
+		IPAERR("rule handle %u has no stable handle\n", tbl_rule_hdl);
+		goto bail;
 	}
-	IPADBG("Passed Table: %d and rule handle %d\n", table_handle, rule_handle);
 
-	if (pthread_mutex_lock(&ipv6ct_mutex))
+	memset(&rule, 0, sizeof(rule));
+
+	rule.src_ipv6_lsb = entry->src_ipv6_lsb;
+	rule.src_ipv6_msb = entry->src_ipv6_msb;
+	rule.dest_ipv6_lsb = entry->dest_ipv6_lsb;
+	rule.dest_ipv6_msb = entry->dest_ipv6_msb;
+	rule.src_port = entry->src_port;
+	rule.dest_port = entry->dest_port;
+	rule.protocol = entry->protocol;
+	rule.direction_settings =
+		(entry->in_allowed && entry->out_allowed) ? IPA_IPV6CT_DIRECTION_ALLOW_ALL :
+		(entry->in_allowed) ? IPA_IPV6CT_DIRECTION_ALLOW_IN :
+		(entry->out_allowed) ? IPA_IPV6CT_DIRECTION_ALLOW_OUT :
+		IPA_IPV6CT_DIRECTION_DENY_ALL;
+
+	ret = ipa_ipv6ct_add_entry(dst_table, &rule, &new_rule_hdl);
+	if (ret)
 	{
-		IPAERR("unable to lock the ipv6ct mutex\n");
-		return -EINVAL;
+		IPAERR("unable to copy rule handle %u\n", tbl_rule_hdl);
+		goto bail;
 	}
 
-	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
-	if (!ipv6ct_table->mem_desc.valid)
-	{
-		IPAERR("invalid table handle %d\n", table_handle);
-		ret = -EINVAL;
-		goto unlock;
-	}
+	ipa_table_get_entry(&dst_table->table, new_rule_hdl, (void**)&new_entry, NULL);
+	new_entry->time_stamp = entry->time_stamp;
 
-	ret = ipa_table_get_entry(&ipv6ct_table->table, rule_handle, (void**)&entry, NULL);
-	if (ret)
-	{
-		IPAERR("unable to retrive the entry with handle=%d in IPV6CT table with handle=%d\n",
-			rule_handle, table_handle);
-		goto unlock;
-	}
+	args->obj->tot_rules_in_table[args->dst_sub]++;
 
-	*time_stamp = entry->time_stamp;
+	ret = nati_hdl_move(&args->obj->hdls, stable_hdl, new_rule_hdl);
 
-unlock:
-	if (pthread_mutex_unlock(&ipv6ct_mutex))
-	{
-		IPAERR("unable to unlock the ipv6ct mutex\n");
-		return (ret) ? ret : -EPERM;
-	}
+	IPADBG("stable_hdl(0x%08X) new_rule_hdl(0x%08X)\n", stable_hdl, new_rule_hdl);
+
+bail:
+	IPADBG("Out\n");
 
-	IPADBG("return\n");
 	return ret;
 }
 
@@ -646,6 +1692,7 @@ static uint16_t table_entry_get_delete_head_dma_command_data(void* head, void* n
  * @ipv6ct_table: [in] IPv6CT table
  * @number_of_entries: [in] number of IPv6CT entries
  * @table_index: [in] the index of the IPv6CT table
+ * @nmi: [in] the memory the table is meant for
  *
  * This function creates new IPv6CT table:
  * - Initializes table, memory descriptor and table_dma_cmd_helpers structures
@@ -653,18 +1700,19 @@ static uint16_t table_entry_get_delete_head_dma_command_data(void* head, void* n
  *
  * Returns:	0  On Success, negative on failure
  */
-static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t number_of_entries, uint8_t table_index)
+static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t number_of_entries, uint8_t table_index,
+	enum ipa3_nat_mem_in nmi)
 {
 	int ret, size;
 
 	IPADBG("\n");
 
 	ipa_table_init(
-		&ipv6ct_table->table, IPA_IPV6CT_TABLE_NAME, IPA_NAT_MEM_IN_DDR,
+		&ipv6ct_table->table, IPA_IPV6CT_TABLE_NAME, nmi,
 		sizeof(ipa_ipv6ct_hw_entry), NULL, 0, &entry_interface);
 
 	ret = ipa_table_calculate_entries_num(
-		&ipv6ct_table->table, number_of_entries, IPA_NAT_MEM_IN_DDR);
+		&ipv6ct_table->table, number_of_entries, nmi);
 
 	if (ret)
 	{
@@ -673,6 +1721,20 @@ static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t numb
 		return ret;
 	}
 
+	ret = ipa_table_create_expn_free_list(&ipv6ct_table->table);
+	if (ret)
+	{
+		IPAERR("unable to create ipv6ct table expansion free list\n");
+		return ret;
+	}
+
+	ret = ipa_table_create_bucket_info(&ipv6ct_table->table);
+	if (ret)
+	{
+		IPAERR("unable to create ipv6ct table bucket info\n");
+		goto bail;
+	}
+
 	size = ipa_table_calculate_size(&ipv6ct_table->table);
 	IPADBG("IPv6CT table size: %d\n", size);
 
@@ -683,7 +1745,7 @@ static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t numb
 		table_index,
 		IPA_IOC_ALLOC_IPV6CT_TABLE,
 		IPA_IOC_DEL_IPV6CT_TABLE,
-		false); /* false here means don't consider using sram */
+		nmi == IPA_NAT_MEM_IN_SRAM); /* only the SRAM sub-table considers sram */
 
 	ret = ipa_mem_descriptor_allocate_memory(
 		&ipv6ct_table->mem_desc,
@@ -705,10 +1767,69 @@ static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t numb
 	return 0;
 
 bail:
+	ipa_table_destroy_expn_free_list(&ipv6ct_table->table);
+	ipa_table_destroy_bucket_info(&ipv6ct_table->table);
 	memset(ipv6ct_table, 0, sizeof(*ipv6ct_table));
 	return ret;
 }
 
+/**
+ * ipa_ipv6ct_create_sram_table() - Creates the SRAM table of an IPv6CT table
+ * @obj: [in] IPv6CT table
+ * @table_index: [in] the index of the IPv6CT table
+ *
+ * The SRAM table is made as large as the SRAM allows, and the
+ * threshold for moving back to it from DDR is set accordingly.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_create_sram_table(ipa_ipv6ct_obj* obj, uint8_t table_index)
+{
+	uint32_t sram_size = 0;
+	int ret;
+
+	IPADBG("\n");
+
+	ret = ipa_nati_get_sram_size(&sram_size);
+	if (ret)
+		goto bail;
+
+	ret = ipa_calc_num_sram_table_entries(
+		sram_size, sizeof(ipa_ipv6ct_hw_entry), 0, (uint16_t*) &obj->tot_slots_in_sram);
+	if (ret)
+		goto bail;
+
+	obj->back_to_sram_thresh = PRCNT_OF(obj->tot_slots_in_sram);
+
+	IPADBG("sram_size(%u) tot_slots_in_sram(%u) back_to_sram_thresh(%u)\n",
+		sram_size, obj->tot_slots_in_sram, obj->back_to_sram_thresh);
+
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE);
+	if (ret)
+	{
+		IPAERR("Voting clock on failed\n");
+		goto bail;
+	}
+
+	ret = ipa_ipv6ct_create_table(
+		&obj->sub_tables[SRAM_SUB], obj->tot_slots_in_sram, table_index, IPA_NAT_MEM_IN_SRAM);
+
+	if (ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE))
+		IPAWARN("Voting clock off failed\n");
+
+	/* The kernel places tables by size, and this one may not have fit */
+	if (ret == 0 && !obj->sub_tables[SRAM_SUB].mem_desc.sram_to_be_used)
+	{
+		IPAERR("ipv6ct table of %u entries didn't go to SRAM\n", obj->tot_slots_in_sram);
+		ipa_ipv6ct_destroy_table(&obj->sub_tables[SRAM_SUB]);
+		ret = -ENOMEM;
+	}
+
+bail:
+	IPADBG("return\n");
+	return ret;
+}
+
 static int ipa_ipv6ct_destroy_table(ipa_ipv6ct_table* ipv6ct_table)
 {
 	int ret;
@@ -719,6 +1840,9 @@ static int ipa_ipv6ct_destroy_table(ipa_ipv6ct_table* ipv6ct_table)
 	if (ret)
 		IPAERR("unable to delete IPV6CT descriptor\n");
 
+	ipa_table_destroy_expn_free_list(&ipv6ct_table->table);
+	ipa_table_destroy_bucket_info(&ipv6ct_table->table);
+
 	memset(ipv6ct_table, 0, sizeof(*ipv6ct_table));
 
 	IPADBG("return\n");
@@ -789,7 +1913,7 @@ static int ipa_ipv6ct_post_init_cmd(ipa_ipv6ct_table* ipv6ct_table, uint8_t tbl_
 	cmd.table_entries = ipv6ct_table->table.table_entries - 1;
 	cmd.expn_table_entries = ipv6ct_table->table.expn_table_entries;
 
-	ret = ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_INIT_IPV6CT_TABLE, &cmd);
+	ret = ipa_nat_be_ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_INIT_IPV6CT_TABLE, &cmd);
 	if (ret)
 	{
 		IPAERR("unable to post init cmd Error: %d IPA fd %d\n", ret, ipv6ct.ipa_desc->fd);
@@ -800,13 +1924,57 @@ static int ipa_ipv6ct_post_init_cmd(ipa_ipv6ct_table* ipv6ct_table, uint8_t tbl_
 	return 0;
 }
 
-static int ipa_ipv6ct_post_dma_cmd(struct ipa_ioc_nat_dma_cmd* cmd)
+/*
+ * Does, in software, what the IPA would do with a dma command. Only
+ * safe while the IPA isn't using the table, see
+ * ipa_ipv6ct_switch_table().
+ */
+static void ipa_ipv6ct_apply_dma_cmd(ipa_ipv6ct_table* ipv6ct_table, const struct ipa_ioc_nat_dma_cmd* cmd)
+{
+	const struct ipa_ioc_nat_dma_one* dma;
+	uint8_t* base;
+	uint32_t i;
+
+	IPADBG("\n");
+
+	for (i = 0; i < cmd->entries; i++)
+	{
+		dma = &cmd->dma[i];
+
+		switch (dma->base_addr)
+		{
+		case IPA_IPV6CT_BASE_TBL:
+			base = ipv6ct_table->table.table_addr;
+			break;
+		case IPA_IPV6CT_EXPN_TBL:
+			base = ipv6ct_table->table.expn_table_addr;
+			break;
+		default:
+			IPAERR("Bad base_addr(%u) in dma entry %u\n", dma->base_addr, i);
+			continue;
+		}
+
+		*(uint16_t*) (base + (dma->offset - ipv6ct_table->mem_desc.addr_offset)) = dma->data;
+	}
+
+	IPADBG("return\n");
+}
+
+static int ipa_ipv6ct_post_dma_cmd(ipa_ipv6ct_table* ipv6ct_table, struct ipa_ioc_nat_dma_cmd* cmd)
 {
 	IPADBG("\n");
 
-	cmd->mem_type = IPA_NAT_MEM_IN_DDR;
+	if (ipv6ct_table->offline)
+	{
+		ipa_ipv6ct_apply_dma_cmd(ipv6ct_table, cmd);
+		IPADBG("applied dma command to offline table\n");
+		return 0;
+	}
+
+	cmd->mem_type = (ipv6ct_table->mem_desc.sram_to_be_used) ?
+		IPA_NAT_MEM_IN_SRAM : IPA_NAT_MEM_IN_DDR;
 
-	if (ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd))
+	if (ipa_nat_be_ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd))
 	{
 		IPAERR("ioctl (IPA_IOC_TABLE_DMA_CMD) on fd %d has failed\n",
 			   ipv6ct.ipa_desc->fd);
@@ -816,8 +1984,20 @@ static int ipa_ipv6ct_post_dma_cmd(struct ipa_ioc_nat_dma_cmd* cmd)
 	return 0;
 }
 
+/*
+ * Only the SRAM table needs the clock voted on for the app to touch it
+ */
+static int ipa_ipv6ct_vote(ipa_ipv6ct_table* ipv6ct_table, enum ipa_app_clock_vote_type vote_type)
+{
+	if (!ipv6ct_table->mem_desc.sram_to_be_used)
+		return 0;
+
+	return ipa_nat_vote_clock(vote_type);
+}
+
 void ipa_ipv6ct_dump_table(uint32_t table_handle)
 {
+	ipa_ipv6ct_obj* obj;
 	ipa_ipv6ct_table* ipv6ct_table;
 
 	if (ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
@@ -838,7 +2018,8 @@ void ipa_ipv6ct_dump_table(uint32_t table_handle)
 		return;
 	}
 
-	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
+	obj = &ipv6ct.tables[table_handle - 1];
+	ipv6ct_table = &obj->sub_tables[IPV6CT_CURR_SUB(obj)];
 	if (!ipv6ct_table->mem_desc.valid)
 	{
 		IPAERR("invalid table handle %d\n", table_handle);
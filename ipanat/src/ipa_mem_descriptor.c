@@ -75,7 +75,7 @@ static int AllocateMemory(
 
 	memset(&desc->nat_sram_info, 0, sizeof(desc->nat_sram_info));
 
-	ret = ioctl(
+	ret = ipa_nat_be_ioctl(
 		ipa_fd,
 		IPA_IOC_GET_NAT_IN_SRAM_INFO,
 		&desc->nat_sram_info);
@@ -109,7 +109,7 @@ static int AllocateMemory(
 
 	cmd.size = desc->orig_rqst_size;
 
-	ret = ioctl(ipa_fd, desc->allocate_ioctl_num, &cmd);
+	ret = ipa_nat_be_ioctl(ipa_fd, desc->allocate_ioctl_num, &cmd);
 
 	if (ret)
 	{
@@ -155,7 +155,7 @@ static int MapMemory(
 	strlcpy(device_full_path + ipa_dev_dir_path_len,
 			desc->name, IPA_RESOURCE_NAME_MAX - ipa_dev_dir_path_len);
 
-	device_fd = open(device_full_path, O_RDWR);
+	device_fd = ipa_nat_be_open(device_full_path, O_RDWR);
 
 	if (device_fd < 0)
 	{
@@ -192,23 +192,11 @@ static int MapMemory(
 		desc->orig_rqst_size;
 
 	desc->mmap_addr = desc->base_addr =
-		(void* )mmap(
-			NULL,
-			desc->mmap_size,
-			PROT_READ | PROT_WRITE,
-			MAP_SHARED,
-			device_fd,
-			0);
+		ipa_nat_be_mmap(desc->mmap_size, device_fd);
 #else
 	IPADBG("user space r3pc\n");
 	desc->mmap_addr = desc->base_addr =
-		(void *) mmap(
-			(caddr_t)0,
-			IPA_DEVICE_MMAP_MEM_SIZE,
-			PROT_READ | PROT_WRITE,
-			MAP_SHARED,
-			device_fd,
-			0);
+		ipa_nat_be_mmap(IPA_DEVICE_MMAP_MEM_SIZE, device_fd);
 #endif
 
 	if (desc->base_addr == MAP_FAILED)
@@ -231,7 +219,7 @@ static int MapMemory(
 		   (long unsigned int) desc->base_addr);
 
 close:
-	if (close(device_fd))
+	if (ipa_nat_be_close(device_fd))
 	{
 		IPAERR("unable to close the file descriptor for %s\n", desc->name);
 		ret = -EINVAL;
@@ -261,7 +249,7 @@ static int DeallocateMemory(
 		IPA_NAT_MEM_IN_SRAM       :
 		IPA_NAT_MEM_IN_DDR;
 
-	ret = ioctl(ipa_fd, desc->delete_ioctl_num, &cmd);
+	ret = ipa_nat_be_ioctl(ipa_fd, desc->delete_ioctl_num, &cmd);
 
 	if (ret)
 	{
@@ -351,9 +339,9 @@ int ipa_mem_descriptor_delete(
 	desc->valid = FALSE;
 
 #ifndef IPA_ON_R3PC
-	munmap(desc->mmap_addr, desc->mmap_size);
+	ipa_nat_be_munmap(desc->mmap_addr, desc->mmap_size);
 #else
-	munmap(desc->mmap_addr, IPA_DEVICE_MMAP_MEM_SIZE);
+	ipa_nat_be_munmap(desc->mmap_addr, IPA_DEVICE_MMAP_MEM_SIZE);
 #endif
 
 	ret = DeallocateMemory(desc, ipa_fd);
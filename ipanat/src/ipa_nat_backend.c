@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ipa_nat_backend.h"
+#include "ipa_nat_utils.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+/*
+ * ----------------------------------------------------------------------------
+ * The kernel backend
+ * ----------------------------------------------------------------------------
+ */
+static int kernel_open(
+	const char* path,
+	int         flags )
+{
+	return open(path, flags);
+}
+
+static int kernel_close(
+	int fd )
+{
+	return close(fd);
+}
+
+static int kernel_ioctl(
+	int           fd,
+	unsigned long req,
+	void*         arg )
+{
+	return ioctl(fd, req, arg);
+}
+
+static void* kernel_mmap(
+	size_t len,
+	int    fd )
+{
+	return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+}
+
+static int kernel_munmap(
+	void*  addr,
+	size_t len )
+{
+	return munmap(addr, len);
+}
+
+const ipa_nat_backend ipa_nat_kernel_backend =
+{
+	.name   = "kernel",
+	.open   = kernel_open,
+	.close  = kernel_close,
+	.ioctl  = kernel_ioctl,
+	.mmap   = kernel_mmap,
+	.munmap = kernel_munmap,
+};
+
+/*
+ * ----------------------------------------------------------------------------
+ * Backend selection and dispatch
+ * ----------------------------------------------------------------------------
+ */
+static const ipa_nat_backend* const backends[IPA_NAT_BACKEND_MAX] =
+{
+	[IPA_NAT_BACKEND_KERNEL] = &ipa_nat_kernel_backend,
+#ifdef FEATURE_IPA_NAT_SIM
+	[IPA_NAT_BACKEND_SIM]    = &ipa_nat_sim_backend,
+#endif
+};
+
+static ipa_nat_backend_type   cur_type = IPA_NAT_BACKEND_KERNEL;
+static const ipa_nat_backend* cur_be   = &ipa_nat_kernel_backend;
+
+/*
+ * Open fds plus live mappings.  Tables, and the clock vote lease,
+ * open and close from whatever thread they're used on...
+ */
+static uint32_t busy_cnt = 0;
+
+static void busy_get(void)
+{
+	__atomic_add_fetch(&busy_cnt, 1, __ATOMIC_SEQ_CST);
+}
+
+static void busy_put(void)
+{
+	uint32_t cnt = __atomic_load_n(&busy_cnt, __ATOMIC_SEQ_CST);
+
+	while ( cnt > 0 &&
+			! __atomic_compare_exchange_n(
+				&busy_cnt, &cnt, cnt - 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) );
+}
+
+int ipa_nat_set_backend(
+	ipa_nat_backend_type type )
+{
+	uint32_t busy;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! VALID_IPA_NAT_BACKEND_TYPE(type) )
+	{
+		IPAERR("Bad backend type(%u)\n", type);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( backends[type] == NULL )
+	{
+		IPAERR("Backend type(%u) isn't built in\n", type);
+		ret = -ENOTSUP;
+		goto bail;
+	}
+
+	busy = __atomic_load_n(&busy_cnt, __ATOMIC_SEQ_CST);
+
+	if ( busy )
+	{
+		IPAERR("Can't switch backends with %u device(s) or mapping(s) open on %s\n",
+			   busy, cur_be->name);
+		ret = -EBUSY;
+		goto bail;
+	}
+
+	cur_type = type;
+	cur_be   = backends[type];
+
+	IPADBG("Using the %s driver backend\n", cur_be->name);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+ipa_nat_backend_type ipa_nat_get_backend(void)
+{
+	return cur_type;
+}
+
+int ipa_nat_be_open(
+	const char* path,
+	int         flags )
+{
+	int fd = cur_be->open(path, flags);
+
+	if ( fd >= 0 )
+	{
+		busy_get();
+	}
+
+	return fd;
+}
+
+int ipa_nat_be_close(
+	int fd )
+{
+	int ret = cur_be->close(fd);
+
+	if ( ret == 0 )
+	{
+		busy_put();
+	}
+
+	return ret;
+}
+
+int ipa_nat_be_ioctl(
+	int           fd,
+	unsigned long req,
+	void*         arg )
+{
+	return cur_be->ioctl(fd, req, arg);
+}
+
+void* ipa_nat_be_mmap(
+	size_t len,
+	int    fd )
+{
+	void* addr = cur_be->mmap(len, fd);
+
+	if ( addr != MAP_FAILED )
+	{
+		busy_get();
+	}
+
+	return addr;
+}
+
+int ipa_nat_be_munmap(
+	void*  addr,
+	size_t len )
+{
+	int ret = cur_be->munmap(addr, len);
+
+	if ( ret == 0 )
+	{
+		busy_put();
+	}
+
+	return ret;
+}
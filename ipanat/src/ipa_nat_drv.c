@@ -133,6 +133,47 @@ int ipa_nat_add_ipv4_rule(
 	return 0;
 }
 
+/**
+ * ipa_nat_add_ipv4_rules() - to insert many ipv4 rules at once
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rules: [in] array of new rules
+ * @num_rules: [in] number of rules in the array
+ * @rule_handles: [out] array receiving the handle of each rule
+ *
+ * A rule that could not be added has its handle set to zero
+ *
+ * Returns:	0  On Success (all rules added), negative on failure
+ */
+int ipa_nat_add_ipv4_rules(
+	uint32_t tbl_hdl,
+	const ipa_nat_ipv4_rule *clnt_rules,
+	uint32_t num_rules,
+	uint32_t *rule_hdls)
+{
+	int result = -EINVAL;
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 clnt_rules == NULL ||
+		 rule_hdls == NULL ||
+		 num_rules == 0 ) {
+		IPAERR(
+			"Invalid parameters tbl_hdl=%d clnt_rules=%pK num_rules=%u rule_hdls=%pK\n",
+			tbl_hdl, clnt_rules, num_rules, rule_hdls);
+		return result;
+	}
+
+	IPADBG("Passed Table handle: 0x%x num_rules: %u\n", tbl_hdl, num_rules);
+
+	result = ipa_nati_add_ipv4_rules(tbl_hdl, clnt_rules, num_rules, rule_hdls);
+
+	if (result) {
+		IPAERR("Not all %u rules could be added\n", num_rules);
+		return result;
+	}
+
+	return 0;
+}
+
 /**
  * ipa_nat_del_ipv4_rule() - to delete ipv4 nat rule
  * @table_handle: [in] handle of ipv4 nat table
@@ -169,6 +210,42 @@ int ipa_nat_del_ipv4_rule(
 	return 0;
 }
 
+/**
+ * ipa_nat_del_ipv4_rules() - to delete many ipv4 nat rules at once
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_handles: [in] array of ipv4 nat rule handles
+ * @num_rules: [in] number of handles in the array
+ *
+ * Returns:	0  On Success (all rules deleted), negative on failure
+ */
+int ipa_nat_del_ipv4_rules(
+	uint32_t tbl_hdl,
+	const uint32_t *rule_hdls,
+	uint32_t num_rules)
+{
+	int result = -EINVAL;
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 rule_hdls == NULL ||
+		 num_rules == 0 ) {
+		IPAERR(
+			"Invalid parameters tbl_hdl=%d rule_hdls=%pK num_rules=%u\n",
+			tbl_hdl, rule_hdls, num_rules);
+		return result;
+	}
+
+	IPADBG("Passed Table handle: 0x%x num_rules: %u\n", tbl_hdl, num_rules);
+
+	result = ipa_nati_del_ipv4_rules(tbl_hdl, rule_hdls, num_rules);
+
+	if (result) {
+		IPAERR("Not all %u rules could be deleted\n", num_rules);
+		return result;
+	}
+
+	return 0;
+}
+
 /**
  * ipa_nat_query_timestamp() - to query timestamp
  * @table_handle: [in] handle of ipv4 nat table
@@ -199,6 +276,202 @@ int ipa_nat_query_timestamp(
 	return ipa_nati_query_timestamp(tbl_hdl, rule_hdl, time_stamp);
 }
 
+/**
+ * ipa_nat_query_timestamps() - to query many timestamps at once
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_handles: [in] array of ipv4 nat rule handles
+ * @num_rules: [in] number of handles in the array
+ * @time_stamps: [out] array receiving the time stamp of each rule
+ *
+ * Returns:	0  On Success (all handles read), negative on failure
+ */
+int ipa_nat_query_timestamps(
+	uint32_t tbl_hdl,
+	const uint32_t *rule_hdls,
+	uint32_t num_rules,
+	uint32_t *time_stamps)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 rule_hdls == NULL ||
+		 num_rules == 0 ||
+		 time_stamps == NULL )
+	{
+		IPAERR("Invalid parameters passed tbl_hdl=0x%x rule_hdls=%pK "
+			   "num_rules=%u time_stamps=%pK\n",
+			   tbl_hdl, rule_hdls, num_rules, time_stamps);
+		return -EINVAL;
+	}
+
+	IPADBG("Passed Table 0x%x and %u rule handles\n", tbl_hdl, num_rules);
+
+	return ipa_nati_query_timestamps(tbl_hdl, rule_hdls, num_rules, time_stamps);
+}
+
+/**
+ * ipa_nat_query_all_timestamps() - to query the timestamp of every rule
+ * @table_handle: [in] handle of ipv4 nat table
+ * @time_stamps: [out] array receiving rule handles and time stamps
+ * @max_rules: [in] number of elements in the array
+ * @num_rules: [out] number of elements filled in
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_query_all_timestamps(
+	uint32_t tbl_hdl,
+	ipa_nat_rule_time_stamp *time_stamps,
+	uint32_t max_rules,
+	uint32_t *num_rules)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 time_stamps == NULL ||
+		 max_rules == 0 ||
+		 num_rules == NULL )
+	{
+		IPAERR("Invalid parameters passed tbl_hdl=0x%x time_stamps=%pK "
+			   "max_rules=%u num_rules=%pK\n",
+			   tbl_hdl, time_stamps, max_rules, num_rules);
+		return -EINVAL;
+	}
+
+	IPADBG("Passed Table 0x%x and room for %u rules\n", tbl_hdl, max_rules);
+
+	return ipa_nati_query_all_timestamps(tbl_hdl, time_stamps, max_rules, num_rules);
+}
+
+/**
+ * ipa_nat_query_changed_timestamps() - to find the rules hit since last asked
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @shadow: [in/out] what the last call saw; *shadow is NULL the first time
+ * @time_stamps: [out] array receiving rule handles and time stamps
+ * @max_rules: [in] number of elements in the array
+ * @num_rules: [out] number of elements filled in
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_query_changed_timestamps(
+	uint32_t tbl_hdl,
+	ipa_nat_ts_shadow **shadow,
+	ipa_nat_rule_time_stamp *time_stamps,
+	uint32_t max_rules,
+	uint32_t *num_rules)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 shadow == NULL ||
+		 time_stamps == NULL ||
+		 max_rules == 0 ||
+		 num_rules == NULL )
+	{
+		IPAERR("Invalid parameters passed tbl_hdl=0x%x shadow=%pK "
+			   "time_stamps=%pK max_rules=%u num_rules=%pK\n",
+			   tbl_hdl, shadow, time_stamps, max_rules, num_rules);
+		return -EINVAL;
+	}
+
+	IPADBG("Passed Table 0x%x\n", tbl_hdl);
+
+	return ipa_nati_query_changed_timestamps(
+		tbl_hdl, shadow, time_stamps, max_rules, num_rules);
+}
+
+/**
+ * ipa_nat_free_ts_shadow() - to free what ipa_nat_query_changed_timestamps()
+ * allocated
+ * @shadow: [in] the shadow, which may be NULL
+ */
+void ipa_nat_free_ts_shadow(
+	ipa_nat_ts_shadow *shadow)
+{
+	ipa_nati_free_ts_shadow(shadow);
+}
+
+/**
+ * ipa_nat_find_ipv4_rule() - to find the handle of an offloaded rule
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule: [in] rule to look for
+ * @rule_handle: [out] handle of the matching rule
+ *
+ * Returns:	0  On Success, -ENOENT when no such rule exists,
+ *		other negative values on failure
+ */
+int ipa_nat_find_ipv4_rule(
+	uint32_t tbl_hdl,
+	const ipa_nat_ipv4_rule *clnt_rule,
+	uint32_t *rule_hdl)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 clnt_rule == NULL ||
+		 rule_hdl == NULL )
+	{
+		IPAERR("Invalid parameters passed tbl_hdl=0x%x clnt_rule=%pK rule_hdl=%pK\n",
+			   tbl_hdl, clnt_rule, rule_hdl);
+		return -EINVAL;
+	}
+
+	return ipa_nati_find_ipv4_rule(tbl_hdl, clnt_rule, rule_hdl);
+}
+
+/**
+ * ipa_nat_collect_stale() - to find, and optionally delete, idle rules
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @older_than: [in] a time stamp, as the IPA writes them into rules
+ * @del_stale: [in] whether to delete the rules found
+ * @stale_cb: [in] called with the rules found, a batch at a time
+ * @arb_data_ptr: [in] passed, untouched, to stale_cb
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_collect_stale(
+	uint32_t tbl_hdl,
+	uint32_t older_than,
+	bool del_stale,
+	ipa_nat_stale_cb stale_cb,
+	void *arb_data_ptr)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 stale_cb == NULL )
+	{
+		IPAERR("Invalid parameters passed tbl_hdl=0x%x stale_cb=%pK\n",
+			   tbl_hdl, stale_cb);
+		return -EINVAL;
+	}
+
+	IPADBG("Passed Table 0x%x older_than(%u) del_stale(%u)\n",
+		   tbl_hdl, older_than, del_stale);
+
+	return ipa_nati_collect_stale(tbl_hdl, older_than, del_stale, stale_cb, arb_data_ptr);
+}
+
+/**
+ * ipa_nat_compact_ipv4_tbl() - to shorten rule lists in the table
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @max_moves: [in] most rules to move in this call
+ * @num_moved: [out] number of rules moved
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_compact_ipv4_tbl(
+	uint32_t tbl_hdl,
+	uint32_t max_moves,
+	uint32_t *num_moved)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 num_moved == NULL )
+	{
+		IPAERR("Invalid parameters passed tbl_hdl=0x%x num_moved=%pK\n",
+			   tbl_hdl, num_moved);
+		return -EINVAL;
+	}
+
+	*num_moved = 0;
+
+	if ( max_moves == 0 )
+	{
+		return 0;
+	}
+
+	return ipa_nati_compact_ipv4_tbl(tbl_hdl, max_moves, num_moved);
+}
+
 /**
 * ipa_nat_modify_pdn() - modify single PDN entry in the PDN config table
 * @table_handle: [in] handle of ipv4 nat table
@@ -346,3 +619,29 @@ int ipa_nat_vote_clock(
 
 	return ipa_nati_vote_clock(vote_type);
 }
+
+/**
+ * ipa_nat_set_vote_linger() - set the clock vote linger period
+ * @linger_ms: [in] linger period in milliseconds
+ */
+int ipa_nat_set_vote_linger(
+	uint32_t linger_ms )
+{
+	return ipa_nati_set_vote_linger(linger_ms);
+}
+
+/**
+ * ipa_nat_get_vote_stats() - get the clock vote lease's counters
+ * @stats_ptr: [out] where to put them
+ */
+int ipa_nat_get_vote_stats(
+	ipa_nat_vote_stats* stats_ptr )
+{
+	if ( ! stats_ptr )
+	{
+		IPAERR("NULL stats_ptr parameter\n");
+		return -EINVAL;
+	}
+
+	return ipa_nati_get_vote_stats(stats_ptr);
+}
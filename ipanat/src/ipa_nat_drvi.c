@@ -41,8 +41,28 @@
 #include <unistd.h>
 #include <linux/msm_ipa.h>
 
-#define MAX_DMA_ENTRIES_FOR_ADD 4
-#define MAX_DMA_ENTRIES_FOR_DEL 3
+/*
+ * The vector unit, if any, the record scans use (see
+ * ipa_nati_scan_recs())
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# if defined(__AVX2__)
+#  include <immintrin.h>
+#  define NATI_SCAN_ISA   "avx2"
+#  define NATI_SCAN_BLOCK 8
+# elif defined(__SSE2__)
+#  include <emmintrin.h>
+#  define NATI_SCAN_ISA   "sse2"
+#  define NATI_SCAN_BLOCK 4
+# elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define NATI_SCAN_ISA   "neon"
+#  define NATI_SCAN_BLOCK 4
+# endif
+#endif
+
+
+#define MAX_DMA_ENTRIES_FOR_PULL 3
 
 #define IPA_NAT_DEBUG_FILE_PATH "/sys/kernel/debug/ipa/ip4_nat"
 #define IPA_NAT_TABLE_NAME "IPA NAT table"
@@ -686,12 +706,345 @@ static void ipa_nati_create_table_dma_cmd_helpers(
 	IPADBG("Out\n");
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ * Private helpers for the 5-tuple shadow index
+ *
+ * Each table keeps, in ordinary memory, an open addressed hash of the
+ * 5-tuple and pdn of every rule it holds.  It answers "is this rule
+ * offloaded, and under which handle?" without walking (or even
+ * touching) the NAT table, which may live in SRAM.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t tuple_hash(
+	const struct ipa_nat_tuple* tuple)
+{
+	uint32_t hash;
+
+	hash  = tuple->private_ip * 0x9E3779B1;
+	hash ^= tuple->target_ip  * 0x85EBCA77;
+	hash ^= ((uint32_t) tuple->private_port << 16 | tuple->target_port) * 0xC2B2AE3D;
+	hash ^= ((uint32_t) tuple->protocol << 8 | tuple->pdn_index) * 0x27D4EB2F;
+
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6D;
+	hash ^= hash >> 13;
+
+	return hash;
+}
+
+static bool tuple_matches(
+	const struct ipa_nat_tuple* a,
+	const struct ipa_nat_tuple* b)
+{
+	return
+		a->private_ip   == b->private_ip   &&
+		a->target_ip    == b->target_ip    &&
+		a->private_port == b->private_port &&
+		a->target_port  == b->target_port  &&
+		a->protocol     == b->protocol     &&
+		a->pdn_index    == b->pdn_index;
+}
+
+static void ipa_nati_rule_tuple(
+	const struct ipa_nat_rule* rule,
+	uint16_t                   rec_index,
+	struct ipa_nat_tuple*      tuple)
+{
+	tuple->private_ip   = rule->private_ip;
+	tuple->target_ip    = rule->target_ip;
+	tuple->private_port = rule->private_port;
+	tuple->target_port  = rule->target_port;
+	tuple->protocol     = rule->protocol;
+	tuple->pdn_index    = rule->pdn_index;
+	tuple->rec_index    = rec_index;
+}
+
+static int ipa_nati_tuple_index_create(
+	struct ipa_nat_ip4_table_cache* nat_table)
+{
+	struct ipa_nat_tuple_index* ti = &nat_table->tuple_index;
+
+	uint32_t num_slots = 1;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	/*
+	 * Keep the load factor at or under one half...
+	 */
+	while ( num_slots < 2 * nat_table->table.tot_tbl_ents )
+	{
+		num_slots <<= 1;
+	}
+
+	ti->slots = (struct ipa_nat_tuple*)
+		calloc(num_slots, sizeof(struct ipa_nat_tuple));
+
+	if ( ti->slots == NULL )
+	{
+		IPAERR("Unable to allocate %u tuple index slots\n", num_slots);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	ti->mask  = num_slots - 1;
+	ti->count = 0;
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+static void ipa_nati_tuple_index_destroy(
+	struct ipa_nat_ip4_table_cache* nat_table)
+{
+	free(nat_table->tuple_index.slots);
+
+	memset(&nat_table->tuple_index, 0, sizeof(nat_table->tuple_index));
+}
+
+static void ipa_nati_tuple_index_reset(
+	struct ipa_nat_ip4_table_cache* nat_table)
+{
+	struct ipa_nat_tuple_index* ti = &nat_table->tuple_index;
+
+	if ( ti->slots )
+	{
+		memset(ti->slots, 0, (ti->mask + 1) * sizeof(struct ipa_nat_tuple));
+	}
+
+	ti->count = 0;
+}
+
+static void ipa_nati_tuple_index_add(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	const struct ipa_nat_tuple*     tuple)
+{
+	struct ipa_nat_tuple_index* ti = &nat_table->tuple_index;
+
+	uint32_t i;
+
+	if ( ti->slots == NULL || ti->count >= ti->mask )
+	{
+		IPAERR("No room in tuple index for record %u\n", tuple->rec_index);
+		return;
+	}
+
+	for ( i = tuple_hash(tuple) & ti->mask;
+		  VALID_INDEX(ti->slots[i].rec_index);
+		  i = (i + 1) & ti->mask )
+		;
+
+	ti->slots[i] = *tuple;
+
+	ti->count++;
+}
+
+/*
+ * Removal shifts later members of the probe sequence back into the
+ * hole, so lookups never need tombstones.
+ */
+static void ipa_nati_tuple_index_del(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	const struct ipa_nat_tuple*     tuple)
+{
+	struct ipa_nat_tuple_index* ti = &nat_table->tuple_index;
+
+	uint32_t i, j, home;
+
+	if ( ti->slots == NULL )
+	{
+		return;
+	}
+
+	for ( i = tuple_hash(tuple) & ti->mask;
+		  ti->slots[i].rec_index != tuple->rec_index;
+		  i = (i + 1) & ti->mask )
+	{
+		if ( ! VALID_INDEX(ti->slots[i].rec_index) )
+		{
+			IPAERR("Record %u not in tuple index\n", tuple->rec_index);
+			return;
+		}
+	}
+
+	for ( j = (i + 1) & ti->mask;
+		  VALID_INDEX(ti->slots[j].rec_index);
+		  j = (j + 1) & ti->mask )
+	{
+		home = tuple_hash(&ti->slots[j]) & ti->mask;
+
+		/*
+		 * The member at j may move to i only if its home slot
+		 * isn't cyclically within (i, j]...
+		 */
+		if ( ((j - home) & ti->mask) >= ((j - i) & ti->mask) )
+		{
+			ti->slots[i] = ti->slots[j];
+			i = j;
+		}
+	}
+
+	memset(&ti->slots[i], 0, sizeof(struct ipa_nat_tuple));
+
+	ti->count--;
+}
+
+static uint16_t ipa_nati_tuple_index_find(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	const struct ipa_nat_tuple*     tuple)
+{
+	struct ipa_nat_tuple_index* ti = &nat_table->tuple_index;
+
+	uint32_t i;
+
+	if ( ti->slots == NULL )
+	{
+		return IPA_TABLE_INVALID_ENTRY;
+	}
+
+	for ( i = tuple_hash(tuple) & ti->mask;
+		  VALID_INDEX(ti->slots[i].rec_index);
+		  i = (i + 1) & ti->mask )
+	{
+		if ( tuple_matches(&ti->slots[i], tuple) )
+		{
+			return ti->slots[i].rec_index;
+		}
+	}
+
+	return IPA_TABLE_INVALID_ENTRY;
+}
+
+static void ipa_nati_tuple_index_add_rec(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	uint16_t                        rec_index)
+{
+	struct ipa_nat_tuple tuple;
+
+	ipa_nati_rule_tuple(
+		(struct ipa_nat_rule*) GOTO_REC(&nat_table->table, rec_index),
+		rec_index,
+		&tuple);
+
+	ipa_nati_tuple_index_add(nat_table, &tuple);
+}
+
+static int ipa_nati_table_size(
+	struct ipa_nat_ip4_table_cache* nat_table)
+{
+	return
+		ipa_table_calculate_size(&nat_table->table) +
+		ipa_table_calculate_size(&nat_table->index_table);
+}
+
+/*
+ * Frees everything a table keeps in ordinary memory.  The caller has
+ * seen to the memory descriptor...
+ */
+static void ipa_nati_free_table_info(
+	struct ipa_nat_ip4_table_cache* nat_table)
+{
+	ipa_table_destroy_expn_free_list(&nat_table->table);
+	ipa_table_destroy_expn_free_list(&nat_table->index_table);
+
+	ipa_table_destroy_bucket_info(&nat_table->table);
+	ipa_table_destroy_bucket_info(&nat_table->index_table);
+
+	ipa_nati_tuple_index_destroy(nat_table);
+
+	free(nat_table->index_expn_table_meta);
+	free(nat_table->staged_image);
+
+	memset(nat_table, 0, sizeof(*nat_table));
+}
+
+/**
+ * ipa_nati_alloc_table_mem() - Gets the memory for a table
+ * @nat_cache_ptr: [in] the cache the table belongs to
+ * @nat_table: [in] IPv4 NAT table, with its dimensions calculated
+ * @table_index: [in] the index of the IPv4 NAT table
+ *
+ * Allocates and maps the memory for table and index table, points
+ * them at it, and creates the table_dma_cmd_helpers that go with it.
+ * The memory is not cleared.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_nati_alloc_table_mem(
+	struct ipa_nat_cache*           nat_cache_ptr,
+	struct ipa_nat_ip4_table_cache* nat_table,
+	uint8_t                         table_index)
+{
+	int ret, size;
+	void* base_addr;
+
+#ifdef IPA_ON_R3PC
+	uint32_t nat_mem_offset = 0;
+#endif
+
+	IPADBG("In\n");
+
+	size = ipa_nati_table_size(nat_table);
+
+	IPADBG("Nat Base and Index Table size: %d\n", size);
+
+	ipa_mem_descriptor_init(
+		&nat_table->mem_desc,
+		IPA_NAT_DEV_NAME,
+		size,
+		table_index,
+		IPA_IOC_ALLOC_NAT_TABLE,
+		IPA_IOC_DEL_NAT_TABLE,
+		true);  /* true here means do consider using sram */
+
+	ret = ipa_mem_descriptor_allocate_memory(
+		&nat_table->mem_desc,
+		nat_cache_ptr->ipa_desc->fd);
+
+	if (ret) {
+		IPAERR("unable to allocate nat memory descriptor Error: %d\n", ret);
+		goto bail;
+	}
+
+	base_addr = nat_table->mem_desc.base_addr;
+
+#ifdef IPA_ON_R3PC
+	ret = ipa_nat_be_ioctl(nat_cache_ptr->ipa_desc->fd,
+				IPA_IOC_GET_NAT_OFFSET,
+				&nat_mem_offset);
+	if (ret) {
+		IPAERR("unable to post ant offset cmd Error: %d IPA fd %d\n",
+			   ret, nat_cache_ptr->ipa_desc->fd);
+		ipa_mem_descriptor_delete(&nat_table->mem_desc, nat_cache_ptr->ipa_desc->fd);
+		goto bail;
+	}
+	base_addr += nat_mem_offset;
+#endif
+
+	base_addr =
+		ipa_table_calculate_addresses(&nat_table->table, base_addr);
+	ipa_table_calculate_addresses(&nat_table->index_table, base_addr);
+
+	ipa_nati_create_table_dma_cmd_helpers(nat_table, table_index);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 /**
  * ipa_nati_create_table() - Creates a new IPv4 NAT table
  * @nat_table: [in] IPv4 NAT table
  * @public_ip_addr: [in] public IPv4 address
  * @number_of_entries: [in] number of NAT entries
  * @table_index: [in] the index of the IPv4 NAT table
+ * @staged: [in] build the table in ordinary memory, see
+ *          ipa_nati_grow_ipv4_tbl()
  *
  * This function creates new IPv4 NAT table:
  * - Initializes table, index table, memory descriptor and
@@ -706,15 +1059,12 @@ static int ipa_nati_create_table(
 	struct ipa_nat_ip4_table_cache* nat_table,
 	uint32_t                        public_ip_addr,
 	uint16_t                        number_of_entries,
-	uint8_t                         table_index)
+	uint8_t                         table_index,
+	bool                            staged)
 {
 	int ret, size;
 	void* base_addr;
 
-#ifdef IPA_ON_R3PC
-	uint32_t nat_mem_offset = 0;
-#endif
-
 	IPADBG("In\n");
 
 	nat_table->public_addr = public_ip_addr;
@@ -776,64 +1126,81 @@ static int ipa_nati_create_table(
 	nat_table->index_table.tot_tbl_ents =
 		nat_table->table.tot_tbl_ents;
 
-	size  = ipa_table_calculate_size(&nat_table->table);
-	size += ipa_table_calculate_size(&nat_table->index_table);
+	/*
+	 * Allocate the expansion free slot lists for both tables
+	 */
+	ret = ipa_table_create_expn_free_list(&nat_table->table);
 
-	IPADBG("Nat Base and Index Table size: %d\n", size);
+	if (ret) {
+		IPAERR("unable to create nat table expansion free list\n");
+		goto bail_meta;
+	}
 
-	ipa_mem_descriptor_init(
-		&nat_table->mem_desc,
-		IPA_NAT_DEV_NAME,
-		size,
-		table_index,
-		IPA_IOC_ALLOC_NAT_TABLE,
-		IPA_IOC_DEL_NAT_TABLE,
-		true);  /* true here means do consider using sram */
+	ret = ipa_table_create_expn_free_list(&nat_table->index_table);
 
-	ret = ipa_mem_descriptor_allocate_memory(
-		&nat_table->mem_desc,
-		nat_cache_ptr->ipa_desc->fd);
+	if (ret) {
+		IPAERR("unable to create index table expansion free list\n");
+		goto bail_meta;
+	}
+
+	ret = ipa_table_create_bucket_info(&nat_table->table);
 
 	if (ret) {
-		IPAERR("unable to allocate nat memory descriptor Error: %d\n", ret);
+		IPAERR("unable to create nat table bucket info\n");
 		goto bail_meta;
 	}
 
-	base_addr = nat_table->mem_desc.base_addr;
+	ret = ipa_table_create_bucket_info(&nat_table->index_table);
 
-#ifdef IPA_ON_R3PC
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd,
-				IPA_IOC_GET_NAT_OFFSET,
-				&nat_mem_offset);
 	if (ret) {
-		IPAERR("unable to post ant offset cmd Error: %d IPA fd %d\n",
-			   ret, nat_cache_ptr->ipa_desc->fd);
-		goto bail_mem_desc;
+		IPAERR("unable to create index table bucket info\n");
+		goto bail_meta;
 	}
-	base_addr += nat_mem_offset;
-#endif
 
-	base_addr =
-		ipa_table_calculate_addresses(&nat_table->table, base_addr);
-	ipa_table_calculate_addresses(&nat_table->index_table, base_addr);
+	ret = ipa_nati_tuple_index_create(nat_table);
 
-	ipa_table_reset(&nat_table->table);
-	ipa_table_reset(&nat_table->index_table);
+	if (ret) {
+		IPAERR("unable to create nat table tuple index\n");
+		goto bail_meta;
+	}
 
-	ipa_nati_create_table_dma_cmd_helpers(nat_table, table_index);
+	if (staged) {
+		/*
+		 * No memory descriptor yet, so the dma command helpers work
+		 * in offsets from the start of the image...
+		 */
+		size = ipa_nati_table_size(nat_table);
 
-	goto done;
+		nat_table->staged_image = calloc(1, size);
 
-#ifdef IPA_ON_R3PC
-bail_mem_desc:
-	ipa_mem_descriptor_delete(&nat_table->mem_desc, nat_cache_ptr->ipa_desc->fd);
-#endif
+		if (nat_table->staged_image == NULL) {
+			IPAERR("unable to allocate staged nat table of size %d\n", size);
+			ret = -ENOMEM;
+			goto bail_meta;
+		}
 
-bail_meta:
-	free(nat_table->index_expn_table_meta);
-	memset(nat_table, 0, sizeof(*nat_table));
+		base_addr =
+			ipa_table_calculate_addresses(&nat_table->table, nat_table->staged_image);
+		ipa_table_calculate_addresses(&nat_table->index_table, base_addr);
 
-done:
+		ipa_nati_create_table_dma_cmd_helpers(nat_table, table_index);
+	} else {
+		ret = ipa_nati_alloc_table_mem(nat_cache_ptr, nat_table, table_index);
+
+		if (ret) {
+			goto bail_meta;
+		}
+	}
+
+	ipa_table_reset(&nat_table->table);
+	ipa_table_reset(&nat_table->index_table);
+
+	goto done;
+
+bail_meta:
+	ipa_nati_free_table_info(nat_table);
+
+done:
 	IPADBG("Out\n");
 
 	return ret;
@@ -853,9 +1220,7 @@ static int ipa_nati_destroy_table(
 	if (ret)
 		IPAERR("unable to delete NAT descriptor\n");
 
-	free(nat_table->index_expn_table_meta);
-
-	memset(nat_table, 0, sizeof(*nat_table));
+	ipa_nati_free_table_info(nat_table);
 
 	IPADBG("Out\n");
 
@@ -914,7 +1279,7 @@ static int ipa_nati_post_ipv4_init_cmd(
 	*buf = '\0';
 	IPADBG("%s\n", ipa_ioc_v4_nat_init_as_str(&cmd, buf, sizeof(buf)));
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_V4_INIT_NAT, &cmd);
+	ret = ipa_nat_be_ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_V4_INIT_NAT, &cmd);
 
 	if (ret) {
 		IPAERR("unable to post init cmd Error: %d IPA fd %d\n",
@@ -1092,6 +1457,54 @@ static uint16_t src_hash(
 	return hash;
 }
 
+/*
+ * Does, in software, what the IPA would do with a dma command: each
+ * entry writes 16 bits of data at an offset into one of the tables.
+ * Only safe when the IPA is not using the tables in question.
+ */
+static void ipa_nati_apply_ipv4_dma_cmd(
+	struct ipa_nat_cache*             nat_cache_ptr,
+	const struct ipa_ioc_nat_dma_cmd* cmd)
+{
+	const struct ipa_ioc_nat_dma_one* dma;
+	struct ipa_nat_ip4_table_cache*   nat_table;
+	uint8_t*                          base;
+	uint32_t                          i;
+
+	IPADBG("In\n");
+
+	for ( i = 0; i < cmd->entries; i++ )
+	{
+		dma = &cmd->dma[i];
+
+		nat_table = &nat_cache_ptr->ip4_tbl[dma->table_index];
+
+		switch ( dma->base_addr )
+		{
+		case IPA_NAT_BASE_TBL:
+			base = nat_table->table.table_addr;
+			break;
+		case IPA_NAT_EXPN_TBL:
+			base = nat_table->table.expn_table_addr;
+			break;
+		case IPA_NAT_INDX_TBL:
+			base = nat_table->index_table.table_addr;
+			break;
+		case IPA_NAT_INDEX_EXPN_TBL:
+			base = nat_table->index_table.expn_table_addr;
+			break;
+		default:
+			IPAERR("Bad base_addr(%u) in dma entry %u\n", dma->base_addr, i);
+			continue;
+		}
+
+		*(uint16_t*) (base + (dma->offset - nat_table->mem_desc.addr_offset)) =
+			dma->data;
+	}
+
+	IPADBG("Out\n");
+}
+
 static int ipa_nati_post_ipv4_dma_cmd(
 	struct ipa_nat_cache*       nat_cache_ptr,
 	struct ipa_ioc_nat_dma_cmd* cmd)
@@ -1106,7 +1519,14 @@ static int ipa_nati_post_ipv4_dma_cmd(
 	*buf = '\0';
 	IPADBG("%s\n", prep_ioc_nat_dma_cmd_4print(cmd, buf, sizeof(buf)));
 
-	if (ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd)) {
+	if (nat_cache_ptr->offline) {
+		ipa_nati_apply_ipv4_dma_cmd(nat_cache_ptr, cmd);
+		IPADBG("Applied dma command to offline %s tables\n",
+			   ipa3_nat_mem_in_as_str(nat_cache_ptr->nmi));
+		goto bail;
+	}
+
+	if (ipa_nat_be_ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd)) {
 		IPAERR("ioctl (IPA_IOC_TABLE_DMA_CMD) on fd %d has failed\n",
 			   nat_cache_ptr->ipa_desc->fd);
 		ret = -EIO;
@@ -1149,7 +1569,7 @@ int ipa_nati_modify_pdn(
 	if (entry->public_ip == 0)
 		IPADBG("PDN %d public ip will be set  to 0\n", entry->pdn_index);
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_NAT_MODIFY_PDN, entry);
+	ret = ipa_nat_be_ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_NAT_MODIFY_PDN, entry);
 
 	if ( ret ) {
 		IPAERR("unable to call modify pdn icotl\nindex %d, ip 0x%X, src_metdata 0x%X, dst_metadata 0x%X IPA fd %d\n",
@@ -1443,7 +1863,8 @@ int ipa_NATI_add_ipv4_tbl(
 		nat_table,
 		public_ip_addr,
 		number_of_entries,
-		nat_cache_ptr->table_cnt);
+		nat_cache_ptr->table_cnt,
+		false);
 
 	if (ret) {
 		IPAERR("unable to create nat table Error: %d\n", ret);
@@ -1567,6 +1988,12 @@ bail:
 	return ret;
 }
 
+/*
+ * The time stamp queries below take no lock.  They are only reached
+ * through the state machine's read side, which either holds nat_mutex
+ * (when a writer asks) or brackets them with ipa_nati_read_begin() and
+ * ipa_nati_read_retry() and reruns them if a writer got in...
+ */
 int ipa_NATI_query_timestamp(
 	uint32_t  tbl_hdl,
 	uint32_t  rule_hdl,
@@ -1596,16 +2023,10 @@ int ipa_NATI_query_timestamp(
 
 	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
 
-	if (pthread_mutex_lock(&nat_mutex)) {
-		IPAERR("unable to lock the nat mutex\n");
-		ret = -EINVAL;
-		goto bail;
-	}
-
 	if ( ! nat_table->mem_desc.valid ) {
 		IPAERR("invalid table handle %d\n", tbl_hdl);
 		ret = -EINVAL;
-		goto unlock;
+		goto bail;
 	}
 
 	ret = ipa_table_get_entry(
@@ -1618,7 +2039,7 @@ int ipa_NATI_query_timestamp(
 		IPAERR("Unable to retrive the entry with "
 			   "handle=%u in NAT table with handle=0x%08X\n",
 			   rule_hdl, tbl_hdl);
-		goto unlock;
+		goto bail;
 	}
 
 	*buf = '\0';
@@ -1628,237 +2049,1540 @@ int ipa_NATI_query_timestamp(
 
 	*time_stamp = rule_ptr->time_stamp;
 
-unlock:
-	if (pthread_mutex_unlock(&nat_mutex)) {
-		IPAERR("unable to unlock the nat mutex\n");
-		ret = (ret) ? ret : -EPERM;
-	}
-
 bail:
 	IPADBG("Out\n");
 
 	return ret;
 }
 
-int ipa_NATI_add_ipv4_rule(
-	uint32_t                 tbl_hdl,
-	const ipa_nat_ipv4_rule* clnt_rule,
-	uint32_t*                rule_hdl)
+int ipa_NATI_query_timestamps(
+	uint32_t        tbl_hdl,
+	const uint32_t* rule_hdls,
+	uint32_t        num_rules,
+	uint32_t*       time_stamps )
 {
-	uint32_t cmd_sz =
-		sizeof(struct ipa_ioc_nat_dma_cmd) +
-		(MAX_DMA_ENTRIES_FOR_ADD * sizeof(struct ipa_ioc_nat_dma_one));
-	char cmd_buf[cmd_sz];
-	struct ipa_ioc_nat_dma_cmd* cmd =
-		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
-
 	enum ipa3_nat_mem_in            nmi;
 	struct ipa_nat_cache*           nat_cache_ptr;
 	struct ipa_nat_ip4_table_cache* nat_table;
-	struct ipa_nat_rule*            rule;
+	struct ipa_nat_rule*            rule_ptr;
 
-	uint16_t new_entry_index;
-	uint16_t new_index_tbl_entry_index;
-	uint32_t new_entry_handle;
-	char     buf[1024];
+	uint32_t i;
 
 	int ret = 0;
 
 	IPADBG("In\n");
 
-	memset(cmd_buf, 0, sizeof(cmd_buf));
-
-	if ( ! VALID_TBL_HDL(tbl_hdl) ||
-		 ! clnt_rule ||
-		 ! rule_hdl )
-	{
-		IPAERR("Bad arg: tbl_hdl(0x%08X) and/or clnt_rule(%p) and/or rule_hdl(%p)\n",
-			   tbl_hdl, clnt_rule, rule_hdl);
-		ret = -EINVAL;
-		goto done;
-	}
-
-	*rule_hdl = 0;
-
-	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
-
 	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
 
 	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
 		IPAERR("Bad cache type argument passed\n");
 		ret = -EINVAL;
-		goto done;
+		goto bail;
 	}
 
-	*buf = '\0';
-	IPADBG("tbl_hdl(0x%08X) nmi(%s) %s\n",
-		   tbl_hdl,
-		   ipa3_nat_mem_in_as_str(nmi),
-		   prep_nat_ipv4_rule_4print(clnt_rule, buf, sizeof(buf)));
-
 	nat_cache_ptr = &ipv4_nat_cache[nmi];
 
 	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
 
-	if (clnt_rule->protocol == IPAHAL_NAT_INVALID_PROTOCOL) {
-		IPAERR("invalid parameter protocol=%d\n", clnt_rule->protocol);
+	if ( ! nat_table->mem_desc.valid ) {
+		IPAERR("invalid table handle %d\n", tbl_hdl);
 		ret = -EINVAL;
-		goto done;
+		goto bail;
 	}
 
 	/*
-	 * Verify that the rule's PDN is valid
+	 * The records are read in place, hence no per rule locking,
+	 * handle validation beyond a bounds check, or printing...
 	 */
-	if (clnt_rule->pdn_index >= IPA_MAX_PDN_NUM ||
-		pdns[clnt_rule->pdn_index].public_ip == 0) {
-		IPAERR("invalid parameters, pdn index %d, public ip = 0x%X\n",
-			   clnt_rule->pdn_index, pdns[clnt_rule->pdn_index].public_ip);
-		ret = -EINVAL;
-		goto done;
-	}
-
-	if (pthread_mutex_lock(&nat_mutex)) {
-		IPAERR("unable to lock the nat mutex\n");
-		ret = -EINVAL;
-		goto done;
-	}
-
-	if (! nat_table->mem_desc.valid) {
-		IPAERR("invalid table handle %d\n", tbl_hdl);
-		ret = -EINVAL;
-		goto unlock;
-	}
+	for ( i = 0; i < num_rules; i++ )
+	{
+		enum ipa3_nat_mem_in rule_nmi;
+		uint8_t              is_expn_tbl;
+		uint16_t             rec_index;
+
+		BREAK_RULE_HDL(
+			(&nat_table->table), rule_hdls[i], rule_nmi, is_expn_tbl, rec_index);
+
+		if ( ! VALID_RULE_HDL(rule_hdls[i])
+			 ||
+			 rule_nmi != nmi
+			 ||
+			 rec_index >= nat_table->table.tot_tbl_ents )
+		{
+			IPAERR("Bad rule handle 0x%08X for table with handle 0x%08X\n",
+				   rule_hdls[i], tbl_hdl);
+			ret = -EINVAL;
+			continue;
+		}
 
-	new_entry_index = dst_hash(
-		nat_cache_ptr,
-		pdns[clnt_rule->pdn_index].public_ip,
-		clnt_rule->target_ip,
-		clnt_rule->target_port,
-		clnt_rule->public_port,
-		clnt_rule->protocol,
-		nat_table->table.table_entries - 1);
+		UNUSED(is_expn_tbl);
 
-	ret = ipa_table_add_entry(
-		&nat_table->table,
-		(void*) clnt_rule,
-		&new_entry_index,
-		&new_entry_handle,
-		cmd);
+		rule_ptr = (struct ipa_nat_rule*) GOTO_REC(&nat_table->table, rec_index);
 
-	if (ret) {
-		IPAERR("Failed to add a new NAT entry\n");
-		goto unlock;
+		time_stamps[i] = rule_ptr->time_stamp;
 	}
 
-	new_index_tbl_entry_index =
-		src_hash(clnt_rule->private_ip,
-				 clnt_rule->private_port,
-				 clnt_rule->target_ip,
-				 clnt_rule->target_port,
-				 clnt_rule->protocol,
-				 nat_table->table.table_entries - 1);
-
-	ret = ipa_table_add_entry(
-		&nat_table->index_table,
-		(void*) &new_entry_index,
-		&new_index_tbl_entry_index,
-		NULL,
-		cmd);
+bail:
+	IPADBG("Out\n");
 
-	if (ret) {
-		IPAERR("failed to add a new NAT index entry\n");
-		goto fail_add_index_entry;
-	}
+	return ret;
+}
 
-	rule = ipa_table_get_entry_by_index(
-		&nat_table->table,
-		new_entry_index);
+/*
+ * ----------------------------------------------------------------------------
+ * Scanning rule records a block at a time
+ * ----------------------------------------------------------------------------
+ */
 
-	if (rule == NULL) {
-		IPAERR("Failed to retrieve the entry in index %d for NAT table with handle=%d\n",
-			   new_entry_index, tbl_hdl);
-		ret = -EPERM;
-		goto bail;
-	}
+/*
+ * Rule time stamps are 24 bits wide, and wrap.  Stamp a is taken to
+ * be before stamp b when b is less than half the stamp's range ahead
+ * of it...
+ */
+#undef  IPA_NAT_TS_MASK
+#define IPA_NAT_TS_MASK 0x00FFFFFF
 
-	rule->indx_tbl_entry = new_index_tbl_entry_index;
+#undef  IPA_NAT_TS_BEFORE
+#define IPA_NAT_TS_BEFORE(a, b) \
+	( ((b) - (a)) & IPA_NAT_TS_MASK && \
+	  (((b) - (a)) & IPA_NAT_TS_MASK) <= (IPA_NAT_TS_MASK >> 1) )
 
-	rule->redirect   = clnt_rule->redirect;
-	rule->enable     = clnt_rule->enable;
-	rule->time_stamp = clnt_rule->time_stamp;
+/*
+ * The IPA writes a rule's time stamp into the record itself, so the
+ * time stamp APIs look at every record in the table.  Of the record's
+ * eight 32 bit words, they only need two:
+ *
+ *   word 4: ip_chksum, rsvd1, redirect and, in bit 31, enable
+ *   word 5: time_stamp, with protocol in the top byte
+ *
+ * With a little endian bitfield layout, which is what the IPA reads,
+ * the vector versions below pull those words out of several records at
+ * once.  Elsewhere, or when forced to, the records are looked at one
+ * at a time...
+ */
+#undef  NATI_REC_WORDS
+#define NATI_REC_WORDS  (sizeof(struct ipa_nat_rule) / sizeof(uint32_t))
 
-	IPADBG("new entry:%d, new index entry: %d\n",
-		   new_entry_index, new_index_tbl_entry_index);
+#undef  NATI_FLAGS_WORD
+#define NATI_FLAGS_WORD 4
 
-	IPADBG("rule_hdl(0x%08X) -> %s\n",
-		   new_entry_handle,
-		   prep_nat_rule_4print(rule, buf, sizeof(buf)));
+#undef  NATI_TS_WORD
+#define NATI_TS_WORD    5
 
-	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+static bool scan_scalar = false;
 
-	if (ret) {
-		IPAERR("unable to post dma command\n");
-		goto bail;
+static inline bool nati_scan_one(
+	const struct ipa_nat_rule* rule_ptr,
+	ipa_nati_scan_type         type,
+	uint32_t                   ref,
+	const uint32_t*            shadow )
+{
+	if ( ! rule_ptr->enable ||
+		 rule_ptr->protocol == IPAHAL_NAT_INVALID_PROTOCOL )
+	{
+		return false;
 	}
 
-	if (pthread_mutex_unlock(&nat_mutex)) {
-		IPAERR("unable to unlock the nat mutex\n");
-		ret = -EPERM;
-		goto done;
+	switch ( type )
+	{
+	case NATI_SCAN_CHANGED:
+		return rule_ptr->time_stamp != *shadow;
+	case NATI_SCAN_STALE:
+		return IPA_NAT_TS_BEFORE((uint32_t) rule_ptr->time_stamp, ref);
+	default:
+		return true;
 	}
+}
 
-	*rule_hdl = new_entry_handle;
+#if defined(NATI_SCAN_ISA) && defined(__AVX2__)
+/*
+ * Eight records, gathering each of the two words at a 32 byte
+ * stride...
+ */
+static inline uint32_t nati_scan_block(
+	const uint32_t*    w,
+	ipa_nati_scan_type type,
+	uint32_t           ref,
+	const uint32_t*    shadow )
+{
+	const __m256i idx =
+		_mm256_setr_epi32(
+			0 * NATI_REC_WORDS, 1 * NATI_REC_WORDS,
+			2 * NATI_REC_WORDS, 3 * NATI_REC_WORDS,
+			4 * NATI_REC_WORDS, 5 * NATI_REC_WORDS,
+			6 * NATI_REC_WORDS, 7 * NATI_REC_WORDS);
+
+	__m256i flags = _mm256_i32gather_epi32((const int*) (w + NATI_FLAGS_WORD), idx, 4);
+	__m256i tsw   = _mm256_i32gather_epi32((const int*) (w + NATI_TS_WORD),    idx, 4);
+	__m256i ts    = _mm256_and_si256(tsw, _mm256_set1_epi32(IPA_NAT_TS_MASK));
+	__m256i hit, d;
+
+	hit = _mm256_andnot_si256(
+		_mm256_cmpeq_epi32(
+			_mm256_srli_epi32(tsw, 24),
+			_mm256_set1_epi32(IPAHAL_NAT_INVALID_PROTOCOL)),
+		_mm256_srai_epi32(flags, 31));
+
+	if ( type == NATI_SCAN_CHANGED )
+	{
+		hit = _mm256_andnot_si256(
+			_mm256_cmpeq_epi32(ts, _mm256_loadu_si256((const __m256i*) shadow)),
+			hit);
+	}
+	else if ( type == NATI_SCAN_STALE )
+	{
+		d = _mm256_and_si256(
+			_mm256_sub_epi32(_mm256_set1_epi32(ref), ts),
+			_mm256_set1_epi32(IPA_NAT_TS_MASK));
+
+		hit = _mm256_and_si256(
+			hit,
+			_mm256_and_si256(
+				_mm256_cmpgt_epi32(d, _mm256_setzero_si256()),
+				_mm256_cmpgt_epi32(_mm256_set1_epi32((IPA_NAT_TS_MASK >> 1) + 1), d)));
+	}
 
-	IPADBG("rule_hdl value(%u)\n", *rule_hdl);
+	return (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+}
+#elif defined(NATI_SCAN_ISA) && defined(__SSE2__)
+/*
+ * Four records, whose back halves are loaded and then unpacked into a
+ * vector of each word...
+ */
+static inline uint32_t nati_scan_block(
+	const uint32_t*    w,
+	ipa_nati_scan_type type,
+	uint32_t           ref,
+	const uint32_t*    shadow )
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i*) (w + 0 * NATI_REC_WORDS + NATI_FLAGS_WORD));
+	__m128i r1 = _mm_loadu_si128((const __m128i*) (w + 1 * NATI_REC_WORDS + NATI_FLAGS_WORD));
+	__m128i r2 = _mm_loadu_si128((const __m128i*) (w + 2 * NATI_REC_WORDS + NATI_FLAGS_WORD));
+	__m128i r3 = _mm_loadu_si128((const __m128i*) (w + 3 * NATI_REC_WORDS + NATI_FLAGS_WORD));
+	__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	__m128i flags = _mm_unpacklo_epi64(t0, t1);
+	__m128i tsw   = _mm_unpackhi_epi64(t0, t1);
+	__m128i ts    = _mm_and_si128(tsw, _mm_set1_epi32(IPA_NAT_TS_MASK));
+	__m128i hit, d;
+
+	hit = _mm_andnot_si128(
+		_mm_cmpeq_epi32(
+			_mm_srli_epi32(tsw, 24),
+			_mm_set1_epi32(IPAHAL_NAT_INVALID_PROTOCOL)),
+		_mm_srai_epi32(flags, 31));
+
+	if ( type == NATI_SCAN_CHANGED )
+	{
+		hit = _mm_andnot_si128(
+			_mm_cmpeq_epi32(ts, _mm_loadu_si128((const __m128i*) shadow)),
+			hit);
+	}
+	else if ( type == NATI_SCAN_STALE )
+	{
+		d = _mm_and_si128(
+			_mm_sub_epi32(_mm_set1_epi32(ref), ts),
+			_mm_set1_epi32(IPA_NAT_TS_MASK));
+
+		hit = _mm_and_si128(
+			hit,
+			_mm_and_si128(
+				_mm_cmpgt_epi32(d, _mm_setzero_si128()),
+				_mm_cmpgt_epi32(_mm_set1_epi32((IPA_NAT_TS_MASK >> 1) + 1), d)));
+	}
 
-	goto done;
+	return (uint32_t) _mm_movemask_ps(_mm_castsi128_ps(hit));
+}
+#elif defined(NATI_SCAN_ISA)
+/*
+ * Four records, each loaded straight into a lane of the two word
+ * vectors...
+ */
+static inline uint32_t nati_scan_block(
+	const uint32_t*    w,
+	ipa_nati_scan_type type,
+	uint32_t           ref,
+	const uint32_t*    shadow )
+{
+	static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
 
-bail:
-	ipa_table_erase_entry(&nat_table->index_table, new_index_tbl_entry_index);
+	uint32x4x2_t v;
+	uint32x4_t   ts, hit, d;
+	uint32x2_t   sum;
 
-fail_add_index_entry:
-	ipa_table_erase_entry(&nat_table->table, new_entry_index);
+	v.val[0] = v.val[1] = vdupq_n_u32(0);
 
-unlock:
-	if (pthread_mutex_unlock(&nat_mutex))
-		IPAERR("unable to unlock the nat mutex\n");
-done:
-	IPADBG("Out\n");
+	v = vld2q_lane_u32(w + 0 * NATI_REC_WORDS + NATI_FLAGS_WORD, v, 0);
+	v = vld2q_lane_u32(w + 1 * NATI_REC_WORDS + NATI_FLAGS_WORD, v, 1);
+	v = vld2q_lane_u32(w + 2 * NATI_REC_WORDS + NATI_FLAGS_WORD, v, 2);
+	v = vld2q_lane_u32(w + 3 * NATI_REC_WORDS + NATI_FLAGS_WORD, v, 3);
 
-	return ret;
-}
+	ts = vandq_u32(v.val[1], vdupq_n_u32(IPA_NAT_TS_MASK));
 
-int ipa_NATI_del_ipv4_rule(
-	uint32_t tbl_hdl,
-	uint32_t rule_hdl )
-{
-	uint32_t cmd_sz =
-		sizeof(struct ipa_ioc_nat_dma_cmd) +
-		(MAX_DMA_ENTRIES_FOR_DEL * sizeof(struct ipa_ioc_nat_dma_one));
-	char cmd_buf[cmd_sz];
-	struct ipa_ioc_nat_dma_cmd* cmd =
-		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+	hit = vbicq_u32(
+		vtstq_u32(v.val[0], vdupq_n_u32(0x80000000)),
+		vceqq_u32(
+			vshrq_n_u32(v.val[1], 24),
+			vdupq_n_u32(IPAHAL_NAT_INVALID_PROTOCOL)));
 
-	enum ipa3_nat_mem_in            nmi;
-	struct ipa_nat_cache*           nat_cache_ptr;
-	struct ipa_nat_ip4_table_cache* nat_table;
-	struct ipa_nat_rule*            table_rule;
-	struct ipa_nat_indx_tbl_rule*   index_table_rule;
+	if ( type == NATI_SCAN_CHANGED )
+	{
+		hit = vbicq_u32(hit, vceqq_u32(ts, vld1q_u32(shadow)));
+	}
+	else if ( type == NATI_SCAN_STALE )
+	{
+		d = vandq_u32(
+			vsubq_u32(vdupq_n_u32(ref), ts),
+			vdupq_n_u32(IPA_NAT_TS_MASK));
+
+		hit = vandq_u32(
+			hit,
+			vandq_u32(
+				vtstq_u32(d, d),
+				vcleq_u32(d, vdupq_n_u32(IPA_NAT_TS_MASK >> 1))));
+	}
 
-	ipa_table_iterator table_iterator;
-	ipa_table_iterator index_table_iterator;
+	hit = vandq_u32(hit, vld1q_u32(lane_bits));
 
-	uint16_t index;
-	char     buf[1024];
-	int      ret = 0;
+	sum = vadd_u32(vget_low_u32(hit), vget_high_u32(hit));
 
-	IPADBG("In\n");
+	return vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+#endif
 
-	memset(cmd_buf, 0, sizeof(cmd_buf));
+/**
+ * ipa_nati_scan_recs() - finds the records of interest in a block
+ * @recs: [in] the first record
+ * @num_recs: [in] how many records, at most 32
+ * @type: [in] what's of interest, see ipa_nati_scan_type
+ * @ref: [in] for NATI_SCAN_STALE, the time stamp to compare against
+ * @shadow: [in] for NATI_SCAN_CHANGED, a time stamp per record
+ *
+ * Returns: a mask with bit i set when recs[i] is of interest
+ */
+uint32_t ipa_nati_scan_recs(
+	const struct ipa_nat_rule* recs,
+	uint32_t                   num_recs,
+	ipa_nati_scan_type         type,
+	uint32_t                   ref,
+	const uint32_t*            shadow )
+{
+	uint32_t bits = 0;
+	uint32_t i    = 0;
 
-	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u)\n", tbl_hdl, rule_hdl);
+	ref &= IPA_NAT_TS_MASK;
 
-	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+#if defined(NATI_SCAN_ISA)
+	if ( ! scan_scalar )
+	{
+		for ( ; i + NATI_SCAN_BLOCK <= num_recs; i += NATI_SCAN_BLOCK )
+		{
+			bits |= nati_scan_block(
+				(const uint32_t*) &recs[i],
+				type,
+				ref,
+				(shadow) ? &shadow[i] : NULL) << i;
+		}
+	}
+#endif
+
+	for ( ; i < num_recs; i++ )
+	{
+		bits |= (uint32_t) nati_scan_one(
+			&recs[i], type, ref, (shadow) ? &shadow[i] : NULL) << i;
+	}
+
+	return bits;
+}
+
+const char* ipa_nati_scan_isa(void)
+{
+#if defined(NATI_SCAN_ISA)
+	return (scan_scalar) ? "scalar" : NATI_SCAN_ISA;
+#else
+	return "scalar";
+#endif
+}
+
+void ipa_nati_scan_force_scalar(
+	bool force )
+{
+	scan_scalar = force;
+}
+
+/*
+ * Runs one of the scans over the whole of a NAT table, leaving out
+ * index zero, which is never handed out, and lists the rules found.
+ * For NATI_SCAN_CHANGED, the shadow is brought up to date for the
+ * rules listed, and only for those, so that when found fills up,
+ * another go picks up where this one left off...
+ */
+static int ipa_nati_scan_tbl(
+	ipa_table*               table,
+	ipa_nati_scan_type       type,
+	uint32_t                 ref,
+	uint32_t*                shadow,
+	ipa_nat_rule_time_stamp* found,
+	uint32_t                 max_found,
+	uint32_t*                num_found_ptr )
+{
+	struct ipa_nat_rule* rule_ptr;
+
+	uint32_t num_found = 0;
+	uint32_t base, bits, idx;
+
+	int ret = 0;
+
+	for ( base = 0; base < table->tot_tbl_ents; base += 32 )
+	{
+		bits = ipa_nati_scan_recs(
+			(const struct ipa_nat_rule*) GOTO_REC(table, base),
+			min(table->tot_tbl_ents - base, 32),
+			type,
+			ref,
+			(shadow) ? &shadow[base] : NULL);
+
+		if ( base == 0 )
+		{
+			bits &= ~1U;
+		}
+
+		for ( ; bits; bits &= bits - 1 )
+		{
+			if ( num_found == max_found )
+			{
+				ret = -ENOSPC;
+				goto bail;
+			}
+
+			idx      = base + __builtin_ctz(bits);
+			rule_ptr = (struct ipa_nat_rule*) GOTO_REC(table, idx);
+
+			found[num_found].rule_hdl   = ipa_table_get_entry_hdl(table, idx);
+			found[num_found].time_stamp = rule_ptr->time_stamp;
+
+			if ( shadow )
+			{
+				shadow[idx] = rule_ptr->time_stamp;
+			}
+
+			num_found++;
+		}
+	}
+
+bail:
+	*num_found_ptr = num_found;
+
+	return ret;
+}
+
+int ipa_NATI_query_all_timestamps(
+	uint32_t                 tbl_hdl,
+	ipa_nat_rule_time_stamp* time_stamps,
+	uint32_t                 max_rules,
+	uint32_t*                num_rules_ptr )
+{
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	if ( ! nat_table->mem_desc.valid ) {
+		IPAERR("invalid table handle %d\n", tbl_hdl);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	ret = ipa_nati_scan_tbl(
+		&nat_table->table, NATI_SCAN_LIVE, 0, NULL,
+		time_stamps, max_rules, num_rules_ptr);
+
+	if ( ret == -ENOSPC )
+	{
+		IPAERR("More than %u rules in table with handle 0x%08X\n",
+			   max_rules, tbl_hdl);
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_NATI_collect_stale(
+	uint32_t                 tbl_hdl,
+	uint32_t                 older_than,
+	ipa_nat_rule_time_stamp* stale,
+	uint32_t                 max_rules,
+	uint32_t*                num_stale_ptr )
+{
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	if ( ! nat_table->mem_desc.valid ) {
+		IPAERR("invalid table handle %d\n", tbl_hdl);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	ret = ipa_nati_scan_tbl(
+		&nat_table->table, NATI_SCAN_STALE, older_than, NULL,
+		stale, max_rules, num_stale_ptr);
+
+	if ( ret == -ENOSPC )
+	{
+		IPAERR("More than %u stale rules in table with handle 0x%08X\n",
+			   max_rules, tbl_hdl);
+	}
+
+	IPADBG("%u rules in table with handle 0x%08X stale before %u\n",
+		   *num_stale_ptr, tbl_hdl, older_than & IPA_NAT_TS_MASK);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_NATI_query_changed_timestamps(
+	uint32_t                 tbl_hdl,
+	ipa_nat_ts_shadow*       shadow,
+	ipa_nat_rule_time_stamp* time_stamps,
+	uint32_t                 max_rules,
+	uint32_t*                num_rules_ptr )
+{
+	enum ipa3_nat_mem_in            nmi;
+	uint32_t                        broken_tbl_hdl;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, broken_tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[broken_tbl_hdl - 1];
+
+	if ( ! nat_table->mem_desc.valid ) {
+		IPAERR("invalid table handle %d\n", broken_tbl_hdl);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	/*
+	 * The shadow is indexed by record, so when the rules are now in
+	 * another table, or the table has been resized, nothing in it
+	 * means anything.  It's then filled with a value no 24 bit time
+	 * stamp matches, so that every live rule is reported...
+	 */
+	if ( shadow->tbl_hdl != tbl_hdl ||
+		 shadow->tot_tbl_ents != nat_table->table.tot_tbl_ents )
+	{
+		uint32_t* time_stamps_new =
+			realloc(shadow->time_stamps,
+					nat_table->table.tot_tbl_ents * sizeof(uint32_t));
+
+		if ( ! time_stamps_new )
+		{
+			IPAERR("Unable to allocate shadow of %u time stamps\n",
+				   nat_table->table.tot_tbl_ents);
+			ret = -ENOMEM;
+			goto bail;
+		}
+
+		IPADBG("Shadow reset for table with handle 0x%08X\n", tbl_hdl);
+
+		shadow->tbl_hdl      = tbl_hdl;
+		shadow->tot_tbl_ents = nat_table->table.tot_tbl_ents;
+		shadow->time_stamps  = time_stamps_new;
+
+		memset(time_stamps_new, 0xFF,
+			   nat_table->table.tot_tbl_ents * sizeof(uint32_t));
+	}
+
+	ret = ipa_nati_scan_tbl(
+		&nat_table->table, NATI_SCAN_CHANGED, 0, shadow->time_stamps,
+		time_stamps, max_rules, num_rules_ptr);
+
+	IPADBG("%u rules in table with handle 0x%08X changed\n",
+		   *num_rules_ptr, tbl_hdl);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+void ipa_nati_free_ts_shadow(
+	ipa_nat_ts_shadow* shadow )
+{
+	if ( shadow )
+	{
+		free(shadow->time_stamps);
+		free(shadow);
+	}
+}
+
+int ipa_NATI_find_ipv4_rule(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl )
+{
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	struct ipa_nat_tuple tuple;
+	uint16_t             rec_index;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	memset(&tuple, 0, sizeof(tuple));
+
+	tuple.private_ip   = clnt_rule->private_ip;
+	tuple.target_ip    = clnt_rule->target_ip;
+	tuple.private_port = clnt_rule->private_port;
+	tuple.target_port  = clnt_rule->target_port;
+	tuple.protocol     = clnt_rule->protocol;
+	tuple.pdn_index    = clnt_rule->pdn_index;
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( ! nat_table->mem_desc.valid ) {
+		IPAERR("invalid table handle %d\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	rec_index = ipa_nati_tuple_index_find(nat_table, &tuple);
+
+	if ( ! VALID_INDEX(rec_index) ) {
+		ret = -ENOENT;
+		goto unlock;
+	}
+
+	*rule_hdl = ipa_table_get_entry_hdl(&nat_table->table, rec_index);
+
+	IPADBG("rule_hdl(0x%08X)\n", *rule_hdl);
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Computes the NAT and index table buckets a client rule hashes to
+ */
+static void ipa_nati_rule_buckets(
+	struct ipa_nat_cache*           nat_cache_ptr,
+	struct ipa_nat_ip4_table_cache* nat_table,
+	const ipa_nat_ipv4_rule*        clnt_rule,
+	uint16_t*                       nat_bucket_ptr,
+	uint16_t*                       idx_bucket_ptr)
+{
+	*nat_bucket_ptr = dst_hash(
+		nat_cache_ptr,
+		pdns[clnt_rule->pdn_index].public_ip,
+		clnt_rule->target_ip,
+		clnt_rule->target_port,
+		clnt_rule->public_port,
+		clnt_rule->protocol,
+		nat_table->table.table_entries - 1);
+
+	*idx_bucket_ptr = src_hash(
+		clnt_rule->private_ip,
+		clnt_rule->private_port,
+		clnt_rule->target_ip,
+		clnt_rule->target_port,
+		clnt_rule->protocol,
+		nat_table->table.table_entries - 1);
+}
+
+/**
+ * ipa_nati_stage_ipv4_rule() - stages a rule into the tables
+ * @nat_table: [in] IPv4 NAT table
+ * @clnt_rule: [in] the rule to add
+ * @cmd: [in/out] dma command the rule's dma entries are appended to
+ * @entry_index_ptr: [in/out] in: NAT bucket, out: NAT table index
+ * @index_entry_index_ptr: [in/out] in: index bucket, out: index table index
+ * @rule_hdl: [out] handle of the new rule
+ *
+ * Fills in the software side of both tables and appends the dma
+ * entries that make the rule visible to the IPA.  The command is not
+ * posted.  On failure, the tables and the command are left as they
+ * were found.
+ *
+ * Must be called with nat_mutex held.
+ *
+ * Returns: 0 On Success, negative on failure
+ */
+static int ipa_nati_stage_ipv4_rule(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	const ipa_nat_ipv4_rule*        clnt_rule,
+	struct ipa_ioc_nat_dma_cmd*     cmd,
+	uint16_t*                       entry_index_ptr,
+	uint16_t*                       index_entry_index_ptr,
+	uint32_t*                       rule_hdl)
+{
+	struct ipa_nat_rule* rule;
+
+	uint8_t  orig_entries = cmd->entries;
+	char     buf[1024];
+
+	int ret;
+
+	UNUSED(buf);
+
+	IPADBG("In\n");
+
+	ret = ipa_table_add_entry(
+		&nat_table->table,
+		(void*) clnt_rule,
+		entry_index_ptr,
+		rule_hdl,
+		cmd);
+
+	if (ret) {
+		IPAERR("Failed to add a new NAT entry\n");
+		goto bail;
+	}
+
+	ret = ipa_table_add_entry(
+		&nat_table->index_table,
+		(void*) entry_index_ptr,
+		index_entry_index_ptr,
+		NULL,
+		cmd);
+
+	if (ret) {
+		IPAERR("failed to add a new NAT index entry\n");
+		goto fail_add_index_entry;
+	}
+
+	rule = ipa_table_get_entry_by_index(
+		&nat_table->table,
+		*entry_index_ptr);
+
+	if (rule == NULL) {
+		IPAERR("Failed to retrieve the entry in index %d for NAT table\n",
+			   *entry_index_ptr);
+		ret = -EPERM;
+		goto fail_get_entry;
+	}
+
+	rule->indx_tbl_entry = *index_entry_index_ptr;
+
+	rule->redirect   = clnt_rule->redirect;
+	rule->enable     = clnt_rule->enable;
+	rule->time_stamp = clnt_rule->time_stamp;
+
+	IPADBG("new entry:%d, new index entry: %d\n",
+		   *entry_index_ptr, *index_entry_index_ptr);
+
+	IPADBG("rule_hdl(0x%08X) -> %s\n",
+		   *rule_hdl,
+		   prep_nat_rule_4print(rule, buf, sizeof(buf)));
+
+	goto bail;
+
+fail_get_entry:
+	ipa_table_erase_entry(&nat_table->index_table, *index_entry_index_ptr);
+
+fail_add_index_entry:
+	ipa_table_erase_entry(&nat_table->table, *entry_index_ptr);
+
+	cmd->entries = orig_entries;
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Validates the parts of a client rule that are independent of the
+ * table state
+ */
+static int ipa_nati_check_ipv4_rule(
+	const ipa_nat_ipv4_rule* clnt_rule)
+{
+	if (clnt_rule->protocol == IPAHAL_NAT_INVALID_PROTOCOL) {
+		IPAERR("invalid parameter protocol=%d\n", clnt_rule->protocol);
+		return -EINVAL;
+	}
+
+	/*
+	 * Verify that the rule's PDN is valid
+	 */
+	if (clnt_rule->pdn_index >= IPA_MAX_PDN_NUM ||
+		pdns[clnt_rule->pdn_index].public_ip == 0) {
+		IPAERR("invalid parameters, pdn index %d, public ip = 0x%X\n",
+			   clnt_rule->pdn_index,
+			   (clnt_rule->pdn_index < IPA_MAX_PDN_NUM) ?
+			   pdns[clnt_rule->pdn_index].public_ip : 0);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int ipa_NATI_add_ipv4_rule(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl)
+{
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_ADD * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	uint16_t new_entry_index;
+	uint16_t new_index_tbl_entry_index;
+	uint32_t new_entry_handle;
+	char     buf[1024];
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	memset(cmd_buf, 0, sizeof(cmd_buf));
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 ! clnt_rule ||
+		 ! rule_hdl )
+	{
+		IPAERR("Bad arg: tbl_hdl(0x%08X) and/or clnt_rule(%p) and/or rule_hdl(%p)\n",
+			   tbl_hdl, clnt_rule, rule_hdl);
+		ret = -EINVAL;
+		goto done;
+	}
+
+	*rule_hdl = 0;
+
+	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	*buf = '\0';
+	IPADBG("tbl_hdl(0x%08X) nmi(%s) %s\n",
+		   tbl_hdl,
+		   ipa3_nat_mem_in_as_str(nmi),
+		   prep_nat_ipv4_rule_4print(clnt_rule, buf, sizeof(buf)));
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	ret = ipa_nati_check_ipv4_rule(clnt_rule);
+
+	if (ret) {
+		goto done;
+	}
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	if (! nat_table->mem_desc.valid && ! nat_table->staged_image) {
+		IPAERR("invalid table handle %d\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ipa_nati_rule_buckets(
+		nat_cache_ptr,
+		nat_table,
+		clnt_rule,
+		&new_entry_index,
+		&new_index_tbl_entry_index);
+
+	ret = ipa_nati_stage_ipv4_rule(
+		nat_table,
+		clnt_rule,
+		cmd,
+		&new_entry_index,
+		&new_index_tbl_entry_index,
+		&new_entry_handle);
+
+	if (ret) {
+		goto unlock;
+	}
+
+	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+
+	if (ret) {
+		IPAERR("unable to post dma command\n");
+		goto bail;
+	}
+
+	ipa_nati_tuple_index_add_rec(nat_table, new_entry_index);
+
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = -EPERM;
+		goto done;
+	}
+
+	*rule_hdl = new_entry_handle;
+
+	IPADBG("rule_hdl value(%u)\n", *rule_hdl);
+
+	goto done;
+
+bail:
+	ipa_table_erase_entry(&nat_table->index_table, new_index_tbl_entry_index);
+	ipa_table_erase_entry(&nat_table->table, new_entry_index);
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex))
+		IPAERR("unable to unlock the nat mutex\n");
+done:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Book keeping for rules that have been staged into the tables, but
+ * whose dma command has yet to be posted...
+ */
+typedef struct
+{
+	uint32_t rule_sub;    /* subscript into caller's rule array */
+	uint16_t nat_bucket;
+	uint16_t idx_bucket;
+	uint16_t entry_index;
+	uint16_t index_entry_index;
+	uint32_t rule_hdl;
+} staged_ipv4_rule;
+
+#define MAX_STAGED_RULES \
+	(MAX_DMA_ENTRIES_FOR_BATCH / MAX_DMA_ENTRIES_FOR_ADD)
+
+/*
+ * Posts the dma command for all staged rules.  On success, their
+ * handles are handed back to the caller.  On failure, every staged
+ * rule is removed from the tables.
+ */
+static int ipa_nati_flush_staged_ipv4_rules(
+	struct ipa_nat_cache*           nat_cache_ptr,
+	struct ipa_nat_ip4_table_cache* nat_table,
+	struct ipa_ioc_nat_dma_cmd*     cmd,
+	staged_ipv4_rule*               staged,
+	uint32_t*                       num_staged_ptr,
+	uint32_t*                       rule_hdls)
+{
+	uint32_t i;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( *num_staged_ptr == 0 )
+	{
+		goto bail;
+	}
+
+	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+
+	if ( ret )
+	{
+		IPAERR("unable to post dma command for %u rules\n", *num_staged_ptr);
+
+		for ( i = *num_staged_ptr; i > 0; i-- )
+		{
+			ipa_table_erase_entry(
+				&nat_table->index_table, staged[i - 1].index_entry_index);
+			ipa_table_erase_entry(
+				&nat_table->table, staged[i - 1].entry_index);
+		}
+	}
+	else
+	{
+		for ( i = 0; i < *num_staged_ptr; i++ )
+		{
+			rule_hdls[staged[i].rule_sub] = staged[i].rule_hdl;
+
+			ipa_nati_tuple_index_add_rec(nat_table, staged[i].entry_index);
+		}
+	}
+
+	*num_staged_ptr = 0;
+	cmd->entries    = 0;
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_NATI_add_ipv4_rules(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rules,
+	uint32_t                 num_rules,
+	uint32_t*                rule_hdls)
+{
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_BATCH * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	staged_ipv4_rule staged[MAX_STAGED_RULES];
+	uint32_t         num_staged = 0;
+
+	uint32_t i, j;
+
+	int ret = 0, rule_ret, flush_ret;
+
+	IPADBG("In\n");
+
+	memset(cmd_buf, 0, sizeof(cmd_buf));
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 ! clnt_rules ||
+		 ! num_rules ||
+		 ! rule_hdls )
+	{
+		IPAERR("Bad arg: tbl_hdl(0x%08X) and/or clnt_rules(%p) "
+			   "and/or num_rules(%u) and/or rule_hdls(%p)\n",
+			   tbl_hdl, clnt_rules, num_rules, rule_hdls);
+		ret = -EINVAL;
+		goto done;
+	}
+
+	memset(rule_hdls, 0, num_rules * sizeof(uint32_t));
+
+	IPADBG("tbl_hdl(0x%08X) num_rules(%u)\n", tbl_hdl, num_rules);
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	if (! nat_table->mem_desc.valid) {
+		IPAERR("invalid table handle %d\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	for ( i = 0; i < num_rules; i++ )
+	{
+		const ipa_nat_ipv4_rule* clnt_rule = &clnt_rules[i];
+
+		uint16_t nat_bucket, idx_bucket;
+		bool     collides = false;
+
+		rule_ret = ipa_nati_check_ipv4_rule(clnt_rule);
+
+		if ( rule_ret )
+		{
+			IPAERR("rule %u rejected\n", i);
+			ret = rule_ret;
+			continue;
+		}
+
+		ipa_nati_rule_buckets(
+			nat_cache_ptr, nat_table, clnt_rule, &nat_bucket, &idx_bucket);
+
+		/*
+		 * A staged rule's head and list linkage are only written by
+		 * the IPA when the dma command is posted.  Until then, the
+		 * tables can't be trusted for a bucket that a staged rule
+		 * touched, hence flush before reusing such a bucket...
+		 */
+		for ( j = 0; j < num_staged && ! collides; j++ )
+		{
+			collides =
+				staged[j].nat_bucket == nat_bucket ||
+				staged[j].idx_bucket == idx_bucket;
+		}
+
+		if ( collides ||
+			 num_staged == MAX_STAGED_RULES ||
+			 cmd->entries + MAX_DMA_ENTRIES_FOR_ADD > MAX_DMA_ENTRIES_FOR_BATCH )
+		{
+			flush_ret = ipa_nati_flush_staged_ipv4_rules(
+				nat_cache_ptr, nat_table, cmd, staged, &num_staged, rule_hdls);
+
+			ret = (flush_ret) ? flush_ret : ret;
+		}
+
+		staged[num_staged].rule_sub          = i;
+		staged[num_staged].nat_bucket        = nat_bucket;
+		staged[num_staged].idx_bucket        = idx_bucket;
+		staged[num_staged].entry_index       = nat_bucket;
+		staged[num_staged].index_entry_index = idx_bucket;
+
+		rule_ret = ipa_nati_stage_ipv4_rule(
+			nat_table,
+			clnt_rule,
+			cmd,
+			&staged[num_staged].entry_index,
+			&staged[num_staged].index_entry_index,
+			&staged[num_staged].rule_hdl);
+
+		if ( rule_ret )
+		{
+			IPAERR("Unable to add rule %u\n", i);
+			ret = rule_ret;
+			continue;
+		}
+
+		num_staged++;
+	}
+
+	flush_ret = ipa_nati_flush_staged_ipv4_rules(
+		nat_cache_ptr, nat_table, cmd, staged, &num_staged, rule_hdls);
+
+	ret = (flush_ret) ? flush_ret : ret;
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+done:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * What is needed to delete a rule, from command generation through
+ * to the table clean up done after the dma command is posted...
+ */
+typedef struct
+{
+	uint32_t             rule_hdl;
+	struct ipa_nat_tuple tuple;
+	uint16_t             nat_bucket;
+	uint16_t             idx_bucket;
+	ipa_table_iterator table_iterator;
+	ipa_table_iterator index_table_iterator;
+} staged_ipv4_del;
+
+#define MAX_STAGED_DELS \
+	(MAX_DMA_ENTRIES_FOR_BATCH / MAX_DMA_ENTRIES_FOR_DEL)
+
+/*
+ * Finds the rule and the buckets it hangs off, without touching the
+ * tables...
+ */
+static int ipa_nati_locate_ipv4_del(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	uint32_t                        rule_hdl,
+	staged_ipv4_del*                del)
+{
+	struct ipa_nat_rule*          table_rule;
+	struct ipa_nat_indx_tbl_rule* index_table_rule;
+
+	uint16_t index;
+	char     buf[1024];
+	int      ret;
+
+	UNUSED(buf);
+
+	IPADBG("In\n");
+
+	memset(del, 0, sizeof(staged_ipv4_del));
+
+	del->rule_hdl = rule_hdl;
+
+	ret = ipa_table_get_entry(
+		&nat_table->table,
+		rule_hdl,
+		(void**) &table_rule,
+		&index);
+
+	if (ret) {
+		IPAERR("Unable to retrive the entry with rule_hdl=%u\n", rule_hdl);
+		goto bail;
+	}
+
+	*buf = '\0';
+	IPADBG("rule_hdl(0x%08X) -> %s\n",
+		   rule_hdl,
+		   prep_nat_rule_4print(table_rule, buf, sizeof(buf)));
+
+	/*
+	 * Grabbed now, since deleting a list head rewrites its protocol...
+	 */
+	ipa_nati_rule_tuple(table_rule, index, &del->tuple);
+
+	ret = ipa_table_iterator_init(
+		&del->table_iterator,
+		&nat_table->table,
+		table_rule,
+		index);
+
+	if (ret) {
+		IPAERR("Unable to create iterator which points to the "
+			   "entry %u in NAT table\n",
+			   index);
+		goto bail;
+	}
+
+	index = table_rule->indx_tbl_entry;
+
+	index_table_rule = (struct ipa_nat_indx_tbl_rule*)
+		ipa_table_get_entry_by_index(&nat_table->index_table, index);
+
+	if (index_table_rule == NULL) {
+		IPAERR("Unable to retrieve the entry in index %u "
+			   "in NAT index table\n",
+			   index);
+		ret = -EPERM;
+		goto bail;
+	}
+
+	ret = ipa_table_iterator_init(
+		&del->index_table_iterator,
+		&nat_table->index_table,
+		index_table_rule,
+		index);
+
+	if (ret) {
+		IPAERR("Unable to create iterator which points to the "
+			   "entry %u in NAT index table\n",
+			   index);
+		goto bail;
+	}
+
+	del->nat_bucket = ipa_table_get_chain_head(
+		&nat_table->table, del->table_iterator.curr_index);
+
+	del->idx_bucket = ipa_table_get_chain_head(
+		&nat_table->index_table, del->index_table_iterator.curr_index);
+
+	if ( ! VALID_INDEX(del->nat_bucket) || ! VALID_INDEX(del->idx_bucket) )
+	{
+		ret = -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Adds the rule's delete operations to the dma command.
+ */
+static int ipa_nati_stage_ipv4_del(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	struct ipa_ioc_nat_dma_cmd*     cmd,
+	staged_ipv4_del*                del)
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	ipa_table_create_delete_command(
+		&nat_table->index_table,
+		cmd,
+		&del->index_table_iterator);
+
+	if (ipa_table_iterator_is_head_with_tail(&del->index_table_iterator)) {
+
+		ipa_nati_copy_second_index_entry_to_head(
+			nat_table, &del->index_table_iterator, cmd);
+		/*
+		 * Iterate to the next entry which should be deleted
+		 */
+		ret = ipa_table_iterator_next(
+			&del->index_table_iterator, &nat_table->index_table);
+
+		if (ret) {
+			IPAERR("Unable to move the iterator to the next entry "
+				   "(points to the entry %u in NAT index table)\n",
+				   del->index_table_iterator.curr_index);
+			goto bail;
+		}
+	}
+
+	ipa_table_create_delete_command(
+		&nat_table->table,
+		cmd,
+		&del->table_iterator);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Once the IPA has seen the dma command, the rule's records can be
+ * released.
+ */
+static void ipa_nati_finish_ipv4_del(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	staged_ipv4_del*                del)
+{
+	ipa_table_iterator* table_iterator       = &del->table_iterator;
+	ipa_table_iterator* index_table_iterator = &del->index_table_iterator;
+
+	IPADBG("In\n");
+
+	ipa_nati_tuple_index_del(nat_table, &del->tuple);
+
+	if (! ipa_table_iterator_is_head_with_tail(table_iterator)) {
+		/* The entry can be deleted */
+		uint8_t is_prev_empty =
+			(table_iterator->prev_entry != NULL &&
+			 ((struct ipa_nat_rule*)table_iterator->prev_entry)->protocol ==
+			 IPAHAL_NAT_INVALID_PROTOCOL);
+
+		ipa_table_delete_entry(
+			&nat_table->table, table_iterator, is_prev_empty);
+	}
+
+	ipa_table_delete_entry(
+		&nat_table->index_table,
+		index_table_iterator,
+		FALSE);
+
+	if (index_table_iterator->curr_index >= nat_table->index_table.table_entries)
+		nat_table->index_expn_table_meta[
+			index_table_iterator->curr_index - nat_table->index_table.table_entries].
+			prev_index = IPA_TABLE_INVALID_ENTRY;
+
+	IPADBG("Out\n");
+}
+
+int ipa_NATI_del_ipv4_rule(
+	uint32_t tbl_hdl,
+	uint32_t rule_hdl )
+{
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_DEL * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	staged_ipv4_del del;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	memset(cmd_buf, 0, sizeof(cmd_buf));
+
+	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u)\n", tbl_hdl, rule_hdl);
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	IPADBG("nmi(%s)\n", ipa3_nat_mem_in_as_str(nmi));
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("Unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	if (! nat_table->mem_desc.valid) {
+		IPAERR("Invalid table handle 0x%08X\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = ipa_nati_locate_ipv4_del(nat_table, rule_hdl, &del);
+
+	if (ret) {
+		IPAERR("Unable to locate rule_hdl=%u in table with handle=0x%08X\n",
+			   rule_hdl, tbl_hdl);
+		goto unlock;
+	}
+
+	ret = ipa_nati_stage_ipv4_del(nat_table, cmd, &del);
+
+	if (ret) {
+		goto unlock;
+	}
+
+	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+
+	if (ret) {
+		IPAERR("Unable to post dma command\n");
+		goto unlock;
+	}
+
+	ipa_nati_finish_ipv4_del(nat_table, &del);
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("Unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+done:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_NATI_del_ipv4_rules(
+	uint32_t        tbl_hdl,
+	const uint32_t* rule_hdls,
+	uint32_t        num_rules,
+	uint32_t*       num_deleted_ptr)
+{
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_BATCH * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+
+	staged_ipv4_del staged[MAX_STAGED_DELS];
+	uint32_t        num_staged;
+
+	uint8_t* done_list = NULL;
+	uint32_t num_done  = 0;
+
+	uint32_t i, j;
+	uint8_t  entries;
+
+	int ret = 0, rule_ret;
+
+	IPADBG("In\n");
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 ! rule_hdls ||
+		 ! num_rules ||
+		 ! num_deleted_ptr )
+	{
+		IPAERR("Bad arg: tbl_hdl(0x%08X) and/or rule_hdls(%p) "
+			   "and/or num_rules(%u) and/or num_deleted_ptr(%p)\n",
+			   tbl_hdl, rule_hdls, num_rules, num_deleted_ptr);
+		ret = -EINVAL;
+		goto done;
+	}
+
+	*num_deleted_ptr = 0;
+
+	IPADBG("tbl_hdl(0x%08X) num_rules(%u)\n", tbl_hdl, num_rules);
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
 
 	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
 		IPAERR("Bad cache type argument passed\n");
@@ -1866,12 +3590,353 @@ int ipa_NATI_del_ipv4_rule(
 		goto done;
 	}
 
-	IPADBG("nmi(%s)\n", ipa3_nat_mem_in_as_str(nmi));
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
+
+	done_list = calloc(num_rules, sizeof(uint8_t));
+
+	if ( ! done_list ) {
+		IPAERR("Unable to allocate done list for %u rules\n", num_rules);
+		ret = -ENOMEM;
+		goto done;
+	}
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("Unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto done;
+	}
+
+	if (! nat_table->mem_desc.valid) {
+		IPAERR("Invalid table handle 0x%08X\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * Each pass stages at most one delete per bucket, since a delete
+	 * relies on list linkage that only the IPA writes when the dma
+	 * command is posted.  Rules sharing a bucket with an already
+	 * staged rule wait for a later pass...
+	 */
+	while ( num_done < num_rules )
+	{
+		memset(cmd_buf, 0, sizeof(cmd_buf));
+
+		num_staged = 0;
+
+		for ( i = 0;
+			  i < num_rules && num_staged < MAX_STAGED_DELS;
+			  i++ )
+		{
+			staged_ipv4_del* del = &staged[num_staged];
+			bool             collides = false;
+
+			if ( done_list[i] )
+			{
+				continue;
+			}
+
+			rule_ret = ipa_nati_locate_ipv4_del(nat_table, rule_hdls[i], del);
+
+			if ( rule_ret )
+			{
+				IPAERR("Unable to locate rule_hdl=%u\n", rule_hdls[i]);
+				done_list[i] = 1;
+				num_done++;
+				ret = rule_ret;
+				continue;
+			}
+
+			for ( j = 0; j < num_staged && ! collides; j++ )
+			{
+				collides =
+					staged[j].nat_bucket == del->nat_bucket ||
+					staged[j].idx_bucket == del->idx_bucket;
+			}
+
+			if ( collides )
+			{
+				continue;
+			}
+
+			done_list[i] = 1;
+			num_done++;
+
+			entries = cmd->entries;
+
+			rule_ret = ipa_nati_stage_ipv4_del(nat_table, cmd, del);
+
+			if ( rule_ret )
+			{
+				cmd->entries = entries;
+				ret = rule_ret;
+				continue;
+			}
+
+			num_staged++;
+		}
+
+		if ( num_staged == 0 )
+		{
+			continue;
+		}
+
+		rule_ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+
+		if ( rule_ret )
+		{
+			IPAERR("Unable to post dma command for %u deletes\n", num_staged);
+			ret = rule_ret;
+			continue;
+		}
+
+		for ( j = 0; j < num_staged; j++ )
+		{
+			ipa_nati_finish_ipv4_del(nat_table, &staged[j]);
+		}
+
+		*num_deleted_ptr += num_staged;
+	}
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("Unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+done:
+	free(done_list);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * Expansion table compaction
+ *
+ * Deleting the first rule of a list can't free its base table slot,
+ * since the IPA gets to the rest of the list through it.  The slot
+ * is left enabled, with a protocol the IPA never matches (see
+ * ipa_table_create_delete_command()), and the list keeps its length.
+ *
+ * The following pulls the second rule of such a list up into the
+ * base table slot, and so frees its expansion table slot.  The order
+ * in which it's done means the IPA always sees a whole list:
+ *
+ *   1. Software copies the rule into the slot, all but the protocol,
+ *      which still says deleted.  The IPA skips the slot, as before.
+ *
+ *   2. One dma command then:
+ *      a) sets the slot's protocol; the rule is now found in the slot
+ *         first, and also, still, at its old place
+ *      b) points the rule's index table entry at the slot
+ *      c) unlinks the old place from the list
+ *
+ *   3. Software frees the old place.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+	uint16_t             head_index;
+	uint16_t             second_index;
+	struct ipa_nat_tuple tuple;
+} staged_ipv4_pull;
+
+#define MAX_STAGED_PULLS \
+	(MAX_DMA_ENTRIES_FOR_BATCH / MAX_DMA_ENTRIES_FOR_PULL)
+
+/*
+ * What's written at IPA_NAT_RULE_PROTO_FIELD_OFFSET to give a rule
+ * back its protocol.  The time stamp's top byte shares the word.
+ */
+static uint16_t ipa_nati_proto_field_value(
+	const struct ipa_nat_rule* rule)
+{
+	return (uint16_t) ((rule->protocol << 8) | ((rule->time_stamp >> 16) & 0xFF));
+}
+
+/*
+ * Steps 1 and 2 above...
+ */
+static int ipa_nati_stage_ipv4_pull(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	struct ipa_ioc_nat_dma_cmd*     cmd,
+	staged_ipv4_pull*               pull)
+{
+	ipa_table*           table = &nat_table->table;
+	struct ipa_nat_rule* head_rule;
+	struct ipa_nat_rule* second_rule;
+	struct ipa_nat_rule  rule;
+	void*                index_table_rule;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	head_rule = (struct ipa_nat_rule*) GOTO_REC(table, pull->head_index);
+
+	pull->second_index = head_rule->next_index;
+
+	if ( pull->second_index < table->table_entries
+		 ||
+		 pull->second_index >= table->tot_tbl_ents )
+	{
+		IPAERR("Bad next index %u in deleted list head %u\n",
+			   pull->second_index, pull->head_index);
+		ret = -EPERM;
+		goto bail;
+	}
+
+	second_rule = (struct ipa_nat_rule*) GOTO_REC(table, pull->second_index);
+
+	index_table_rule = ipa_table_get_entry_by_index(
+		&nat_table->index_table, second_rule->indx_tbl_entry);
+
+	if ( ! second_rule->enable || index_table_rule == NULL )
+	{
+		IPAERR("Unusable second rule %u in list at %u\n",
+			   pull->second_index, pull->head_index);
+		ret = -EPERM;
+		goto bail;
+	}
+
+	ipa_nati_rule_tuple(second_rule, pull->second_index, &pull->tuple);
+
+	rule = *second_rule;
+
+	rule.protocol   = IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE;
+	rule.next_index = pull->second_index;
+	rule.prev_index = head_rule->prev_index;
+
+	*head_rule = rule;
+
+	/*
+	 * The protocol helper is the one used to delete list heads...
+	 */
+	ipa_table_add_dma_cmd(
+		table,
+		HELP_DELETE_HEAD,
+		head_rule,
+		pull->head_index,
+		ipa_nati_proto_field_value(second_rule),
+		cmd);
+
+	ipa_table_add_dma_cmd(
+		&nat_table->index_table,
+		HELP_UPDATE_HEAD,
+		index_table_rule,
+		second_rule->indx_tbl_entry,
+		pull->head_index,
+		cmd);
+
+	ipa_table_add_dma_cmd(
+		table,
+		HELP_UPDATE_ENTRY,
+		head_rule,
+		pull->head_index,
+		second_rule->next_index,
+		cmd);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Step 3 above...
+ */
+static void ipa_nati_finish_ipv4_pull(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	staged_ipv4_pull*               pull)
+{
+	ipa_table*           table = &nat_table->table;
+	struct ipa_nat_rule* second_rule;
+	uint16_t             next_index;
+
+	IPADBG("In\n");
+
+	second_rule = (struct ipa_nat_rule*) GOTO_REC(table, pull->second_index);
+
+	next_index = second_rule->next_index;
+
+	if ( VALID_INDEX(next_index) )
+	{
+		table->entry_interface->entry_set_prev_index(
+			GOTO_REC(table, next_index),
+			next_index,
+			pull->head_index,
+			table->meta,
+			table->table_entries);
+	}
+
+	ipa_nati_tuple_index_del(nat_table, &pull->tuple);
+
+	ipa_nati_tuple_index_add_rec(nat_table, pull->head_index);
+
+	ipa_table_erase_entry(table, pull->second_index);
+
+	IPADBG("Out\n");
+}
+
+int ipa_NATI_compact_ipv4_tbl(
+	uint32_t  tbl_hdl,
+	uint32_t  max_moves,
+	uint32_t* old_rule_hdls,
+	uint32_t* new_rule_hdls,
+	uint32_t* num_moved_ptr)
+{
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(MAX_DMA_ENTRIES_FOR_BATCH * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	enum ipa3_nat_mem_in            nmi;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+	ipa_table*                      table;
+
+	staged_ipv4_pull staged[MAX_STAGED_PULLS];
+	uint32_t         num_slots, num_staged, scanned, i;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 ! old_rule_hdls ||
+		 ! new_rule_hdls ||
+		 ! num_moved_ptr )
+	{
+		IPAERR("Bad arg: tbl_hdl(0x%08X) and/or old_rule_hdls(%p) "
+			   "and/or new_rule_hdls(%p) and/or num_moved_ptr(%p)\n",
+			   tbl_hdl, old_rule_hdls, new_rule_hdls, num_moved_ptr);
+		ret = -EINVAL;
+		goto done;
+	}
+
+	*num_moved_ptr = 0;
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto done;
+	}
 
 	nat_cache_ptr = &ipv4_nat_cache[nmi];
 
 	nat_table = &nat_cache_ptr->ip4_tbl[tbl_hdl - 1];
 
+	table = &nat_table->table;
+
 	if (pthread_mutex_lock(&nat_mutex)) {
 		IPAERR("Unable to lock the nat mutex\n");
 		ret = -EINVAL;
@@ -1884,116 +3949,102 @@ int ipa_NATI_del_ipv4_rule(
 		goto unlock;
 	}
 
-	ret = ipa_table_get_entry(
-		&nat_table->table,
-		rule_hdl,
-		(void**) &table_rule,
-		&index);
-
-	if (ret) {
-		IPAERR("Unable to retrive the entry with rule_hdl=%u\n", rule_hdl);
-		goto unlock;
+	/*
+	 * Picks up where the last call left off, and looks at each base
+	 * table slot at most once.  Slot zero is never used, so there are
+	 * table_entries - 1 of them...
+	 */
+	if ( ! VALID_INDEX(nat_table->compact_cursor)
+		 ||
+		 nat_table->compact_cursor >= table->table_entries )
+	{
+		nat_table->compact_cursor = 1;
 	}
 
-	*buf = '\0';
-	IPADBG("rule_hdl(0x%08X) -> %s\n",
-		   rule_hdl,
-		   prep_nat_rule_4print(table_rule, buf, sizeof(buf)));
+	num_slots = ( table->table_entries > 1 ) ? table->table_entries - 1 : 0;
 
-	ret = ipa_table_iterator_init(
-		&table_iterator,
-		&nat_table->table,
-		table_rule,
-		index);
+	for ( scanned = 0;
+		  *num_moved_ptr < max_moves && scanned < num_slots; )
+	{
+		memset(cmd_buf, 0, sizeof(cmd_buf));
 
-	if (ret) {
-		IPAERR("Unable to create iterator which points to the "
-			   "entry %u in NAT table with handle=0x%08X\n",
-			   index, tbl_hdl);
-		goto unlock;
-	}
+		for ( num_staged = 0;
+			  num_staged < MAX_STAGED_PULLS &&
+			  *num_moved_ptr + num_staged < max_moves &&
+			  scanned < num_slots;
+			  scanned++ )
+		{
+			struct ipa_nat_rule* head_rule;
+			uint16_t             index;
 
-	index = table_rule->indx_tbl_entry;
+			index = nat_table->compact_cursor;
 
-	index_table_rule = (struct ipa_nat_indx_tbl_rule*)
-		ipa_table_get_entry_by_index(&nat_table->index_table, index);
+			nat_table->compact_cursor =
+				( index + 1 < table->table_entries ) ? index + 1 : 1;
 
-	if (index_table_rule == NULL) {
-		IPAERR("Unable to retrieve the entry in index %u "
-			   "in NAT index table with handle=0x%08X\n",
-			   index, tbl_hdl);
-		ret = -EPERM;
-		goto unlock;
-	}
+			/*
+			 * Step 1 leaves a staged head looking like one still to
+			 * be pulled, so it mustn't be staged twice...
+			 */
+			for ( i = 0; i < num_staged && staged[i].head_index != index; i++ );
 
-	ret = ipa_table_iterator_init(
-		&index_table_iterator,
-		&nat_table->index_table,
-		index_table_rule,
-		index);
+			if ( i < num_staged )
+			{
+				continue;
+			}
 
-	if (ret) {
-		IPAERR("Unable to create iterator which points to the "
-			   "entry %u in NAT index table with handle=0x%08X\n",
-			   index, tbl_hdl);
-		goto unlock;
-	}
+			head_rule = (struct ipa_nat_rule*) GOTO_REC(table, index);
 
-	ipa_table_create_delete_command(
-		&nat_table->index_table,
-		cmd,
-		&index_table_iterator);
+			if ( ! head_rule->enable
+				 ||
+				 head_rule->protocol != IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE
+				 ||
+				 ! VALID_INDEX(head_rule->next_index) )
+			{
+				continue;
+			}
 
-	if (ipa_table_iterator_is_head_with_tail(&index_table_iterator)) {
+			staged[num_staged].head_index = index;
+
+			if ( ipa_nati_stage_ipv4_pull(nat_table, cmd, &staged[num_staged]) == 0 )
+			{
+				num_staged++;
+			}
+		}
+
+		if ( num_staged == 0 )
+		{
+			continue;
+		}
 
-		ipa_nati_copy_second_index_entry_to_head(
-			nat_table, &index_table_iterator, cmd);
 		/*
-		 * Iterate to the next entry which should be deleted
+		 * Should the command not go, the staged heads were only
+		 * written in step 1, hence remain deleted list heads...
 		 */
-		ret = ipa_table_iterator_next(
-			&index_table_iterator, &nat_table->index_table);
+		ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
 
-		if (ret) {
-			IPAERR("Unable to move the iterator to the next entry "
-				   "(points to the entry %u in NAT index table)\n",
-				   index);
+		if ( ret )
+		{
+			IPAERR("Unable to post dma command for %u pulls\n", num_staged);
 			goto unlock;
 		}
-	}
-
-	ipa_table_create_delete_command(
-		&nat_table->table,
-		cmd,
-		&table_iterator);
 
-	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+		for ( i = 0; i < num_staged; i++ )
+		{
+			ipa_nati_finish_ipv4_pull(nat_table, &staged[i]);
 
-	if (ret) {
-		IPAERR("Unable to post dma command\n");
-		goto unlock;
-	}
+			old_rule_hdls[*num_moved_ptr] =
+				ipa_table_get_entry_hdl(table, staged[i].second_index);
 
-	if (! ipa_table_iterator_is_head_with_tail(&table_iterator)) {
-		/* The entry can be deleted */
-		uint8_t is_prev_empty =
-			(table_iterator.prev_entry != NULL &&
-			 ((struct ipa_nat_rule*)table_iterator.prev_entry)->protocol ==
-			 IPAHAL_NAT_INVALID_PROTOCOL);
+			new_rule_hdls[*num_moved_ptr] =
+				ipa_table_get_entry_hdl(table, staged[i].head_index);
 
-		ipa_table_delete_entry(
-			&nat_table->table, &table_iterator, is_prev_empty);
+			(*num_moved_ptr)++;
+		}
 	}
 
-	ipa_table_delete_entry(
-		&nat_table->index_table,
-		&index_table_iterator,
-		FALSE);
-
-	if (index_table_iterator.curr_index >= nat_table->index_table.table_entries)
-		nat_table->index_expn_table_meta[
-			index_table_iterator.curr_index - nat_table->index_table.table_entries].
-			prev_index = IPA_TABLE_INVALID_ENTRY;
+	IPADBG("%u rules pulled into base table of tbl_hdl(0x%08X)\n",
+		   *num_moved_ptr, tbl_hdl);
 
 unlock:
 	if (pthread_mutex_unlock(&nat_mutex)) {
@@ -2039,7 +4090,7 @@ int ipa_nati_get_sram_size(
 
 	memset(&nat_sram_info, 0, sizeof(nat_sram_info));
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd,
+	ret = ipa_nat_be_ioctl(nat_cache_ptr->ipa_desc->fd,
 				IPA_IOC_GET_NAT_IN_SRAM_INFO,
 				&nat_sram_info);
 
@@ -2255,6 +4306,8 @@ int ipa_NATI_clear_ipv4_tbl(
 	nat_table->index_table.cur_tbl_cnt =
 		nat_table->index_table.cur_expn_tbl_cnt = 0;
 
+	ipa_nati_tuple_index_reset(nat_table);
+
 unlock:
 	if (pthread_mutex_unlock(&nat_mutex)) {
 		IPAERR("unable to unlock the nat mutex\n");
@@ -2272,45 +4325,317 @@ int ipa_nati_copy_ipv4_tbl(
 	uint32_t          dst_tbl_hdl,
 	ipa_table_walk_cb copy_cb )
 {
+	enum ipa3_nat_mem_in  nmi;
+	uint32_t              broken_tbl_hdl;
+	struct ipa_nat_cache* dst_cache_ptr;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! copy_cb )
+	{
+		IPAERR("copy_cb is null\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	BREAK_TBL_HDL(dst_tbl_hdl, nmi, broken_tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) )
+	{
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	dst_cache_ptr = &ipv4_nat_cache[nmi];
+
+	UNUSED(broken_tbl_hdl);
+
+	if (pthread_mutex_lock(&nat_mutex))
+	{
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( dst_cache_ptr == active_nat_cache_ptr )
+	{
+		IPAERR("Destination %s table is in use by the IPA\n",
+			   ipa3_nat_mem_in_as_str(nmi));
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * The IPA is not using the destination yet, so the table is built
+	 * entirely in memory: the dma commands generated by each add are
+	 * applied by software rather than posted one ioctl at a time.  The
+	 * caller makes it visible with a single focus change afterwards.
+	 */
+	dst_cache_ptr->offline = true;
+
+	/*
+	 * Clear the destination table...
+	 */
+	ret = ipa_NATI_clear_ipv4_tbl(dst_tbl_hdl);
+
+	if ( ret == 0 )
+	{
+		uintptr_t dth = dst_tbl_hdl;
+		/*
+		 * Now walk the source table and pass the valid records to the
+		 * user's copy callback...
+		 */
+		ret = ipa_NATI_walk_ipv4_tbl(
+			src_tbl_hdl, USE_NAT_TABLE, copy_cb, (void*) dth);
+
+		if ( ret != 0 )
+		{
+			IPAERR("ipa_table_walk returned non-zero (%d)\n", ret);
+		}
+	}
+
+	dst_cache_ptr->offline = false;
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex))
+	{
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Gives a table, built elsewhere, its IPA memory and copies the image
+ * in...
+ */
+static int ipa_nati_load_table_image(
+	struct ipa_nat_cache*           nat_cache_ptr,
+	struct ipa_nat_ip4_table_cache* nat_table,
+	uint8_t                         table_index,
+	const void*                     image)
+{
+	int ret;
+
+	ret = ipa_nati_alloc_table_mem(nat_cache_ptr, nat_table, table_index);
+
+	if (ret == 0) {
+		memcpy(nat_table->table.table_addr, image, ipa_nati_table_size(nat_table));
+	}
+
+	return ret;
+}
+
+/**
+ * ipa_nati_grow_ipv4_tbl() - Grows a live IPv4 NAT table
+ * @tbl_hdl: [in] the table to grow
+ * @number_of_entries: [in] number of NAT entries the table should have
+ * @copy_cb: [in] called with each of the table's rules
+ * @arb_data_ptr: [in] passed, untouched, to copy_cb
+ *
+ * The larger table is built in ordinary memory while the IPA carries
+ * on with the current one.  For the duration of the walk, tbl_hdl
+ * names the larger table, so copy_cb need only add the rule it's
+ * handed back to tbl_hdl, where it's hashed into its bucket of the
+ * larger table.
+ *
+ * The IPA is only given one table of each memory type, hence the
+ * current one's memory is released before the larger table's is
+ * allocated, filled with the finished image, and handed to the IPA.
+ * Should that allocation fail, the current table is put back as it
+ * was.  Should that fail too, the table is lost: tbl_hdl no longer
+ * names a table, and -ENODEV is returned.
+ *
+ * Handles of the current table's rules are meaningless afterwards;
+ * copy_cb is expected to note what replaced them.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nati_grow_ipv4_tbl(
+	uint32_t          tbl_hdl,
+	uint16_t          number_of_entries,
+	ipa_table_walk_cb copy_cb,
+	void*             arb_data_ptr )
+{
+	enum ipa3_nat_mem_in            nmi;
+	uint32_t                        broken_tbl_hdl;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+	struct ipa_nat_ip4_table_cache  old_table;
+	void*                           old_image = NULL;
+	int                             size;
+
 	int ret = 0;
 
 	IPADBG("In\n");
 
-	if ( ! copy_cb )
+	if ( ! VALID_TBL_HDL(tbl_hdl) || ! copy_cb )
+	{
+		IPAERR("Bad arg: tbl_hdl(0x%08X) and/or copy_cb(%p)\n",
+			   tbl_hdl, copy_cb);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, broken_tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) )
+	{
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[broken_tbl_hdl - 1];
+
+	if (pthread_mutex_lock(&nat_mutex))
+	{
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( ! nat_table->mem_desc.valid )
+	{
+		IPAERR("invalid table handle 0x%08X\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	old_table = *nat_table;
+
+	memset(nat_table, 0, sizeof(*nat_table));
+
+	ret = ipa_nati_create_table(
+		nat_cache_ptr,
+		nat_table,
+		old_table.public_addr,
+		number_of_entries,
+		broken_tbl_hdl - 1,
+		true);
+
+	if ( ret == 0 && nat_table->table.tot_tbl_ents <= old_table.table.tot_tbl_ents )
+	{
+		IPAERR("%u entries would not grow a table of %u\n",
+			   nat_table->table.tot_tbl_ents,
+			   old_table.table.tot_tbl_ents);
+		ipa_nati_free_table_info(nat_table);
+		ret = -EINVAL;
+	}
+
+	if ( ret != 0 )
+	{
+		*nat_table = old_table;
+		goto unlock;
+	}
+
+	IPADBG("Growing %s table from %u to %u entries\n",
+		   ipa3_nat_mem_in_as_str(nmi),
+		   old_table.table.tot_tbl_ents,
+		   nat_table->table.tot_tbl_ents);
+
+	/*
+	 * Re-hash the rules into the larger table.  Its dma commands are
+	 * applied by software, since the IPA hasn't seen it yet...
+	 */
+	nat_cache_ptr->offline = true;
+
+	ret = ipa_table_walk(&old_table.table, 0, WHEN_SLOT_FILLED, copy_cb, arb_data_ptr);
+
+	nat_cache_ptr->offline = false;
+
+	if ( ret == 0 )
+	{
+		size = ipa_nati_table_size(&old_table);
+
+		old_image = malloc(size);
+
+		if ( old_image )
+		{
+			memcpy(old_image, old_table.table.table_addr, size);
+		}
+		else
+		{
+			IPAERR("Unable to allocate copy of table of size %d\n", size);
+			ret = -ENOMEM;
+		}
+	}
+	else
+	{
+		IPAERR("ipa_table_walk returned non-zero (%d)\n", ret);
+	}
+
+	if ( ret == 0 )
 	{
-		IPAERR("copy_cb is null\n");
-		ret = -EINVAL;
-		goto bail;
+		ret = ipa_mem_descriptor_delete(
+			&old_table.mem_desc, nat_cache_ptr->ipa_desc->fd);
 	}
 
-	if (pthread_mutex_lock(&nat_mutex))
+	if ( ret != 0 )
 	{
-		IPAERR("unable to lock the nat mutex\n");
-		ret = -EINVAL;
-		goto bail;
+		ipa_nati_free_table_info(nat_table);
+		*nat_table = old_table;
+		goto unlock;
 	}
 
 	/*
-	 * Clear the destination table...
+	 * From here until the init command below, the IPA has no table
+	 * and lookups go to software...
 	 */
-	ret = ipa_NATI_clear_ipv4_tbl(dst_tbl_hdl);
+	ret = ipa_nati_load_table_image(
+		nat_cache_ptr, nat_table, broken_tbl_hdl - 1, nat_table->staged_image);
 
-	if ( ret == 0 )
+	if ( ret != 0 )
 	{
-		uintptr_t dth = dst_tbl_hdl;
-		/*
-		 * Now walk the source table and pass the valid records to the
-		 * user's copy callback...
-		 */
-		ret = ipa_NATI_walk_ipv4_tbl(
-			src_tbl_hdl, USE_NAT_TABLE, copy_cb, (void*) dth);
+		IPAERR("Unable to allocate grown table, putting old one back\n");
 
-		if ( ret != 0 )
+		ipa_nati_free_table_info(nat_table);
+		*nat_table = old_table;
+
+		if ( ipa_nati_load_table_image(
+				 nat_cache_ptr, nat_table, broken_tbl_hdl - 1, old_image) != 0 )
 		{
-			IPAERR("ipa_table_walk returned non-zero (%d)\n", ret);
+			/*
+			 * The table is gone.  Forget it, as a delete would, so
+			 * that nothing finds it through tbl_hdl...
+			 */
+			IPAERR("Unable to put old table back, table 0x%08X lost\n", tbl_hdl);
+			ipa_nati_free_table_info(nat_table);
+			memset(nat_table, 0, sizeof(*nat_table));
+
+			if ( ! --nat_cache_ptr->table_cnt )
+			{
+				ipa_descriptor_close(nat_cache_ptr->ipa_desc);
+				nat_cache_ptr->ipa_desc = NULL;
+			}
+
+			ret = -ENODEV;
 			goto unlock;
 		}
 	}
+	else
+	{
+		free(nat_table->staged_image);
+		nat_table->staged_image = NULL;
+
+		ipa_nati_free_table_info(&old_table);
+	}
+
+	if ( ipa_nati_post_ipv4_init_cmd(
+			 nat_cache_ptr, nat_table, broken_tbl_hdl - 1, false) != 0 )
+	{
+		IPAERR("unable to post nat_init command\n");
+		ret = (ret) ? ret : -EIO;
+	}
 
 unlock:
 	if (pthread_mutex_unlock(&nat_mutex))
@@ -2319,6 +4644,8 @@ unlock:
 		ret = (ret) ? ret : -EPERM;
 	}
 
+	free(old_image);
+
 bail:
 	IPADBG("Out\n");
 
@@ -2336,11 +4663,15 @@ int ipa_NATI_walk_ipv4_tbl(
 	struct ipa_nat_cache*           nat_cache_ptr;
 	struct ipa_nat_ip4_table_cache* nat_table;
 	ipa_table*                      ipa_tbl_ptr;
+	ipa_table                       snap;
+	uint32_t                        seq;
 
 	int ret = 0;
 
 	IPADBG("In\n");
 
+	memset(&snap, 0, sizeof(snap));
+
 	if ( ! VALID_TBL_HDL(tbl_hdl) ||
 		 ! VALID_WHICHTBL2USE(which) ||
 		 ! walk_cb )
@@ -2351,17 +4682,8 @@ int ipa_NATI_walk_ipv4_tbl(
 		goto bail;
 	}
 
-	if ( pthread_mutex_lock(&nat_mutex) )
-	{
-		IPAERR("unable to lock the nat mutex\n");
-		ret = -EINVAL;
-		goto bail;
-	}
+	ipa_nati_read_lock();
 
-	/*
-	 * Now walk the table and pass the valid records to the user's
-	 * walk callback...
-	 */
 	BREAK_TBL_HDL(tbl_hdl, nmi, broken_tbl_hdl);
 
 	if ( ! IPA_VALID_NAT_MEM_IN(nmi) )
@@ -2387,123 +4709,91 @@ int ipa_NATI_walk_ipv4_tbl(
 		&nat_table->table     :
 		&nat_table->index_table;
 
-	ret = ipa_table_walk(ipa_tbl_ptr, 0, WHEN_SLOT_FILLED, walk_cb, arb_data_ptr);
+	/*
+	 * The user's callback can neither be rerun nor be allowed to hold
+	 * up rule insertion, so it's handed a coherent private copy of
+	 * the table rather than the table itself...
+	 */
+	ret = ipa_table_snapshot_alloc(ipa_tbl_ptr, &snap);
 
 	if ( ret != 0 )
 	{
-		IPAERR("ipa_table_walk returned non-zero (%d)\n", ret);
 		goto unlock;
 	}
 
-unlock:
-	if ( pthread_mutex_unlock(&nat_mutex) )
+	do
 	{
-		IPAERR("unable to unlock the nat mutex\n");
-		ret = (ret) ? ret : -EPERM;
-	}
-
-bail:
-	IPADBG("Out\n");
-
-	return ret;
-}
-
-typedef struct
-{
-	WhichTbl2Use        which;
-	uint32_t            tot_for_avg;
-	ipa_nati_tbl_stats* stats_ptr;
-} chain_stat_help;
-
-static int gen_chain_stats(
-	ipa_table*      table_ptr,
-	uint32_t        rule_hdl,
-	void*           record_ptr,
-	uint16_t        record_index,
-	void*           meta_record_ptr,
-	uint16_t        meta_record_index,
-	void*           arb_data_ptr )
-{
-	chain_stat_help* csh_ptr = (chain_stat_help*) arb_data_ptr;
-
-	enum ipa3_nat_mem_in nmi;
-	uint8_t              is_expn_tbl;
-	uint16_t             rule_index;
+		seq = ipa_nati_read_begin();
 
-	uint32_t             chain_len = 0;
+		ipa_table_snapshot_take(ipa_tbl_ptr, &snap);
 
-	UNUSED(record_index);
-	UNUSED(meta_record_ptr);
-	UNUSED(meta_record_index);
+	} while ( ipa_nati_read_retry(seq) );
 
-	BREAK_RULE_HDL(table_ptr, rule_hdl, nmi, is_expn_tbl, rule_index);
+unlock:
+	ipa_nati_read_unlock();
 
-	if ( is_expn_tbl )
+	if ( ret != 0 )
 	{
-		nmi++; /* stop compiler usage warning */
-		return 1;
+		goto bail;
 	}
 
-	if ( csh_ptr->which == USE_NAT_TABLE )
-	{
-		struct ipa_nat_rule* list_elem_ptr =
-			(struct ipa_nat_rule*) record_ptr;
+	/*
+	 * Now walk the copy and pass the valid records to the user's
+	 * walk callback...
+	 */
+	ret = ipa_table_walk(&snap, 0, WHEN_SLOT_FILLED, walk_cb, arb_data_ptr);
 
-		if ( list_elem_ptr->next_index )
-		{
-			chain_len = 1;
+	if ( ret != 0 )
+	{
+		IPAERR("ipa_table_walk returned non-zero (%d)\n", ret);
+		goto bail;
+	}
 
-			while ( list_elem_ptr->next_index )
-			{
-				chain_len++;
+bail:
+	ipa_table_snapshot_free(&snap);
 
-				list_elem_ptr = (struct ipa_nat_rule*)
-					GOTO_REC(table_ptr, list_elem_ptr->next_index);
-			}
-		}
-	}
-	else
-	{
-		struct ipa_nat_indx_tbl_rule* list_elem_ptr =
-			(struct ipa_nat_indx_tbl_rule*) record_ptr;
+	IPADBG("Out\n");
 
-		if ( list_elem_ptr->next_index )
-		{
-			chain_len = 1;
+	return ret;
+}
 
-			while ( list_elem_ptr->next_index )
-			{
-				chain_len++;
+/*
+ * Fills one table's stats from the counters the table keeps (see
+ * ipa_table_create_bucket_info()).  The caller makes sure they
+ * aren't changing underneath...
+ */
+static void gen_tbl_stats(
+	ipa_table*           table_ptr,
+	enum ipa3_nat_mem_in nmi,
+	ipa_nati_tbl_stats*  stats_ptr )
+{
+	memset(stats_ptr, 0, sizeof(ipa_nati_tbl_stats));
 
-				list_elem_ptr = (struct ipa_nat_indx_tbl_rule*)
-					GOTO_REC(table_ptr, list_elem_ptr->next_index);
-			}
-		}
-	}
+	stats_ptr->nmi                  = nmi;
 
-	if ( chain_len )
-	{
-		csh_ptr->stats_ptr->tot_chains += 1;
+	stats_ptr->tot_base_ents        = table_ptr->table_entries;
+	stats_ptr->tot_expn_ents        = table_ptr->expn_table_entries;
+	stats_ptr->tot_ents             =
+		stats_ptr->tot_base_ents + stats_ptr->tot_expn_ents;
 
-		csh_ptr->tot_for_avg += chain_len;
+	stats_ptr->tot_base_ents_filled = table_ptr->cur_tbl_cnt;
+	stats_ptr->tot_expn_ents_filled = table_ptr->cur_expn_tbl_cnt;
 
-		if ( csh_ptr->stats_ptr->min_chain_len == 0 )
-		{
-			csh_ptr->stats_ptr->min_chain_len = chain_len;
-		}
-		else
-		{
-			csh_ptr->stats_ptr->min_chain_len =
-				min(csh_ptr->stats_ptr->min_chain_len, chain_len);
-		}
+	stats_ptr->tot_chains           = table_ptr->tot_chains;
+	stats_ptr->min_chain_len        = table_ptr->min_chain_len;
+	stats_ptr->max_chain_len        = table_ptr->max_chain_len;
 
-		csh_ptr->stats_ptr->max_chain_len =
-			max(csh_ptr->stats_ptr->max_chain_len, chain_len);
+	if ( table_ptr->tot_chains )
+	{
+		stats_ptr->avg_chain_len =
+			(float) table_ptr->tot_chain_ents / (float) table_ptr->tot_chains;
 	}
-
-	return 0;
 }
 
+/*
+ * Nothing is walked here.  The tables count as they go, so this is
+ * cheap enough to poll...
+ */
 int ipa_NATI_ipv4_tbl_stats(
 	uint32_t            tbl_hdl,
 	ipa_nati_tbl_stats* nat_stats_ptr,
@@ -2513,9 +4803,7 @@ int ipa_NATI_ipv4_tbl_stats(
 	uint32_t                        broken_tbl_hdl;
 	struct ipa_nat_cache*           nat_cache_ptr;
 	struct ipa_nat_ip4_table_cache* nat_table;
-	ipa_table*                      ipa_tbl_ptr;
-
-	chain_stat_help                 csh;
+	uint32_t                        seq;
 
 	int ret = 0;
 
@@ -2536,15 +4824,7 @@ int ipa_NATI_ipv4_tbl_stats(
 		goto bail;
 	}
 
-	if ( pthread_mutex_lock(&nat_mutex) )
-	{
-		IPAERR("unable to lock the nat mutex\n");
-		ret = -EINVAL;
-		goto bail;
-	}
-
-	memset(nat_stats_ptr, 0, sizeof(ipa_nati_tbl_stats));
-	memset(idx_stats_ptr, 0, sizeof(ipa_nati_tbl_stats));
+	ipa_nati_read_lock();
 
 	BREAK_TBL_HDL(tbl_hdl, nmi, broken_tbl_hdl);
 
@@ -2566,84 +4846,229 @@ int ipa_NATI_ipv4_tbl_stats(
 
 	nat_table = &nat_cache_ptr->ip4_tbl[broken_tbl_hdl - 1];
 
-	/*
-	 * Gather NAT table stats...
-	 */
-	ipa_tbl_ptr = &nat_table->table;
+	do
+	{
+		seq = ipa_nati_read_begin();
 
-	nat_stats_ptr->nmi                  = nmi;
+		gen_tbl_stats(&nat_table->table,       nmi, nat_stats_ptr);
+		gen_tbl_stats(&nat_table->index_table, nmi, idx_stats_ptr);
 
-	nat_stats_ptr->tot_base_ents        = ipa_tbl_ptr->table_entries;
-	nat_stats_ptr->tot_expn_ents        = ipa_tbl_ptr->expn_table_entries;
-	nat_stats_ptr->tot_ents             =
-		nat_stats_ptr->tot_base_ents + nat_stats_ptr->tot_expn_ents;
+	} while ( ipa_nati_read_retry(seq) );
+
+unlock:
+	ipa_nati_read_unlock();
+
+bail:
+	IPADBG("Out\n");
 
-	nat_stats_ptr->tot_base_ents_filled = ipa_tbl_ptr->cur_tbl_cnt;
-	nat_stats_ptr->tot_expn_ents_filled = ipa_tbl_ptr->cur_expn_tbl_cnt;
+	return ret;
+}
 
-	memset(&csh, 0, sizeof(chain_stat_help));
+/*
+ * CLOCK VOTE LEASE
+ *
+ * Every IPA_IOC_APP_CLOCK_VOTE the library (and its users, via
+ * ipa_nat_vote_clock()) asks for goes through here.  The kernel is
+ * voted on by the first holder only, and the holders that overlap it
+ * share that vote.  When the last one lets go, the vote is kept for
+ * the linger period, so that the next operation of a burst finds the
+ * clock still on, and is only then voted off, by a helper thread.
+ * With no linger, it is voted off at once, as it always was.
+ *
+ * The lease has its own descriptor, since the tables' come and go
+ * with the tables, and a vote belongs to the descriptor it was cast
+ * on.  It is opened on the first vote and kept for as long as the
+ * process lives, so that a vote or devote costs just the ioctl.
+ */
+static struct
+{
+	pthread_mutex_t     mutex;
+	pthread_cond_t      cond;
+	bool                cond_inited;
+	bool                thread_started;
+	ipa_descriptor*     ipa_desc;
+	uint32_t            holders;
+	bool                voted;
+	uint32_t            linger_ms;
+	uint64_t            release_at;  /* in nanoseconds */
+	ipa_nat_vote_stats  stats;
+} vote_lease = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static int vote_lease_ioctl(
+	enum ipa_app_clock_vote_type vote_type )
+{
+	int ret;
 
-	csh.which     = USE_NAT_TABLE;
-	csh.stats_ptr = nat_stats_ptr;
+	if ( ! vote_lease.ipa_desc ) {
+		vote_lease.ipa_desc = ipa_descriptor_open();
+		if ( vote_lease.ipa_desc == NULL ) {
+			IPAERR("failed to open IPA driver file descriptor\n");
+			return -EIO;
+		}
+	}
 
-	ret = ipa_table_walk(
-		ipa_tbl_ptr, 0, WHEN_SLOT_FILLED, gen_chain_stats, &csh);
+	ret = ipa_nat_be_ioctl(vote_lease.ipa_desc->fd,
+				IPA_IOC_APP_CLOCK_VOTE,
+				(void*) (uintptr_t) vote_type);
 
-	if ( ret < 0 )
-	{
-		IPAERR("Error gathering chain stats\n");
-		ret = -EINVAL;
-		goto unlock;
+	if (ret) {
+		IPAERR("APP_CLOCK_VOTE ioctl failure %d on IPA fd %d\n",
+			   ret, vote_lease.ipa_desc->fd);
+		return ret;
 	}
 
-	if ( csh.tot_for_avg && nat_stats_ptr->tot_chains )
+	vote_lease.stats.ioctls++;
+
+	vote_lease.voted = (vote_type == IPA_APP_CLK_VOTE);
+
+	return 0;
+}
+
+/*
+ * Votes the clock off once a lingering vote's time is up.  Lives for
+ * as long as the process does.
+ */
+static void* vote_lease_thread(
+	void* arg )
+{
+	struct timespec ts;
+	uint64_t        now;
+
+	UNUSED(arg);
+
+	pthread_mutex_lock(&vote_lease.mutex);
+
+	while ( 1 )
 	{
-		nat_stats_ptr->avg_chain_len =
-			(float) csh.tot_for_avg / (float) nat_stats_ptr->tot_chains;
+		if ( ! vote_lease.voted || vote_lease.holders ) {
+			pthread_cond_wait(&vote_lease.cond, &vote_lease.mutex);
+			continue;
+		}
+
+		currTimeAs(TimeAsNanSecs, &now);
+
+		if ( now >= vote_lease.release_at ) {
+			IPADBG("Clock vote lease expired\n");
+			if ( vote_lease_ioctl(IPA_APP_CLK_DEVOTE) == 0 ) {
+				vote_lease.stats.expiries++;
+			} else {
+				/*
+				 * Retrying at once would spin, holding the mutex
+				 * every voter needs.  Give up on the vote instead,
+				 * as when the kernel's votes are reset...
+				 */
+				IPAERR("Dropping clock vote lease\n");
+				vote_lease.voted = false;
+			}
+			continue;
+		}
+
+		ts.tv_sec  = vote_lease.release_at / 1000000000ULL;
+		ts.tv_nsec = vote_lease.release_at % 1000000000ULL;
+
+		pthread_cond_timedwait(&vote_lease.cond, &vote_lease.mutex, &ts);
 	}
 
-	/*
-	 * Now lets gather index table stats...
-	 */
-	ipa_tbl_ptr = &nat_table->index_table;
+	return NULL;
+}
+
+/*
+ * With the lease mutex held...
+ */
+static int vote_lease_start_thread(void)
+{
+	pthread_condattr_t attr;
+	pthread_t          thread;
+	int                ret;
+
+	if ( vote_lease.thread_started ) {
+		return 0;
+	}
 
-	idx_stats_ptr->nmi                  = nmi;
+	if ( ! vote_lease.cond_inited ) {
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		ret = pthread_cond_init(&vote_lease.cond, &attr);
+		pthread_condattr_destroy(&attr);
+		if ( ret ) {
+			IPAERR("unable to init vote lease condition %d\n", ret);
+			return -ret;
+		}
+		vote_lease.cond_inited = true;
+	}
 
-	idx_stats_ptr->tot_base_ents        = ipa_tbl_ptr->table_entries;
-	idx_stats_ptr->tot_expn_ents        = ipa_tbl_ptr->expn_table_entries;
-	idx_stats_ptr->tot_ents             =
-		idx_stats_ptr->tot_base_ents + idx_stats_ptr->tot_expn_ents;
+	ret = pthread_create(&thread, NULL, vote_lease_thread, NULL);
+	if ( ret ) {
+		IPAERR("unable to start vote lease thread %d\n", ret);
+		return -ret;
+	}
 
-	idx_stats_ptr->tot_base_ents_filled = ipa_tbl_ptr->cur_tbl_cnt;
-	idx_stats_ptr->tot_expn_ents_filled = ipa_tbl_ptr->cur_expn_tbl_cnt;
+	pthread_detach(thread);
 
-	memset(&csh, 0, sizeof(chain_stat_help));
+	vote_lease.thread_started = true;
 
-	csh.which     = USE_INDEX_TABLE;
-	csh.stats_ptr = idx_stats_ptr;
+	return 0;
+}
 
-	ret = ipa_table_walk(
-		ipa_tbl_ptr, 0, WHEN_SLOT_FILLED, gen_chain_stats, &csh);
+int ipa_nati_vote_clock(
+    enum ipa_app_clock_vote_type vote_type )
+{
+	uint64_t now;
 
-	if ( ret < 0 )
-	{
-		IPAERR("Error gathering chain stats\n");
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if (pthread_mutex_lock(&vote_lease.mutex)) {
+		IPAERR("unable to lock the vote lease mutex\n");
 		ret = -EINVAL;
-		goto unlock;
+		goto bail;
 	}
 
-	if ( csh.tot_for_avg && idx_stats_ptr->tot_chains )
+	switch ( vote_type )
 	{
-		idx_stats_ptr->avg_chain_len =
-			(float) csh.tot_for_avg / (float) idx_stats_ptr->tot_chains;
-	}
+	case IPA_APP_CLK_VOTE:
+		vote_lease.stats.votes++;
+		if ( vote_lease.voted ) {
+			vote_lease.stats.votes_avoided++;
+		} else if ( (ret = vote_lease_ioctl(IPA_APP_CLK_VOTE)) != 0 ) {
+			break;
+		}
+		vote_lease.holders++;
+		break;
 
-	ret = 0;
+	case IPA_APP_CLK_DEVOTE:
+		if ( vote_lease.holders == 0 ) {
+			IPAERR("Devote without a vote\n");
+			ret = -EINVAL;
+			break;
+		}
+		vote_lease.stats.devotes++;
+		if ( --vote_lease.holders ) {
+			break;
+		}
+		if ( vote_lease.linger_ms && vote_lease_start_thread() == 0 ) {
+			currTimeAs(TimeAsNanSecs, &now);
+			vote_lease.release_at =
+				now + (uint64_t) vote_lease.linger_ms * 1000000ULL;
+			pthread_cond_signal(&vote_lease.cond);
+			break;
+		}
+		ret = vote_lease_ioctl(IPA_APP_CLK_DEVOTE);
+		break;
 
-unlock:
-	if ( pthread_mutex_unlock(&nat_mutex) )
-	{
-		IPAERR("unable to unlock the nat mutex\n");
+	default:
+		/*
+		 * Whatever the kernel had is gone, hence so is the lease
+		 */
+		ret = vote_lease_ioctl(vote_type);
+		vote_lease.holders = 0;
+		vote_lease.voted   = false;
+		break;
+	}
+
+	if (pthread_mutex_unlock(&vote_lease.mutex)) {
+		IPAERR("unable to unlock the vote lease mutex\n");
 		ret = (ret) ? ret : -EPERM;
 	}
 
@@ -2653,35 +5078,65 @@ bail:
 	return ret;
 }
 
-int ipa_nati_vote_clock(
-    enum ipa_app_clock_vote_type vote_type )
+int ipa_nati_set_vote_linger(
+	uint32_t linger_ms )
 {
-	struct ipa_nat_cache* nat_cache_ptr =
-		&ipv4_nat_cache[IPA_NAT_MEM_IN_SRAM];
-
 	int ret = 0;
 
 	IPADBG("In\n");
 
-	if ( ! nat_cache_ptr->ipa_desc ) {
-		nat_cache_ptr->ipa_desc = ipa_descriptor_open();
-		if ( nat_cache_ptr->ipa_desc == NULL ) {
-			IPAERR("failed to open IPA driver file descriptor\n");
-			ret = -EIO;
-			goto bail;
-		}
+	if (pthread_mutex_lock(&vote_lease.mutex)) {
+		IPAERR("unable to lock the vote lease mutex\n");
+		ret = -EINVAL;
+		goto bail;
 	}
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd,
-				IPA_IOC_APP_CLOCK_VOTE,
-				vote_type);
+	IPADBG("linger_ms(%u)\n", linger_ms);
 
-	if (ret) {
-		IPAERR("APP_CLOCK_VOTE ioctl failure %d on IPA fd %d\n",
-			   ret, nat_cache_ptr->ipa_desc->fd);
+	vote_lease.linger_ms = linger_ms;
+
+	/*
+	 * A vote lingering on under the old period is let go of now
+	 */
+	if ( vote_lease.voted && ! vote_lease.holders ) {
+		ret = vote_lease_ioctl(IPA_APP_CLK_DEVOTE);
+	}
+
+	if (pthread_mutex_unlock(&vote_lease.mutex)) {
+		IPAERR("unable to unlock the vote lease mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_get_vote_stats(
+	ipa_nat_vote_stats* stats_ptr )
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if (pthread_mutex_lock(&vote_lease.mutex)) {
+		IPAERR("unable to lock the vote lease mutex\n");
+		ret = -EINVAL;
 		goto bail;
 	}
 
+	*stats_ptr = vote_lease.stats;
+
+	stats_ptr->holders   = vote_lease.holders;
+	stats_ptr->voted     = vote_lease.voted;
+	stats_ptr->linger_ms = vote_lease.linger_ms;
+
+	if (pthread_mutex_unlock(&vote_lease.mutex)) {
+		IPAERR("unable to unlock the vote lease mutex\n");
+		ret = -EPERM;
+	}
+
 bail:
 	IPADBG("Out\n");
 
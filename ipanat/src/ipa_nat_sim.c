@@ -0,0 +1,721 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ipa_nat_backend.h"
+#include "ipa_nat_utils.h"
+#include "ipa_table.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#ifdef FEATURE_IPA_NAT_SIM
+
+/*
+ * An in-process stand in for the IPA kernel driver.
+ *
+ * Each table (one NAT and one IPv6CT table per memory type) is
+ * backed by heap memory that is handed out by mmap.  The init
+ * commands tell us where the sub-tables start, and the dma commands
+ * are applied to that memory exactly as the hardware would, hence
+ * the library sees the very same table contents it would on target.
+ *
+ * Like the real driver, a table whose size fits in the SRAM we report
+ * is placed in SRAM, and only one table can be there at once.  While
+ * one is, no SRAM is reported as available, so that the library
+ * doesn't expect the next table to land there too.
+ */
+#define SIM_FD_IPA    0x5100
+#define SIM_FD_NAT    0x5101
+#define SIM_FD_IPV6CT 0x5102
+
+/*
+ * The "physical" offset handed back at allocation time, and where,
+ * within its mmap, an SRAM based table starts.  Neither is zero, so
+ * that a library bug that ignores them shows up here too.
+ */
+#define SIM_TBL_OFFSET       0x100
+#define SIM_SRAM_MMAP_OFFSET 0x40
+
+/*
+ * The IPv6CT init command doesn't name a memory type, so an SRAM
+ * based IPv6CT table is told apart by the offset handed back for it.
+ */
+#define SIM_SRAM_TBL_OFFSET  0x8100
+
+#define SIM_PAGE_SIZE 4096
+
+#define SIM_MAX_SUB_TBLS 4
+
+typedef struct
+{
+	bool     allocated;
+	uint32_t offset;
+	uint32_t size;
+	uint8_t* mem;
+	size_t   mem_len;
+	uint32_t mmap_offset;
+	bool     inited;
+	uint8_t  tbl_index;
+	uint32_t sub_offset[SIM_MAX_SUB_TBLS];
+} sim_table;
+
+static pthread_mutex_t   sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static sim_table         sim_nat[IPA_NAT_MEM_IN_MAX];
+static sim_table         sim_ipv6ct[IPA_NAT_MEM_IN_MAX];
+static sim_table*        sim_nat_pending    = NULL;
+static sim_table*        sim_ipv6ct_pending = NULL;
+static sim_table*        sim_ipv6ct_focus   = NULL;
+
+static uint32_t          sim_sram_size = IPA_NAT_SIM_DEFAULT_SRAM_SIZE;
+static int               sim_votes     = 0;
+
+static ipa_nat_sim_stats sim_stats;
+
+#undef  SIM_ERR
+#define SIM_ERR(e) \
+	do { errno = (e); ret = -1; goto bail; } while ( 0 )
+
+static bool sim_sram_in_use(void)
+{
+	return
+		sim_nat[IPA_NAT_MEM_IN_SRAM].allocated ||
+		sim_ipv6ct[IPA_NAT_MEM_IN_SRAM].allocated;
+}
+
+/*
+ * The library names the memory type in its commands, but a small
+ * table it thinks of as DDR may well have been placed in SRAM, so
+ * fall back to whichever table of the kind there is...
+ */
+static sim_table* sim_pick_table(
+	sim_table*           tbls,
+	enum ipa3_nat_mem_in nmi )
+{
+	enum ipa3_nat_mem_in i;
+
+	if ( IPA_VALID_NAT_MEM_IN(nmi) && tbls[nmi].allocated )
+	{
+		return &tbls[nmi];
+	}
+
+	for ( i = IPA_NAT_MEM_IN_DDR; i < IPA_NAT_MEM_IN_MAX; i++ )
+	{
+		if ( tbls[i].allocated )
+		{
+			return &tbls[i];
+		}
+	}
+
+	return NULL;
+}
+
+static sim_table* sim_nat_table(
+	enum ipa3_nat_mem_in nmi )
+{
+	return sim_pick_table(sim_nat, nmi);
+}
+
+static uint8_t* sim_dma_target(
+	enum ipa3_nat_mem_in              nmi,
+	const struct ipa_ioc_nat_dma_one* dma )
+{
+	sim_table* tbl;
+	uint8_t    sub;
+	uint32_t   pos;
+
+	if ( ! VALID_IPA_TABLE_DMA_TYPE(dma->base_addr) )
+	{
+		return NULL;
+	}
+
+	if ( dma->base_addr >= IPA_IPV6CT_BASE_TBL )
+	{
+		tbl = sim_pick_table(sim_ipv6ct, nmi);
+		sub = dma->base_addr - IPA_IPV6CT_BASE_TBL;
+	}
+	else
+	{
+		tbl = sim_nat_table(nmi);
+		sub = dma->base_addr;
+	}
+
+	if ( ! tbl ||
+		 ! tbl->inited ||
+		 ! tbl->mem ||
+		 tbl->tbl_index != dma->table_index ||
+		 dma->offset < tbl->offset )
+	{
+		return NULL;
+	}
+
+	pos =
+		(tbl->sub_offset[sub] - tbl->sub_offset[0]) +
+		(dma->offset - tbl->offset);
+
+	if ( pos + sizeof(uint16_t) > tbl->size )
+	{
+		return NULL;
+	}
+
+	return tbl->mem + tbl->mmap_offset + pos;
+}
+
+static int sim_dma(
+	struct ipa_ioc_nat_dma_cmd* cmd )
+{
+	uint8_t* tgt;
+	uint32_t i;
+
+	int ret = 0;
+
+	/*
+	 * All or nothing, validate every entry before applying any...
+	 */
+	for ( i = 0; i < cmd->entries; i++ )
+	{
+		if ( ! sim_dma_target(cmd->mem_type, &cmd->dma[i]) )
+		{
+			IPAERR("Bad dma entry %u: table_index(%u) base_addr(%u) offset(0x%08X)\n",
+				   i, cmd->dma[i].table_index, cmd->dma[i].base_addr, cmd->dma[i].offset);
+			SIM_ERR(EINVAL);
+		}
+	}
+
+	for ( i = 0; i < cmd->entries; i++ )
+	{
+		tgt = sim_dma_target(cmd->mem_type, &cmd->dma[i]);
+
+		*(uint16_t*) tgt = cmd->dma[i].data;
+	}
+
+	sim_stats.dma_cmds++;
+	sim_stats.dma_entries += cmd->entries;
+
+bail:
+	return ret;
+}
+
+static int sim_alloc(
+	sim_table*                             tbl,
+	struct ipa_ioc_nat_ipv6ct_table_alloc* cmd,
+	uint32_t                               offset,
+	uint32_t                               mmap_offset )
+{
+	int ret = 0;
+
+	if ( tbl->allocated || cmd->size == 0 )
+	{
+		SIM_ERR(ENOMEM);
+	}
+
+	memset(tbl, 0, sizeof(*tbl));
+
+	tbl->allocated   = true;
+	tbl->offset      = offset;
+	tbl->size        = cmd->size;
+	tbl->mmap_offset = mmap_offset;
+
+	cmd->offset = offset;
+
+bail:
+	return ret;
+}
+
+static int sim_del(
+	sim_table* tbl )
+{
+	int ret = 0;
+
+	if ( ! tbl || ! tbl->allocated )
+	{
+		SIM_ERR(EINVAL);
+	}
+
+	free(tbl->mem);
+
+	if ( sim_nat_pending == tbl )
+	{
+		sim_nat_pending = NULL;
+	}
+
+	if ( sim_ipv6ct_pending == tbl )
+	{
+		sim_ipv6ct_pending = NULL;
+	}
+
+	if ( sim_ipv6ct_focus == tbl )
+	{
+		sim_ipv6ct_focus = NULL;
+	}
+
+	memset(tbl, 0, sizeof(*tbl));
+
+bail:
+	return ret;
+}
+
+static bool sim_offset_ok(
+	sim_table* tbl,
+	uint32_t   offset )
+{
+	return offset >= tbl->offset && offset < tbl->offset + tbl->size;
+}
+
+static int sim_v4_init(
+	struct ipa_ioc_v4_nat_init* cmd )
+{
+	sim_table* tbl = sim_nat_table(cmd->mem_type);
+
+	int ret = 0;
+
+	if ( ! tbl || ! tbl->mem ||
+		 cmd->ipv4_rules_offset != tbl->offset ||
+		 ! sim_offset_ok(tbl, cmd->expn_rules_offset) ||
+		 ! sim_offset_ok(tbl, cmd->index_offset) ||
+		 ! sim_offset_ok(tbl, cmd->index_expn_offset) )
+	{
+		SIM_ERR(EINVAL);
+	}
+
+	tbl->tbl_index = cmd->tbl_index;
+
+	tbl->sub_offset[IPA_NAT_BASE_TBL]       = cmd->ipv4_rules_offset;
+	tbl->sub_offset[IPA_NAT_EXPN_TBL]       = cmd->expn_rules_offset;
+	tbl->sub_offset[IPA_NAT_INDX_TBL]       = cmd->index_offset;
+	tbl->sub_offset[IPA_NAT_INDEX_EXPN_TBL] = cmd->index_expn_offset;
+
+	tbl->inited = true;
+
+	sim_stats.inits++;
+
+	if ( cmd->focus_change )
+	{
+		sim_stats.focus_changes++;
+	}
+
+bail:
+	return ret;
+}
+
+static int sim_ipv6ct_init(
+	struct ipa_ioc_ipv6ct_init* cmd )
+{
+	sim_table* tbl =
+		(cmd->base_table_offset == SIM_SRAM_TBL_OFFSET) ?
+		&sim_ipv6ct[IPA_NAT_MEM_IN_SRAM]               :
+		&sim_ipv6ct[IPA_NAT_MEM_IN_DDR];
+
+	int ret = 0;
+
+	if ( ! tbl->allocated || ! tbl->mem ||
+		 cmd->base_table_offset != tbl->offset ||
+		 ! sim_offset_ok(tbl, cmd->expn_table_offset) )
+	{
+		SIM_ERR(EINVAL);
+	}
+
+	tbl->tbl_index = cmd->tbl_index;
+
+	tbl->sub_offset[0] = cmd->base_table_offset;
+	tbl->sub_offset[1] = cmd->expn_table_offset;
+
+	tbl->inited = true;
+
+	sim_stats.inits++;
+
+	if ( sim_ipv6ct_focus && sim_ipv6ct_focus != tbl )
+	{
+		sim_stats.focus_changes++;
+	}
+
+	sim_ipv6ct_focus = tbl;
+
+bail:
+	return ret;
+}
+
+static int sim_open(
+	const char* path,
+	int         flags )
+{
+	UNUSED(flags);
+
+	if ( ! strcmp(path, IPA_DEV_NAME) )
+	{
+		return SIM_FD_IPA;
+	}
+
+	if ( ! strcmp(path, "/dev/" IPA_NAT_DEV_NAME) )
+	{
+		return SIM_FD_NAT;
+	}
+
+	if ( ! strcmp(path, "/dev/" IPA_IPV6CT_DEV_NAME) )
+	{
+		return SIM_FD_IPV6CT;
+	}
+
+	errno = ENOENT;
+
+	return -1;
+}
+
+static int sim_close(
+	int fd )
+{
+	if ( fd < SIM_FD_IPA || fd > SIM_FD_IPV6CT )
+	{
+		errno = EBADF;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int sim_ioctl(
+	int           fd,
+	unsigned long req,
+	void*         arg )
+{
+	struct ipa_ioc_nat_ipv6ct_table_alloc* alloc_ptr;
+	struct ipa_ioc_nat_ipv6ct_table_del*   del_ptr;
+	struct ipa_nat_in_sram_info*           sram_ptr;
+	bool                                   in_sram;
+
+	int ret = 0;
+
+	pthread_mutex_lock(&sim_mutex);
+
+	if ( fd != SIM_FD_IPA )
+	{
+		SIM_ERR(EBADF);
+	}
+
+	sim_stats.ioctls++;
+
+	switch ( req )
+	{
+	case IPA_IOC_GET_HW_VERSION:
+		*(enum ipa_hw_type*) arg = IPA_HW_v4_5;
+		break;
+
+	case IPA_IOC_GET_NAT_IN_SRAM_INFO:
+		if ( ! sim_sram_size )
+		{
+			SIM_ERR(EOPNOTSUPP);
+		}
+		sram_ptr = (struct ipa_nat_in_sram_info*) arg;
+		sram_ptr->sram_mem_available_for_nat =
+			sim_sram_in_use() ? 0 : sim_sram_size;
+		sram_ptr->nat_table_offset_into_mmap = SIM_SRAM_MMAP_OFFSET;
+		sram_ptr->best_nat_in_sram_size_rqst =
+			(SIM_SRAM_MMAP_OFFSET + sim_sram_size + SIM_PAGE_SIZE - 1) &
+			~(SIM_PAGE_SIZE - 1);
+		break;
+
+	case IPA_IOC_ALLOC_NAT_TABLE:
+		alloc_ptr = (struct ipa_ioc_nat_ipv6ct_table_alloc*) arg;
+		in_sram   =
+			sim_sram_size && alloc_ptr->size <= sim_sram_size &&
+			! sim_sram_in_use();
+		ret = sim_alloc(
+			&sim_nat[in_sram ? IPA_NAT_MEM_IN_SRAM : IPA_NAT_MEM_IN_DDR],
+			alloc_ptr,
+			SIM_TBL_OFFSET,
+			in_sram ? SIM_SRAM_MMAP_OFFSET : 0);
+		if ( ret == 0 )
+		{
+			sim_nat_pending =
+				&sim_nat[in_sram ? IPA_NAT_MEM_IN_SRAM : IPA_NAT_MEM_IN_DDR];
+		}
+		break;
+
+	case IPA_IOC_ALLOC_IPV6CT_TABLE:
+		alloc_ptr = (struct ipa_ioc_nat_ipv6ct_table_alloc*) arg;
+		in_sram   =
+			sim_sram_size && alloc_ptr->size <= sim_sram_size &&
+			! sim_sram_in_use();
+		ret = sim_alloc(
+			&sim_ipv6ct[in_sram ? IPA_NAT_MEM_IN_SRAM : IPA_NAT_MEM_IN_DDR],
+			alloc_ptr,
+			in_sram ? SIM_SRAM_TBL_OFFSET : SIM_TBL_OFFSET,
+			in_sram ? SIM_SRAM_MMAP_OFFSET : 0);
+		if ( ret == 0 )
+		{
+			sim_ipv6ct_pending =
+				&sim_ipv6ct[in_sram ? IPA_NAT_MEM_IN_SRAM : IPA_NAT_MEM_IN_DDR];
+		}
+		break;
+
+	case IPA_IOC_DEL_NAT_TABLE:
+		del_ptr = (struct ipa_ioc_nat_ipv6ct_table_del*) arg;
+		ret = sim_del(sim_nat_table(del_ptr->mem_type));
+		break;
+
+	case IPA_IOC_DEL_IPV6CT_TABLE:
+		del_ptr = (struct ipa_ioc_nat_ipv6ct_table_del*) arg;
+		ret = sim_del(sim_pick_table(sim_ipv6ct, del_ptr->mem_type));
+		break;
+
+	case IPA_IOC_V4_INIT_NAT:
+		ret = sim_v4_init((struct ipa_ioc_v4_nat_init*) arg);
+		break;
+
+	case IPA_IOC_INIT_IPV6CT_TABLE:
+		ret = sim_ipv6ct_init((struct ipa_ioc_ipv6ct_init*) arg);
+		break;
+
+	case IPA_IOC_TABLE_DMA_CMD:
+		ret = sim_dma((struct ipa_ioc_nat_dma_cmd*) arg);
+		break;
+
+	case IPA_IOC_NAT_MODIFY_PDN:
+		if ( ((struct ipa_ioc_nat_pdn_entry*) arg)->pdn_index >= IPA_MAX_PDN_NUM )
+		{
+			SIM_ERR(EINVAL);
+		}
+		break;
+
+	case IPA_IOC_GET_NAT_OFFSET:
+		*(uint32_t*) arg = 0;
+		break;
+
+	case IPA_IOC_APP_CLOCK_VOTE:
+		/*
+		 * The vote type is passed by value, not by reference...
+		 */
+		switch ( (enum ipa_app_clock_vote_type) (uintptr_t) arg )
+		{
+		case IPA_APP_CLK_VOTE:
+			sim_votes++;
+			break;
+		case IPA_APP_CLK_DEVOTE:
+			if ( sim_votes == 0 )
+			{
+				SIM_ERR(EINVAL);
+			}
+			sim_votes--;
+			break;
+		case IPA_APP_CLK_RESET_VOTE:
+			sim_votes = 0;
+			break;
+		default:
+			SIM_ERR(EINVAL);
+		}
+		break;
+
+	default:
+		IPAERR("Unsupported ioctl(0x%lx)\n", req);
+		SIM_ERR(ENOTTY);
+	}
+
+bail:
+	pthread_mutex_unlock(&sim_mutex);
+
+	return ret;
+}
+
+static void* sim_mmap(
+	size_t len,
+	int    fd )
+{
+	sim_table* tbl;
+	void*      addr = MAP_FAILED;
+
+	pthread_mutex_lock(&sim_mutex);
+
+	tbl =
+		(fd == SIM_FD_NAT)    ? sim_nat_pending    :
+		(fd == SIM_FD_IPV6CT) ? sim_ipv6ct_pending :
+		NULL;
+
+	if ( ! tbl ||
+		 ! tbl->allocated ||
+		 tbl->mem ||
+		 len < tbl->mmap_offset + tbl->size )
+	{
+		errno = EINVAL;
+		goto bail;
+	}
+
+	tbl->mem = (uint8_t*) calloc(1, len);
+
+	if ( ! tbl->mem )
+	{
+		errno = ENOMEM;
+		goto bail;
+	}
+
+	tbl->mem_len = len;
+
+	if ( tbl == sim_nat_pending )
+	{
+		sim_nat_pending = NULL;
+	}
+
+	if ( tbl == sim_ipv6ct_pending )
+	{
+		sim_ipv6ct_pending = NULL;
+	}
+
+	addr = tbl->mem;
+
+bail:
+	pthread_mutex_unlock(&sim_mutex);
+
+	return addr;
+}
+
+static int sim_munmap(
+	void*  addr,
+	size_t len )
+{
+	sim_table* tbl = NULL;
+	uint32_t   i;
+
+	int ret = 0;
+
+	pthread_mutex_lock(&sim_mutex);
+
+	for ( i = 0; i < IPA_NAT_MEM_IN_MAX; i++ )
+	{
+		if ( sim_nat[i].mem && sim_nat[i].mem == addr )
+		{
+			tbl = &sim_nat[i];
+		}
+
+		if ( sim_ipv6ct[i].mem && sim_ipv6ct[i].mem == addr )
+		{
+			tbl = &sim_ipv6ct[i];
+		}
+	}
+
+	if ( ! tbl || len > tbl->mem_len )
+	{
+		SIM_ERR(EINVAL);
+	}
+
+	free(tbl->mem);
+
+	tbl->mem     = NULL;
+	tbl->mem_len = 0;
+	tbl->inited  = false;
+
+bail:
+	pthread_mutex_unlock(&sim_mutex);
+
+	return ret;
+}
+
+const ipa_nat_backend ipa_nat_sim_backend =
+{
+	.name   = "simulator",
+	.open   = sim_open,
+	.close  = sim_close,
+	.ioctl  = sim_ioctl,
+	.mmap   = sim_mmap,
+	.munmap = sim_munmap,
+};
+
+int ipa_nat_sim_set_sram_size(
+	uint32_t sram_size )
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	pthread_mutex_lock(&sim_mutex);
+
+	if ( sim_sram_in_use() )
+	{
+		IPAERR("Can't resize SRAM while a table is in it\n");
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	sim_sram_size = sram_size;
+
+unlock:
+	pthread_mutex_unlock(&sim_mutex);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+void ipa_nat_sim_get_stats(
+	ipa_nat_sim_stats* stats_ptr )
+{
+	pthread_mutex_lock(&sim_mutex);
+
+	*stats_ptr = sim_stats;
+
+	pthread_mutex_unlock(&sim_mutex);
+}
+
+void ipa_nat_sim_reset_stats(void)
+{
+	pthread_mutex_lock(&sim_mutex);
+
+	memset(&sim_stats, 0, sizeof(sim_stats));
+
+	pthread_mutex_unlock(&sim_mutex);
+}
+
+#else /* FEATURE_IPA_NAT_SIM */
+
+/*
+ * Production builds carry no simulator; the knobs are kept so that
+ * the test programs still link against them...
+ */
+int ipa_nat_sim_set_sram_size(
+	uint32_t sram_size )
+{
+	UNUSED(sram_size);
+
+	IPAERR("libipanat was built without the driver simulator\n");
+
+	return -ENOTSUP;
+}
+
+void ipa_nat_sim_get_stats(
+	ipa_nat_sim_stats* stats_ptr )
+{
+	memset(stats_ptr, 0, sizeof(ipa_nat_sim_stats));
+}
+
+void ipa_nat_sim_reset_stats(void)
+{
+}
+
+#endif /* FEATURE_IPA_NAT_SIM */
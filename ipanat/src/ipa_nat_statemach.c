@@ -28,32 +28,20 @@
  */
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
 
 #include "ipa_nat_drv.h"
 #include "ipa_nat_drvi.h"
 
-#include "ipa_nat_map.h"
-
 #include "ipa_nat_statemach.h"
 
-#undef PRCNT_OF
-#define PRCNT_OF(v) \
-	((.25) * (v))
-
 #undef  CHOOSE_MEM_SUB
 #define CHOOSE_MEM_SUB() \
 	(nati_obj.curr_state == NATI_STATE_HYBRID) ? \
 	SRAM_SUB : \
 	DDR_SUB
 
-#undef  CHOOSE_MAPS
-#define CHOOSE_MAPS(o2n, n2o) \
-	do { \
-		uint32_t sub = CHOOSE_MEM_SUB(); \
-		o2n = nati_obj.map_pairs[sub].orig2new_map; \
-		n2o = nati_obj.map_pairs[sub].new2orig_map; \
-	} while (0)
-
 #undef  CHOOSE_CNTR
 #define CHOOSE_CNTR() \
 	&(nati_obj.tot_rules_in_table[CHOOSE_MEM_SUB()])
@@ -116,6 +104,7 @@ static ipa_nati_obj nati_obj = {
 	.state_to_hold       = NATI_STATE_NULL,
 	.ddr_tbl_hdl         = 0,
 	.sram_tbl_hdl        = 0,
+	.ddr_grow_limit      = 0,
 	.tot_slots_in_sram   = 0,
 	.back_to_sram_thresh = 0,
 	/*
@@ -124,12 +113,7 @@ static ipa_nati_obj nati_obj = {
 	 *   tot_rules_in_table[1] for sram
 	 */
 	.tot_rules_in_table  = { 0, 0 },
-	/*
-	 * Remember:
-	 *   map_pairs[0] for ddr, and
-	 *   map_pairs[1] for sram
-	 */
-	.map_pairs = { {MAP_NUM_00, MAP_NUM_01}, {MAP_NUM_02, MAP_NUM_03} },
+	.hdls                = { NULL, NULL, 0, NULL },
 	/*
 	 * Remember:
 	 *   sw_stats[0] for ddr, and
@@ -235,6 +219,148 @@ static int give_mutex()
 	return ret;
 }
 
+/*
+ * Table readers (time stamp queries, walks and stats) don't take the
+ * mutex above.  Instead, the outermost trip through the state machine
+ * by a writer makes nat_seq odd on the way in and even again on the
+ * way out, so a reader that sees the same even value before and after
+ * a read knows nothing changed while it looked, and otherwise simply
+ * looks again.  Writers never wait for readers, save for the few
+ * triggers that create or tear down what readers dereference (see
+ * EXCLUSIVE_TRIGGER()); those raise nat_excl and wait for nat_readers
+ * to drain first.
+ */
+static uint32_t     nat_seq         = 0;
+static uint32_t     nat_readers     = 0;
+static uint32_t     nat_excl        = 0;
+static __thread int nat_write_depth = 0;
+
+static void write_begin(
+	ipa_nati_trigger trigger )
+{
+	if ( nat_write_depth++ )
+	{
+		if ( EXCLUSIVE_TRIGGER(trigger) &&
+			 ! __atomic_load_n(&nat_excl, __ATOMIC_SEQ_CST) )
+		{
+			/*
+			 * Readers already in are spinning on our odd nat_seq,
+			 * and won't leave until it's even.  An exclusive trigger
+			 * is only ever nested from a point where the tables are
+			 * coherent (ie. a failed rule add), so let them finish
+			 * their read before shutting them out...
+			 */
+			__atomic_store_n(&nat_excl, 1, __ATOMIC_SEQ_CST);
+
+			__atomic_add_fetch(&nat_seq, 1, __ATOMIC_SEQ_CST);
+
+			while ( __atomic_load_n(&nat_readers, __ATOMIC_SEQ_CST) )
+			{
+				sched_yield();
+			}
+
+			__atomic_add_fetch(&nat_seq, 1, __ATOMIC_SEQ_CST);
+		}
+
+		return;
+	}
+
+	if ( EXCLUSIVE_TRIGGER(trigger) )
+	{
+		__atomic_store_n(&nat_excl, 1, __ATOMIC_SEQ_CST);
+
+		while ( __atomic_load_n(&nat_readers, __ATOMIC_SEQ_CST) )
+		{
+			sched_yield();
+		}
+	}
+
+	__atomic_add_fetch(&nat_seq, 1, __ATOMIC_SEQ_CST);
+
+	/*
+	 * Keep the table writes that follow from becoming visible before
+	 * the odd count does...
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static void write_end(void)
+{
+	if ( --nat_write_depth )
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&nat_seq, 1, __ATOMIC_RELEASE);
+
+	__atomic_store_n(&nat_excl, 0, __ATOMIC_RELEASE);
+}
+
+void ipa_nati_read_lock(void)
+{
+	if ( nat_write_depth )
+	{
+		return;
+	}
+
+	for ( ;; )
+	{
+		__atomic_add_fetch(&nat_readers, 1, __ATOMIC_SEQ_CST);
+
+		if ( ! __atomic_load_n(&nat_excl, __ATOMIC_SEQ_CST) )
+		{
+			break;
+		}
+
+		__atomic_sub_fetch(&nat_readers, 1, __ATOMIC_SEQ_CST);
+
+		while ( __atomic_load_n(&nat_excl, __ATOMIC_ACQUIRE) )
+		{
+			sched_yield();
+		}
+	}
+}
+
+void ipa_nati_read_unlock(void)
+{
+	if ( nat_write_depth )
+	{
+		return;
+	}
+
+	__atomic_sub_fetch(&nat_readers, 1, __ATOMIC_RELEASE);
+}
+
+uint32_t ipa_nati_read_begin(void)
+{
+	uint32_t seq = 0;
+
+	if ( nat_write_depth )
+	{
+		return seq;
+	}
+
+	while ( (seq = __atomic_load_n(&nat_seq, __ATOMIC_ACQUIRE)) & 1 )
+	{
+		sched_yield();
+	}
+
+	return seq;
+}
+
+bool ipa_nati_read_retry(
+	uint32_t seq )
+{
+	if ( nat_write_depth )
+	{
+		return false;
+	}
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(&nat_seq, __ATOMIC_RELAXED) != seq;
+}
+
 /*
  * ****************************************************************************
  *
@@ -380,6 +506,30 @@ int ipa_nati_add_ipv4_rule(
 	return ret;
 }
 
+int ipa_nati_add_ipv4_rules(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rules,
+	uint32_t                 num_rules,
+	uint32_t*                rule_hdls )
+{
+	rules_add_args args = {
+		.tbl_hdl    = tbl_hdl,
+		.clnt_rules = clnt_rules,
+		.num_rules  = num_rules,
+		.rule_hdls  = rule_hdls,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_ADD_RULES, (void*) &args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 int ipa_nati_del_ipv4_rule(
 	uint32_t tbl_hdl,
 	uint32_t rule_hdl )
@@ -400,6 +550,28 @@ int ipa_nati_del_ipv4_rule(
 	return ret;
 }
 
+int ipa_nati_del_ipv4_rules(
+	uint32_t        tbl_hdl,
+	const uint32_t* rule_hdls,
+	uint32_t        num_rules )
+{
+	rules_del_args args = {
+		.tbl_hdl   = tbl_hdl,
+		.rule_hdls = rule_hdls,
+		.num_rules = num_rules,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_DEL_RULES, (void*) &args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 int ipa_nati_query_timestamp(
 	uint32_t  tbl_hdl,
 	uint32_t  rule_hdl,
@@ -427,6 +599,199 @@ int ipa_nati_query_timestamp(
 	return ret;
 }
 
+int ipa_nati_find_ipv4_rule(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl)
+{
+	rule_find_args args = {
+		.tbl_hdl   = tbl_hdl,
+		.clnt_rule = clnt_rule,
+		.rule_hdl  = rule_hdl,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_FIND_RULE, (void*) &args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * How many stale rules are handed to the callback at a time...
+ */
+#undef  NATI_STALE_BATCH
+#define NATI_STALE_BATCH 64
+
+int ipa_nati_collect_stale(
+	uint32_t         tbl_hdl,
+	uint32_t         older_than,
+	bool             del_stale,
+	ipa_nat_stale_cb stale_cb,
+	void*            arb_data_ptr)
+{
+	ipa_nat_rule_time_stamp* stale     = NULL;
+	uint32_t                 num_stale = 0;
+	uint32_t                 i, batch;
+
+	stale_collect_args args = {
+		.tbl_hdl       = tbl_hdl,
+		.older_than    = older_than,
+		.del_stale     = del_stale,
+		.stale_ptr     = &stale,
+		.num_stale_ptr = &num_stale,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_GET_STALE, (void*) &args);
+
+	/*
+	 * The callback is made from outside the state machine, so that it
+	 * may use the library...
+	 */
+	for ( i = 0; i < num_stale; i += batch )
+	{
+		batch = num_stale - i;
+
+		if ( batch > NATI_STALE_BATCH )
+		{
+			batch = NATI_STALE_BATCH;
+		}
+
+		if ( stale_cb(&stale[i], batch, arb_data_ptr) )
+		{
+			break;
+		}
+	}
+
+	free(stale);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_compact_ipv4_tbl(
+	uint32_t  tbl_hdl,
+	uint32_t  max_moves,
+	uint32_t* num_moved)
+{
+	table_compact_args args = {
+		.tbl_hdl       = tbl_hdl,
+		.max_moves     = max_moves,
+		.num_moved_ptr = num_moved,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_TBL_PACK, (void*) &args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_query_timestamps(
+	uint32_t        tbl_hdl,
+	const uint32_t* rule_hdls,
+	uint32_t        num_rules,
+	uint32_t*       time_stamps)
+{
+	timestamps_query_args args = {
+		.tbl_hdl     = tbl_hdl,
+		.rule_hdls   = rule_hdls,
+		.num_rules   = num_rules,
+		.time_stamps = time_stamps,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_GET_TSTMPS, (void*) &args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_query_all_timestamps(
+	uint32_t                 tbl_hdl,
+	ipa_nat_rule_time_stamp* time_stamps,
+	uint32_t                 max_rules,
+	uint32_t*                num_rules)
+{
+	timestamps_query_args args = {
+		.tbl_hdl         = tbl_hdl,
+		.num_rules       = max_rules,
+		.all_time_stamps = time_stamps,
+		.num_found_ptr   = num_rules,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	*num_rules = 0;
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_GET_TSTMPS, (void*) &args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_query_changed_timestamps(
+	uint32_t                 tbl_hdl,
+	ipa_nat_ts_shadow**      shadow,
+	ipa_nat_rule_time_stamp* time_stamps,
+	uint32_t                 max_rules,
+	uint32_t*                num_rules)
+{
+	timestamps_query_args args = {
+		.tbl_hdl         = tbl_hdl,
+		.num_rules       = max_rules,
+		.all_time_stamps = time_stamps,
+		.num_found_ptr   = num_rules,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	*num_rules = 0;
+
+	if ( ! *shadow )
+	{
+		*shadow = calloc(1, sizeof(ipa_nat_ts_shadow));
+
+		if ( ! *shadow )
+		{
+			IPAERR("Unable to allocate time stamp shadow\n");
+			ret = -ENOMEM;
+			goto bail;
+		}
+	}
+
+	args.shadow = *shadow;
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_GET_CHNGD, (void*) &args);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 int ipa_nat_switch_to(
 	enum ipa3_nat_mem_in nmi,
 	bool                 hold_state )
@@ -562,7 +927,44 @@ int ipa_nat_switch_to(
 	ret = 0;
 
 unlock:
-	ret = give_mutex();
+	if ( give_mutex() != 0 )
+	{
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nat_set_ddr_grow_limit(
+	uint32_t max_entries )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( max_entries > IPA_TABLE_MAX_ENTRIES )
+	{
+		max_entries = IPA_TABLE_MAX_ENTRIES;
+	}
+
+	ret = take_mutex();
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	nati_obj.ddr_grow_limit = max_entries;
+
+	IPADBG("DDR table may grow to %u entries\n", max_entries);
+
+	if ( give_mutex() != 0 )
+	{
+		ret = -EPERM;
+	}
 
 bail:
 	IPADBG("Out\n");
@@ -575,13 +977,386 @@ bool ipa_nat_is_sram_supported(void)
 	return VALID_TBL_HDL(nati_obj.sram_tbl_hdl);
 }
 
-/******************************************************************************/
 /*
- * FUNCTION: migrate_rule
- *
- * PARAMS:
+ * ****************************************************************************
  *
- *   table_ptr         (IN) The table being walked
+ * STABLE RULE HANDLES, AS USED IN HYBRID MODE
+ *
+ *   The rule_hdl is used to find a rule in the nat table.  It is, in
+ *   effect, an index into the table.  The applcation above us retains
+ *   it for future manipulation of the rule in the table.
+ *
+ *   In hybrid mode, a rule can and will move between SRAM and DDR.
+ *   Because of this, its real handle will change.  Hence, in hybrid
+ *   mode, the application is given a stable handle instead:
+ *
+ *     bits 31..16 The slot's generation
+ *     bits 15..0  The slot's index
+ *
+ *   The slot keeps the rule's real handle for each memory type.  When
+ *   a rule migrates, its slot is updated in place.  Real handles are
+ *   16 bits wide (see MakeEntryHdl), so a flat array is enough to map
+ *   a real handle back to its slot.
+ *
+ *   A DDR only table that fills up is grown (see _smGrowDdrTbl), and
+ *   its rules are rehashed to new places as it is, so the same handles
+ *   are given out in NATI_STATE_DDR_ONLY too.
+ *
+ *   The IPv6CT tables move between SRAM and DDR the same way, and use
+ *   these same routines for their handles (see ipa_ipv6ct.c).
+ *
+ * ****************************************************************************
+ */
+#undef  NATI_MAX_HDLS
+#define NATI_MAX_HDLS \
+	(2 * (IPA_TABLE_INDX_MASK + 1))
+
+#undef  NATI_MAX_REAL_HDLS
+#define NATI_MAX_REAL_HDLS \
+	(UINT16_MAX + 1)
+
+#undef  MAKE_STABLE_HDL
+#define MAKE_STABLE_HDL(gen, slot) \
+	( ((uint32_t) (gen) << 16) | (slot) )
+
+#undef  BREAK_STABLE_HDL
+#define BREAK_STABLE_HDL(hdl, gen, slot) \
+	do { \
+		gen  = (hdl) >> 16; \
+		slot = (hdl) & 0xFFFF; \
+	} while ( 0 )
+
+#undef  REAL_HDL_SUB
+#define REAL_HDL_SUB(hdl) \
+	( ((((hdl) >> IPA_TABLE_TYPE_MEM_SHIFT) & IPA_TABLE_TYPE_MASK) \
+	   == IPA_NAT_MEM_IN_SRAM) ? SRAM_SUB : DDR_SUB )
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdls_reset
+ *
+ * DESCRIPTION:
+ *
+ *   Frees every slot.  Handles given out before the reset are no
+ *   longer valid.
+ */
+void nati_hdls_reset(
+	nati_hdl_tbl* hdls )
+{
+	uint32_t slot;
+
+	if ( ! hdls->slots )
+	{
+		return;
+	}
+
+	for ( slot = NATI_MAX_HDLS, hdls->free_cnt = 0; slot > 0; slot-- )
+	{
+		nati_hdl_slot* slot_ptr = &hdls->slots[slot];
+
+		if ( slot_ptr->rule_hdl[DDR_SUB] || slot_ptr->rule_hdl[SRAM_SUB] )
+		{
+			slot_ptr->gen++;
+			slot_ptr->rule_hdl[DDR_SUB] = slot_ptr->rule_hdl[SRAM_SUB] = 0;
+		}
+
+		hdls->free_list[hdls->free_cnt++] = slot;
+	}
+
+	memset(hdls->slot_of, 0, NATI_MAX_REAL_HDLS * sizeof(uint16_t));
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdls_destroy
+ */
+void nati_hdls_destroy(
+	nati_hdl_tbl* hdls )
+{
+	free(hdls->slots);
+	free(hdls->free_list);
+	free(hdls->slot_of);
+
+	memset(hdls, 0, sizeof(nati_hdl_tbl));
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdls_create
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+int nati_hdls_create(
+	nati_hdl_tbl* hdls )
+{
+	nati_hdls_destroy(hdls);
+
+	hdls->slots     = calloc(NATI_MAX_HDLS + 1, sizeof(nati_hdl_slot));
+	hdls->free_list = calloc(NATI_MAX_HDLS, sizeof(uint16_t));
+	hdls->slot_of   = calloc(NATI_MAX_REAL_HDLS, sizeof(uint16_t));
+
+	if ( ! hdls->slots || ! hdls->free_list || ! hdls->slot_of )
+	{
+		IPAERR("Unable to allocate stable handle table\n");
+		nati_hdls_destroy(hdls);
+		return -ENOMEM;
+	}
+
+	nati_hdls_reset(hdls);
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdl_alloc
+ *
+ * DESCRIPTION:
+ *
+ *   Gives a newly added rule, known by its real handle, a stable
+ *   handle.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+int nati_hdl_alloc(
+	nati_hdl_tbl* hdls,
+	uint32_t      rule_hdl,
+	uint32_t*     stable_hdl_ptr )
+{
+	nati_hdl_slot* slot_ptr;
+	uint16_t       slot;
+
+	if ( ! hdls->free_cnt || rule_hdl >= NATI_MAX_REAL_HDLS )
+	{
+		IPAERR("Unable to give rule_hdl(0x%08X) a stable handle, free_cnt(%u)\n",
+			   rule_hdl, hdls->free_cnt);
+		return -ENOSPC;
+	}
+
+	slot     = hdls->free_list[--hdls->free_cnt];
+	slot_ptr = &hdls->slots[slot];
+
+	slot_ptr->rule_hdl[DDR_SUB] = slot_ptr->rule_hdl[SRAM_SUB] = 0;
+	slot_ptr->rule_hdl[REAL_HDL_SUB(rule_hdl)] = rule_hdl;
+
+	hdls->slot_of[rule_hdl] = slot;
+
+	*stable_hdl_ptr = MAKE_STABLE_HDL(slot_ptr->gen, slot);
+
+	IPADBG("rule_hdl(0x%08X) -> stable_hdl(0x%08X)\n",
+		   rule_hdl, *stable_hdl_ptr);
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdl_slot_ptr
+ *
+ * DESCRIPTION:
+ *
+ *   Returns the slot a stable handle names, or NULL when the handle is
+ *   malformed or stale.
+ */
+static nati_hdl_slot* nati_hdl_slot_ptr(
+	nati_hdl_tbl* hdls,
+	uint32_t      stable_hdl )
+{
+	nati_hdl_slot* slot_ptr;
+	uint32_t       gen, slot;
+
+	BREAK_STABLE_HDL(stable_hdl, gen, slot);
+
+	if ( ! hdls->slots || slot == 0 || slot > NATI_MAX_HDLS )
+	{
+		IPAERR("Bad stable_hdl(0x%08X)\n", stable_hdl);
+		return NULL;
+	}
+
+	slot_ptr = &hdls->slots[slot];
+
+	if ( slot_ptr->gen != gen ||
+		 ! (slot_ptr->rule_hdl[DDR_SUB] || slot_ptr->rule_hdl[SRAM_SUB]) )
+	{
+		IPAERR("Stale stable_hdl(0x%08X)\n", stable_hdl);
+		return NULL;
+	}
+
+	return slot_ptr;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdl_resolve
+ *
+ * DESCRIPTION:
+ *
+ *   Finds the rule's real handle in the memory named by sub (DDR_SUB or
+ *   SRAM_SUB), which is normally the one currently being used.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+int nati_hdl_resolve(
+	nati_hdl_tbl* hdls,
+	uint32_t      sub,
+	uint32_t      stable_hdl,
+	uint32_t*     rule_hdl_ptr )
+{
+	nati_hdl_slot* slot_ptr = nati_hdl_slot_ptr(hdls, stable_hdl);
+
+	if ( ! slot_ptr || ! slot_ptr->rule_hdl[sub] )
+	{
+		return -1;
+	}
+
+	*rule_hdl_ptr = slot_ptr->rule_hdl[sub];
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdl_free
+ *
+ * DESCRIPTION:
+ *
+ *   Like nati_hdl_resolve(), then releases the stable handle.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+int nati_hdl_free(
+	nati_hdl_tbl* hdls,
+	uint32_t      sub,
+	uint32_t      stable_hdl,
+	uint32_t*     rule_hdl_ptr )
+{
+	int ret = nati_hdl_resolve(hdls, sub, stable_hdl, rule_hdl_ptr);
+
+	if ( ret == 0 )
+	{
+		nati_hdl_slot* slot_ptr = &hdls->slots[stable_hdl & 0xFFFF];
+
+		slot_ptr->gen++;
+		slot_ptr->rule_hdl[DDR_SUB] = slot_ptr->rule_hdl[SRAM_SUB] = 0;
+
+		hdls->free_list[hdls->free_cnt++] = stable_hdl & 0xFFFF;
+	}
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdl_of
+ *
+ * DESCRIPTION:
+ *
+ *   The reverse of nati_hdl_resolve(): finds the stable handle of a
+ *   rule known by its real handle, in either memory.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+int nati_hdl_of(
+	nati_hdl_tbl* hdls,
+	uint32_t      rule_hdl,
+	uint32_t*     stable_hdl_ptr )
+{
+	uint16_t slot;
+
+	if ( ! hdls->slot_of || ! rule_hdl || rule_hdl >= NATI_MAX_REAL_HDLS )
+	{
+		return -1;
+	}
+
+	slot = hdls->slot_of[rule_hdl];
+
+	if ( slot == 0 ||
+		 hdls->slots[slot].rule_hdl[REAL_HDL_SUB(rule_hdl)] != rule_hdl )
+	{
+		IPAERR("rule_hdl(0x%08X) has no stable handle\n", rule_hdl);
+		return -1;
+	}
+
+	*stable_hdl_ptr = MAKE_STABLE_HDL(hdls->slots[slot].gen, slot);
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_hdl_move
+ *
+ * DESCRIPTION:
+ *
+ *   Records a rule's real handle in the memory it's being copied to.
+ *   It only becomes current once the IPA is switched to that memory.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+int nati_hdl_move(
+	nati_hdl_tbl* hdls,
+	uint32_t      stable_hdl,
+	uint32_t      new_rule_hdl )
+{
+	nati_hdl_slot* slot_ptr = nati_hdl_slot_ptr(hdls, stable_hdl);
+
+	if ( ! slot_ptr || new_rule_hdl >= NATI_MAX_REAL_HDLS )
+	{
+		return -1;
+	}
+
+	slot_ptr->rule_hdl[REAL_HDL_SUB(new_rule_hdl)] = new_rule_hdl;
+
+	hdls->slot_of[new_rule_hdl] = stable_hdl & 0xFFFF;
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nat_rule_to_v4_rule
+ *
+ * DESCRIPTION:
+ *
+ *   Recovers, from a table record, the rule that was added.
+ */
+static void nat_rule_to_v4_rule(
+	const struct ipa_nat_rule* nat_rule_ptr,
+	ipa_nat_ipv4_rule*         v4_rule_ptr )
+{
+	memset(v4_rule_ptr, 0, sizeof(ipa_nat_ipv4_rule));
+
+	v4_rule_ptr->private_ip   = nat_rule_ptr->private_ip;
+	v4_rule_ptr->private_port = nat_rule_ptr->private_port;
+	v4_rule_ptr->protocol     = nat_rule_ptr->protocol;
+	v4_rule_ptr->public_port  = nat_rule_ptr->public_port;
+	v4_rule_ptr->target_ip    = nat_rule_ptr->target_ip;
+	v4_rule_ptr->target_port  = nat_rule_ptr->target_port;
+	v4_rule_ptr->pdn_index    = nat_rule_ptr->pdn_index;
+	v4_rule_ptr->redirect     = nat_rule_ptr->redirect;
+	v4_rule_ptr->enable       = nat_rule_ptr->enable;
+	v4_rule_ptr->time_stamp   = nat_rule_ptr->time_stamp;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: migrate_rule
+ *
+ * PARAMS:
+ *
+ *   table_ptr         (IN) The table being walked
  *
  *   tbl_rule_hdl      (IN) The nat rule's handle from the source table
  *
@@ -610,22 +1385,10 @@ bool ipa_nat_is_sram_supported(void)
  *
  * AN IMPORTANT NOTE ON RULE HANDLES WHEN IN MYBRID MODE
  *
- *   The rule_hdl is used to find a rule in the nat table.  It is, in
- *   effect, an index into the table.  The applcation above us retains
- *   it for future manipulation of the rule in the table.
- *
- *   In hybrid mode, a rule can and will move between SRAM and DDR.
- *   Because of this, its handle will change.  The application has
- *   only the original handle and doesn't know of the new handle.  A
- *   mapping, used in hybrid mode, will maintain a relationship
- *   between the original handle and the rule's current real handle...
- *
- *   To help you get a mindset of how this is done:
- *
- *     The original handle will map (point) to the new and new handle
- *     will map (point) back to original.
- *
- * NOTE WELL: There are two sets of maps.  One for each memory type...
+ *   The application only knows the rule by its stable handle.  Once
+ *   the rule has been copied, its stable handle's slot is told of the
+ *   rule's real handle in the destination table.  See STABLE RULE
+ *   HANDLES above...
  *
  * RETURNS:
  *
@@ -645,11 +1408,9 @@ static int migrate_rule(
 
 	ipa_nat_ipv4_rule    v4_rule;
 
-	uint32_t             orig_rule_hdl;
+	uint32_t             stable_hdl;
 	uint32_t             new_rule_hdl;
 
-	uint32_t             src_orig2new_map, src_new2orig_map;
-	uint32_t             dst_orig2new_map, dst_new2orig_map;
 	uint32_t*            cnt_ptr;
 
 	const char*          mig_dir_ptr;
@@ -678,29 +1439,15 @@ static int migrate_rule(
 	{
 		mig_dir_ptr = "SRAM -> DDR";
 
-		src_orig2new_map = nati_obj.map_pairs[SRAM_SUB].orig2new_map;
-		src_new2orig_map = nati_obj.map_pairs[SRAM_SUB].new2orig_map;
-
-		dst_orig2new_map = nati_obj.map_pairs[DDR_SUB].orig2new_map;
-		dst_new2orig_map = nati_obj.map_pairs[DDR_SUB].new2orig_map;
-
-		cnt_ptr          = &(nati_obj.tot_rules_in_table[DDR_SUB]);
+		cnt_ptr     = &(nati_obj.tot_rules_in_table[DDR_SUB]);
 	}
 	else
 	{
 		mig_dir_ptr = "DDR -> SRAM";
 
-		src_orig2new_map = nati_obj.map_pairs[DDR_SUB].orig2new_map;
-		src_new2orig_map = nati_obj.map_pairs[DDR_SUB].new2orig_map;
-
-		dst_orig2new_map = nati_obj.map_pairs[SRAM_SUB].orig2new_map;
-		dst_new2orig_map = nati_obj.map_pairs[SRAM_SUB].new2orig_map;
-
-		cnt_ptr          = &(nati_obj.tot_rules_in_table[SRAM_SUB]);
+		cnt_ptr     = &(nati_obj.tot_rules_in_table[SRAM_SUB]);
 	}
 
-	src_orig2new_map++; /* to avoid compiler usage warning */
-
 	if ( nat_rule_ptr->protocol == IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE )
 	{
 		IPADBG("%s: Special \"first rule in list\" case. "
@@ -710,26 +1457,15 @@ static int migrate_rule(
 		goto bail;
 	}
 
-	ret = ipa_nat_map_find(src_new2orig_map, tbl_rule_hdl, &orig_rule_hdl);
+	ret = nati_hdl_of(&nati_obj.hdls, tbl_rule_hdl, &stable_hdl);
 
 	if ( ret != 0 )
 	{
-		IPAERR("%s: ipa_nat_map_find(src_new2orig_map) fail\n", mig_dir_ptr);
+		IPAERR("%s: nati_hdl_of() fail\n", mig_dir_ptr);
 		goto bail;
 	}
 
-	memset(&v4_rule, 0, sizeof(v4_rule));
-
-	v4_rule.private_ip   = nat_rule_ptr->private_ip;
-	v4_rule.private_port = nat_rule_ptr->private_port;
-	v4_rule.protocol     = nat_rule_ptr->protocol;
-	v4_rule.public_port  = nat_rule_ptr->public_port;
-	v4_rule.target_ip    = nat_rule_ptr->target_ip;
-	v4_rule.target_port  = nat_rule_ptr->target_port;
-	v4_rule.pdn_index    = nat_rule_ptr->pdn_index;
-	v4_rule.redirect     = nat_rule_ptr->redirect;
-	v4_rule.enable       = nat_rule_ptr->enable;
-	v4_rule.time_stamp   = nat_rule_ptr->time_stamp;
+	nat_rule_to_v4_rule(nat_rule_ptr, &v4_rule);
 
 	ret = ipa_NATI_add_ipv4_rule(dst_tbl_hdl, &v4_rule, &new_rule_hdl);
 
@@ -741,53 +1477,932 @@ static int migrate_rule(
 
 	(*cnt_ptr)++;
 
-	/*
-	 * The following is needed to maintain the original handle and
-	 * have it point to the new handle.
-	 *
-	 * Remember, original handle points to new and the new handle
-	 * points back to original.
-	 */
-	ret = ipa_nat_map_add(dst_orig2new_map, orig_rule_hdl, new_rule_hdl);
+	ret = nati_hdl_move(&nati_obj.hdls, stable_hdl, new_rule_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("%s: nati_hdl_move() fail\n", mig_dir_ptr);
+		goto bail;
+	}
+
+	IPADBG("stable_hdl(0x%08X) new_rule_hdl(0x%08X)\n",
+		   stable_hdl, new_rule_hdl);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * The following is handed to rehash_rule() below...
+ */
+typedef struct
+{
+	uint32_t  tbl_hdl;
+	uint32_t* stable_hdls;
+	uint32_t* new_rule_hdls;
+	uint32_t  num_moved;
+	uint32_t  max_moved;
+} nati_grow_args;
+
+/******************************************************************************/
+/*
+ * FUNCTION: rehash_rule
+ *
+ * PARAMS:
+ *
+ *   Those of migrate_rule() above, save arb_data_ptr, which is a
+ *   nati_grow_args
+ *
+ * DESCRIPTION:
+ *
+ *   The ipa_nati_grow_ipv4_tbl() counterpart of migrate_rule(): adds
+ *   the rule to the larger table.
+ *
+ *   Unlike a migration, old and new real handles are in the same
+ *   memory, so a rule's new handle may well be one that another rule,
+ *   yet to be copied, still has.  The stable handles are therefore
+ *   left alone until the copy has succeeded; the moves are only noted
+ *   here.
+ *
+ * RETURNS:
+ *
+ *   Returns 0 on success, non-zero on failure
+ */
+static int rehash_rule(
+	ipa_table*      table_ptr,
+	uint32_t        tbl_rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	struct ipa_nat_rule* nat_rule_ptr = (struct ipa_nat_rule*) record_ptr;
+	nati_grow_args*      args         = (nati_grow_args*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule    v4_rule;
+
+	uint32_t             stable_hdl;
+	uint32_t             new_rule_hdl;
+
+	int                  ret;
+
+	UNUSED(table_ptr);
+	UNUSED(record_index);
+	UNUSED(meta_record_ptr);
+	UNUSED(meta_record_index);
+
+	IPADBG("In\n");
+
+	if ( nat_rule_ptr->protocol == IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE )
+	{
+		IPADBG("Special \"first rule in list\" case. "
+			   "Rule's enabled bit on, but protocol implies deleted\n");
+		ret = 0;
+		goto bail;
+	}
+
+	ret = nati_hdl_of(&nati_obj.hdls, tbl_rule_hdl, &stable_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("nati_hdl_of() fail\n");
+		goto bail;
+	}
+
+	if ( args->num_moved >= args->max_moved )
+	{
+		IPAERR("More rules than expected (%u)\n", args->max_moved);
+		ret = -1;
+		goto bail;
+	}
+
+	nat_rule_to_v4_rule(nat_rule_ptr, &v4_rule);
+
+	ret = ipa_NATI_add_ipv4_rule(args->tbl_hdl, &v4_rule, &new_rule_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("ipa_NATI_add_ipv4_rule() fail\n");
+		goto bail;
+	}
+
+	args->stable_hdls[args->num_moved]   = stable_hdl;
+	args->new_rule_hdls[args->num_moved] = new_rule_hdl;
+
+	args->num_moved++;
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * ****************************************************************************
+ *
+ * STATE MACHINE CODE BEGINS HERE
+ *
+ * ****************************************************************************
+ */
+static int _smUndef(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr ); /* forward declaration */
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smDelTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the destruction of the DDR based NAT
+ *   table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smDelTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_del_args* args = (table_del_args*) arb_data_ptr;
+
+	uint32_t tbl_hdl = args->tbl_hdl;
+
+	int ret;
+
+	UNUSED(nati_obj_ptr);
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+
+	ret = ipa_NATI_del_ipv4_table(tbl_hdl);
+
+	if ( ret == 0 && ! IN_HYBRID_STATE() )
+	{
+		nati_hdls_destroy(&nati_obj_ptr->hdls);
+
+		/*
+		 * The following will create the preferred "initial state" for
+		 * restart...
+		 */
+		BACK2_UNSTARTED_STATE();
+	}
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smFirstTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the creation of the very first NAT table(s)
+ *   before any others have ever been created...
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smFirstTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*           arb_data_ptr )
+{
+	table_add_args* args = (table_add_args*) arb_data_ptr;
+
+	const char* mem_type_ptr    = args->mem_type_ptr;
+
+	int ret;
+
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	/*
+	 * This is the first time in here.  Let the ipacm's XML config (or
+	 * state_to_hold) drive initial state...
+	 */
+	SET_NATIOBJ_STATE(
+		nati_obj_ptr,
+		(nati_obj_ptr->hold_state && nati_obj_ptr->state_to_hold) ?
+		nati_obj_ptr->state_to_hold                               :
+		mem_type_str_to_ipa_nati_state(mem_type_ptr));
+
+	ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_ADD_TABLE, arb_data_ptr);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smAddDdrTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the creation of a NAT table in DDR.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smAddDdrTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_add_args* args = (table_add_args*) arb_data_ptr;
+
+	uint32_t  public_ip_addr    = args->public_ip_addr;
+	uint16_t  number_of_entries = args->number_of_entries;
+	uint32_t* tbl_hdl_ptr       = args->tbl_hdl;
+
+	bool      new_hdls          = false;
+
+	int ret;
+
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	IPADBG("public_ip_addr(0x%08X) number_of_entries(%u) tbl_hdl_ptr(%p)\n",
+		   public_ip_addr, number_of_entries, tbl_hdl_ptr);
+
+	if ( nati_obj_ptr->curr_state == NATI_STATE_DDR_ONLY
+		 &&
+		 ! nati_obj_ptr->hdls.slots )
+	{
+		/*
+		 * The table can grow, which moves its rules, hence stable
+		 * handles here too...
+		 */
+		nati_obj_ptr->tot_rules_in_table[DDR_SUB] = 0;
+
+		ret = nati_hdls_create(&nati_obj_ptr->hdls);
+
+		if ( ret != 0 )
+		{
+			goto bail;
+		}
+
+		new_hdls = true;
+	}
+
+	ret = ipa_NATI_add_ipv4_tbl(
+		IPA_NAT_MEM_IN_DDR,
+		public_ip_addr,
+		number_of_entries,
+		&nati_obj_ptr->ddr_tbl_hdl);
+
+	if ( ret == 0 )
+	{
+		nati_obj_ptr->ddr_tbl_ents = number_of_entries;
+
+		*tbl_hdl_ptr = nati_obj_ptr->ddr_tbl_hdl;
+
+		IPADBG("DDR table creation successful: tbl_hdl(0x%08X)\n",
+			   *tbl_hdl_ptr);
+	}
+	else if ( new_hdls )
+	{
+		nati_hdls_destroy(&nati_obj_ptr->hdls);
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smAddSramTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the creation of a NAT table in SRAM.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smAddSramTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_add_args* args = (table_add_args*) arb_data_ptr;
+
+	uint32_t  public_ip_addr    = args->public_ip_addr;
+	uint16_t  number_of_entries = args->number_of_entries;
+	uint32_t* tbl_hdl_ptr       = args->tbl_hdl;
+
+	uint32_t  sram_size = 0;
+
+	int ret;
+
+	UNUSED(number_of_entries);
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	IPADBG("public_ip_addr(0x%08X) tbl_hdl_ptr(%p)\n",
+		   public_ip_addr, tbl_hdl_ptr);
+
+	ret = ipa_nati_get_sram_size(&sram_size);
+
+	if ( ret == 0 )
+	{
+		ret = ipa_calc_num_sram_table_entries(
+			sram_size,
+			sizeof(struct ipa_nat_rule),
+			sizeof(struct ipa_nat_indx_tbl_rule),
+			(uint16_t*) &nati_obj_ptr->tot_slots_in_sram);
+
+		if ( ret == 0 )
+		{
+			nati_obj_ptr->back_to_sram_thresh =
+				PRCNT_OF(nati_obj_ptr->tot_slots_in_sram);
+
+			IPADBG("sram_size(%u or 0x%x) tot_slots_in_sram(%u) back_to_sram_thresh(%u)\n",
+				   sram_size,
+				   sram_size,
+				   nati_obj_ptr->tot_slots_in_sram,
+				   nati_obj_ptr->back_to_sram_thresh);
+
+			IPADBG("Voting clock on for sram table creation\n");
+
+			if ( (ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE)) != 0 )
+			{
+				IPAERR("Voting clock on failed\n");
+				goto done;
+			}
+
+			ret = ipa_NATI_add_ipv4_tbl(
+				IPA_NAT_MEM_IN_SRAM,
+				public_ip_addr,
+				nati_obj_ptr->tot_slots_in_sram,
+				&nati_obj_ptr->sram_tbl_hdl);
+
+			if ( ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != 0 )
+			{
+				IPAWARN("Voting clock off failed\n");
+			}
+
+			if ( ret == 0 )
+			{
+				*tbl_hdl_ptr = nati_obj_ptr->sram_tbl_hdl;
+
+				IPADBG("SRAM table creation successful: tbl_hdl(0x%08X)\n",
+					   *tbl_hdl_ptr);
+			}
+		}
+	}
+
+done:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smAddSramAndDdrTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the creation of NAT tables in both DDR
+ *   and in SRAM.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smAddSramAndDdrTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_add_args* args = (table_add_args*) arb_data_ptr;
+
+	uint32_t  public_ip_addr    = args->public_ip_addr;
+	uint16_t  number_of_entries = args->number_of_entries;
+	uint32_t* tbl_hdl_ptr       = args->tbl_hdl;
+
+	uint32_t tbl_hdl;
+
+	int ret;
+
+	UNUSED(tbl_hdl_ptr);
+
+	IPADBG("In\n");
+
+	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
+	nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
+
+	ret = nati_hdls_create(&nati_obj_ptr->hdls);
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	ret = _smAddSramTbl(nati_obj_ptr, trigger, arb_data_ptr);
+
+	if ( ret == 0 )
+	{
+		if ( nati_obj_ptr->tot_slots_in_sram >= number_of_entries )
+		{
+			/*
+			 * The number of slots in SRAM can accommodate what was
+			 * being requested for DDR, hence no need to use DDR and
+			 * we will continue by using SRAM only...
+			 */
+			SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_SRAM_ONLY);
+		}
+		else
+		{
+			/*
+			 * SRAM not big enough. Let's create secondary DDR based
+			 * table...
+			 */
+			table_add_args new_args = {
+				.public_ip_addr    = public_ip_addr,
+				.number_of_entries = number_of_entries,
+				.tbl_hdl           = &tbl_hdl,  /* to protect app's table handle above */
+			};
+
+			ret = _smAddDdrTbl(nati_obj_ptr, trigger, (void*) &new_args);
+
+			if ( ret == 0 )
+			{
+				/*
+				 * The following will tell the IPA to change focus to
+				 * SRAM...
+				 */
+				ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_SRAM, 0);
+			}
+		}
+	}
+	else
+	{
+		/*
+		 * SRAM table creation in HYBRID mode failed.  Can we fall
+		 * back to DDR only?  We need to try and see what happens...
+		 */
+		ret = _smAddDdrTbl(nati_obj_ptr, trigger, arb_data_ptr);
+
+		if ( ret == 0 )
+		{
+			SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_DDR_ONLY);
+		}
+	}
+
+	if ( ret != 0 || nati_obj_ptr->curr_state == NATI_STATE_SRAM_ONLY )
+	{
+		/*
+		 * Stable handles are only needed when rules can move...
+		 */
+		nati_hdls_destroy(&nati_obj_ptr->hdls);
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smDelSramAndDdrTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the destruction of the SRAM, then DDR
+ *   based NAT tables.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smDelSramAndDdrTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
+	nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
+
+	nati_hdls_destroy(&nati_obj_ptr->hdls);
+
+	ret = _smDelTbl(nati_obj_ptr, trigger, arb_data_ptr);
+
+	if ( ret == 0 )
+	{
+		table_del_args new_args = {
+			.tbl_hdl = nati_obj_ptr->ddr_tbl_hdl,
+		};
+
+		ret = _smDelTbl(nati_obj_ptr, trigger, (void*) &new_args);
+	}
+
+	if ( ret == 0 )
+	{
+		/*
+		 * The following will create the preferred "initial state" for
+		 * restart...
+		 */
+		BACK2_UNSTARTED_STATE();
+	}
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smClrTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the clearing of a table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smClrTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_clear_args* args = (table_clear_args*) arb_data_ptr;
+
+	uint32_t tbl_hdl = args->tbl_hdl;
+
+	enum ipa3_nat_mem_in nmi;
+	uint32_t             unused_hdl, sub;
+
+	int ret;
+
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, unused_hdl);
+
+	unused_hdl++; /* to avoid compiler usage warning */
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
+		IPAERR("Bad cache type\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	sub = (nmi == IPA_NAT_MEM_IN_SRAM) ? SRAM_SUB : DDR_SUB;
+
+	nati_obj_ptr->tot_rules_in_table[sub] = 0;
+
+	ret = ipa_NATI_clear_ipv4_tbl(tbl_hdl);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smClrTblHybrid
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the clearing of the appropriate hybrid
+ *   table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smClrTblHybrid(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_clear_args* args = (table_clear_args*) arb_data_ptr;
+
+	uint32_t tbl_hdl = args->tbl_hdl;
+
+	table_clear_args new_args = {
+		.tbl_hdl =
+		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		    tbl_hdl :
+		    nati_obj_ptr->ddr_tbl_hdl,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = _smClrTbl(nati_obj_ptr, trigger, (void*) &new_args);
+
+	if ( ret == 0 )
+	{
+		nati_hdls_reset(&nati_obj_ptr->hdls);
+	}
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smWalkTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the walk of a table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smWalkTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_walk_args* args = (table_walk_args*) arb_data_ptr;
+
+	uint32_t          tbl_hdl = args->tbl_hdl;
+	WhichTbl2Use      which   = args->which;
+	ipa_table_walk_cb walk_cb = args->walk_cb;
+	void*             wadp    = args->arb_data_ptr;
+
+	int ret;
+
+	UNUSED(nati_obj_ptr);
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+
+	ret = ipa_NATI_walk_ipv4_tbl(tbl_hdl, which, walk_cb, wadp);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smWalkTblHybrid
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the walk of the appropriate hybrid
+ *   table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smWalkTblHybrid(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_walk_args* args = (table_walk_args*) arb_data_ptr;
+
+	uint32_t          tbl_hdl = args->tbl_hdl;
+	WhichTbl2Use      which   = args->which;
+	ipa_table_walk_cb walk_cb = args->walk_cb;
+	void*             wadp    = args->arb_data_ptr;
+
+	table_walk_args new_args = {
+		.tbl_hdl =
+		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		    tbl_hdl :
+		    nati_obj_ptr->ddr_tbl_hdl,
+		.which        = which,
+		.walk_cb      = walk_cb,
+		.arb_data_ptr = wadp,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = _smWalkTbl(nati_obj_ptr, trigger, (void*) &new_args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smStatTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will get size/usage stats for a table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smStatTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_stats_args* args = (table_stats_args*) arb_data_ptr;
+
+	uint32_t            tbl_hdl       = args->tbl_hdl;
+	ipa_nati_tbl_stats* nat_stats_ptr = args->nat_stats_ptr;
+	ipa_nati_tbl_stats* idx_stats_ptr = args->idx_stats_ptr;
+
+	int ret;
+
+	UNUSED(nati_obj_ptr);
+	UNUSED(trigger);
+
+	IPADBG("In\n");
+
+	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+
+	ret = ipa_NATI_ipv4_tbl_stats(tbl_hdl, nat_stats_ptr, idx_stats_ptr);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smStatTblHybrid
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will cause the retrieval of table size/usage stats
+ *   for the appropriate hybrid table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smStatTblHybrid(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	table_stats_args* args = (table_stats_args*) arb_data_ptr;
+
+	uint32_t            tbl_hdl       = args->tbl_hdl;
+	ipa_nati_tbl_stats* nat_stats_ptr = args->nat_stats_ptr;
+	ipa_nati_tbl_stats* idx_stats_ptr = args->idx_stats_ptr;
 
-	if ( ret != 0 )
-	{
-		IPAERR("%s: ipa_nat_map_add(dst_orig2new_map) fail\n", mig_dir_ptr);
-		goto bail;
-	}
+	table_stats_args new_args = {
+		.tbl_hdl =
+		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		    tbl_hdl :
+		    nati_obj_ptr->ddr_tbl_hdl,
+		.nat_stats_ptr = nat_stats_ptr,
+		.idx_stats_ptr = idx_stats_ptr,
+	};
 
-	ret = ipa_nat_map_add(dst_new2orig_map, new_rule_hdl, orig_rule_hdl);
+	int ret;
 
-	if ( ret != 0 )
-	{
-		IPAERR("%s: ipa_nat_map_add(dst_new2orig_map) fail\n", mig_dir_ptr);
-		goto bail;
-	}
+	IPADBG("In\n");
 
-	IPADBG("orig_rule_hdl(0x%08X) new_rule_hdl(0x%08X)\n",
-		   orig_rule_hdl, new_rule_hdl);
+	ret = _smStatTbl(nati_obj_ptr, trigger, (void*) &new_args);
 
-bail:
 	IPADBG("Out\n");
 
 	return ret;
 }
 
-/*
- * ****************************************************************************
- *
- * STATE MACHINE CODE BEGINS HERE
- *
- * ****************************************************************************
- */
-static int _smUndef(
-	ipa_nati_obj*    nati_obj_ptr,
-	ipa_nati_trigger trigger,
-	void*            arb_data_ptr ); /* forward declaration */
-
 /******************************************************************************/
 /*
- * FUNCTION: _smDelTbl
+ * FUNCTION: _smAddRuleToTbl
  *
  * PARAMS:
  *
@@ -799,40 +2414,50 @@ static int _smUndef(
  *
  * DESCRIPTION:
  *
- *   The following will cause the destruction of the DDR based NAT
- *   table.
+ *   The following will cause the addtion of a NAT rule into the DDR
+ *   based table.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smDelTbl(
+static int _smAddRuleToTbl(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_del_args* args = (table_del_args*) arb_data_ptr;
+	rule_add_args* args = (rule_add_args*) arb_data_ptr;
 
-	uint32_t tbl_hdl = args->tbl_hdl;
+	uint32_t           tbl_hdl   = args->tbl_hdl;
+	ipa_nat_ipv4_rule* clnt_rule = (ipa_nat_ipv4_rule*) args->clnt_rule;
+	uint32_t*          rule_hdl  = args->rule_hdl;
+
+	char buf[1024];
 
 	int ret;
 
+	UNUSED(buf);
 	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+	IPADBG("tbl_hdl(0x%08X) clnt_rule_ptr(%p) rule_hdl_ptr(%p) %s\n",
+		   tbl_hdl, clnt_rule, rule_hdl,
+		   prep_nat_ipv4_rule_4print(clnt_rule, buf, sizeof(buf)));
 
-	ret = ipa_NATI_del_ipv4_table(tbl_hdl);
+	clnt_rule->redirect = clnt_rule->enable = clnt_rule->time_stamp = 0;
 
-	if ( ret == 0 && ! IN_HYBRID_STATE() )
+	ret = ipa_NATI_add_ipv4_rule(tbl_hdl, clnt_rule, rule_hdl);
+
+	if ( ret == 0 )
 	{
-		/*
-		 * The following will create the preferred "initial state" for
-		 * restart...
-		 */
-		BACK2_UNSTARTED_STATE();
+		uint32_t* cnt_ptr = CHOOSE_CNTR();
+
+		(*cnt_ptr)++;
+
+		IPADBG("rule_hdl value(%u or 0x%08X)\n",
+			   *rule_hdl, *rule_hdl);
 	}
 
 	IPADBG("Out\n");
@@ -842,7 +2467,7 @@ static int _smDelTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smFirstTbl
+ * FUNCTION: _smDelRuleFromTbl
  *
  * PARAMS:
  *
@@ -854,39 +2479,40 @@ static int _smDelTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the creation of the very first NAT table(s)
- *   before any others have ever been created...
+ *   The following will cause the deletion of a NAT rule from the DDR
+ *   based table.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smFirstTbl(
+static int _smDelRuleFromTbl(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
-	void*           arb_data_ptr )
+	void*            arb_data_ptr )
 {
-	table_add_args* args = (table_add_args*) arb_data_ptr;
+	rule_del_args* args  = (rule_del_args*) arb_data_ptr;
 
-	const char* mem_type_ptr    = args->mem_type_ptr;
+	uint32_t tbl_hdl  = args->tbl_hdl;
+	uint32_t rule_hdl = args->rule_hdl;
 
 	int ret;
 
+	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
 
 	IPADBG("In\n");
 
-	/*
-	 * This is the first time in here.  Let the ipacm's XML config (or
-	 * state_to_hold) drive initial state...
-	 */
-	SET_NATIOBJ_STATE(
-		nati_obj_ptr,
-		(nati_obj_ptr->hold_state && nati_obj_ptr->state_to_hold) ?
-		nati_obj_ptr->state_to_hold                               :
-		mem_type_str_to_ipa_nati_state(mem_type_ptr));
+	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u)\n", tbl_hdl, rule_hdl);
 
-	ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_ADD_TABLE, arb_data_ptr);
+	ret = ipa_NATI_del_ipv4_rule(tbl_hdl, rule_hdl);
+
+	if ( ret == 0 )
+	{
+		uint32_t* cnt_ptr = CHOOSE_CNTR();
+
+		(*cnt_ptr)--;
+	}
 
 	IPADBG("Out\n");
 
@@ -895,7 +2521,7 @@ static int _smFirstTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smAddDdrTbl
+ * FUNCTION: _smAddRuleHybrid
  *
  * PARAMS:
  *
@@ -907,44 +2533,97 @@ static int _smFirstTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the creation of a NAT table in DDR.
+ *   The following will cause the addition of a NAT rule into either
+ *   the SRAM or DDR based table.
+ *
+ *   *** !!! HOWEVER *** REMEMBER !!! ***
+ *
+ *   We're here because we're in a HYBRID state...with the potential
+ *   moving between SRAM and DDR.  THIS HAS IMLICATIONS AS IT RELATES
+ *   TO RULE MAPPING.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smAddDdrTbl(
+static int _smAddRuleHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_add_args* args = (table_add_args*) arb_data_ptr;
+	rule_add_args* args = (rule_add_args*) arb_data_ptr;
 
-	uint32_t  public_ip_addr    = args->public_ip_addr;
-	uint16_t  number_of_entries = args->number_of_entries;
-	uint32_t* tbl_hdl_ptr       = args->tbl_hdl;
+	uint32_t           tbl_hdl   = args->tbl_hdl;
+	ipa_nat_ipv4_rule* clnt_rule = (ipa_nat_ipv4_rule*) args->clnt_rule;
+	uint32_t*          rule_hdl  = args->rule_hdl;
 
-	int ret;
+	rule_add_args new_args = {
+		.tbl_hdl =
+		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		    tbl_hdl :
+		    nati_obj_ptr->ddr_tbl_hdl,
+		.clnt_rule = clnt_rule,
+		.rule_hdl  = rule_hdl,
+	};
 
-	UNUSED(trigger);
+	int ret;
 
 	IPADBG("In\n");
 
-	IPADBG("public_ip_addr(0x%08X) number_of_entries(%u) tbl_hdl_ptr(%p)\n",
-		   public_ip_addr, number_of_entries, tbl_hdl_ptr);
-
-	ret = ipa_NATI_add_ipv4_tbl(
-		IPA_NAT_MEM_IN_DDR,
-		public_ip_addr,
-		number_of_entries,
-		&nati_obj_ptr->ddr_tbl_hdl);
+	ret = _smAddRuleToTbl(nati_obj_ptr, trigger, (void*) &new_args);
 
 	if ( ret == 0 )
 	{
-		*tbl_hdl_ptr = nati_obj_ptr->ddr_tbl_hdl;
+		/*
+		 * The application is handed a stable handle rather than the
+		 * real one, since the rule can and will move between SRAM and
+		 * DDR.  See STABLE RULE HANDLES above...
+		 */
+		ret = nati_hdl_alloc(&nati_obj_ptr->hdls, *rule_hdl, rule_hdl);
+	}
+	else
+	{
+		if ( nati_obj_ptr->curr_state == NATI_STATE_HYBRID
+			 &&
+			 ! nati_obj_ptr->hold_state )
+		{
+			/*
+			 * In hybrid mode, we always start in SRAM...hence
+			 * NATI_STATE_HYBRID implies SRAM.  The rule addition
+			 * above did not work, meaning the SRAM table is full,
+			 * hence let's jump to DDR...
+			 *
+			 * The following will focus us on DDR and cause the copy
+			 * of data from SRAM to DDR.
+			 */
+			IPAINFO("Add of rule failed...attempting table switch\n");
 
-		IPADBG("DDR table creation successful: tbl_hdl(0x%08X)\n",
-			   *tbl_hdl_ptr);
+			ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
+
+			if ( ret == 0 )
+			{
+				SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID_DDR);
+
+				/*
+				 * Now add the rule to DDR...
+				 */
+				ret = ipa_nati_statemach(nati_obj_ptr, trigger, arb_data_ptr);
+			}
+		}
+		else if ( DDR_CURRENTLY_ACTIVE() )
+		{
+			/*
+			 * DDR is as far as the rule can go, so make room there
+			 * and try again.  Should the table not be full, or have
+			 * grown as far as it can, the add's failure stands...
+			 */
+			IPAINFO("Add of rule failed...attempting to grow DDR table\n");
+
+			if ( ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_GROW, 0) == 0 )
+			{
+				ret = ipa_nati_statemach(nati_obj_ptr, trigger, arb_data_ptr);
+			}
+		}
 	}
 
 	IPADBG("Out\n");
@@ -954,7 +2633,7 @@ static int _smAddDdrTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smAddSramTbl
+ * FUNCTION: _smAddRulesToTbl
  *
  * PARAMS:
  *
@@ -966,86 +2645,55 @@ static int _smAddDdrTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the creation of a NAT table in SRAM.
+ *   The bulk version of _smAddRuleToTbl.  A rule's handle is left at
+ *   zero when the rule could not be added.
  *
  * RETURNS:
  *
- *   zero on success, otherwise non-zero
+ *   zero when all rules were added, otherwise non-zero
  */
-static int _smAddSramTbl(
+static int _smAddRulesToTbl(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_add_args* args = (table_add_args*) arb_data_ptr;
+	rules_add_args* args = (rules_add_args*) arb_data_ptr;
 
-	uint32_t  public_ip_addr    = args->public_ip_addr;
-	uint16_t  number_of_entries = args->number_of_entries;
-	uint32_t* tbl_hdl_ptr       = args->tbl_hdl;
+	uint32_t           tbl_hdl    = args->tbl_hdl;
+	ipa_nat_ipv4_rule* clnt_rules = (ipa_nat_ipv4_rule*) args->clnt_rules;
+	uint32_t           num_rules  = args->num_rules;
+	uint32_t*          rule_hdls  = args->rule_hdls;
 
-	uint32_t  sram_size = 0;
+	uint32_t* cnt_ptr = CHOOSE_CNTR();
+	uint32_t  i;
 
 	int ret;
 
-	UNUSED(number_of_entries);
+	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
 
 	IPADBG("In\n");
 
-	IPADBG("public_ip_addr(0x%08X) tbl_hdl_ptr(%p)\n",
-		   public_ip_addr, tbl_hdl_ptr);
-
-	ret = ipa_nati_get_sram_size(&sram_size);
+	IPADBG("tbl_hdl(0x%08X) clnt_rules_ptr(%p) num_rules(%u) rule_hdls_ptr(%p)\n",
+		   tbl_hdl, clnt_rules, num_rules, rule_hdls);
 
-	if ( ret == 0 )
+	for ( i = 0; i < num_rules; i++ )
 	{
-		ret = ipa_calc_num_sram_table_entries(
-			sram_size,
-			sizeof(struct ipa_nat_rule),
-			sizeof(struct ipa_nat_indx_tbl_rule),
-			(uint16_t*) &nati_obj_ptr->tot_slots_in_sram);
-
-		if ( ret == 0 )
-		{
-			nati_obj_ptr->back_to_sram_thresh =
-				PRCNT_OF(nati_obj_ptr->tot_slots_in_sram);
-
-			IPADBG("sram_size(%u or 0x%x) tot_slots_in_sram(%u) back_to_sram_thresh(%u)\n",
-				   sram_size,
-				   sram_size,
-				   nati_obj_ptr->tot_slots_in_sram,
-				   nati_obj_ptr->back_to_sram_thresh);
-
-			IPADBG("Voting clock on for sram table creation\n");
-
-			if ( (ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE)) != 0 )
-			{
-				IPAERR("Voting clock on failed\n");
-				goto done;
-			}
-
-			ret = ipa_NATI_add_ipv4_tbl(
-				IPA_NAT_MEM_IN_SRAM,
-				public_ip_addr,
-				nati_obj_ptr->tot_slots_in_sram,
-				&nati_obj_ptr->sram_tbl_hdl);
-
-			if ( ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != 0 )
-			{
-				IPAWARN("Voting clock off failed\n");
-			}
+		clnt_rules[i].redirect   = 0;
+		clnt_rules[i].enable     = 0;
+		clnt_rules[i].time_stamp = 0;
+	}
 
-			if ( ret == 0 )
-			{
-				*tbl_hdl_ptr = nati_obj_ptr->sram_tbl_hdl;
+	ret = ipa_NATI_add_ipv4_rules(tbl_hdl, clnt_rules, num_rules, rule_hdls);
 
-				IPADBG("SRAM table creation successful: tbl_hdl(0x%08X)\n",
-					   *tbl_hdl_ptr);
-			}
+	for ( i = 0; i < num_rules; i++ )
+	{
+		if ( rule_hdls[i] )
+		{
+			(*cnt_ptr)++;
 		}
 	}
 
-done:
 	IPADBG("Out\n");
 
 	return ret;
@@ -1053,7 +2701,7 @@ done:
 
 /******************************************************************************/
 /*
- * FUNCTION: _smAddSramAndDdrTbl
+ * FUNCTION: _smAddRulesHybrid
  *
  * PARAMS:
  *
@@ -1065,91 +2713,140 @@ done:
  *
  * DESCRIPTION:
  *
- *   The following will cause the creation of NAT tables in both DDR
- *   and in SRAM.
+ *   The bulk version of _smAddRuleHybrid.  Rules that don't fit into
+ *   SRAM cause a switch to DDR, after which only those rules are
+ *   retried.
  *
  * RETURNS:
  *
- *   zero on success, otherwise non-zero
+ *   zero when all rules were added, otherwise non-zero
  */
-static int _smAddSramAndDdrTbl(
+static int _smAddRulesHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_add_args* args = (table_add_args*) arb_data_ptr;
+	rules_add_args* args = (rules_add_args*) arb_data_ptr;
 
-	uint32_t  public_ip_addr    = args->public_ip_addr;
-	uint16_t  number_of_entries = args->number_of_entries;
-	uint32_t* tbl_hdl_ptr       = args->tbl_hdl;
+	rules_add_args new_args = {
+		.tbl_hdl =
+		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		    args->tbl_hdl :
+		    nati_obj_ptr->ddr_tbl_hdl,
+		.clnt_rules = args->clnt_rules,
+		.num_rules  = args->num_rules,
+		.rule_hdls  = args->rule_hdls,
+	};
 
-	uint32_t tbl_hdl;
+	rules_add_args retry_args;
 
-	int ret;
+	uint32_t i, num_failed;
 
-	UNUSED(tbl_hdl_ptr);
+	int ret, map_ret;
 
 	IPADBG("In\n");
 
-	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
-	nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
-
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].orig2new_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].new2orig_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].orig2new_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].new2orig_map);
-
-	ret = _smAddSramTbl(nati_obj_ptr, trigger, arb_data_ptr);
+	ret = _smAddRulesToTbl(nati_obj_ptr, trigger, (void*) &new_args);
 
-	if ( ret == 0 )
+	/*
+	 * See _smAddRuleHybrid for why handles are swapped...
+	 */
+	for ( i = num_failed = 0; i < args->num_rules; i++ )
 	{
-		if ( nati_obj_ptr->tot_slots_in_sram >= number_of_entries )
+		if ( ! args->rule_hdls[i] )
 		{
-			/*
-			 * The number of slots in SRAM can accommodate what was
-			 * being requested for DDR, hence no need to use DDR and
-			 * we will continue by using SRAM only...
-			 */
-			SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_SRAM_ONLY);
+			num_failed++;
+			continue;
 		}
-		else
-		{
-			/*
-			 * SRAM not big enough. Let's create secondary DDR based
-			 * table...
-			 */
-			table_add_args new_args = {
-				.public_ip_addr    = public_ip_addr,
-				.number_of_entries = number_of_entries,
-				.tbl_hdl           = &tbl_hdl,  /* to protect app's table handle above */
-			};
 
-			ret = _smAddDdrTbl(nati_obj_ptr, trigger, (void*) &new_args);
+		map_ret = nati_hdl_alloc(
+			&nati_obj_ptr->hdls, args->rule_hdls[i], &args->rule_hdls[i]);
 
-			if ( ret == 0 )
-			{
-				/*
-				 * The following will tell the IPA to change focus to
-				 * SRAM...
-				 */
-				ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_SRAM, 0);
-			}
+		if ( map_ret != 0 )
+		{
+			ret = map_ret;
 		}
 	}
-	else
+
+	if ( num_failed
+		 &&
+		 ((nati_obj_ptr->curr_state == NATI_STATE_HYBRID
+		   &&
+		   ! nati_obj_ptr->hold_state)
+		  ||
+		  DDR_CURRENTLY_ACTIVE()) )
 	{
 		/*
-		 * SRAM table creation in HYBRID mode failed.  Can we fall
-		 * back to DDR only?  We need to try and see what happens...
+		 * As in _smAddRuleHybrid, SRAM overflows to DDR, and DDR
+		 * grows...
 		 */
-		ret = _smAddDdrTbl(nati_obj_ptr, trigger, arb_data_ptr);
+		ipa_nati_trigger fix_trigger =
+			DDR_CURRENTLY_ACTIVE() ?
+			NATI_TRIG_TBL_GROW     :
+			NATI_TRIG_TBL_SWITCH;
+
+		ipa_nat_ipv4_rule* failed_rules;
+		uint32_t*          failed_hdls;
+		uint32_t           j;
+
+		IPAINFO("Add of %u rules failed...attempting %s\n",
+				num_failed,
+				(fix_trigger == NATI_TRIG_TBL_GROW) ?
+				"to grow DDR table" : "table switch");
+
+		failed_rules = calloc(num_failed, sizeof(ipa_nat_ipv4_rule));
+		failed_hdls  = calloc(num_failed, sizeof(uint32_t));
+
+		if ( ! failed_rules || ! failed_hdls )
+		{
+			IPAERR("Unable to allocate retry list of %u rules\n", num_failed);
+			free(failed_rules);
+			free(failed_hdls);
+			ret = -ENOMEM;
+			goto bail;
+		}
+
+		for ( i = j = 0; i < args->num_rules; i++ )
+		{
+			if ( ! args->rule_hdls[i] )
+			{
+				failed_rules[j++] = args->clnt_rules[i];
+			}
+		}
+
+		ret = ipa_nati_statemach(nati_obj_ptr, fix_trigger, 0);
 
 		if ( ret == 0 )
 		{
-			SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_DDR_ONLY);
+			if ( fix_trigger == NATI_TRIG_TBL_SWITCH )
+			{
+				SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID_DDR);
+			}
+
+			retry_args.tbl_hdl    = args->tbl_hdl;
+			retry_args.clnt_rules = failed_rules;
+			retry_args.num_rules  = num_failed;
+			retry_args.rule_hdls  = failed_hdls;
+
+			/*
+			 * Now add the leftovers to DDR (or the grown DDR)...
+			 */
+			ret = ipa_nati_statemach(nati_obj_ptr, trigger, (void*) &retry_args);
+
+			for ( i = j = 0; i < args->num_rules; i++ )
+			{
+				if ( ! args->rule_hdls[i] )
+				{
+					args->rule_hdls[i] = failed_hdls[j++];
+				}
+			}
 		}
+
+		free(failed_rules);
+		free(failed_hdls);
 	}
 
+bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -1157,7 +2854,7 @@ static int _smAddSramAndDdrTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smDelSramAndDdrTbl
+ * FUNCTION: _smDelRuleHybrid
  *
  * PARAMS:
  *
@@ -1169,48 +2866,102 @@ static int _smAddSramAndDdrTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the destruction of the SRAM, then DDR
- *   based NAT tables.
+ *   The following will cause the deletion of a NAT rule from either
+ *   the SRAM or DDR based table.
+ *
+ *   *** !!! HOWEVER *** REMEMBER !!! ***
+ *
+ *   We're here because we're in a HYBRID state...with the potential
+ *   moving between SRAM and DDR.  THIS HAS IMLICATIONS AS IT RELATES
+ *   TO RULE MAPPING.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smDelSramAndDdrTbl(
+static int _smDelRuleHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	int ret;
+	rule_del_args* args = (rule_del_args*) arb_data_ptr;
 
-	IPADBG("In\n");
+	uint32_t tbl_hdl       = args->tbl_hdl;
+	uint32_t orig_rule_hdl = args->rule_hdl;
 
-	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
-	nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
+	uint32_t new_rule_hdl;
 
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].orig2new_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].new2orig_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].orig2new_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].new2orig_map);
+	int      ret;
 
-	ret = _smDelTbl(nati_obj_ptr, trigger, arb_data_ptr);
+	IPADBG("In\n");
+
+	/*
+	 * The application knows the rule by its stable handle.  Swap it
+	 * for the rule's real handle in the memory currently in use, and
+	 * release it.  See STABLE RULE HANDLES above...
+	 */
+	ret = nati_hdl_free(
+		&nati_obj_ptr->hdls, CHOOSE_MEM_SUB(), orig_rule_hdl, &new_rule_hdl);
 
 	if ( ret == 0 )
 	{
-		table_del_args new_args = {
-			.tbl_hdl = nati_obj_ptr->ddr_tbl_hdl,
+		rule_del_args new_args = {
+			.tbl_hdl =
+			  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+			    tbl_hdl :
+			    nati_obj_ptr->ddr_tbl_hdl,
+			.rule_hdl = new_rule_hdl,
 		};
 
-		ret = _smDelTbl(nati_obj_ptr, trigger, (void*) &new_args);
-	}
+		IPADBG("orig_rule_hdl(0x%08X) -> new_rule_hdl(0x%08X)\n",
+			   orig_rule_hdl, new_rule_hdl);
 
-	if ( ret == 0 )
-	{
-		/*
-		 * The following will create the preferred "initial state" for
-		 * restart...
-		 */
-		BACK2_UNSTARTED_STATE();
+		ret = _smDelRuleFromTbl(nati_obj_ptr, trigger, (void*) &new_args);
+
+		if ( ret == 0 && nati_obj_ptr->curr_state == NATI_STATE_HYBRID_DDR )
+		{
+			/*
+			 * We need to check when/if we can go back to SRAM.
+			 *
+			 * How/why can we go back?
+			 *
+			 *   Given enough deletions, and when we get to a user
+			 *   defined threshold (ie. a percentage of what SRAM can
+			 *   hold), we can pop back to using SRAM.
+			 */
+			uint32_t* cnt_ptr = CHOOSE_CNTR();
+
+			if ( *cnt_ptr <= nati_obj_ptr->back_to_sram_thresh
+				 &&
+				 ! nati_obj_ptr->hold_state )
+			{
+				/*
+				 * The following will focus us on SRAM and cause the copy
+				 * of data from DDR to SRAM.
+				 */
+				IPAINFO("Switch back to SRAM threshold has been reached -> "
+						"Total rules in DDR(%u) <= SRAM THRESH(%u)\n",
+						*cnt_ptr,
+						nati_obj_ptr->back_to_sram_thresh);
+
+				ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
+
+				if ( ret == 0 )
+				{
+					SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
+				}
+				else
+				{
+					/*
+					 * The following will force us stay in DDR for
+					 * now, but the next delete will trigger the
+					 * switch logic above to run again...perhaps it
+					 * will work then.
+					 */
+					ret = 0;
+				}
+			}
+		}
 	}
 
 	IPADBG("Out\n");
@@ -1220,7 +2971,7 @@ static int _smDelSramAndDdrTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smClrTbl
+ * FUNCTION: _smDelRulesFromTbl
  *
  * PARAMS:
  *
@@ -1232,52 +2983,37 @@ static int _smDelSramAndDdrTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the clearing of a table.
+ *   The bulk version of _smDelRuleFromTbl.
  *
  * RETURNS:
  *
- *   zero on success, otherwise non-zero
+ *   zero when all rules were deleted, otherwise non-zero
  */
-static int _smClrTbl(
+static int _smDelRulesFromTbl(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_clear_args* args = (table_clear_args*) arb_data_ptr;
+	rules_del_args* args = (rules_del_args*) arb_data_ptr;
 
-	uint32_t tbl_hdl = args->tbl_hdl;
-
-	enum ipa3_nat_mem_in nmi;
-	uint32_t             unused_hdl, sub;
+	uint32_t* cnt_ptr     = CHOOSE_CNTR();
+	uint32_t  num_deleted = 0;
 
 	int ret;
 
+	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
-
-	BREAK_TBL_HDL(tbl_hdl, nmi, unused_hdl);
-
-	unused_hdl++; /* to avoid compiler usage warning */
-
-	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ) {
-		IPAERR("Bad cache type\n");
-		ret = -EINVAL;
-		goto bail;
-	}
-
-	sub = (nmi == IPA_NAT_MEM_IN_SRAM) ? SRAM_SUB : DDR_SUB;
-
-	nati_obj_ptr->tot_rules_in_table[sub] = 0;
+	IPADBG("tbl_hdl(0x%08X) rule_hdls_ptr(%p) num_rules(%u)\n",
+		   args->tbl_hdl, args->rule_hdls, args->num_rules);
 
-	ipa_nat_map_clear(nati_obj.map_pairs[sub].orig2new_map);
-	ipa_nat_map_clear(nati_obj.map_pairs[sub].new2orig_map);
+	ret = ipa_NATI_del_ipv4_rules(
+		args->tbl_hdl, args->rule_hdls, args->num_rules, &num_deleted);
 
-	ret = ipa_NATI_clear_ipv4_tbl(tbl_hdl);
+	*cnt_ptr -= num_deleted;
 
-bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -1285,7 +3021,7 @@ bail:
 
 /******************************************************************************/
 /*
- * FUNCTION: _smClrTblHybrid
+ * FUNCTION: _smDelRulesHybrid
  *
  * PARAMS:
  *
@@ -1297,35 +3033,100 @@ bail:
  *
  * DESCRIPTION:
  *
- *   The following will cause the clearing of the appropriate hybrid
- *   table.
+ *   The bulk version of _smDelRuleHybrid.  The original handles are
+ *   mapped to their current ones, and the switch back to SRAM is
+ *   considered once, after all the deletes.
  *
  * RETURNS:
  *
- *   zero on success, otherwise non-zero
+ *   zero when all rules were deleted, otherwise non-zero
  */
-static int _smClrTblHybrid(
+static int _smDelRulesHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_clear_args* args = (table_clear_args*) arb_data_ptr;
+	rules_del_args* args = (rules_del_args*) arb_data_ptr;
 
-	uint32_t tbl_hdl = args->tbl_hdl;
+	uint32_t* new_rule_hdls;
+	uint32_t  num_mapped;
 
-	table_clear_args new_args = {
-		.tbl_hdl =
-		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-		    tbl_hdl :
-		    nati_obj_ptr->ddr_tbl_hdl,
-	};
+	uint32_t i;
 
-	int ret;
+	int ret = 0, map_ret;
 
 	IPADBG("In\n");
 
-	ret = _smClrTbl(nati_obj_ptr, trigger, (void*) &new_args);
+	new_rule_hdls = calloc(args->num_rules, sizeof(uint32_t));
+
+	if ( ! new_rule_hdls )
+	{
+		IPAERR("Unable to allocate map list of %u rules\n", args->num_rules);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	/*
+	 * See _smDelRuleHybrid for why handles are swapped...
+	 */
+	for ( i = num_mapped = 0; i < args->num_rules; i++ )
+	{
+		map_ret = nati_hdl_free(
+			&nati_obj_ptr->hdls, CHOOSE_MEM_SUB(), args->rule_hdls[i], &new_rule_hdls[num_mapped]);
+
+		if ( map_ret != 0 )
+		{
+			ret = map_ret;
+			continue;
+		}
+
+		num_mapped++;
+	}
+
+	if ( num_mapped )
+	{
+		rules_del_args new_args = {
+			.tbl_hdl =
+			  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+			    args->tbl_hdl :
+			    nati_obj_ptr->ddr_tbl_hdl,
+			.rule_hdls = new_rule_hdls,
+			.num_rules = num_mapped,
+		};
+
+		uint32_t* cnt_ptr;
+
+		map_ret = _smDelRulesFromTbl(nati_obj_ptr, trigger, (void*) &new_args);
+
+		ret = (map_ret) ? map_ret : ret;
+
+		cnt_ptr = CHOOSE_CNTR();
+
+		if ( nati_obj_ptr->curr_state == NATI_STATE_HYBRID_DDR
+			 &&
+			 *cnt_ptr <= nati_obj_ptr->back_to_sram_thresh
+			 &&
+			 ! nati_obj_ptr->hold_state )
+		{
+			IPAINFO("Switch back to SRAM threshold has been reached -> "
+					"Total rules in DDR(%u) <= SRAM THRESH(%u)\n",
+					*cnt_ptr,
+					nati_obj_ptr->back_to_sram_thresh);
+
+			/*
+			 * As in _smDelRuleHybrid, a failed switch keeps us in
+			 * DDR until a later delete tries again...
+			 */
+			if ( ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0) == 0 )
+			{
+				SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
+			}
+		}
+	}
+
+	free(new_rule_hdls);
 
+bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -1333,7 +3134,7 @@ static int _smClrTblHybrid(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smWalkTbl
+ * FUNCTION: _smGoToDdr
  *
  * PARAMS:
  *
@@ -1345,34 +3146,31 @@ static int _smClrTblHybrid(
  *
  * DESCRIPTION:
  *
- *   The following will cause the walk of a table.
+ *   The following will cause the IPA to use the DDR based NAT
+ *   table...
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smWalkTbl(
+static int _smGoToDdr(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_walk_args* args = (table_walk_args*) arb_data_ptr;
-
-	uint32_t          tbl_hdl = args->tbl_hdl;
-	WhichTbl2Use      which   = args->which;
-	ipa_table_walk_cb walk_cb = args->walk_cb;
-	void*             wadp    = args->arb_data_ptr;
-
 	int ret;
 
-	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
+	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+	ret = ipa_NATI_post_ipv4_init_cmd(nati_obj_ptr->ddr_tbl_hdl);
 
-	ret = ipa_NATI_walk_ipv4_tbl(tbl_hdl, which, walk_cb, wadp);
+	if ( ret == 0 )
+	{
+		SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID_DDR);
+	}
 
 	IPADBG("Out\n");
 
@@ -1381,7 +3179,7 @@ static int _smWalkTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smWalkTblHybrid
+ * FUNCTION: _smGoToSram
  *
  * PARAMS:
  *
@@ -1393,40 +3191,31 @@ static int _smWalkTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the walk of the appropriate hybrid
- *   table.
+ *   The following will cause the IPA to use the SRAM based NAT
+ *   table...
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smWalkTblHybrid(
+static int _smGoToSram(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_walk_args* args = (table_walk_args*) arb_data_ptr;
-
-	uint32_t          tbl_hdl = args->tbl_hdl;
-	WhichTbl2Use      which   = args->which;
-	ipa_table_walk_cb walk_cb = args->walk_cb;
-	void*             wadp    = args->arb_data_ptr;
-
-	table_walk_args new_args = {
-		.tbl_hdl =
-		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-		    tbl_hdl :
-		    nati_obj_ptr->ddr_tbl_hdl,
-		.which        = which,
-		.walk_cb      = walk_cb,
-		.arb_data_ptr = wadp,
-	};
-
 	int ret;
 
+	UNUSED(trigger);
+	UNUSED(arb_data_ptr);
+
 	IPADBG("In\n");
 
-	ret = _smWalkTbl(nati_obj_ptr, trigger, (void*) &new_args);
+	ret = ipa_NATI_post_ipv4_init_cmd(nati_obj_ptr->sram_tbl_hdl);
+
+	if ( ret == 0 )
+	{
+		SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
+	}
 
 	IPADBG("Out\n");
 
@@ -1435,7 +3224,7 @@ static int _smWalkTblHybrid(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smStatTbl
+ * FUNCTION: _smSwitchFromDdrToSram
  *
  * PARAMS:
  *
@@ -1447,33 +3236,159 @@ static int _smWalkTblHybrid(
  *
  * DESCRIPTION:
  *
- *   The following will get size/usage stats for a table.
+ *   The following will cause a copy of the DDR table to SRAM and then
+ *   will make the IPA use the SRAM...
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smStatTbl(
+static int _smSwitchFromDdrToSram(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_stats_args* args = (table_stats_args*) arb_data_ptr;
+	nati_switch_stats* sw_stats_ptr = CHOOSE_SW_STATS();
 
-	uint32_t            tbl_hdl       = args->tbl_hdl;
-	ipa_nati_tbl_stats* nat_stats_ptr = args->nat_stats_ptr;
-	ipa_nati_tbl_stats* idx_stats_ptr = args->idx_stats_ptr;
+	uint32_t*          cnt_ptr      = CHOOSE_CNTR();
 
-	int ret;
+	ipa_nati_tbl_stats nat_stats, idx_stats;
 
-	UNUSED(nati_obj_ptr);
+	const char*        mem_type;
+
+	uint64_t           start, stop;
+
+	int                stats_ret, ret;
+
+	bool               collect_stats = (bool) arb_data_ptr;
+
+	UNUSED(cnt_ptr);
 	UNUSED(trigger);
+	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X)\n", tbl_hdl);
+	stats_ret = (collect_stats) ?
+		ipa_NATI_ipv4_tbl_stats(
+			nati_obj_ptr->ddr_tbl_hdl, &nat_stats, &idx_stats) :
+		-1;
 
-	ret = ipa_NATI_ipv4_tbl_stats(tbl_hdl, nat_stats_ptr, idx_stats_ptr);
+	currTimeAs(TimeAsNanSecs, &start);
+
+	/*
+	 * Clear destination counter...
+	 */
+	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
+
+	/*
+	 * Now build SRAM from DDR's content.  The IPA is still using DDR,
+	 * so this is done without posting anything to the kernel...
+	 */
+	ret = ipa_nati_copy_ipv4_tbl(
+		nati_obj_ptr->ddr_tbl_hdl,
+		nati_obj_ptr->sram_tbl_hdl,
+		migrate_rule);
+
+	if ( ret == 0 )
+	{
+		/*
+		 * ...and, once complete, switch focus to SRAM
+		 */
+		ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_SRAM, 0);
+	}
+
+	currTimeAs(TimeAsNanSecs, &stop);
+
+	if ( ret == 0 )
+	{
+		sw_stats_ptr->pass += 1;
+
+		IPADBG("Transistion from DDR to SRAM took %f microseconds "
+			   "(%u rules, one focus change)\n",
+			   (float) (stop - start) / 1000.0,
+			   nati_obj_ptr->tot_rules_in_table[SRAM_SUB]);
+	}
+	else
+	{
+		sw_stats_ptr->fail += 1;
+	}
+
+	IPADBG("Transistion pass/fail counts (DDR to SRAM) PASS: %u FAIL: %u\n",
+		   sw_stats_ptr->pass,
+		   sw_stats_ptr->fail);
+
+	if ( stats_ret == 0 )
+	{
+		mem_type = ipa3_nat_mem_in_as_str(nat_stats.nmi);
+
+		/*
+		 * NAT table stats...
+		 */
+		IPADBG("Able to add (%u) records to %s "
+			   "NAT table of size (%u) or (%f) percent\n",
+			   *cnt_ptr,
+			   mem_type,
+			   nat_stats.tot_ents,
+			   ((float) *cnt_ptr / (float) nat_stats.tot_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "NAT BASE table of size (%u) or (%f) percent\n",
+			   nat_stats.tot_base_ents_filled,
+			   mem_type,
+			   nat_stats.tot_base_ents,
+			   ((float) nat_stats.tot_base_ents_filled /
+				(float) nat_stats.tot_base_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "NAT EXPN table of size (%u) or (%f) percent\n",
+			   nat_stats.tot_expn_ents_filled,
+			   mem_type,
+			   nat_stats.tot_expn_ents,
+			   ((float) nat_stats.tot_expn_ents_filled /
+				(float) nat_stats.tot_expn_ents) * 100.0);
+
+		IPADBG("%s NAT table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
+			   mem_type,
+			   nat_stats.tot_chains,
+			   nat_stats.min_chain_len,
+			   nat_stats.max_chain_len,
+			   nat_stats.avg_chain_len);
+
+		/*
+		 * INDEX table stats...
+		 */
+		IPADBG("Able to add (%u) records to %s "
+			   "IDX table of size (%u) or (%f) percent\n",
+			   *cnt_ptr,
+			   mem_type,
+			   idx_stats.tot_ents,
+			   ((float) *cnt_ptr / (float) idx_stats.tot_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "IDX BASE table of size (%u) or (%f) percent\n",
+			   idx_stats.tot_base_ents_filled,
+			   mem_type,
+			   idx_stats.tot_base_ents,
+			   ((float) idx_stats.tot_base_ents_filled /
+				(float) idx_stats.tot_base_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "IDX EXPN table of size (%u) or (%f) percent\n",
+			   idx_stats.tot_expn_ents_filled,
+			   mem_type,
+			   idx_stats.tot_expn_ents,
+			   ((float) idx_stats.tot_expn_ents_filled /
+				(float) idx_stats.tot_expn_ents) * 100.0);
+
+		IPADBG("%s IDX table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
+			   mem_type,
+			   idx_stats.tot_chains,
+			   idx_stats.min_chain_len,
+			   idx_stats.max_chain_len,
+			   idx_stats.avg_chain_len);
+
+		mem_type++; /* to avoid compiler usage warning */
+	}
 
 	IPADBG("Out\n");
 
@@ -1482,7 +3397,7 @@ static int _smStatTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smStatTblHybrid
+ * FUNCTION: _smSwitchFromSramToDdr
  *
  * PARAMS:
  *
@@ -1494,38 +3409,159 @@ static int _smStatTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the retrieval of table size/usage stats
- *   for the appropriate hybrid table.
+ *   The following will cause a copy of the SRAM table to DDR and then
+ *   will make the IPA use the DDR...
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smStatTblHybrid(
+static int _smSwitchFromSramToDdr(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	table_stats_args* args = (table_stats_args*) arb_data_ptr;
+	nati_switch_stats* sw_stats_ptr = CHOOSE_SW_STATS();
 
-	uint32_t            tbl_hdl       = args->tbl_hdl;
-	ipa_nati_tbl_stats* nat_stats_ptr = args->nat_stats_ptr;
-	ipa_nati_tbl_stats* idx_stats_ptr = args->idx_stats_ptr;
+	uint32_t*          cnt_ptr      = CHOOSE_CNTR();
 
-	table_stats_args new_args = {
-		.tbl_hdl =
-		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-		    tbl_hdl :
-		    nati_obj_ptr->ddr_tbl_hdl,
-		.nat_stats_ptr = nat_stats_ptr,
-		.idx_stats_ptr = idx_stats_ptr,
-	};
+	ipa_nati_tbl_stats nat_stats, idx_stats;
 
-	int ret;
+	const char*        mem_type;
+
+	uint64_t           start, stop;
+
+	int                stats_ret, ret;
+
+	bool               collect_stats = (bool) arb_data_ptr;
+
+	UNUSED(cnt_ptr);
+	UNUSED(trigger);
+	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	ret = _smStatTbl(nati_obj_ptr, trigger, (void*) &new_args);
+	stats_ret = (collect_stats) ?
+		ipa_NATI_ipv4_tbl_stats(
+			nati_obj_ptr->sram_tbl_hdl, &nat_stats, &idx_stats) :
+		-1;
+
+	currTimeAs(TimeAsNanSecs, &start);
+
+	/*
+	 * Clear destination counter...
+	 */
+	nati_obj_ptr->tot_rules_in_table[DDR_SUB] = 0;
+
+	/*
+	 * Now build DDR from SRAM's content.  The IPA is still using SRAM,
+	 * so this is done without posting anything to the kernel...
+	 */
+	ret = ipa_nati_copy_ipv4_tbl(
+		nati_obj_ptr->sram_tbl_hdl,
+		nati_obj_ptr->ddr_tbl_hdl,
+		migrate_rule);
+
+	if ( ret == 0 )
+	{
+		/*
+		 * ...and, once complete, switch focus to DDR
+		 */
+		ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_DDR, 0);
+	}
+
+	currTimeAs(TimeAsNanSecs, &stop);
+
+	if ( ret == 0 )
+	{
+		sw_stats_ptr->pass += 1;
+
+		IPADBG("Transistion from SRAM to DDR took %f microseconds "
+			   "(%u rules, one focus change)\n",
+			   (float) (stop - start) / 1000.0,
+			   nati_obj_ptr->tot_rules_in_table[DDR_SUB]);
+	}
+	else
+	{
+		sw_stats_ptr->fail += 1;
+	}
+
+	IPADBG("Transistion pass/fail counts (SRAM to DDR) PASS: %u FAIL: %u\n",
+		   sw_stats_ptr->pass,
+		   sw_stats_ptr->fail);
+
+	if ( stats_ret == 0 )
+	{
+		mem_type = ipa3_nat_mem_in_as_str(nat_stats.nmi);
+
+		/*
+		 * NAT table stats...
+		 */
+		IPADBG("Able to add (%u) records to %s "
+			   "NAT table of size (%u) or (%f) percent\n",
+			   *cnt_ptr,
+			   mem_type,
+			   nat_stats.tot_ents,
+			   ((float) *cnt_ptr / (float) nat_stats.tot_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "NAT BASE table of size (%u) or (%f) percent\n",
+			   nat_stats.tot_base_ents_filled,
+			   mem_type,
+			   nat_stats.tot_base_ents,
+			   ((float) nat_stats.tot_base_ents_filled /
+				(float) nat_stats.tot_base_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "NAT EXPN table of size (%u) or (%f) percent\n",
+			   nat_stats.tot_expn_ents_filled,
+			   mem_type,
+			   nat_stats.tot_expn_ents,
+			   ((float) nat_stats.tot_expn_ents_filled /
+				(float) nat_stats.tot_expn_ents) * 100.0);
+
+		IPADBG("%s NAT table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
+			   mem_type,
+			   nat_stats.tot_chains,
+			   nat_stats.min_chain_len,
+			   nat_stats.max_chain_len,
+			   nat_stats.avg_chain_len);
+
+		/*
+		 * INDEX table stats...
+		 */
+		IPADBG("Able to add (%u) records to %s "
+			   "IDX table of size (%u) or (%f) percent\n",
+			   *cnt_ptr,
+			   mem_type,
+			   idx_stats.tot_ents,
+			   ((float) *cnt_ptr / (float) idx_stats.tot_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "IDX BASE table of size (%u) or (%f) percent\n",
+			   idx_stats.tot_base_ents_filled,
+			   mem_type,
+			   idx_stats.tot_base_ents,
+			   ((float) idx_stats.tot_base_ents_filled /
+				(float) idx_stats.tot_base_ents) * 100.0);
+
+		IPADBG("Able to add (%u) records to %s "
+			   "IDX EXPN table of size (%u) or (%f) percent\n",
+			   idx_stats.tot_expn_ents_filled,
+			   mem_type,
+			   idx_stats.tot_expn_ents,
+			   ((float) idx_stats.tot_expn_ents_filled /
+				(float) idx_stats.tot_expn_ents) * 100.0);
+
+		IPADBG("%s IDX table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
+			   mem_type,
+			   idx_stats.tot_chains,
+			   idx_stats.min_chain_len,
+			   idx_stats.max_chain_len,
+			   idx_stats.avg_chain_len);
+
+		mem_type++; /* to avoid compiler usage warning */
+	}
 
 	IPADBG("Out\n");
 
@@ -1534,7 +3570,7 @@ static int _smStatTblHybrid(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smAddRuleToTbl
+ * FUNCTION: _smGrowDdrTbl
  *
  * PARAMS:
  *
@@ -1546,106 +3582,159 @@ static int _smStatTblHybrid(
  *
  * DESCRIPTION:
  *
- *   The following will cause the addtion of a NAT rule into the DDR
- *   based table.
+ *   The following will double the size of a full DDR table, up to the
+ *   largest table there can be.  The larger table is built from the
+ *   current one's content while the IPA carries on using the current
+ *   one (see ipa_nati_grow_ipv4_tbl()).  The rules' stable handles are
+ *   then pointed at their new real handles, all at once.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smAddRuleToTbl(
+static int _smGrowDdrTbl(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	rule_add_args* args = (rule_add_args*) arb_data_ptr;
+	ipa_nati_tbl_stats nat_stats, idx_stats;
 
-	uint32_t           tbl_hdl   = args->tbl_hdl;
-	ipa_nat_ipv4_rule* clnt_rule = (ipa_nat_ipv4_rule*) args->clnt_rule;
-	uint32_t*          rule_hdl  = args->rule_hdl;
+	nati_grow_args     args;
 
-	char buf[1024];
+	uint32_t           number_of_entries, i;
 
-	int ret;
+	uint64_t           start, stop;
+
+	int                ret;
 
-	UNUSED(buf);
-	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
+	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X) clnt_rule_ptr(%p) rule_hdl_ptr(%p) %s\n",
-		   tbl_hdl, clnt_rule, rule_hdl,
-		   prep_nat_ipv4_rule_4print(clnt_rule, buf, sizeof(buf)));
+	memset(&args, 0, sizeof(args));
 
-	clnt_rule->redirect = clnt_rule->enable = clnt_rule->time_stamp = 0;
+	ret = ipa_NATI_ipv4_tbl_stats(
+		nati_obj_ptr->ddr_tbl_hdl, &nat_stats, &idx_stats);
 
-	ret = ipa_NATI_add_ipv4_rule(tbl_hdl, clnt_rule, rule_hdl);
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
 
-	if ( ret == 0 )
+	/*
+	 * A rule can be refused for reasons other than lack of room, and
+	 * growing won't help with those...
+	 */
+	if ( nat_stats.tot_expn_ents_filled < nat_stats.tot_expn_ents
+		 &&
+		 idx_stats.tot_expn_ents_filled < idx_stats.tot_expn_ents )
 	{
-		uint32_t* cnt_ptr = CHOOSE_CNTR();
+		IPADBG("Expansion tables not full, DDR table not grown\n");
+		ret = -1;
+		goto bail;
+	}
 
-		(*cnt_ptr)++;
+	number_of_entries = 2 * nati_obj_ptr->ddr_tbl_ents;
+
+	if ( number_of_entries > nati_obj_ptr->ddr_grow_limit )
+	{
+		number_of_entries = nati_obj_ptr->ddr_grow_limit;
+	}
+
+	if ( number_of_entries <= nati_obj_ptr->ddr_tbl_ents )
+	{
+		IPADBG("DDR table is as large as it may be (%u entries)\n",
+			   nati_obj_ptr->ddr_tbl_ents);
+		ret = -1;
+		goto bail;
+	}
+
+	args.tbl_hdl   = nati_obj_ptr->ddr_tbl_hdl;
+	args.max_moved = nat_stats.tot_base_ents_filled + nat_stats.tot_expn_ents_filled;
+
+	args.stable_hdls   = calloc(args.max_moved + 1, sizeof(uint32_t));
+	args.new_rule_hdls = calloc(args.max_moved + 1, sizeof(uint32_t));
+
+	if ( ! args.stable_hdls || ! args.new_rule_hdls )
+	{
+		IPAERR("Unable to allocate move list of %u rules\n", args.max_moved);
+		ret = -ENOMEM;
+		goto free;
+	}
+
+	IPAINFO("Growing DDR table from %u to %u entries\n",
+			nati_obj_ptr->ddr_tbl_ents, number_of_entries);
+
+	currTimeAs(TimeAsNanSecs, &start);
+
+	ret = ipa_nati_grow_ipv4_tbl(
+		nati_obj_ptr->ddr_tbl_hdl,
+		number_of_entries,
+		rehash_rule,
+		(void*) &args);
+
+	if ( ret == 0 )
+	{
+		nati_obj_ptr->ddr_tbl_ents = number_of_entries;
 
-		IPADBG("rule_hdl value(%u or 0x%08X)\n",
-			   *rule_hdl, *rule_hdl);
+		for ( i = 0; i < args.num_moved; i++ )
+		{
+			if ( nati_hdl_move(
+					 &nati_obj_ptr->hdls,
+					 args.stable_hdls[i],
+					 args.new_rule_hdls[i]) != 0 )
+			{
+				IPAERR("nati_hdl_move() fail for stable_hdl(0x%08X)\n",
+					   args.stable_hdls[i]);
+				ret = -1;
+			}
+		}
 	}
 
-	IPADBG("Out\n");
-
-	return ret;
-}
+	else if ( ret == -ENODEV )
+	{
+		/*
+		 * The DDR table couldn't be grown, nor put back.  Without it,
+		 * no table is usable, so what's left of them goes too, and the
+		 * application has to start over...
+		 */
+		IPAERR("DDR table lost while growing, state machine reset\n");
 
-/******************************************************************************/
-/*
- * FUNCTION: _smDelRuleFromTbl
- *
- * PARAMS:
- *
- *   nati_obj_ptr (IN) A pointer to an initialized nati object
- *
- *   trigger      (IN) The trigger to run through the state machine
- *
- *   arb_data_ptr (IN) Whatever you like
- *
- * DESCRIPTION:
- *
- *   The following will cause the deletion of a NAT rule from the DDR
- *   based table.
- *
- * RETURNS:
- *
- *   zero on success, otherwise non-zero
- */
-static int _smDelRuleFromTbl(
-	ipa_nati_obj*    nati_obj_ptr,
-	ipa_nati_trigger trigger,
-	void*            arb_data_ptr )
-{
-	rule_del_args* args  = (rule_del_args*) arb_data_ptr;
+		if ( nati_obj_ptr->curr_state == NATI_STATE_HYBRID_DDR )
+		{
+			if ( ipa_NATI_del_ipv4_table(nati_obj_ptr->sram_tbl_hdl) != 0 )
+			{
+				IPAERR("Unable to delete SRAM table 0x%08X\n",
+					   nati_obj_ptr->sram_tbl_hdl);
+			}
 
-	uint32_t tbl_hdl  = args->tbl_hdl;
-	uint32_t rule_hdl = args->rule_hdl;
+			nati_obj_ptr->sram_tbl_hdl = 0;
+		}
 
-	int ret;
+		nati_hdls_destroy(&nati_obj_ptr->hdls);
 
-	UNUSED(nati_obj_ptr);
-	UNUSED(trigger);
+		nati_obj_ptr->ddr_tbl_hdl  = 0;
+		nati_obj_ptr->ddr_tbl_ents = 0;
 
-	IPADBG("In\n");
+		memset(nati_obj_ptr->tot_rules_in_table, 0,
+			   sizeof(nati_obj_ptr->tot_rules_in_table));
 
-	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u)\n", tbl_hdl, rule_hdl);
+		BACK2_UNSTARTED_STATE();
+	}
 
-	ret = ipa_NATI_del_ipv4_rule(tbl_hdl, rule_hdl);
+	currTimeAs(TimeAsNanSecs, &stop);
 
-	if ( ret == 0 )
-	{
-		uint32_t* cnt_ptr = CHOOSE_CNTR();
+	IPADBG("Growing DDR table %s and took %f microseconds (%u rules)\n",
+		   (ret == 0) ? "passed" : "failed",
+		   (float) (stop - start) / 1000.0,
+		   args.num_moved);
 
-		(*cnt_ptr)--;
-	}
+free:
+	free(args.stable_hdls);
+	free(args.new_rule_hdls);
 
+bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -1653,7 +3742,7 @@ static int _smDelRuleFromTbl(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smAddRuleHybrid
+ * FUNCTION: _smCompactTbl
  *
  * PARAMS:
  *
@@ -1665,110 +3754,86 @@ static int _smDelRuleFromTbl(
  *
  * DESCRIPTION:
  *
- *   The following will cause the addition of a NAT rule into either
- *   the SRAM or DDR based table.
- *
- *   *** !!! HOWEVER *** REMEMBER !!! ***
+ *   The following will move rules, from the expansion table of the
+ *   table currently in use, into base table slots freed by deletes
+ *   (see ipa_NATI_compact_ipv4_tbl()).  The moved rules' stable
+ *   handles are pointed at their new real handles.
  *
- *   We're here because we're in a HYBRID state...with the potential
- *   moving between SRAM and DDR.  THIS HAS IMLICATIONS AS IT RELATES
- *   TO RULE MAPPING.
+ *   Without stable handles (ie. NATI_STATE_SRAM_ONLY), the
+ *   application holds real handles, which can't be changed under it,
+ *   hence nothing is moved.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smAddRuleHybrid(
+static int _smCompactTbl(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	rule_add_args* args = (rule_add_args*) arb_data_ptr;
+	table_compact_args* args = (table_compact_args*) arb_data_ptr;
 
-	uint32_t           tbl_hdl   = args->tbl_hdl;
-	ipa_nat_ipv4_rule* clnt_rule = (ipa_nat_ipv4_rule*) args->clnt_rule;
-	uint32_t*          rule_hdl  = args->rule_hdl;
+	uint32_t  tbl_hdl =
+		(nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		args->tbl_hdl :
+		nati_obj_ptr->ddr_tbl_hdl;
 
-	rule_add_args new_args = {
-		.tbl_hdl =
-		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-		    tbl_hdl :
-		    nati_obj_ptr->ddr_tbl_hdl,
-		.clnt_rule = clnt_rule,
-		.rule_hdl  = rule_hdl,
-	};
+	uint32_t* old_rule_hdls = NULL;
+	uint32_t* new_rule_hdls = NULL;
+	uint32_t  stable_hdl, i;
 
-	uint32_t orig2new_map, new2orig_map;
+	int ret = 0;
 
-	int ret;
+	UNUSED(trigger);
 
 	IPADBG("In\n");
 
-	ret = _smAddRuleToTbl(nati_obj_ptr, trigger, (void*) &new_args);
+	*args->num_moved_ptr = 0;
 
-	if ( ret == 0 )
+	if ( ! nati_obj_ptr->hdls.slots )
 	{
-		/*
-		 * The rule_hdl is used to find a rule in the nat table.  It
-		 * is, in effect, an index into the table.  The applcation
-		 * above us retains it for future manipulation of the rule in
-		 * the table.
-		 *
-		 * In hybrid mode, a rule can and will move between SRAM and
-		 * DDR.  Because of this, its handle will change.  The
-		 * application has only the original handle and doesn't know
-		 * of the new handle.  A mapping, used in hybrid mode, will
-		 * maintain a relationship between the original handle and the
-		 * rule's current real handle...
-		 *
-		 * To help you get a mindset of how this is done:
-		 *
-		 *   The original handle will map (point) to the new and new
-		 *   handle will map (point) back to original.
-		 *
-		 * NOTE WELL: There are two sets of maps.  One for each memory
-		 *            type...
-		 */
-		CHOOSE_MAPS(orig2new_map, new2orig_map);
+		IPADBG("No stable handles in state(%s), nothing moved\n",
+			   ipa_nati_state_as_str(nati_obj_ptr->curr_state));
+		goto bail;
+	}
 
-		ret = ipa_nat_map_add(orig2new_map, *rule_hdl, *rule_hdl);
+	old_rule_hdls = calloc(args->max_moves, sizeof(uint32_t));
+	new_rule_hdls = calloc(args->max_moves, sizeof(uint32_t));
 
-		if ( ret == 0 )
-		{
-			ret = ipa_nat_map_add(new2orig_map, *rule_hdl, *rule_hdl);
-		}
-	}
-	else
+	if ( ! old_rule_hdls || ! new_rule_hdls )
 	{
-		if ( nati_obj_ptr->curr_state == NATI_STATE_HYBRID
-			 &&
-			 ! nati_obj_ptr->hold_state )
-		{
-			/*
-			 * In hybrid mode, we always start in SRAM...hence
-			 * NATI_STATE_HYBRID implies SRAM.  The rule addition
-			 * above did not work, meaning the SRAM table is full,
-			 * hence let's jump to DDR...
-			 *
-			 * The following will focus us on DDR and cause the copy
-			 * of data from SRAM to DDR.
-			 */
-			IPAINFO("Add of rule failed...attempting table switch\n");
-
-			ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
+		IPAERR("Unable to allocate move list of %u rules\n", args->max_moves);
+		ret = -ENOMEM;
+		goto bail;
+	}
 
-			if ( ret == 0 )
-			{
-				SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID_DDR);
+	ret = ipa_NATI_compact_ipv4_tbl(
+		tbl_hdl,
+		args->max_moves,
+		old_rule_hdls,
+		new_rule_hdls,
+		args->num_moved_ptr);
 
-				/*
-				 * Now add the rule to DDR...
-				 */
-				ret = ipa_nati_statemach(nati_obj_ptr, trigger, arb_data_ptr);
-			}
+	/*
+	 * Rules moved before a failure have moved nonetheless...
+	 */
+	for ( i = 0; i < *args->num_moved_ptr; i++ )
+	{
+		if ( nati_hdl_of(&nati_obj_ptr->hdls, old_rule_hdls[i], &stable_hdl) != 0
+			 ||
+			 nati_hdl_move(&nati_obj_ptr->hdls, stable_hdl, new_rule_hdls[i]) != 0 )
+		{
+			IPAERR("Unable to follow rule_hdl(0x%08X) to rule_hdl(0x%08X)\n",
+				   old_rule_hdls[i], new_rule_hdls[i]);
+			ret = -1;
 		}
 	}
 
+bail:
+	free(old_rule_hdls);
+	free(new_rule_hdls);
+
 	IPADBG("Out\n");
 
 	return ret;
@@ -1776,7 +3841,7 @@ static int _smAddRuleHybrid(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smDelRuleHybrid
+ * FUNCTION: _smGetTmStmp
  *
  * PARAMS:
  *
@@ -1788,122 +3853,39 @@ static int _smAddRuleHybrid(
  *
  * DESCRIPTION:
  *
- *   The following will cause the deletion of a NAT rule from either
- *   the SRAM or DDR based table.
- *
- *   *** !!! HOWEVER *** REMEMBER !!! ***
- *
- *   We're here because we're in a HYBRID state...with the potential
- *   moving between SRAM and DDR.  THIS HAS IMLICATIONS AS IT RELATES
- *   TO RULE MAPPING.
+ *   Retrieve rule's timestamp from NAT table.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smDelRuleHybrid(
+static int _smGetTmStmp(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	rule_del_args* args = (rule_del_args*) arb_data_ptr;
-
-	uint32_t tbl_hdl       = args->tbl_hdl;
-	uint32_t orig_rule_hdl = args->rule_hdl;
+	timestap_query_args* args  = (timestap_query_args*) arb_data_ptr;
 
-	uint32_t new_rule_hdl;
+	uint32_t  tbl_hdl    = args->tbl_hdl;
+	uint32_t  rule_hdl   = args->rule_hdl;
+	uint32_t* time_stamp = args->time_stamp;
 
-	uint32_t orig2new_map,  new2orig_map;
+	int ret;
 
-	int      ret;
+	UNUSED(nati_obj_ptr);
+	UNUSED(trigger);
+	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	CHOOSE_MAPS(orig2new_map, new2orig_map);
+	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u) time_stamp_ptr(%p)\n",
+		   tbl_hdl, rule_hdl, time_stamp);
 
-	/*
-	 * The rule_hdl is used to find a rule in the nat table.  It is,
-	 * in effect, an index into the table.  The applcation above us
-	 * retains it for future manipulation of the rule in the table.
-	 *
-	 * In hybrid mode, a rule can and will move between SRAM and DDR.
-	 * Because of this, its handle will change.  The application has
-	 * only the original handle and doesn't know of the new handle.  A
-	 * mapping, used in hybrid mode, will maintain a relationship
-	 * between the original handle and the rule's current real
-	 * handle...
-	 *
-	 * To help you get a mindset of how this is done:
-	 *
-	 *   The original handle will map (point) to the new and new
-	 *   handle will map (point) back to original.
-	 *
-	 * NOTE WELL: There are two sets of maps.  One for each memory
-	 *            type...
-	 */
-	ret = ipa_nat_map_del(orig2new_map, orig_rule_hdl, &new_rule_hdl);
+	ret = ipa_NATI_query_timestamp(tbl_hdl, rule_hdl, time_stamp);
 
 	if ( ret == 0 )
 	{
-		rule_del_args new_args = {
-			.tbl_hdl =
-			  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-			    tbl_hdl :
-			    nati_obj_ptr->ddr_tbl_hdl,
-			.rule_hdl = new_rule_hdl,
-		};
-
-		IPADBG("orig_rule_hdl(0x%08X) -> new_rule_hdl(0x%08X)\n",
-			   orig_rule_hdl, new_rule_hdl);
-
-		ipa_nat_map_del(new2orig_map, new_rule_hdl, NULL);
-
-		ret = _smDelRuleFromTbl(nati_obj_ptr, trigger, (void*) &new_args);
-
-		if ( ret == 0 && nati_obj_ptr->curr_state == NATI_STATE_HYBRID_DDR )
-		{
-			/*
-			 * We need to check when/if we can go back to SRAM.
-			 *
-			 * How/why can we go back?
-			 *
-			 *   Given enough deletions, and when we get to a user
-			 *   defined threshold (ie. a percentage of what SRAM can
-			 *   hold), we can pop back to using SRAM.
-			 */
-			uint32_t* cnt_ptr = CHOOSE_CNTR();
-
-			if ( *cnt_ptr <= nati_obj_ptr->back_to_sram_thresh
-				 &&
-				 ! nati_obj_ptr->hold_state )
-			{
-				/*
-				 * The following will focus us on SRAM and cause the copy
-				 * of data from DDR to SRAM.
-				 */
-				IPAINFO("Switch back to SRAM threshold has been reached -> "
-						"Total rules in DDR(%u) <= SRAM THRESH(%u)\n",
-						*cnt_ptr,
-						nati_obj_ptr->back_to_sram_thresh);
-
-				ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
-
-				if ( ret == 0 )
-				{
-					SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
-				}
-				else
-				{
-					/*
-					 * The following will force us stay in DDR for
-					 * now, but the next delete will trigger the
-					 * switch logic above to run again...perhaps it
-					 * will work then.
-					 */
-					ret = 0;
-				}
-			}
-		}
+		IPADBG("time_stamp(0x%08X)\n", *time_stamp);
 	}
 
 	IPADBG("Out\n");
@@ -1913,7 +3895,7 @@ static int _smDelRuleHybrid(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smGoToDdr
+ * FUNCTION: _smGetTmStmpHybrid
  *
  * PARAMS:
  *
@@ -1925,30 +3907,44 @@ static int _smDelRuleHybrid(
  *
  * DESCRIPTION:
  *
- *   The following will cause the IPA to use the DDR based NAT
- *   table...
+ *   Retrieve rule's timestamp from the state approriate NAT table.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smGoToDdr(
+static int _smGetTmStmpHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	int ret;
+	timestap_query_args* args  = (timestap_query_args*) arb_data_ptr;
 
-	UNUSED(trigger);
-	UNUSED(arb_data_ptr);
+	uint32_t  tbl_hdl       = args->tbl_hdl;
+	uint32_t  orig_rule_hdl = args->rule_hdl;
+	uint32_t* time_stamp    = args->time_stamp;
+
+	uint32_t  new_rule_hdl;
+
+	int       ret;
 
 	IPADBG("In\n");
 
-	ret = ipa_NATI_post_ipv4_init_cmd(nati_obj_ptr->ddr_tbl_hdl);
+	ret = nati_hdl_resolve(
+		&nati_obj_ptr->hdls, CHOOSE_MEM_SUB(), orig_rule_hdl, &new_rule_hdl);
 
 	if ( ret == 0 )
 	{
-		SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID_DDR);
+		timestap_query_args new_args = {
+			.tbl_hdl =
+			  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+			    tbl_hdl :
+			    nati_obj_ptr->ddr_tbl_hdl,
+			.rule_hdl   = new_rule_hdl,
+			.time_stamp = time_stamp,
+		};
+
+		ret = _smGetTmStmp(nati_obj_ptr, trigger, (void*) &new_args);
 	}
 
 	IPADBG("Out\n");
@@ -1958,7 +3954,7 @@ static int _smGoToDdr(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smGoToSram
+ * FUNCTION: _smGetTmStmps
  *
  * PARAMS:
  *
@@ -1970,30 +3966,54 @@ static int _smGoToDdr(
  *
  * DESCRIPTION:
  *
- *   The following will cause the IPA to use the SRAM based NAT
- *   table...
+ *   Retrieve the timestamps of many rules, of all rules, or of the
+ *   rules whose timestamp changed, from NAT table.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smGoToSram(
+static int _smGetTmStmps(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
+	timestamps_query_args* args = (timestamps_query_args*) arb_data_ptr;
+
 	int ret;
 
+	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
-	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	ret = ipa_NATI_post_ipv4_init_cmd(nati_obj_ptr->sram_tbl_hdl);
+	IPADBG("tbl_hdl(0x%08X) rule_hdls_ptr(%p) num_rules(%u)\n",
+		   args->tbl_hdl, args->rule_hdls, args->num_rules);
 
-	if ( ret == 0 )
+	if ( args->rule_hdls )
 	{
-		SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
+		ret = ipa_NATI_query_timestamps(
+			args->tbl_hdl,
+			args->rule_hdls,
+			args->num_rules,
+			args->time_stamps);
+	}
+	else if ( args->shadow )
+	{
+		ret = ipa_NATI_query_changed_timestamps(
+			args->tbl_hdl,
+			args->shadow,
+			args->all_time_stamps,
+			args->num_rules,
+			args->num_found_ptr);
+	}
+	else
+	{
+		ret = ipa_NATI_query_all_timestamps(
+			args->tbl_hdl,
+			args->all_time_stamps,
+			args->num_rules,
+			args->num_found_ptr);
 	}
 
 	IPADBG("Out\n");
@@ -2003,7 +4023,7 @@ static int _smGoToSram(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smSwitchFromDdrToSram
+ * FUNCTION: _smGetTmStmpsHybrid
  *
  * PARAMS:
  *
@@ -2015,163 +4035,96 @@ static int _smGoToSram(
  *
  * DESCRIPTION:
  *
- *   The following will cause a copy of the DDR table to SRAM and then
- *   will make the IPA use the SRAM...
+ *   Retrieve the timestamps of many rules, of all rules, or of the
+ *   rules whose timestamp changed, from the state approriate NAT
+ *   table.  Original handles are mapped to the
+ *   current ones on the way in, and back on the way out.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smSwitchFromDdrToSram(
+static int _smGetTmStmpsHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	nati_switch_stats* sw_stats_ptr = CHOOSE_SW_STATS();
-
-	uint32_t*          cnt_ptr      = CHOOSE_CNTR();
-
-	ipa_nati_tbl_stats nat_stats, idx_stats;
-
-	const char*        mem_type;
+	timestamps_query_args* args = (timestamps_query_args*) arb_data_ptr;
 
-	uint64_t           start, stop;
+	timestamps_query_args new_args = *args;
 
-	int                stats_ret, ret;
+	uint32_t* new_rule_hdls = NULL;
 
-	bool               collect_stats = (bool) arb_data_ptr;
+	uint32_t i, j;
 
-	UNUSED(cnt_ptr);
-	UNUSED(trigger);
-	UNUSED(arb_data_ptr);
+	int ret = 0, map_ret;
 
 	IPADBG("In\n");
 
-	stats_ret = (collect_stats) ?
-		ipa_NATI_ipv4_tbl_stats(
-			nati_obj_ptr->ddr_tbl_hdl, &nat_stats, &idx_stats) :
-		-1;
-
-	currTimeAs(TimeAsNanSecs, &start);
-
-	/*
-	 * First, switch focus to SRAM...
-	 */
-	ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_SRAM, 0);
+	new_args.tbl_hdl =
+		(nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		args->tbl_hdl :
+		nati_obj_ptr->ddr_tbl_hdl;
 
-	if ( ret == 0 )
+	if ( args->rule_hdls )
 	{
-		/*
-		 * Clear destination counter...
-		 */
-		nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
+		new_rule_hdls = calloc(args->num_rules, sizeof(uint32_t));
 
-		/*
-		 * Clear destination SRAM maps...
-		 */
-		ipa_nat_map_clear(nati_obj.map_pairs[SRAM_SUB].orig2new_map);
-		ipa_nat_map_clear(nati_obj.map_pairs[SRAM_SUB].new2orig_map);
+		if ( ! new_rule_hdls )
+		{
+			IPAERR("Unable to allocate map list of %u rules\n", args->num_rules);
+			ret = -ENOMEM;
+			goto bail;
+		}
 
 		/*
-		 * Now copy DDR's content to SRAM...
+		 * An unmappable handle is left at zero, which the lower
+		 * layer rejects without touching its time stamp...
 		 */
-		ret = ipa_nati_copy_ipv4_tbl(
-			nati_obj_ptr->ddr_tbl_hdl,
-			nati_obj_ptr->sram_tbl_hdl,
-			migrate_rule);
-
-		currTimeAs(TimeAsNanSecs, &stop);
-
-		if ( ret == 0 )
+		for ( i = 0; i < args->num_rules; i++ )
 		{
-			sw_stats_ptr->pass += 1;
+			map_ret = nati_hdl_resolve(
+				&nati_obj_ptr->hdls, CHOOSE_MEM_SUB(), args->rule_hdls[i], &new_rule_hdls[i]);
 
-			IPADBG("Transistion from DDR to SRAM took %f microseconds\n",
-				   (float) (stop - start) / 1000.0);
-		}
-		else
-		{
-			sw_stats_ptr->fail += 1;
+			ret = (map_ret) ? map_ret : ret;
 		}
 
-		IPADBG("Transistion pass/fail counts (DDR to SRAM) PASS: %u FAIL: %u\n",
-			   sw_stats_ptr->pass,
-			   sw_stats_ptr->fail);
+		new_args.rule_hdls = new_rule_hdls;
 
-		if ( stats_ret == 0 )
-		{
-			mem_type = ipa3_nat_mem_in_as_str(nat_stats.nmi);
+		map_ret = _smGetTmStmps(nati_obj_ptr, trigger, (void*) &new_args);
 
-			/*
-			 * NAT table stats...
-			 */
-			IPADBG("Able to add (%u) records to %s "
-				   "NAT table of size (%u) or (%f) percent\n",
-				   *cnt_ptr,
-				   mem_type,
-				   nat_stats.tot_ents,
-				   ((float) *cnt_ptr / (float) nat_stats.tot_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "NAT BASE table of size (%u) or (%f) percent\n",
-				   nat_stats.tot_base_ents_filled,
-				   mem_type,
-				   nat_stats.tot_base_ents,
-				   ((float) nat_stats.tot_base_ents_filled /
-					(float) nat_stats.tot_base_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "NAT EXPN table of size (%u) or (%f) percent\n",
-				   nat_stats.tot_expn_ents_filled,
-				   mem_type,
-				   nat_stats.tot_expn_ents,
-				   ((float) nat_stats.tot_expn_ents_filled /
-					(float) nat_stats.tot_expn_ents) * 100.0);
-
-			IPADBG("%s NAT table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
-				   mem_type,
-				   nat_stats.tot_chains,
-				   nat_stats.min_chain_len,
-				   nat_stats.max_chain_len,
-				   nat_stats.avg_chain_len);
+		ret = (map_ret) ? map_ret : ret;
+	}
+	else
+	{
+		ret = _smGetTmStmps(nati_obj_ptr, trigger, (void*) &new_args);
 
-			/*
-			 * INDEX table stats...
-			 */
-			IPADBG("Able to add (%u) records to %s "
-				   "IDX table of size (%u) or (%f) percent\n",
-				   *cnt_ptr,
-				   mem_type,
-				   idx_stats.tot_ents,
-				   ((float) *cnt_ptr / (float) idx_stats.tot_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "IDX BASE table of size (%u) or (%f) percent\n",
-				   idx_stats.tot_base_ents_filled,
-				   mem_type,
-				   idx_stats.tot_base_ents,
-				   ((float) idx_stats.tot_base_ents_filled /
-					(float) idx_stats.tot_base_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "IDX EXPN table of size (%u) or (%f) percent\n",
-				   idx_stats.tot_expn_ents_filled,
-				   mem_type,
-				   idx_stats.tot_expn_ents,
-				   ((float) idx_stats.tot_expn_ents_filled /
-					(float) idx_stats.tot_expn_ents) * 100.0);
-
-			IPADBG("%s IDX table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
-				   mem_type,
-				   idx_stats.tot_chains,
-				   idx_stats.min_chain_len,
-				   idx_stats.max_chain_len,
-				   idx_stats.avg_chain_len);
-
-			mem_type++; /* to avoid compiler usage warning */
+		/*
+		 * Hand back the original handles, dropping any rule that
+		 * doesn't have one...
+		 */
+		for ( i = j = 0; i < *args->num_found_ptr; i++ )
+		{
+			uint32_t orig_rule_hdl;
+
+			if ( nati_hdl_of(
+					 &nati_obj_ptr->hdls,
+					 args->all_time_stamps[i].rule_hdl,
+					 &orig_rule_hdl) == 0 )
+			{
+				args->all_time_stamps[j].rule_hdl   = orig_rule_hdl;
+				args->all_time_stamps[j].time_stamp =
+					args->all_time_stamps[i].time_stamp;
+				j++;
+			}
 		}
+
+		*args->num_found_ptr = j;
 	}
 
+	free(new_rule_hdls);
+
+bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -2179,7 +4132,7 @@ static int _smSwitchFromDdrToSram(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smSwitchFromSramToDdr
+ * FUNCTION: _smGetStale
  *
  * PARAMS:
  *
@@ -2191,163 +4144,136 @@ static int _smSwitchFromDdrToSram(
  *
  * DESCRIPTION:
  *
- *   The following will cause a copy of the SRAM table to DDR and then
- *   will make the IPA use the DDR...
+ *   Find the rules, in the state approriate NAT table, that were last
+ *   hit before a given time stamp, and delete them when asked to.  The
+ *   rules are handed back, with the handles the application knows
+ *   them by, in an array the caller frees.
+ *
+ *   Unlike the other triggers, there's no separate hybrid version;
+ *   the handles are mapped here whenever there are stable ones.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smSwitchFromSramToDdr(
+static int _smGetStale(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	nati_switch_stats* sw_stats_ptr = CHOOSE_SW_STATS();
+	stale_collect_args* args = (stale_collect_args*) arb_data_ptr;
 
-	uint32_t*          cnt_ptr      = CHOOSE_CNTR();
+	ipa_nat_rule_time_stamp* stale = NULL;
 
 	ipa_nati_tbl_stats nat_stats, idx_stats;
 
-	const char*        mem_type;
-
-	uint64_t           start, stop;
-
-	int                stats_ret, ret;
+	uint32_t tbl_hdl = args->tbl_hdl;
+	uint32_t i;
 
-	bool               collect_stats = (bool) arb_data_ptr;
+	int ret, del_ret;
 
-	UNUSED(cnt_ptr);
 	UNUSED(trigger);
-	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	stats_ret = (collect_stats) ?
-		ipa_NATI_ipv4_tbl_stats(
-			nati_obj_ptr->sram_tbl_hdl, &nat_stats, &idx_stats) :
-		-1;
+	*args->stale_ptr     = NULL;
+	*args->num_stale_ptr = 0;
 
-	currTimeAs(TimeAsNanSecs, &start);
+	if ( nati_obj_ptr->hdls.slots
+		 &&
+		 nati_obj_ptr->curr_state != NATI_STATE_HYBRID )
+	{
+		tbl_hdl = nati_obj_ptr->ddr_tbl_hdl;
+	}
+
+	ret = ipa_NATI_ipv4_tbl_stats(tbl_hdl, &nat_stats, &idx_stats);
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	stale = calloc(nat_stats.tot_ents + 1, sizeof(ipa_nat_rule_time_stamp));
+
+	if ( ! stale )
+	{
+		IPAERR("Unable to allocate stale list of %u rules\n", nat_stats.tot_ents);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	ret = ipa_NATI_collect_stale(
+		tbl_hdl, args->older_than, stale, nat_stats.tot_ents + 1, args->num_stale_ptr);
+
+	if ( ret != 0 )
+	{
+		free(stale);
+		*args->num_stale_ptr = 0;
+		goto bail;
+	}
 
 	/*
-	 * First, switch focus to DDR...
+	 * Where the application holds stable handles, hand those back,
+	 * dropping any rule that doesn't have one...
 	 */
-	ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_DDR, 0);
-
-	if ( ret == 0 )
+	if ( nati_obj_ptr->hdls.slots )
 	{
-		/*
-		 * Clear destination counter...
-		 */
-		nati_obj_ptr->tot_rules_in_table[DDR_SUB] = 0;
+		uint32_t j;
 
-		/*
-		 * Clear destination DDR maps...
-		 */
-		ipa_nat_map_clear(nati_obj.map_pairs[DDR_SUB].orig2new_map);
-		ipa_nat_map_clear(nati_obj.map_pairs[DDR_SUB].new2orig_map);
+		for ( i = j = 0; i < *args->num_stale_ptr; i++ )
+		{
+			if ( nati_hdl_of(
+					 &nati_obj_ptr->hdls,
+					 stale[i].rule_hdl,
+					 &stale[j].rule_hdl) == 0 )
+			{
+				stale[j].time_stamp = stale[i].time_stamp;
+				j++;
+			}
+		}
+
+		*args->num_stale_ptr = j;
+	}
+
+	*args->stale_ptr = stale;
 
+	if ( args->del_stale && *args->num_stale_ptr )
+	{
 		/*
-		 * Now copy SRAM's content to DDR...
+		 * The delete takes the handles just found, so it goes back
+		 * through the state machine, which also sees to the hybrid
+		 * mode book keeping...
 		 */
-		ret = ipa_nati_copy_ipv4_tbl(
-			nati_obj_ptr->sram_tbl_hdl,
-			nati_obj_ptr->ddr_tbl_hdl,
-			migrate_rule);
+		uint32_t* rule_hdls = calloc(*args->num_stale_ptr, sizeof(uint32_t));
 
-		currTimeAs(TimeAsNanSecs, &stop);
+		rules_del_args del_args = {
+			.tbl_hdl   = args->tbl_hdl,
+			.rule_hdls = rule_hdls,
+			.num_rules = *args->num_stale_ptr,
+		};
 
-		if ( ret == 0 )
+		if ( ! rule_hdls )
 		{
-			sw_stats_ptr->pass += 1;
-
-			IPADBG("Transistion from SRAM to DDR took %f microseconds\n",
-				   (float) (stop - start) / 1000.0);
+			IPAERR("Unable to allocate delete list of %u rules\n",
+				   *args->num_stale_ptr);
+			ret = -ENOMEM;
+			goto bail;
 		}
-		else
+
+		for ( i = 0; i < *args->num_stale_ptr; i++ )
 		{
-			sw_stats_ptr->fail += 1;
+			rule_hdls[i] = stale[i].rule_hdl;
 		}
 
-		IPADBG("Transistion pass/fail counts (SRAM to DDR) PASS: %u FAIL: %u\n",
-			   sw_stats_ptr->pass,
-			   sw_stats_ptr->fail);
+		del_ret = ipa_nati_statemach(
+			nati_obj_ptr, NATI_TRIG_DEL_RULES, (void*) &del_args);
 
-		if ( stats_ret == 0 )
-		{
-			mem_type = ipa3_nat_mem_in_as_str(nat_stats.nmi);
-
-			/*
-			 * NAT table stats...
-			 */
-			IPADBG("Able to add (%u) records to %s "
-				   "NAT table of size (%u) or (%f) percent\n",
-				   *cnt_ptr,
-				   mem_type,
-				   nat_stats.tot_ents,
-				   ((float) *cnt_ptr / (float) nat_stats.tot_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "NAT BASE table of size (%u) or (%f) percent\n",
-				   nat_stats.tot_base_ents_filled,
-				   mem_type,
-				   nat_stats.tot_base_ents,
-				   ((float) nat_stats.tot_base_ents_filled /
-					(float) nat_stats.tot_base_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "NAT EXPN table of size (%u) or (%f) percent\n",
-				   nat_stats.tot_expn_ents_filled,
-				   mem_type,
-				   nat_stats.tot_expn_ents,
-				   ((float) nat_stats.tot_expn_ents_filled /
-					(float) nat_stats.tot_expn_ents) * 100.0);
-
-			IPADBG("%s NAT table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
-				   mem_type,
-				   nat_stats.tot_chains,
-				   nat_stats.min_chain_len,
-				   nat_stats.max_chain_len,
-				   nat_stats.avg_chain_len);
+		ret = (del_ret) ? del_ret : ret;
 
-			/*
-			 * INDEX table stats...
-			 */
-			IPADBG("Able to add (%u) records to %s "
-				   "IDX table of size (%u) or (%f) percent\n",
-				   *cnt_ptr,
-				   mem_type,
-				   idx_stats.tot_ents,
-				   ((float) *cnt_ptr / (float) idx_stats.tot_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "IDX BASE table of size (%u) or (%f) percent\n",
-				   idx_stats.tot_base_ents_filled,
-				   mem_type,
-				   idx_stats.tot_base_ents,
-				   ((float) idx_stats.tot_base_ents_filled /
-					(float) idx_stats.tot_base_ents) * 100.0);
-
-			IPADBG("Able to add (%u) records to %s "
-				   "IDX EXPN table of size (%u) or (%f) percent\n",
-				   idx_stats.tot_expn_ents_filled,
-				   mem_type,
-				   idx_stats.tot_expn_ents,
-				   ((float) idx_stats.tot_expn_ents_filled /
-					(float) idx_stats.tot_expn_ents) * 100.0);
-
-			IPADBG("%s IDX table chains: tot_chains(%u) min_len(%u) max_len(%u) avg_len(%f)\n",
-				   mem_type,
-				   idx_stats.tot_chains,
-				   idx_stats.min_chain_len,
-				   idx_stats.max_chain_len,
-				   idx_stats.avg_chain_len);
-
-			mem_type++; /* to avoid compiler usage warning */
-		}
+		free(rule_hdls);
 	}
 
+bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -2355,7 +4281,7 @@ static int _smSwitchFromSramToDdr(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smGetTmStmp
+ * FUNCTION: _smFindRule
  *
  * PARAMS:
  *
@@ -2367,40 +4293,27 @@ static int _smSwitchFromSramToDdr(
  *
  * DESCRIPTION:
  *
- *   Retrieve rule's timestamp from NAT table.
+ *   Look a rule up, by its tuple, in NAT table.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smGetTmStmp(
+static int _smFindRule(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	timestap_query_args* args  = (timestap_query_args*) arb_data_ptr;
-
-	uint32_t  tbl_hdl    = args->tbl_hdl;
-	uint32_t  rule_hdl   = args->rule_hdl;
-	uint32_t* time_stamp = args->time_stamp;
+	rule_find_args* args = (rule_find_args*) arb_data_ptr;
 
 	int ret;
 
 	UNUSED(nati_obj_ptr);
 	UNUSED(trigger);
-	UNUSED(arb_data_ptr);
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u) time_stamp_ptr(%p)\n",
-		   tbl_hdl, rule_hdl, time_stamp);
-
-	ret = ipa_NATI_query_timestamp(tbl_hdl, rule_hdl, time_stamp);
-
-	if ( ret == 0 )
-	{
-		IPADBG("time_stamp(0x%08X)\n", *time_stamp);
-	}
+	ret = ipa_NATI_find_ipv4_rule(args->tbl_hdl, args->clnt_rule, args->rule_hdl);
 
 	IPADBG("Out\n");
 
@@ -2409,7 +4322,7 @@ static int _smGetTmStmp(
 
 /******************************************************************************/
 /*
- * FUNCTION: _smGetTmStmpHybrid
+ * FUNCTION: _smFindRuleHybrid
  *
  * PARAMS:
  *
@@ -2421,49 +4334,40 @@ static int _smGetTmStmp(
  *
  * DESCRIPTION:
  *
- *   Retrieve rule's timestamp from the state approriate NAT table.
+ *   Look a rule up, by its tuple, in the state approriate NAT table,
+ *   and hand back its original handle.
  *
  * RETURNS:
  *
  *   zero on success, otherwise non-zero
  */
-static int _smGetTmStmpHybrid(
+static int _smFindRuleHybrid(
 	ipa_nati_obj*    nati_obj_ptr,
 	ipa_nati_trigger trigger,
 	void*            arb_data_ptr )
 {
-	timestap_query_args* args  = (timestap_query_args*) arb_data_ptr;
-
-	uint32_t  tbl_hdl       = args->tbl_hdl;
-	uint32_t  orig_rule_hdl = args->rule_hdl;
-	uint32_t* time_stamp    = args->time_stamp;
+	rule_find_args* args = (rule_find_args*) arb_data_ptr;
 
-	uint32_t  new_rule_hdl;
+	uint32_t new_rule_hdl;
 
-	uint32_t  orig2new_map, new2orig_map;
+	rule_find_args new_args = {
+		.tbl_hdl =
+		  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		    args->tbl_hdl :
+		    nati_obj_ptr->ddr_tbl_hdl,
+		.clnt_rule = args->clnt_rule,
+		.rule_hdl  = &new_rule_hdl,
+	};
 
-	int       ret;
+	int ret;
 
 	IPADBG("In\n");
 
-	CHOOSE_MAPS(orig2new_map, new2orig_map);
-
-	new2orig_map++; /* to avoid compiler usage warning */
-
-	ret = ipa_nat_map_find(orig2new_map, orig_rule_hdl, &new_rule_hdl);
+	ret = _smFindRule(nati_obj_ptr, trigger, (void*) &new_args);
 
 	if ( ret == 0 )
 	{
-		timestap_query_args new_args = {
-			.tbl_hdl =
-			  (nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-			    tbl_hdl :
-			    nati_obj_ptr->ddr_tbl_hdl,
-			.rule_hdl   = new_rule_hdl,
-			.time_stamp = time_stamp,
-		};
-
-		ret = _smGetTmStmp(nati_obj_ptr, trigger, (void*) &new_args);
+		ret = nati_hdl_of(&nati_obj_ptr->hdls, new_rule_hdl, args->rule_hdl);
 	}
 
 	IPADBG("Out\n");
@@ -2492,6 +4396,14 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GET_TSTAMP, _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_ADD_RULES,  _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_DEL_RULES,  _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GET_TSTMPS, _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_FIND_RULE,  _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_TBL_GROW,   _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_TBL_PACK,   _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GET_STALE,  _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GET_CHNGD,  _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2499,15 +4411,23 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_NULL,       _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_ADD_TABLE,  _smAddDdrTbl ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_DEL_TABLE,  _smDelTbl ),
-		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_CLR_TABLE,  _smClrTbl ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_CLR_TABLE,  _smClrTblHybrid ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_WLK_TABLE,  _smWalkTbl ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_TBL_STATS,  _smStatTbl ),
-		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_ADD_RULE,   _smAddRuleToTbl ),
-		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_DEL_RULE,   _smDelRuleFromTbl ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_ADD_RULE,   _smAddRuleHybrid ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_DEL_RULE,   _smDelRuleHybrid ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_TBL_SWITCH, _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GOTO_SRAM,  _smUndef ),
-		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_TSTAMP, _smGetTmStmp ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_ADD_RULES,  _smAddRulesHybrid ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_DEL_RULES,  _smDelRulesHybrid ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_TSTMPS, _smGetTmStmpsHybrid ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_FIND_RULE,  _smFindRuleHybrid ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_TBL_GROW,   _smGrowDdrTbl ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_TBL_PACK,   _smCompactTbl ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_STALE,  _smGetStale ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_CHNGD,  _smGetTmStmpsHybrid ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2524,6 +4444,14 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GET_TSTAMP, _smGetTmStmp ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_ADD_RULES,  _smAddRulesToTbl ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_DEL_RULES,  _smDelRulesFromTbl ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GET_TSTMPS, _smGetTmStmps ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_FIND_RULE,  _smFindRule ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_TBL_GROW,   _smUndef ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_TBL_PACK,   _smCompactTbl ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GET_STALE,  _smGetStale ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GET_CHNGD,  _smGetTmStmps ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2540,6 +4468,14 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GOTO_DDR,   _smGoToDdr ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GOTO_SRAM,  _smGoToSram ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_ADD_RULES,  _smAddRulesHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_DEL_RULES,  _smDelRulesHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GET_TSTMPS, _smGetTmStmpsHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_FIND_RULE,  _smFindRuleHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_TBL_GROW,   _smUndef ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_TBL_PACK,   _smCompactTbl ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GET_STALE,  _smGetStale ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GET_CHNGD,  _smGetTmStmpsHybrid ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2556,6 +4492,14 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GOTO_DDR,   _smGoToDdr ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GOTO_SRAM,  _smGoToSram ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_ADD_RULES,  _smAddRulesHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_DEL_RULES,  _smDelRulesHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GET_TSTMPS, _smGetTmStmpsHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_FIND_RULE,  _smFindRuleHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_TBL_GROW,   _smGrowDdrTbl ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_TBL_PACK,   _smCompactTbl ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GET_STALE,  _smGetStale ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GET_CHNGD,  _smGetTmStmpsHybrid ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2572,6 +4516,14 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GET_TSTAMP, _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_ADD_RULES,  _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_DEL_RULES,  _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GET_TSTMPS, _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_FIND_RULE,  _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_TBL_GROW,   _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_TBL_PACK,   _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GET_STALE,  _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GET_CHNGD,  _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_LAST,       _smUndef ),
 	},
 };
@@ -2612,6 +4564,101 @@ static int _smUndef(
 	return -1;
 }
 
+/******************************************************************************/
+/*
+ * FUNCTION: _statemach_read
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) A READ_ONLY_TRIGGER() trigger
+ *
+ *   arb_data_ptr (IN) Passed, untouched, to the callback
+ *
+ * DESCRIPTION:
+ *
+ *   Runs a read only trigger without taking nat_mutex.  The mutex is
+ *   only held, briefly, around clock votes.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _statemach_read(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	void*            arb_data_ptr )
+{
+	bool     vote = VOTE_REQUIRED(trigger);
+	uint32_t seq;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( vote )
+	{
+		if ( take_mutex() != 0 )
+		{
+			ret = -EPERM;
+			goto bail;
+		}
+
+		ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE);
+
+		give_mutex();
+
+		if ( ret != 0 )
+		{
+			IPAERR("Voting failed TRIGGER(%s)\n",
+				   _state_mach_tbl[nati_obj_ptr->curr_state][trigger].trigger_as_str);
+			ret = -EINVAL;
+			goto bail;
+		}
+	}
+
+	ipa_nati_read_lock();
+
+	if ( RETRYABLE_TRIGGER(trigger) )
+	{
+		do
+		{
+			seq = ipa_nati_read_begin();
+
+			ret = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].sm_cb(
+				nati_obj_ptr, trigger, arb_data_ptr);
+
+		} while ( ipa_nati_read_retry(seq) );
+	}
+	else
+	{
+		ret = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].sm_cb(
+			nati_obj_ptr, trigger, arb_data_ptr);
+	}
+
+	ipa_nati_read_unlock();
+
+	if ( vote )
+	{
+		if ( take_mutex() == 0 )
+		{
+			if ( ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != 0 )
+			{
+				IPAERR("Devoting failed TRIGGER(%s)\n",
+					   _state_mach_tbl[nati_obj_ptr->curr_state][trigger].trigger_as_str);
+			}
+
+			give_mutex();
+		}
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 /******************************************************************************/
 /*
  * FUNCTION: ipa_nati_statemach
@@ -2653,6 +4700,15 @@ int ipa_nati_statemach(
 
 	IPADBG("In\n");
 
+	if ( READ_ONLY_TRIGGER(trigger) && ! nat_write_depth )
+	{
+		IPADBG("STATE(%s) TRIGGER(%s) CB(%s) lockless\n", ss_ptr, ts_ptr, cbs_ptr);
+
+		ret = _statemach_read(nati_obj_ptr, trigger, arb_data_ptr);
+
+		goto bail;
+	}
+
 	ret = take_mutex();
 
 	if ( ret != 0 )
@@ -2677,9 +4733,13 @@ int ipa_nati_statemach(
 		}
 	}
 
+	write_begin(trigger);
+
 	ret = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].sm_cb(
 		nati_obj_ptr, trigger, arb_data_ptr);
 
+	write_end();
+
 	if ( vote )
 	{
 		IPADBG("Voting clock off STATE(%s) TRIGGER(%s)\n",
@@ -2692,7 +4752,10 @@ int ipa_nati_statemach(
 	}
 
 unlock:
-	ret = give_mutex();
+	if ( give_mutex() != 0 )
+	{
+		ret = (ret) ? ret : -EPERM;
+	}
 
 bail:
 	IPADBG("Out\n");
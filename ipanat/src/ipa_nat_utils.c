@@ -38,6 +38,18 @@
 
 static char dbg_buff[IPA_MAX_MSG_LEN];
 
+int ipa_nat_log_lvl = IPA_NAT_DEFAULT_LOG_LEVEL;
+
+ipa_nat_log_level ipa_nat_set_log_level(
+	ipa_nat_log_level level)
+{
+	ipa_nat_log_level prev = (ipa_nat_log_level) ipa_nat_log_lvl;
+
+	ipa_nat_log_lvl = level;
+
+	return prev;
+}
+
 #if !defined(MSM_IPA_TESTS) && !defined(USE_GLIB) && !defined(FEATURE_IPA_ANDROID)
 size_t strlcpy(char* dst, const char* src, size_t size)
 {
@@ -70,7 +82,7 @@ ipa_descriptor* ipa_descriptor_open(void)
 		goto bail;
 	}
 
-	desc_ptr->fd = open(IPA_DEV_NAME, O_RDONLY);
+	desc_ptr->fd = ipa_nat_be_open(IPA_DEV_NAME, O_RDONLY);
 
 	if (desc_ptr->fd < 0)
 	{
@@ -78,7 +90,7 @@ ipa_descriptor* ipa_descriptor_open(void)
 		goto free;
 	}
 
-	res = ioctl(desc_ptr->fd, IPA_IOC_GET_HW_VERSION, &desc_ptr->ver);
+	res = ipa_nat_be_ioctl(desc_ptr->fd, IPA_IOC_GET_HW_VERSION, &desc_ptr->ver);
 
 	if (res == 0)
 	{
@@ -111,7 +123,7 @@ void ipa_descriptor_close(
 	{
 		if ( desc_ptr->fd >= 0)
 		{
-			close(desc_ptr->fd);
+			ipa_nat_be_close(desc_ptr->fd);
 		}
 		free(desc_ptr);
 	}
@@ -30,6 +30,7 @@
 #include "ipa_nat_utils.h"
 
 #include <errno.h>
+#include <stdlib.h>
 
 #define IPA_BASE_TABLE_PERCENTAGE       .8
 #define IPA_EXPANSION_TABLE_PERCENTAGE  .2
@@ -70,6 +71,29 @@ static int FindExpnTblFreeEntry(
 	void**     free_entry,
 	uint16_t*  entry_index );
 
+static void FillExpnFreeList(
+	ipa_table* table );
+
+static void ReleaseExpnTblEntry(
+	ipa_table* table,
+	uint16_t   entry_index );
+
+static bool FindBucketTail(
+	ipa_table*          table,
+	uint16_t            bucket,
+	ipa_table_iterator* iterator );
+
+static void ChainStatsAddRec(
+	ipa_table* table,
+	uint16_t   bucket );
+
+static void ChainStatsDelRec(
+	ipa_table* table,
+	uint16_t   bucket );
+
+static void ResetBucketInfo(
+	ipa_table* table );
+
 static int Get2PowerTightUpperBound(
 	uint16_t num);
 
@@ -221,6 +245,236 @@ void ipa_table_reset(
 	  table->expn_table_addr[i] = '\0';
 	}
 
+	FillExpnFreeList(table);
+
+	ResetBucketInfo(table);
+
+	IPADBG("Out\n");
+}
+
+/**
+ * ipa_table_create_expn_free_list() - allocates the free slot stack
+ * @table: [in] the table, with its entry counts already calculated
+ *
+ * Once allocated, open expansion slots are popped from, and returned
+ * to, the stack rather than found by walking the expansion table.
+ *
+ * Returns: 0 On Success, negative on failure
+ */
+int ipa_table_create_expn_free_list(
+	ipa_table* table)
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	table->expn_free_cnt  = 0;
+	table->expn_free_list = (uint16_t*)
+		calloc(table->expn_table_entries, sizeof(uint16_t));
+
+	if ( table->expn_free_list == NULL )
+	{
+		IPAERR("Unable to allocate %s expansion free list of %u entries\n",
+			   table->name, table->expn_table_entries);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	FillExpnFreeList(table);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+void ipa_table_destroy_expn_free_list(
+	ipa_table* table)
+{
+	IPADBG("In\n");
+
+	free(table->expn_free_list);
+
+	table->expn_free_list = NULL;
+	table->expn_free_cnt  = 0;
+
+	IPADBG("Out\n");
+}
+
+/**
+ * ipa_table_create_bucket_info() - allocates the per bucket book keeping
+ * @table: [in] the table, with its entry counts already calculated
+ *
+ * Once allocated, every record inserted or erased updates its
+ * bucket's tail and length, and the histogram of bucket lengths.
+ * Collisions are then appended without walking the chain, and the
+ * chain count, the total number of chained records, and the shortest
+ * and longest chain can be read straight out of the table.
+ *
+ * Returns: 0 On Success, negative on failure
+ */
+int ipa_table_create_bucket_info(
+	ipa_table* table)
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	table->bucket_tail = (uint16_t*)
+		calloc(table->table_entries, sizeof(uint16_t));
+
+	table->bucket_len = (uint16_t*)
+		calloc(table->table_entries, sizeof(uint16_t));
+
+	table->expn_bucket = (uint16_t*)
+		calloc(table->expn_table_entries + 1, sizeof(uint16_t));
+
+	/*
+	 * A bucket can hold its base record plus every expansion
+	 * record...
+	 */
+	table->chain_len_hist = (uint32_t*)
+		calloc(table->expn_table_entries + 2, sizeof(uint32_t));
+
+	if ( ! table->bucket_tail    ||
+		 ! table->bucket_len     ||
+		 ! table->expn_bucket    ||
+		 ! table->chain_len_hist )
+	{
+		IPAERR("Unable to allocate %s bucket info\n", table->name);
+		ipa_table_destroy_bucket_info(table);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	ResetBucketInfo(table);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+void ipa_table_destroy_bucket_info(
+	ipa_table* table)
+{
+	IPADBG("In\n");
+
+	free(table->bucket_tail);
+	free(table->bucket_len);
+	free(table->expn_bucket);
+	free(table->chain_len_hist);
+
+	table->bucket_tail    = NULL;
+	table->bucket_len     = NULL;
+	table->expn_bucket    = NULL;
+	table->chain_len_hist = NULL;
+
+	ResetBucketInfo(table);
+
+	IPADBG("Out\n");
+}
+
+/*
+ * A snapshot is a private copy of a table's records (and of its
+ * expansion meta data, if it has any) that can be walked while the
+ * real table keeps changing underneath.  It borrows the original's
+ * geometry and entry interface, so the usual GOTO_REC() and
+ * BREAK_RULE_HDL() work on it, but it has no free list and must never
+ * be handed to anything that generates dma commands.
+ */
+int ipa_table_snapshot_alloc(
+	ipa_table* table,
+	ipa_table* snap)
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	*snap = *table;
+
+	snap->expn_free_list = NULL;
+	snap->expn_free_cnt  = 0;
+	snap->meta           = NULL;
+	snap->bucket_tail    = NULL;
+	snap->bucket_len     = NULL;
+	snap->expn_bucket    = NULL;
+	snap->chain_len_hist = NULL;
+
+	snap->table_addr = (uint8_t*)
+		malloc(table->entry_size *
+			   (table->table_entries + table->expn_table_entries));
+
+	if ( snap->table_addr == NULL )
+	{
+		IPAERR("Unable to allocate %s snapshot\n", table->name);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	snap->expn_table_addr =
+		snap->table_addr + table->entry_size * table->table_entries;
+
+	if ( table->meta )
+	{
+		snap->meta =
+			malloc(table->meta_entry_size * table->expn_table_entries);
+
+		if ( snap->meta == NULL )
+		{
+			IPAERR("Unable to allocate %s snapshot meta\n", table->name);
+			ipa_table_snapshot_free(snap);
+			ret = -ENOMEM;
+			goto bail;
+		}
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Only copies.  Whether what was copied is coherent is for the caller
+ * to decide, see ipa_nati_read_begin()...
+ */
+void ipa_table_snapshot_take(
+	ipa_table* table,
+	ipa_table* snap)
+{
+	IPADBG("In\n");
+
+	memcpy(snap->table_addr,
+		   table->table_addr,
+		   table->entry_size *
+		   (table->table_entries + table->expn_table_entries));
+
+	if ( snap->meta )
+	{
+		memcpy(snap->meta,
+			   table->meta,
+			   table->meta_entry_size * table->expn_table_entries);
+	}
+
+	snap->cur_tbl_cnt      = table->cur_tbl_cnt;
+	snap->cur_expn_tbl_cnt = table->cur_expn_tbl_cnt;
+
+	IPADBG("Out\n");
+}
+
+void ipa_table_snapshot_free(
+	ipa_table* snap)
+{
+	IPADBG("In\n");
+
+	free(snap->table_addr);
+	free(snap->meta);
+
+	snap->table_addr      = NULL;
+	snap->expn_table_addr = NULL;
+	snap->meta            = NULL;
+
 	IPADBG("Out\n");
 }
 
@@ -382,6 +636,8 @@ void ipa_table_delete_entry(
 			memset(iterator->prev_entry, 0, table->entry_size);
 
 			--table->cur_tbl_cnt;
+
+			ChainStatsDelRec(table, iterator->prev_index);
 		}
 	}
 
@@ -394,21 +650,57 @@ void ipa_table_erase_entry(
 	ipa_table* table,
 	uint16_t   index)
 {
-	void* entry = GOTO_REC(table, index);
+	void*    entry = GOTO_REC(table, index);
+	uint16_t bucket, prev_index;
 
 	IPADBG("In\n");
 
 	IPADBG("table(%p) index(%u)\n", table, index);
 
+	bucket = ( index < table->table_entries ) ?
+		index :
+		( table->expn_bucket ) ?
+		table->expn_bucket[index - table->table_entries] :
+		IPA_TABLE_INVALID_ENTRY;
+
+	/*
+	 * When the tail goes, the record before it, if it's still there,
+	 * becomes the tail...
+	 */
+	if ( table->bucket_tail
+		 &&
+		 bucket < table->table_entries
+		 &&
+		 table->bucket_tail[bucket] == index )
+	{
+		prev_index = table->entry_interface->entry_get_prev_index(
+			entry, index, table->meta, table->table_entries);
+
+		table->bucket_tail[bucket] =
+			( index >= table->table_entries
+			  &&
+			  VALID_INDEX(prev_index)
+			  &&
+			  table->entry_interface->entry_is_valid(
+				  GOTO_REC(table, prev_index)) ) ?
+			prev_index : IPA_TABLE_INVALID_ENTRY;
+	}
+
 	memset(entry, 0, table->entry_size);
 
 	if ( index < table->table_entries )
 	{
 		--table->cur_tbl_cnt;
+
+		ChainStatsDelRec(table, index);
 	}
 	else
 	{
 		--table->cur_expn_tbl_cnt;
+
+		ChainStatsDelRec(table, bucket);
+
+		ReleaseExpnTblEntry(table, index);
 	}
 
 	IPADBG("Out\n");
@@ -507,6 +799,22 @@ bail:
 	return result;
 }
 
+/**
+ * ipa_table_get_entry_hdl() - returns the handle of the entry at an index
+ * @table: [in] the table
+ * @index: [in] absolute index of the entry
+ *
+ * The inverse of ipa_table_get_entry()
+ *
+ * Returns: the entry handle
+ */
+uint32_t ipa_table_get_entry_hdl(
+	ipa_table* table,
+	uint16_t   index )
+{
+	return MakeEntryHdl(table, index);
+}
+
 void ipa_table_dma_cmd_helper_init(
 	ipa_table_dma_cmd_helper* dma_cmd_helper,
 	uint8_t table_indx,
@@ -776,6 +1084,59 @@ int ipa_table_iterator_is_head_with_tail(
 	return ret;
 }
 
+/**
+ * ipa_table_get_chain_head() - find the base table slot a record hangs off
+ * @table: [in] the table
+ * @index: [in] absolute index of an occupied record
+ *
+ * Follows the prev_index linkage back to the base table, unless the
+ * bucket of each expansion slot is being tracked.  Records sharing a
+ * chain head share a hash bucket.
+ *
+ * Returns: the base table index, or IPA_TABLE_INVALID_ENTRY if the
+ * linkage is broken
+ */
+uint16_t ipa_table_get_chain_head(
+	ipa_table* table,
+	uint16_t   index)
+{
+	uint16_t hops = 0;
+
+	IPADBG("In\n");
+
+	if ( table->expn_bucket
+		 &&
+		 index >= table->table_entries
+		 &&
+		 index < table->tot_tbl_ents )
+	{
+		index = table->expn_bucket[index - table->table_entries];
+	}
+
+	while ( index >= table->table_entries )
+	{
+		if ( index >= table->tot_tbl_ents
+			 ||
+			 hops++ > table->expn_table_entries )
+		{
+			IPAERR("Broken list linkage at index %u in %s\n",
+				   index, table->name);
+			index = IPA_TABLE_INVALID_ENTRY;
+			break;
+		}
+
+		index = table->entry_interface->entry_get_prev_index(
+			GOTO_REC(table, index),
+			index,
+			table->meta,
+			table->table_entries);
+	}
+
+	IPADBG("Out\n");
+
+	return index;
+}
+
 static int InsertHead(
 	ipa_table*                  table,
 	void*                       rec_ptr,   /* empty record in table */
@@ -810,6 +1171,13 @@ static int InsertHead(
 
 	++table->cur_tbl_cnt;
 
+	if ( table->bucket_tail )
+	{
+		table->bucket_tail[rec_index] = rec_index;
+	}
+
+	ChainStatsAddRec(table, rec_index);
+
 bail:
 	IPADBG("Out\n");
 
@@ -836,15 +1204,20 @@ static int InsertTail(
 	/*
 	 * The most important side effect of the following is to set the
 	 * iterator's prev_index and prev_entry...which will be the last
-	 * valid entry on the end of the list.
+	 * valid entry on the end of the list.  When the bucket's tail is
+	 * known, and still looks like a tail, there's no need to walk
+	 * there...
 	 */
-	ret = ipa_table_iterator_end(&iterator, table, *rec_index_ptr, rec_ptr);
-
-	if ( ret )
+	if ( ! FindBucketTail(table, *rec_index_ptr, &iterator) )
 	{
-		IPAERR("Failed to reach the end of list following rec_index(%u) in %s\n",
-			   *rec_index_ptr, table->name);
-		goto bail;
+		ret = ipa_table_iterator_end(&iterator, table, *rec_index_ptr, rec_ptr);
+
+		if ( ret )
+		{
+			IPAERR("Failed to reach the end of list following rec_index(%u) in %s\n",
+				   *rec_index_ptr, table->name);
+			goto bail;
+		}
 	}
 
 	/*
@@ -883,6 +1256,7 @@ static int InsertTail(
 	if (ret)
 	{
 		IPAERR("Unable to insert a new entry to the tail in %s\n", table->name);
+		ReleaseExpnTblEntry(table, iterator.curr_index);
 		goto bail;
 	}
 
@@ -925,6 +1299,19 @@ static int InsertTail(
 
 	++table->cur_expn_tbl_cnt;
 
+	/*
+	 * On the way in, *rec_index_ptr is the bucket...
+	 */
+	if ( table->expn_bucket )
+	{
+		table->expn_bucket[iterator.curr_index - table->table_entries] =
+			*rec_index_ptr;
+
+		table->bucket_tail[*rec_index_ptr] = iterator.curr_index;
+
+		ChainStatsAddRec(table, *rec_index_ptr);
+	}
+
 	*rec_index_ptr = iterator.curr_index;
 
 bail:
@@ -1028,11 +1415,22 @@ static int FindExpnTblFreeEntry(
 	*entry_index = 0;
 	*free_entry  = NULL;
 
-	/*
-	 * The following will start walk at expansion slots
-	 * (ie. just after table->table_entries)...
-	 */
-	ret = ipa_table_walk(table, table->table_entries, WHEN_SLOT_EMPTY, mt_slot, 0);
+	if ( table->expn_free_list )
+	{
+		/*
+		 * Pop the next open slot, if any, off of the free stack...
+		 */
+		ret = ( table->expn_free_cnt ) ?
+			table->expn_free_list[--table->expn_free_cnt] : 0;
+	}
+	else
+	{
+		/*
+		 * The following will start walk at expansion slots
+		 * (ie. just after table->table_entries)...
+		 */
+		ret = ipa_table_walk(table, table->table_entries, WHEN_SLOT_EMPTY, mt_slot, 0);
+	}
 
 	if ( ret > 0 )
 	{
@@ -1074,6 +1472,268 @@ bail:
 	return ret;
 }
 
+/*
+ * Marks every expansion slot as free. The stack is filled from the
+ * top of the expansion table down, so that the lowest slot is handed
+ * out first, just as the table walk would.
+ */
+static void FillExpnFreeList(
+	ipa_table* table )
+{
+	uint16_t i;
+
+	if ( ! table->expn_free_list )
+	{
+		return;
+	}
+
+	table->expn_free_cnt = 0;
+
+	for ( i = table->expn_table_entries; i > 0; i-- )
+	{
+		table->expn_free_list[table->expn_free_cnt++] =
+			table->table_entries + i - 1;
+	}
+}
+
+/*
+ * Returns an expansion slot (absolute index) to the free stack
+ */
+static void ReleaseExpnTblEntry(
+	ipa_table* table,
+	uint16_t   entry_index )
+{
+	if ( ! table->expn_free_list || entry_index < table->table_entries )
+	{
+		return;
+	}
+
+	if ( table->expn_free_cnt >= table->expn_table_entries )
+	{
+		IPAERR("%s: Expansion free list overflow on index (%u)\n",
+			   table->name, entry_index);
+		return;
+	}
+
+	table->expn_free_list[table->expn_free_cnt++] = entry_index;
+}
+
+/*
+ * Sets the iterator's prev_index and prev_entry to the bucket's last
+ * record, as ipa_table_iterator_end() would.  Returns false if the
+ * tail isn't being tracked, or what's recorded doesn't hold up, in
+ * which case the caller walks.
+ */
+static bool FindBucketTail(
+	ipa_table*          table,
+	uint16_t            bucket,
+	ipa_table_iterator* iterator )
+{
+	uint16_t tail;
+	void*    tail_ptr;
+
+	if ( ! table->bucket_tail || bucket >= table->table_entries )
+	{
+		return false;
+	}
+
+	tail = table->bucket_tail[bucket];
+
+	if ( ! VALID_INDEX(tail) || tail >= table->tot_tbl_ents )
+	{
+		return false;
+	}
+
+	tail_ptr = GOTO_REC(table, tail);
+
+	if ( ! table->entry_interface->entry_is_valid(tail_ptr)
+		 ||
+		 VALID_INDEX(table->entry_interface->entry_get_next_index(tail_ptr)) )
+	{
+		IPADBG("Stale tail %u for bucket %u in %s\n",
+			   tail, bucket, table->name);
+		return false;
+	}
+
+	memset(iterator, 0, sizeof(ipa_table_iterator));
+
+	iterator->prev_index = tail;
+	iterator->prev_entry = tail_ptr;
+
+	return true;
+}
+
+/*
+ * Called with a record being added to, or deleted from, a bucket.
+ * Each keeps the histogram, the chain count, and the chained record
+ * count exact.  The longest and shortest chain are exact too, since a
+ * bucket's length only ever moves by one: when the last bucket of the
+ * longest length shrinks, the new longest is one less, and when the
+ * last of the shortest grows, the new shortest is one more.  The only
+ * search is when the last chain of two shrinks to one, and that's
+ * bounded by the longest chain rather than by the size of the table.
+ */
+static void ChainStatsAddRec(
+	ipa_table* table,
+	uint16_t   bucket )
+{
+	uint16_t old_len, new_len;
+
+	if ( ! table->bucket_len || bucket >= table->table_entries )
+	{
+		return;
+	}
+
+	old_len = table->bucket_len[bucket];
+	new_len = old_len + 1;
+
+	table->bucket_len[bucket] = new_len;
+
+	if ( old_len )
+	{
+		table->chain_len_hist[old_len]--;
+	}
+
+	table->chain_len_hist[new_len]++;
+
+	if ( new_len < 2 )
+	{
+		return;
+	}
+
+	if ( new_len == 2 )
+	{
+		table->tot_chains++;
+		table->tot_chain_ents += 2;
+	}
+	else
+	{
+		table->tot_chain_ents++;
+	}
+
+	if ( new_len > table->max_chain_len )
+	{
+		table->max_chain_len = new_len;
+	}
+
+	if ( table->min_chain_len == 0 || new_len < table->min_chain_len )
+	{
+		table->min_chain_len = new_len;
+	}
+	else if ( old_len == table->min_chain_len
+			  &&
+			  table->chain_len_hist[old_len] == 0 )
+	{
+		table->min_chain_len = new_len;
+	}
+}
+
+static void ChainStatsDelRec(
+	ipa_table* table,
+	uint16_t   bucket )
+{
+	uint16_t old_len, new_len, len;
+
+	if ( ! table->bucket_len
+		 ||
+		 bucket >= table->table_entries
+		 ||
+		 table->bucket_len[bucket] == 0 )
+	{
+		return;
+	}
+
+	old_len = table->bucket_len[bucket];
+	new_len = old_len - 1;
+
+	table->bucket_len[bucket] = new_len;
+
+	table->chain_len_hist[old_len]--;
+
+	if ( new_len )
+	{
+		table->chain_len_hist[new_len]++;
+	}
+
+	if ( old_len < 2 )
+	{
+		return;
+	}
+
+	if ( old_len == 2 )
+	{
+		table->tot_chains--;
+		table->tot_chain_ents -= 2;
+	}
+	else
+	{
+		table->tot_chain_ents--;
+	}
+
+	if ( old_len == table->max_chain_len
+		 &&
+		 table->chain_len_hist[old_len] == 0 )
+	{
+		table->max_chain_len = ( new_len >= 2 ) ? new_len : 0;
+	}
+
+	if ( new_len >= 2 )
+	{
+		if ( new_len < table->min_chain_len )
+		{
+			table->min_chain_len = new_len;
+		}
+	}
+	else if ( old_len == table->min_chain_len
+			  &&
+			  table->chain_len_hist[old_len] == 0 )
+	{
+		table->min_chain_len = 0;
+
+		for ( len = old_len + 1; len <= table->max_chain_len; len++ )
+		{
+			if ( table->chain_len_hist[len] )
+			{
+				table->min_chain_len = len;
+				break;
+			}
+		}
+	}
+}
+
+static void ResetBucketInfo(
+	ipa_table* table )
+{
+	if ( table->bucket_tail )
+	{
+		memset(table->bucket_tail, 0,
+			   table->table_entries * sizeof(uint16_t));
+	}
+
+	if ( table->bucket_len )
+	{
+		memset(table->bucket_len, 0,
+			   table->table_entries * sizeof(uint16_t));
+	}
+
+	if ( table->expn_bucket )
+	{
+		memset(table->expn_bucket, 0,
+			   (table->expn_table_entries + 1) * sizeof(uint16_t));
+	}
+
+	if ( table->chain_len_hist )
+	{
+		memset(table->chain_len_hist, 0,
+			   (table->expn_table_entries + 2) * sizeof(uint32_t));
+	}
+
+	table->tot_chains     = 0;
+	table->tot_chain_ents = 0;
+	table->min_chain_len  = 0;
+	table->max_chain_len  = 0;
+}
+
 /**
  * Get2PowerTightUpperBound() - Returns the tight upper bound which is a power of 2
  * @num: [in] given number
@@ -42,6 +42,21 @@ LOCAL_SRC_FILES := \
 		ipa_nat_test023.c \
 		ipa_nat_test024.c \
 		ipa_nat_test025.c \
+		ipa_nat_test026.c \
+		ipa_nat_test027.c \
+		ipa_nat_test028.c \
+		ipa_nat_test029.c \
+		ipa_nat_test030.c \
+		ipa_nat_test031.c \
+		ipa_nat_test032.c \
+		ipa_nat_test033.c \
+		ipa_nat_test034.c \
+		ipa_nat_test035.c \
+		ipa_nat_test036.c \
+		ipa_nat_test037.c \
+		ipa_nat_test038.c \
+		ipa_nat_test039.c \
+		ipa_nat_test040.c \
 		ipa_nat_test999.c \
 		main.c
 
@@ -52,6 +67,24 @@ LOCAL_MODULE_PATH := $(TARGET_OUT_DATA)/kernel-tests/ip_accelerator
 
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../ipanat/inc
+
+LOCAL_C_INCLUDES += $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include
+LOCAL_ADDITIONAL_DEPENDENCIES := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+LOCAL_MODULE := ipanatbench
+LOCAL_SRC_FILES := ipa_nat_bench.c
+
+LOCAL_SHARED_LIBRARIES := libipanat
+
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_PATH := $(TARGET_OUT_DATA)/kernel-tests/ip_accelerator
+
+include $(BUILD_EXECUTABLE)
+
 endif # $(TARGET_ARCH)
 endif
 endif
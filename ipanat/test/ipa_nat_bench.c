@@ -0,0 +1,982 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_bench.c
+
+	@brief
+	Throughput and latency benchmark for the ipv4 NAT table.
+
+	For each memory type, table size, tuple distribution and occupancy
+	asked for, a fresh table is created and filled to that occupancy,
+	each rule's timestamp is queried, then all rules are deleted.
+	Every add, query and delete is timed individually.  One CSV row is
+	written per combination, so that runs can be compared from release
+	to release.
+*/
+/*=========================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "ipa_nat_test.h"
+
+#undef strcasesame
+#define strcasesame(x, y) \
+	(! strcasecmp((x), (y)))
+
+#undef NSECS2USECS
+#define NSECS2USECS(n) \
+	( (double) (n) / 1000.0 )
+
+/*
+ * How the 5-tuples of the rules added are chosen:
+ *
+ *   uniform:   every field random
+ *
+ *   realistic: a home LAN talking to a small, skewed set of popular
+ *              servers, mostly on 443 and 80, with the public port
+ *              handed out sequentially as a NAT port allocator would
+ *
+ *   collide:   the XOR of the hashed fields is held constant, so every
+ *              rule lands in the same NAT and index table bucket and
+ *              the chain grows by one with each add
+ */
+typedef enum
+{
+	BENCH_DIST_UNIFORM   = 0,
+	BENCH_DIST_REALISTIC = 1,
+	BENCH_DIST_COLLIDE   = 2,
+	BENCH_DIST_MAX
+} bench_dist;
+
+static const char* bench_dist_str[BENCH_DIST_MAX] = {
+	"uniform",
+	"realistic",
+	"collide",
+};
+
+#define BENCH_NUM_SERVERS 64
+
+static uint32_t bench_servers[BENCH_NUM_SERVERS];
+
+#define BENCH_COLLIDE_PUB_KEY  0x5A5A
+#define BENCH_COLLIDE_PRIV_KEY 0x3C3C
+
+static void bench_make_rule(
+	bench_dist         dist,
+	uint32_t           i,
+	ipa_nat_ipv4_rule* rule_ptr )
+{
+	uint32_t r;
+
+	memset(rule_ptr, 0, sizeof(*rule_ptr));
+
+	switch ( dist )
+	{
+	case BENCH_DIST_REALISTIC:
+		/*
+		 * Squaring a uniform pick skews it towards the first few
+		 * servers, which is roughly what a household's traffic
+		 * looks like...
+		 */
+		r = rand() % BENCH_NUM_SERVERS;
+		rule_ptr->target_ip    = bench_servers[(r * r) / BENCH_NUM_SERVERS];
+		rule_ptr->private_ip   = htonl(0xC0A80100 | ((rand() % 253) + 2));
+		rule_ptr->private_port = (u16) (32768 + (rand() % 28232));
+		rule_ptr->public_port  = (u16) (1024 + (i % 64512));
+		r = rand() % 10;
+		rule_ptr->protocol     = ( r == 9 ) ? IPPROTO_UDP : IPPROTO_TCP;
+		rule_ptr->target_port  = ( r == 9 ) ? 53 : ( r >= 7 ) ? 80 : 443;
+		break;
+
+	case BENCH_DIST_COLLIDE:
+		rule_ptr->target_ip    = bench_servers[0];
+		rule_ptr->private_ip   = htonl(0xC0A80102);
+		rule_ptr->target_port  = (u16) (1024 + i);
+		rule_ptr->public_port  = rule_ptr->target_port ^ BENCH_COLLIDE_PUB_KEY;
+		rule_ptr->private_port = rule_ptr->target_port ^ BENCH_COLLIDE_PRIV_KEY;
+		rule_ptr->protocol     = IPPROTO_TCP;
+		break;
+
+	case BENCH_DIST_UNIFORM:
+	default:
+		rule_ptr->target_ip    = RAN_ADDR;
+		rule_ptr->target_port  = RAN_PORT;
+		rule_ptr->private_ip   = RAN_ADDR;
+		rule_ptr->private_port = RAN_PORT;
+		rule_ptr->public_port  = RAN_PORT;
+		rule_ptr->protocol     = ( rand() & 1 ) ? IPPROTO_TCP : IPPROTO_UDP;
+		break;
+	}
+}
+
+typedef struct
+{
+	uint32_t ops;
+	double   ops_per_sec;
+	double   p50_usecs;
+	double   p99_usecs;
+	uint64_t max_nsecs;
+} bench_lat;
+
+static int cmp_u64(
+	const void* a,
+	const void* b )
+{
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+
+	return ( x > y ) - ( x < y );
+}
+
+/*
+ * Sorts lat_ptr in place...
+ */
+static void bench_lat_summary(
+	uint64_t*  lat_ptr,
+	uint32_t   ops,
+	bench_lat* sum_ptr )
+{
+	uint64_t tot = 0;
+	uint32_t i;
+
+	memset(sum_ptr, 0, sizeof(*sum_ptr));
+
+	if ( ops == 0 )
+	{
+		return;
+	}
+
+	for ( i = 0; i < ops; i++ )
+	{
+		tot += lat_ptr[i];
+	}
+
+	qsort(lat_ptr, ops, sizeof(uint64_t), cmp_u64);
+
+	sum_ptr->ops         = ops;
+	sum_ptr->ops_per_sec = ( tot ) ? (double) ops * 1e9 / (double) tot : 0.0;
+	sum_ptr->p50_usecs   = NSECS2USECS(lat_ptr[(ops * 50) / 100]);
+	sum_ptr->p99_usecs   = NSECS2USECS(lat_ptr[(ops * 99) / 100]);
+	sum_ptr->max_nsecs   = lat_ptr[ops - 1];
+}
+
+static void bench_csv_header(
+	FILE* out )
+{
+	fprintf(out,
+			"mem_type,dist,entries,occupancy_pct,tot_ents,target_rules,rules,"
+			"add_ops_sec,add_p50_us,add_p99_us,"
+			"query_ops_sec,query_p50_us,query_p99_us,"
+			"del_ops_sec,del_p50_us,del_p99_us,"
+			"nat_chains,nat_chain_min,nat_chain_max,nat_chain_avg,nat_expn_filled,"
+			"idx_chains,idx_chain_min,idx_chain_max,idx_chain_avg,idx_expn_filled,"
+			"switch_to_ddr_us,switch_to_sram_us\n");
+}
+
+/*
+ * Runs one combination and writes its CSV row.  In HYBRID mode, the
+ * migration of the table between SRAM and DDR is carried out inside
+ * the add (or delete) that triggered it, so when the table's memory
+ * changed over a phase, that phase's slowest operation is reported as
+ * the switch time.
+ */
+static int bench_one(
+	FILE*       out,
+	const char* nat_mem_type,
+	u32         pub_ip_add,
+	int         total_entries,
+	int         occ_pct,
+	bench_dist  dist )
+{
+	ipa_nati_tbl_stats nstats, istats, tstats, unused;
+	ipa_nat_ipv4_rule  ipv4_rule;
+	bench_lat          add_sum, qry_sum, del_sum;
+
+	uint32_t  tbl_hdl = 0, time_stamp;
+	uint32_t* hdls    = NULL;
+	uint64_t* lat     = NULL;
+	uint64_t  start, stop;
+	uint32_t  target, added, i;
+
+	double switch_to_ddr = 0.0, switch_to_sram = 0.0;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+
+	if ( ret )
+	{
+		IPAERR("Unable to create %s table of %d entries\n",
+			   nat_mem_type, total_entries);
+		goto bail;
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &tstats, &unused);
+
+	if ( ret )
+	{
+		goto del_tbl;
+	}
+
+	/*
+	 * Occupancy is relative to the number of entries asked for,
+	 * rather than to what the table was actually sized to, so that
+	 * in HYBRID mode it means the same thing before and after the
+	 * move to DDR...
+	 */
+	target = ((uint32_t) total_entries * occ_pct) / 100;
+
+	hdls = calloc(target + 1, sizeof(uint32_t));
+	lat  = calloc(target + 1, sizeof(uint64_t));
+
+	if ( ! hdls || ! lat )
+	{
+		IPAERR("Can't allocate for %u rules\n", target);
+		ret = -ENOMEM;
+		goto del_tbl;
+	}
+
+	/*
+	 * Fill...stopping early, rather than failing, when the table
+	 * can't take any more.  The rules column says how far we got.
+	 */
+	for ( added = 0; added < target; added++ )
+	{
+		bench_make_rule(dist, added, &ipv4_rule);
+
+		currTimeAs(TimeAsNanSecs, &start);
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &hdls[added]);
+		currTimeAs(TimeAsNanSecs, &stop);
+
+		if ( ret )
+		{
+			ret = 0;
+			break;
+		}
+
+		lat[added] = stop - start;
+	}
+
+	bench_lat_summary(lat, added, &add_sum);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+	if ( ret )
+	{
+		goto del_rules;
+	}
+
+	if ( nstats.nmi != tstats.nmi )
+	{
+		switch_to_ddr = NSECS2USECS(add_sum.max_nsecs);
+	}
+
+	for ( i = 0; i < added; i++ )
+	{
+		currTimeAs(TimeAsNanSecs, &start);
+		ret = ipa_nat_query_timestamp(tbl_hdl, hdls[i], &time_stamp);
+		currTimeAs(TimeAsNanSecs, &stop);
+
+		if ( ret )
+		{
+			IPAERR("Query of rule %u failed\n", hdls[i]);
+			goto del_rules;
+		}
+
+		lat[i] = stop - start;
+	}
+
+	bench_lat_summary(lat, added, &qry_sum);
+
+	for ( i = 0; i < added; i++ )
+	{
+		currTimeAs(TimeAsNanSecs, &start);
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, hdls[i]);
+		currTimeAs(TimeAsNanSecs, &stop);
+
+		if ( ret )
+		{
+			IPAERR("Delete of rule %u failed\n", hdls[i]);
+			goto del_rules;
+		}
+
+		hdls[i] = 0;
+
+		lat[i] = stop - start;
+	}
+
+	bench_lat_summary(lat, added, &del_sum);
+
+	if ( nstats.nmi != tstats.nmi )
+	{
+		ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &tstats, &unused);
+
+		if ( ret )
+		{
+			goto del_tbl;
+		}
+
+		if ( tstats.nmi != nstats.nmi )
+		{
+			switch_to_sram = NSECS2USECS(del_sum.max_nsecs);
+		}
+	}
+
+	fprintf(out,
+			"%s,%s,%d,%d,%u,%u,%u,"
+			"%.0f,%.2f,%.2f,"
+			"%.0f,%.2f,%.2f,"
+			"%.0f,%.2f,%.2f,"
+			"%u,%u,%u,%.2f,%u,"
+			"%u,%u,%u,%.2f,%u,"
+			"%.2f,%.2f\n",
+			nat_mem_type, bench_dist_str[dist], total_entries, occ_pct,
+			nstats.tot_ents, target, added,
+			add_sum.ops_per_sec, add_sum.p50_usecs, add_sum.p99_usecs,
+			qry_sum.ops_per_sec, qry_sum.p50_usecs, qry_sum.p99_usecs,
+			del_sum.ops_per_sec, del_sum.p50_usecs, del_sum.p99_usecs,
+			nstats.tot_chains, nstats.min_chain_len, nstats.max_chain_len,
+			nstats.avg_chain_len, nstats.tot_expn_ents_filled,
+			istats.tot_chains, istats.min_chain_len, istats.max_chain_len,
+			istats.avg_chain_len, istats.tot_expn_ents_filled,
+			switch_to_ddr, switch_to_sram);
+
+	fflush(out);
+
+	goto del_tbl;
+
+del_rules:
+	/*
+	 * Only get here on error.  Try to leave nothing behind...
+	 */
+	for ( i = 0; i < added; i++ )
+	{
+		if ( hdls[i] )
+		{
+			ipa_nat_del_ipv4_rule(tbl_hdl, hdls[i]);
+		}
+	}
+
+del_tbl:
+	if ( ipa_nat_del_ipv4_tbl(tbl_hdl) && ret == 0 )
+	{
+		IPAERR("Unable to delete table %u\n", tbl_hdl);
+		ret = -EINVAL;
+	}
+
+bail:
+	free(hdls);
+	free(lat);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+static void bench_chain_csv_header(
+	FILE* out )
+{
+	fprintf(out,
+			"mem_type,entries,chain_len_from,chain_len_to,adds,"
+			"add_p50_us,add_p99_us\n");
+}
+
+/*
+ * Adds colliding rules to one bucket until the expansion table is
+ * full, then reports what the adds cost grouped by the length of the
+ * chain they extended: 1, 2-3, 4-7, and so on.  With the bucket's
+ * tail tracked, the cost should be flat...
+ */
+static int bench_chain_sweep(
+	FILE*       out,
+	const char* nat_mem_type,
+	u32         pub_ip_add,
+	int         total_entries,
+	int*        rows_ptr )
+{
+	ipa_nat_ipv4_rule ipv4_rule;
+	bench_lat         sum;
+
+	uint32_t  tbl_hdl = 0;
+	uint32_t* hdls    = NULL;
+	uint64_t* lat     = NULL;
+	uint64_t  start, stop;
+	uint32_t  added, from, to, i;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+
+	if ( ret )
+	{
+		IPAERR("Unable to create %s table of %d entries\n",
+			   nat_mem_type, total_entries);
+		goto bail;
+	}
+
+	hdls = calloc(total_entries + 1, sizeof(uint32_t));
+	lat  = calloc(total_entries + 1, sizeof(uint64_t));
+
+	if ( ! hdls || ! lat )
+	{
+		IPAERR("Can't allocate for %d rules\n", total_entries);
+		ret = -ENOMEM;
+		goto del_tbl;
+	}
+
+	for ( added = 0; added < (uint32_t) total_entries; added++ )
+	{
+		bench_make_rule(BENCH_DIST_COLLIDE, added, &ipv4_rule);
+
+		currTimeAs(TimeAsNanSecs, &start);
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &hdls[added]);
+		currTimeAs(TimeAsNanSecs, &stop);
+
+		if ( ret )
+		{
+			ret = 0;
+			break;
+		}
+
+		lat[added] = stop - start;
+	}
+
+	/*
+	 * Add number i made the chain i + 1 long...
+	 */
+	for ( from = 1; from <= added; from *= 2 )
+	{
+		to = ( from * 2 - 1 < added ) ? from * 2 - 1 : added;
+
+		bench_lat_summary(&lat[from - 1], to - from + 1, &sum);
+
+		fprintf(out, "%s,%d,%u,%u,%u,%.2f,%.2f\n",
+				nat_mem_type, total_entries, from, to, sum.ops,
+				sum.p50_usecs, sum.p99_usecs);
+
+		(*rows_ptr)++;
+	}
+
+	fflush(out);
+
+	for ( i = 0; i < added; i++ )
+	{
+		ret |= ipa_nat_del_ipv4_rule(tbl_hdl, hdls[i]);
+	}
+
+del_tbl:
+	if ( ipa_nat_del_ipv4_tbl(tbl_hdl) && ret == 0 )
+	{
+		IPAERR("Unable to delete table %u\n", tbl_hdl);
+		ret = -EINVAL;
+	}
+
+bail:
+	free(hdls);
+	free(lat);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+static void bench_scan_csv_header(
+	FILE* out )
+{
+	fprintf(out,
+			"mem_type,entries,occupancy_pct,tot_ents,rules,kernel,"
+			"walk_p50_us,scan_p50_us,scan_scalar_p50_us,changed_p50_us\n");
+}
+
+#define BENCH_SCAN_REPS 50
+
+typedef struct
+{
+	ipa_nat_rule_time_stamp* found;
+	uint32_t                 num_found;
+} bench_walk_data;
+
+/*
+ * What the scans do, done one callback per record...
+ */
+static int bench_walk_cb(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	struct ipa_nat_rule* rule_ptr = (struct ipa_nat_rule*) record_ptr;
+	bench_walk_data*     wd_ptr   = (bench_walk_data*) arb_data_ptr;
+
+	UNUSED(table_ptr);
+	UNUSED(record_index);
+	UNUSED(meta_record_ptr);
+	UNUSED(meta_record_index);
+
+	if ( rule_ptr->enable && rule_ptr->protocol != IPAHAL_NAT_INVALID_PROTOCOL )
+	{
+		wd_ptr->found[wd_ptr->num_found].rule_hdl   = rule_hdl;
+		wd_ptr->found[wd_ptr->num_found].time_stamp = rule_ptr->time_stamp;
+		wd_ptr->num_found++;
+	}
+
+	return 0;
+}
+
+/*
+ * Fills a table to each occupancy asked for, then times reading every
+ * rule's time stamp four ways: walking the table with a callback per
+ * record, the record scan with whichever vector unit the library was
+ * built for, the same scan forced to scalar, and asking only for what
+ * changed, when nothing did...
+ */
+static int bench_scan(
+	FILE*       out,
+	const char* nat_mem_type,
+	u32         pub_ip_add,
+	int         total_entries,
+	const int*  occs,
+	int         num_occs,
+	int*        rows_ptr )
+{
+	ipa_nati_tbl_stats       nstats, istats;
+	ipa_nat_ipv4_rule        ipv4_rule;
+	ipa_nat_rule_time_stamp* found  = NULL;
+	ipa_nat_ts_shadow*       shadow = NULL;
+	bench_walk_data          wd;
+	bench_lat                walk_sum, scan_sum, scalar_sum, chg_sum;
+
+	uint32_t  tbl_hdl = 0, max_found, num_found;
+	uint32_t* hdls    = NULL;
+	uint64_t  lat[4][BENCH_SCAN_REPS];
+	uint64_t  start, stop;
+	uint32_t  target, added = 0, r, i;
+	int       o;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+
+	if ( ret )
+	{
+		IPAERR("Unable to create %s table of %d entries\n",
+			   nat_mem_type, total_entries);
+		goto bail;
+	}
+
+	max_found = (uint32_t) total_entries + 1;
+
+	hdls  = calloc(total_entries + 1, sizeof(uint32_t));
+	found = calloc(max_found, sizeof(ipa_nat_rule_time_stamp));
+
+	if ( ! hdls || ! found )
+	{
+		IPAERR("Can't allocate for %d rules\n", total_entries);
+		ret = -ENOMEM;
+		goto del_tbl;
+	}
+
+	for ( o = 0; o < num_occs && ret == 0; o++ )
+	{
+		target = ((uint32_t) total_entries * occs[o]) / 100;
+
+		for ( ; added < target; added++ )
+		{
+			bench_make_rule(BENCH_DIST_UNIFORM, added, &ipv4_rule);
+
+			if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &hdls[added]) )
+			{
+				break;
+			}
+		}
+
+		ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+		if ( ret )
+		{
+			break;
+		}
+
+		/*
+		 * Have the shadow match the table...
+		 */
+		ret = ipa_nat_query_changed_timestamps(
+			tbl_hdl, &shadow, found, max_found, &num_found);
+
+		for ( r = 0; r < BENCH_SCAN_REPS && ret == 0; r++ )
+		{
+			wd.found     = found;
+			wd.num_found = 0;
+
+			currTimeAs(TimeAsNanSecs, &start);
+			ret = ipa_nati_walk_ipv4_tbl(tbl_hdl, USE_NAT_TABLE, bench_walk_cb, &wd);
+			currTimeAs(TimeAsNanSecs, &stop);
+
+			lat[0][r] = stop - start;
+
+			ipa_nati_scan_force_scalar(false);
+
+			currTimeAs(TimeAsNanSecs, &start);
+			ret |= ipa_nat_query_all_timestamps(tbl_hdl, found, max_found, &num_found);
+			currTimeAs(TimeAsNanSecs, &stop);
+
+			lat[1][r] = stop - start;
+
+			ipa_nati_scan_force_scalar(true);
+
+			currTimeAs(TimeAsNanSecs, &start);
+			ret |= ipa_nat_query_all_timestamps(tbl_hdl, found, max_found, &num_found);
+			currTimeAs(TimeAsNanSecs, &stop);
+
+			lat[2][r] = stop - start;
+
+			ipa_nati_scan_force_scalar(false);
+
+			currTimeAs(TimeAsNanSecs, &start);
+			ret |= ipa_nat_query_changed_timestamps(
+				tbl_hdl, &shadow, found, max_found, &num_found);
+			currTimeAs(TimeAsNanSecs, &stop);
+
+			lat[3][r] = stop - start;
+		}
+
+		if ( ret )
+		{
+			IPAERR("Scan of %s table of %d entries failed\n",
+				   nat_mem_type, total_entries);
+			break;
+		}
+
+		bench_lat_summary(lat[0], BENCH_SCAN_REPS, &walk_sum);
+		bench_lat_summary(lat[1], BENCH_SCAN_REPS, &scan_sum);
+		bench_lat_summary(lat[2], BENCH_SCAN_REPS, &scalar_sum);
+		bench_lat_summary(lat[3], BENCH_SCAN_REPS, &chg_sum);
+
+		fprintf(out, "%s,%d,%d,%u,%u,%s,%.2f,%.2f,%.2f,%.2f\n",
+				nat_mem_type, total_entries, occs[o], nstats.tot_ents, added,
+				ipa_nati_scan_isa(),
+				walk_sum.p50_usecs, scan_sum.p50_usecs,
+				scalar_sum.p50_usecs, chg_sum.p50_usecs);
+
+		fflush(out);
+
+		(*rows_ptr)++;
+	}
+
+	ipa_nat_free_ts_shadow(shadow);
+
+	for ( i = 0; i < added; i++ )
+	{
+		ipa_nat_del_ipv4_rule(tbl_hdl, hdls[i]);
+	}
+
+del_tbl:
+	if ( ipa_nat_del_ipv4_tbl(tbl_hdl) && ret == 0 )
+	{
+		IPAERR("Unable to delete table %u\n", tbl_hdl);
+		ret = -EINVAL;
+	}
+
+bail:
+	free(hdls);
+	free(found);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * Parses a comma separated list of numbers into vals_ptr.  Returns the
+ * number parsed or zero on error.
+ */
+static int bench_parse_list(
+	const char* list_ptr,
+	int*        vals_ptr,
+	int         max_vals,
+	int         min_val,
+	int         max_val )
+{
+	char  buf[256];
+	char* tok;
+	char* save;
+	int   cnt = 0;
+
+	strlcpy(buf, list_ptr, sizeof(buf));
+
+	for ( tok = strtok_r(buf, ",", &save);
+		  tok;
+		  tok = strtok_r(NULL, ",", &save) )
+	{
+		int v = atoi(tok);
+
+		if ( cnt == max_vals || v < min_val || v > max_val )
+		{
+			return 0;
+		}
+
+		vals_ptr[cnt++] = v;
+	}
+
+	return cnt;
+}
+
+static const char* bench_mem_type(
+	const char* mt )
+{
+	if ( strcasesame(mt, "DDR") )    return "DDR";
+	if ( strcasesame(mt, "SRAM") )   return "SRAM";
+	if ( strcasesame(mt, "HYBRID") ) return "HYBRID";
+	return NULL;
+}
+
+static void
+_dispUsage(
+	const char* progNamePtr )
+{
+	printf(
+		"Usage: %s [-x -w -m mt -e N,.. -o N,.. -t dist -c file -l N -s N -S N]\n"
+		"Where:\n"
+		"  -x      Instead, sweep the cost of an add against the length of\n"
+		"          the chain it extends (-o and -t don't apply)\n"
+		"  -w      Instead, compare the ways of reading every rule's time\n"
+		"          stamp at each occupancy (-t doesn't apply)\n"
+		"  -m mt   Where mt is the type of memory to use for the NAT\n"
+		"          Legal mt's: DDR, SRAM, or HYBRID (ie. use SRAM and DDR)\n"
+		"  -e N,.. Comma separated table sizes (default 100,1000)\n"
+		"  -o N,.. Comma separated occupancy levels, as a percentage of\n"
+		"          the table size (default 25,50,75,90)\n"
+		"  -t dist Tuple distribution: uniform, realistic, collide or all\n"
+		"          (default all)\n"
+		"  -c file Where to write the CSV, - being stdout\n"
+		"          (default ipanatbench.csv)\n"
+		"  -l N    Where N is the log level (0 err, 1 warn, 2 info, 3 debug)\n"
+		"          (default 0)\n"
+		"  -s N    Run against the simulated IPA driver rather than the kernel,\n"
+		"          where N is the SRAM size (in bytes) it's to report for NAT\n"
+		"  -S N    Seed for the tuple generator (default time of day)\n",
+		progNamePtr);
+
+	fflush(stdout);
+}
+
+#define BENCH_MAX_LIST 16
+
+int main(
+	int   argc,
+	char* argv[] )
+{
+	int sizes[BENCH_MAX_LIST] = { 100, 1000 };
+	int occs[BENCH_MAX_LIST]  = { 25, 50, 75, 90 };
+	int num_sizes = 2, num_occs = 4;
+
+	int dist_lo = 0, dist_hi = BENCH_DIST_MAX;
+
+	bool chain_sweep = false;
+	bool scan_sweep  = false;
+
+	const char* nat_mem_type = "DDR";
+	const char* csv_path     = "ipanatbench.csv";
+
+	unsigned int seed = (unsigned int) time(NULL);
+
+	uint32_t pub_ip_addr;
+
+	FILE* out;
+
+	int s, o, d, c, rows = 0, ret = 0;
+
+	ipa_nat_set_log_level(IPA_NAT_LOG_ERR);
+
+	while ( (c = getopt(argc, argv, "xwm:e:o:t:c:l:s:S:?")) != -1 )
+	{
+		switch (c)
+		{
+		case 'x':
+			chain_sweep = true;
+			break;
+		case 'w':
+			scan_sweep = true;
+			break;
+		case 'm':
+			if ( ! (nat_mem_type = bench_mem_type(optarg)) )
+			{
+				fprintf(stderr, "Illegal: -m %s\n", optarg);
+				_dispUsage(basename(argv[0]));
+				exit(0);
+			}
+			break;
+		case 'e':
+			if ( ! (num_sizes = bench_parse_list(optarg, sizes, BENCH_MAX_LIST, 1, 0xFFFF)) )
+			{
+				fprintf(stderr, "Illegal: -e %s\n", optarg);
+				_dispUsage(basename(argv[0]));
+				exit(0);
+			}
+			break;
+		case 'o':
+			if ( ! (num_occs = bench_parse_list(optarg, occs, BENCH_MAX_LIST, 1, 100)) )
+			{
+				fprintf(stderr, "Illegal: -o %s\n", optarg);
+				_dispUsage(basename(argv[0]));
+				exit(0);
+			}
+			break;
+		case 't':
+			for ( d = 0; d < BENCH_DIST_MAX; d++ )
+			{
+				if ( strcasesame(optarg, bench_dist_str[d]) )
+				{
+					break;
+				}
+			}
+			if ( d < BENCH_DIST_MAX )
+			{
+				dist_lo = d;
+				dist_hi = d + 1;
+			}
+			else if ( ! strcasesame(optarg, "all") )
+			{
+				fprintf(stderr, "Illegal: -t %s\n", optarg);
+				_dispUsage(basename(argv[0]));
+				exit(0);
+			}
+			break;
+		case 'c':
+			csv_path = optarg;
+			break;
+		case 'l':
+			ipa_nat_set_log_level((ipa_nat_log_level) atoi(optarg));
+			break;
+		case 's':
+			if ( ipa_nat_set_backend(IPA_NAT_BACKEND_SIM) ||
+				 ipa_nat_sim_set_sram_size(atoi(optarg)) )
+			{
+				fprintf(stderr, "Illegal: -s %s\n", optarg);
+				_dispUsage(basename(argv[0]));
+				exit(0);
+			}
+			break;
+		case 'S':
+			seed = (unsigned int) strtoul(optarg, NULL, 0);
+			break;
+		case '?':
+		default:
+			_dispUsage(basename(argv[0]));
+			exit(0);
+			break;
+		}
+	}
+
+	out = ( strcmp(csv_path, "-") ) ? fopen(csv_path, "w") : stdout;
+
+	if ( ! out )
+	{
+		fprintf(stderr, "Can't open %s: %s\n", csv_path, strerror(errno));
+		return 1;
+	}
+
+	srand(seed);
+
+	pub_ip_addr = RAN_ADDR;
+
+	for ( s = 0; s < BENCH_NUM_SERVERS; s++ )
+	{
+		bench_servers[s] = RAN_ADDR;
+	}
+
+	if ( chain_sweep )
+	{
+		bench_chain_csv_header(out);
+
+		for ( s = 0; s < num_sizes && ret == 0; s++ )
+		{
+			ret = bench_chain_sweep(
+				out, nat_mem_type, pub_ip_addr, sizes[s], &rows);
+		}
+	}
+	else if ( scan_sweep )
+	{
+		bench_scan_csv_header(out);
+
+		for ( s = 0; s < num_sizes && ret == 0; s++ )
+		{
+			ret = bench_scan(
+				out, nat_mem_type, pub_ip_addr, sizes[s], occs, num_occs, &rows);
+		}
+	}
+	else
+	{
+		bench_csv_header(out);
+	}
+
+	for ( s = 0; s < num_sizes && ret == 0 && ! chain_sweep && ! scan_sweep; s++ )
+	{
+		for ( d = dist_lo; d < dist_hi && ret == 0; d++ )
+		{
+			for ( o = 0; o < num_occs && ret == 0; o++ )
+			{
+				ret = bench_one(
+					out, nat_mem_type, pub_ip_addr,
+					sizes[s], occs[o], (bench_dist) d);
+
+				rows += ( ret == 0 );
+			}
+		}
+	}
+
+	if ( out != stdout )
+	{
+		fclose(out);
+
+		printf("%d rows written to %s (seed %u)\n", rows, csv_path, seed);
+	}
+
+	return ( ret ) ? 1 : 0;
+}
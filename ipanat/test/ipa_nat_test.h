@@ -112,6 +112,15 @@ static inline u16 rand_ip_port()
 		return -1;													 \
 	}
 
+#define CHECK_ERR_V6_STOP(x, th)									 \
+	if ( x ) {														 \
+		IPAERR("Abrupt end of %s with "								 \
+			   "err: %d at line: %d\n",								 \
+			   __FUNCTION__, x, __LINE__);							 \
+		ipa_ipv6ct_del_tbl(th);										 \
+		return -1;													 \
+	}
+
 #define CHECK_ERR_TBL_ACTION(x, th, action)							 \
 	if ( th ) {														 \
 		int _ter_ = ipa_nat_validate_ipv4_table(th);				 \
@@ -177,4 +186,19 @@ int ipa_nat_test022(const char*, u32, int, u32, int, void*);
 int ipa_nat_test023(const char*, u32, int, u32, int, void*);
 int ipa_nat_test024(const char*, u32, int, u32, int, void*);
 int ipa_nat_test025(const char*, u32, int, u32, int, void*);
+int ipa_nat_test026(const char*, u32, int, u32, int, void*);
+int ipa_nat_test027(const char*, u32, int, u32, int, void*);
+int ipa_nat_test028(const char*, u32, int, u32, int, void*);
+int ipa_nat_test029(const char*, u32, int, u32, int, void*);
+int ipa_nat_test030(const char*, u32, int, u32, int, void*);
+int ipa_nat_test031(const char*, u32, int, u32, int, void*);
+int ipa_nat_test032(const char*, u32, int, u32, int, void*);
+int ipa_nat_test033(const char*, u32, int, u32, int, void*);
+int ipa_nat_test034(const char*, u32, int, u32, int, void*);
+int ipa_nat_test035(const char*, u32, int, u32, int, void*);
+int ipa_nat_test036(const char*, u32, int, u32, int, void*);
+int ipa_nat_test037(const char*, u32, int, u32, int, void*);
+int ipa_nat_test038(const char*, u32, int, u32, int, void*);
+int ipa_nat_test039(const char*, u32, int, u32, int, void*);
+int ipa_nat_test040(const char*, u32, int, u32, int, void*);
 int ipa_nat_test999(const char*, u32, int, u32, int, void*);
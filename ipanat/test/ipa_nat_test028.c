@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test028.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add a batch of ipv4 rules
+	3. Query their timestamps in bulk and compare against the
+	   single rule query
+	4. Query the timestamps of the whole table and verify each
+	   rule is reported exactly once
+	5. Delete the rules and the ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_TS_RULES 8
+
+int ipa_nat_test028(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule       ipv4_rules[NUM_TS_RULES];
+	u32                     rule_hdls[NUM_TS_RULES];
+	u32                     time_stamps[NUM_TS_RULES];
+	ipa_nat_rule_time_stamp all_time_stamps[NUM_TS_RULES];
+	u32                     num_found, time_stamp;
+
+	u32 i, j, hits;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	memset(ipv4_rules, 0, sizeof(ipv4_rules));
+
+	for ( i = 0; i < NUM_TS_RULES; i++ )
+	{
+		ipv4_rules[i].target_ip    = RAN_ADDR;
+		ipv4_rules[i].target_port  = RAN_PORT;
+		ipv4_rules[i].private_ip   = RAN_ADDR;
+		ipv4_rules[i].private_port = RAN_PORT;
+		ipv4_rules[i].protocol     = IPPROTO_TCP;
+		ipv4_rules[i].public_port  = RAN_PORT;
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_add_ipv4_rules(tbl_hdl, ipv4_rules, NUM_TS_RULES, rule_hdls);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_query_timestamps(tbl_hdl, rule_hdls, NUM_TS_RULES, time_stamps);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < NUM_TS_RULES; i++ )
+	{
+		ret = ipa_nat_query_timestamp(tbl_hdl, rule_hdls[i], &time_stamp);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		CHECK_ERR_TBL_STOP(time_stamp != time_stamps[i], tbl_hdl);
+	}
+
+	ret = ipa_nat_query_all_timestamps(
+		tbl_hdl, all_time_stamps, NUM_TS_RULES, &num_found);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	CHECK_ERR_TBL_STOP(num_found != NUM_TS_RULES, tbl_hdl);
+
+	for ( i = 0; i < NUM_TS_RULES; i++ )
+	{
+		for ( j = hits = 0; j < num_found; j++ )
+		{
+			hits += (all_time_stamps[j].rule_hdl == rule_hdls[i]);
+		}
+
+		CHECK_ERR_TBL_STOP(hits != 1, tbl_hdl);
+	}
+
+	/*
+	 * Too small an array must be reported...
+	 */
+	ret = ipa_nat_query_all_timestamps(
+		tbl_hdl, all_time_stamps, NUM_TS_RULES - 1, &num_found);
+	CHECK_ERR_TBL_STOP(ret == 0, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rules(tbl_hdl, rule_hdls, NUM_TS_RULES);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test029.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add ipv4 rules
+	3. Find each rule by its tuple and verify the handle
+	4. Delete a rule and verify it can no longer be found
+	5. Verify a tuple differing only in pdn is not found
+	6. Delete the remaining rules and the ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_FIND_RULES 8
+
+int ipa_nat_test029(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule ipv4_rules[NUM_FIND_RULES];
+	ipa_nat_ipv4_rule other_rule;
+	u32               rule_hdls[NUM_FIND_RULES];
+	u32               found_hdl;
+
+	u32 i;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	memset(ipv4_rules, 0, sizeof(ipv4_rules));
+
+	for ( i = 0; i < NUM_FIND_RULES; i++ )
+	{
+		ipv4_rules[i].target_ip    = RAN_ADDR;
+		ipv4_rules[i].target_port  = RAN_PORT;
+		ipv4_rules[i].private_ip   = RAN_ADDR;
+		ipv4_rules[i].private_port = RAN_PORT;
+		ipv4_rules[i].protocol     = IPPROTO_TCP;
+		ipv4_rules[i].public_port  = RAN_PORT;
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	for ( i = 0; i < NUM_FIND_RULES; i++ )
+	{
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rules[i], &rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	for ( i = 0; i < NUM_FIND_RULES; i++ )
+	{
+		ret = ipa_nat_find_ipv4_rule(tbl_hdl, &ipv4_rules[i], &found_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		CHECK_ERR_TBL_STOP(found_hdl != rule_hdls[i], tbl_hdl);
+	}
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[0]);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_find_ipv4_rule(tbl_hdl, &ipv4_rules[0], &found_hdl);
+	CHECK_ERR_TBL_STOP(ret == 0, tbl_hdl);
+
+	other_rule = ipv4_rules[1];
+	other_rule.pdn_index++;
+
+	ret = ipa_nat_find_ipv4_rule(tbl_hdl, &other_rule, &found_hdl);
+	CHECK_ERR_TBL_STOP(ret == 0, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rules(tbl_hdl, &rule_hdls[1], NUM_FIND_RULES - 1);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 1; i < NUM_FIND_RULES; i++ )
+	{
+		ret = ipa_nat_find_ipv4_rule(tbl_hdl, &ipv4_rules[i], &found_hdl);
+		CHECK_ERR_TBL_STOP(ret == 0, tbl_hdl);
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
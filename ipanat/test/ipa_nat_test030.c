@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test030.c
+
+	@brief
+	Verify the following scenario:
+	1. With logging at error level only, log at each lower level, and
+	   check none of the messages' arguments were evaluated
+	2. With logging at info level, check only the debug message's
+	   arguments were not evaluated
+	3. With logging at debug level, check every message's arguments
+	   were evaluated (debug only when it is compiled in)
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+static u32 num_formatted;
+
+/*
+ * Stands in for an argument that is costly to work out...
+ */
+static u32 formatted(void)
+{
+	return ++num_formatted;
+}
+
+static u32 log_each_level(void)
+{
+	num_formatted = 0;
+
+	IPAWARN("Suppression check, warning (%u)\n", formatted());
+	IPAINFO("Suppression check, info (%u)\n", formatted());
+	IPADBG("Suppression check, debug (%u)\n", formatted());
+
+	return num_formatted;
+}
+
+int ipa_nat_test030(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	ipa_nat_log_level prev_level;
+	u32               num_err, num_info, num_dbg;
+
+	UNUSED(nat_mem_type);
+	UNUSED(pub_ip_add);
+	UNUSED(total_entries);
+	UNUSED(tbl_hdl);
+	UNUSED(sep);
+	UNUSED(arb_data_ptr);
+
+	IPADBG("In\n");
+
+	prev_level = ipa_nat_set_log_level(IPA_NAT_LOG_ERR);
+
+	num_err = log_each_level();
+
+	ipa_nat_set_log_level(IPA_NAT_LOG_INFO);
+
+	num_info = log_each_level();
+
+	ipa_nat_set_log_level(IPA_NAT_LOG_DBG);
+
+	num_dbg = log_each_level();
+
+	ipa_nat_set_log_level(prev_level);
+
+	IPADBG("Arguments evaluated: err(%u) info(%u) dbg(%u)\n",
+		   num_err, num_info, num_dbg);
+
+	CHECK_ERR(num_err != 0);
+	CHECK_ERR(num_info != 2);
+#ifdef NAT_DEBUG
+	CHECK_ERR(num_dbg != 3);
+#else
+	CHECK_ERR(num_dbg != 2);
+#endif
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test031.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add a set of ipv4 rules that will stay put
+	3. Start a thread that continuously queries the time stamps of
+	   those rules, walks the table and gathers its stats
+	4. Meanwhile, repeatedly add and delete other rules
+	5. Stop the thread and verify none of its reads failed and that
+	   every walk saw the rules that stayed put
+	6. Delete the rules and the ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#include <pthread.h>
+
+#define NUM_STABLE_RULES  8
+#define NUM_CHURN_RULES  16
+#define NUM_CHURN_ROUNDS 64
+
+typedef struct
+{
+	u32           tbl_hdl;
+	u32*          rule_hdls;
+	volatile bool stop;
+	u32           reads;
+	u32           errors;
+} reader_args;
+
+static int count_rules(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	u32* cnt_ptr = (u32*) arb_data_ptr;
+
+	UNUSED(table_ptr);
+	UNUSED(rule_hdl);
+	UNUSED(record_ptr);
+	UNUSED(record_index);
+	UNUSED(meta_record_ptr);
+	UNUSED(meta_record_index);
+
+	(*cnt_ptr)++;
+
+	return 0;
+}
+
+static void* reader(
+	void* arg )
+{
+	reader_args* ra = (reader_args*) arg;
+
+	u32 time_stamps[NUM_STABLE_RULES];
+	u32 cnt;
+
+	ipa_nati_tbl_stats nstats, istats;
+
+	while ( ! ra->stop )
+	{
+		if ( ipa_nat_query_timestamps(
+				 ra->tbl_hdl, ra->rule_hdls, NUM_STABLE_RULES, time_stamps) )
+		{
+			ra->errors++;
+		}
+
+		cnt = 0;
+
+		if ( ipa_nati_walk_ipv4_tbl(ra->tbl_hdl, USE_NAT_TABLE, count_rules, &cnt)
+			 ||
+			 cnt < NUM_STABLE_RULES )
+		{
+			ra->errors++;
+		}
+
+		if ( ipa_nati_ipv4_tbl_stats(ra->tbl_hdl, &nstats, &istats)
+			 ||
+			 nstats.tot_base_ents_filled + nstats.tot_expn_ents_filled < NUM_STABLE_RULES )
+		{
+			ra->errors++;
+		}
+
+		ra->reads++;
+	}
+
+	return NULL;
+}
+
+int ipa_nat_test031(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule stable_rules[NUM_STABLE_RULES];
+	u32               stable_hdls[NUM_STABLE_RULES];
+	ipa_nat_ipv4_rule churn_rules[NUM_CHURN_RULES];
+	u32               churn_hdls[NUM_CHURN_RULES];
+
+	reader_args ra;
+	pthread_t   thrd;
+
+	u32 i, round;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	memset(stable_rules, 0, sizeof(stable_rules));
+	memset(churn_rules,  0, sizeof(churn_rules));
+
+	for ( i = 0; i < NUM_STABLE_RULES; i++ )
+	{
+		stable_rules[i].target_ip    = RAN_ADDR;
+		stable_rules[i].target_port  = RAN_PORT;
+		stable_rules[i].private_ip   = RAN_ADDR;
+		stable_rules[i].private_port = RAN_PORT;
+		stable_rules[i].protocol     = IPPROTO_TCP;
+		stable_rules[i].public_port  = RAN_PORT;
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_add_ipv4_rules(tbl_hdl, stable_rules, NUM_STABLE_RULES, stable_hdls);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	memset(&ra, 0, sizeof(ra));
+
+	ra.tbl_hdl   = tbl_hdl;
+	ra.rule_hdls = stable_hdls;
+
+	ret = pthread_create(&thrd, NULL, reader, &ra);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( round = 0; round < NUM_CHURN_ROUNDS; round++ )
+	{
+		for ( i = 0; i < NUM_CHURN_RULES; i++ )
+		{
+			churn_rules[i].target_ip    = RAN_ADDR;
+			churn_rules[i].target_port  = RAN_PORT;
+			churn_rules[i].private_ip   = RAN_ADDR;
+			churn_rules[i].private_port = RAN_PORT;
+			churn_rules[i].protocol     = IPPROTO_UDP;
+			churn_rules[i].public_port  = RAN_PORT;
+
+			ret = ipa_nat_add_ipv4_rule(tbl_hdl, &churn_rules[i], &churn_hdls[i]);
+
+			if ( ret )
+			{
+				break;
+			}
+		}
+
+		if ( ret == 0 )
+		{
+			ret = ipa_nat_del_ipv4_rules(tbl_hdl, churn_hdls, NUM_CHURN_RULES);
+		}
+
+		if ( ret )
+		{
+			break;
+		}
+	}
+
+	ra.stop = true;
+
+	pthread_join(thrd, NULL);
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("Reader made %u passes with %u errors during %u add/delete rounds\n",
+			ra.reads, ra.errors, NUM_CHURN_ROUNDS);
+
+	CHECK_ERR_TBL_STOP(ra.errors, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rules(tbl_hdl, stable_hdls, NUM_STABLE_RULES);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
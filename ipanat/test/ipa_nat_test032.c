@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test032.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add random rules, and rules that all hash to one bucket
+	3. Check the table's stats against chain lengths found by walking it
+	4. Delete every other rule, and check again
+	5. Delete the rest, and check that no chains remain
+	6. Delete ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_RANDOM_RULES  48
+#define NUM_COLLIDE_RULES 16
+
+typedef struct
+{
+	WhichTbl2Use       which;
+	uint32_t           tot_for_avg;
+	ipa_nati_tbl_stats stats;
+} chain_count;
+
+/*
+ * Measures each bucket's chain the slow way...
+ */
+static int count_chain(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	chain_count* cc_ptr = (chain_count*) arb_data_ptr;
+
+	uint16_t next_index;
+	uint32_t chain_len = 1;
+
+	if ( record_index >= table_ptr->table_entries )
+	{
+		return 0;
+	}
+
+	next_index = ( cc_ptr->which == USE_NAT_TABLE ) ?
+		((struct ipa_nat_rule*) record_ptr)->next_index :
+		((struct ipa_nat_indx_tbl_rule*) record_ptr)->next_index;
+
+	while ( next_index )
+	{
+		chain_len++;
+
+		record_ptr = GOTO_REC(table_ptr, next_index);
+
+		next_index = ( cc_ptr->which == USE_NAT_TABLE ) ?
+			((struct ipa_nat_rule*) record_ptr)->next_index :
+			((struct ipa_nat_indx_tbl_rule*) record_ptr)->next_index;
+	}
+
+	if ( chain_len > 1 )
+	{
+		cc_ptr->stats.tot_chains++;
+
+		cc_ptr->tot_for_avg += chain_len;
+
+		if ( cc_ptr->stats.min_chain_len == 0
+			 ||
+			 chain_len < cc_ptr->stats.min_chain_len )
+		{
+			cc_ptr->stats.min_chain_len = chain_len;
+		}
+
+		if ( chain_len > cc_ptr->stats.max_chain_len )
+		{
+			cc_ptr->stats.max_chain_len = chain_len;
+		}
+	}
+
+	return 0;
+}
+
+static int check_stats(
+	u32                 tbl_hdl,
+	WhichTbl2Use        which,
+	ipa_nati_tbl_stats* stats_ptr )
+{
+	chain_count cc;
+	float       avg = 0.0;
+
+	int ret;
+
+	memset(&cc, 0, sizeof(cc));
+
+	cc.which = which;
+
+	ret = ipa_nati_walk_ipv4_tbl(tbl_hdl, which, count_chain, &cc);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	if ( cc.stats.tot_chains )
+	{
+		avg = (float) cc.tot_for_avg / (float) cc.stats.tot_chains;
+	}
+
+	if ( stats_ptr->tot_chains    != cc.stats.tot_chains    ||
+		 stats_ptr->min_chain_len != cc.stats.min_chain_len ||
+		 stats_ptr->max_chain_len != cc.stats.max_chain_len ||
+		 stats_ptr->avg_chain_len  > avg + 0.001            ||
+		 stats_ptr->avg_chain_len  < avg - 0.001 )
+	{
+		IPAERR("%s table stats chains(%u) min(%u) max(%u) avg(%f), "
+			   "walk found chains(%u) min(%u) max(%u) avg(%f)\n",
+			   ( which == USE_NAT_TABLE ) ? "NAT" : "Index",
+			   stats_ptr->tot_chains,
+			   stats_ptr->min_chain_len,
+			   stats_ptr->max_chain_len,
+			   stats_ptr->avg_chain_len,
+			   cc.stats.tot_chains,
+			   cc.stats.min_chain_len,
+			   cc.stats.max_chain_len,
+			   avg);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int check_tbl(
+	u32 tbl_hdl )
+{
+	ipa_nati_tbl_stats nstats, istats;
+
+	int ret;
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+	if ( ret == 0 )
+	{
+		ret = check_stats(tbl_hdl, USE_NAT_TABLE, &nstats);
+	}
+
+	if ( ret == 0 )
+	{
+		ret = check_stats(tbl_hdl, USE_INDEX_TABLE, &istats);
+	}
+
+	return ret;
+}
+
+int ipa_nat_test032(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule  ipv4_rule;
+	ipa_nati_tbl_stats nstats, istats;
+
+	u32 rule_hdls[NUM_RANDOM_RULES + NUM_COLLIDE_RULES];
+	u32 target_ip, i, tot;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	memset(rule_hdls, 0, sizeof(rule_hdls));
+
+	for ( i = tot = 0; i < NUM_RANDOM_RULES && (int) tot < total_entries / 2; i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[tot]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		tot++;
+	}
+
+	/*
+	 * Holding the XOR of the ports constant, with everything else
+	 * fixed, puts these in one bucket of each table.  Stop quietly
+	 * when the expansion table runs out...
+	 */
+	target_ip = RAN_ADDR;
+
+	for ( i = 0; i < NUM_COLLIDE_RULES; i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.target_ip    = target_ip;
+		ipv4_rule.target_port  = 2000 + i;
+		ipv4_rule.private_ip   = pub_ip_add;
+		ipv4_rule.private_port = (2000 + i) ^ 0x0F0F;
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = (2000 + i) ^ 0x7070;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[tot]) )
+		{
+			break;
+		}
+
+		tot++;
+	}
+
+	ret = check_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < tot; i += 2 )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		rule_hdls[i] = 0;
+	}
+
+	ret = check_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 1; i < tot; i += 2 )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( nstats.tot_chains || nstats.max_chain_len ||
+		 istats.tot_chains || istats.max_chain_len )
+	{
+		IPAERR("Chains left behind in an empty table\n");
+		ret = -1;
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test033.c
+
+	@brief
+	Verify the following scenario:
+	1. Let DDR tables grow, and add a small ipv4 table
+	2. Add rules, well past the table's original size
+	3. Where the table grew (ie. DDR), check that every rule's handle
+	   still finds and time stamps its rule
+	4. Delete the rules
+	5. Delete ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define SMALL_TBL_ENTRIES 64
+#define MAX_GROW_RULES    512
+
+int ipa_nat_test033(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule  ipv4_rule;
+	ipa_nati_tbl_stats nstats, istats;
+
+	ipa_nat_ipv4_rule* rules     = NULL;
+	u32*               rule_hdls = NULL;
+
+	u32 orig_ents, found_hdl, time_stamp, i, tot;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, SMALL_TBL_ENTRIES, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_set_ddr_grow_limit(IPA_TABLE_MAX_ENTRIES);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	rules     = calloc(MAX_GROW_RULES, sizeof(ipa_nat_ipv4_rule));
+	rule_hdls = calloc(MAX_GROW_RULES, sizeof(u32));
+
+	if ( ! rules || ! rule_hdls )
+	{
+		IPAERR("Unable to allocate rules\n");
+		ret = -1;
+		goto bail;
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	orig_ents = nstats.tot_ents;
+
+	/*
+	 * Add until an add fails, or until there are enough rules that
+	 * the table must have grown to hold them.  Tables that can't grow
+	 * simply fill up...
+	 */
+	for ( tot = 0; tot < MAX_GROW_RULES && tot <= 2 * orig_ents; tot++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[tot]) )
+		{
+			break;
+		}
+
+		rules[tot] = ipv4_rule;
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	IPADBG("%u rules added, table size went from %u to %u\n",
+		   tot, orig_ents, nstats.tot_ents);
+
+	if ( tot > orig_ents && nstats.tot_ents <= orig_ents )
+	{
+		IPAERR("More rules (%u) than the table holds (%u)\n",
+			   tot, nstats.tot_ents);
+		ret = -1;
+		goto bail;
+	}
+
+	for ( i = 0; i < tot; i++ )
+	{
+		ret = ipa_nat_find_ipv4_rule(tbl_hdl, &rules[i], &found_hdl);
+
+		if ( ret == 0 && found_hdl != rule_hdls[i] )
+		{
+			IPAERR("Rule %u found as 0x%08X, added as 0x%08X\n",
+				   i, found_hdl, rule_hdls[i]);
+			ret = -1;
+		}
+
+		if ( ret == 0 )
+		{
+			ret = ipa_nat_query_timestamp(tbl_hdl, rule_hdls[i], &time_stamp);
+		}
+
+		if ( ret )
+		{
+			goto bail;
+		}
+	}
+
+	for ( i = 0; i < tot; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+
+		if ( ret )
+		{
+			goto bail;
+		}
+	}
+
+bail:
+	free(rules);
+	free(rule_hdls);
+
+	/* leave other tests' tables to fill up */
+	ipa_nat_set_ddr_grow_limit(0);
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
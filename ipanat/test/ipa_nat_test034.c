@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test034.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add rules that all hash to one bucket
+	3. Repeatedly delete the first rule of the list, then compact the
+	   table, checking that each rule moved frees an expansion entry
+	   and that the remaining rules' handles still find them
+	4. Delete ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_COLLIDE_RULES 8
+
+int ipa_nat_test034(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule  ipv4_rules[NUM_COLLIDE_RULES];
+	ipa_nati_tbl_stats before, after, istats;
+
+	u32 rule_hdls[NUM_COLLIDE_RULES];
+	u32 target_ip, found_hdl, time_stamp, num_moved, i, j, tot;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	/*
+	 * See ipa_nat_test032.c for why these share a bucket...
+	 */
+	target_ip = RAN_ADDR;
+
+	for ( tot = 0; tot < NUM_COLLIDE_RULES; tot++ )
+	{
+		ipa_nat_ipv4_rule* rule_ptr = &ipv4_rules[tot];
+
+		memset(rule_ptr, 0, sizeof(ipa_nat_ipv4_rule));
+
+		rule_ptr->target_ip    = target_ip;
+		rule_ptr->target_port  = 3000 + tot;
+		rule_ptr->private_ip   = pub_ip_add;
+		rule_ptr->private_port = (3000 + tot) ^ 0x0F0F;
+		rule_ptr->protocol     = IPPROTO_UDP;
+		rule_ptr->public_port  = (3000 + tot) ^ 0x7070;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, rule_ptr, &rule_hdls[tot]) )
+		{
+			break;
+		}
+	}
+
+	for ( i = 0; i < tot; i++ )
+	{
+		/*
+		 * The list's first rule is the oldest one left...
+		 */
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &before, &istats);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		ret = ipa_nat_compact_ipv4_tbl(tbl_hdl, 2 * NUM_COLLIDE_RULES, &num_moved);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &after, &istats);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		IPADBG("Deleted rule %u of %u, compaction moved %u\n", i, tot, num_moved);
+
+		if ( num_moved > 1
+			 ||
+			 after.tot_expn_ents_filled + num_moved != before.tot_expn_ents_filled
+			 ||
+			 (num_moved && after.max_chain_len >= before.max_chain_len) )
+		{
+			IPAERR("Compaction moved %u, expansion entries %u -> %u, "
+				   "longest list %u -> %u\n",
+				   num_moved,
+				   before.tot_expn_ents_filled,
+				   after.tot_expn_ents_filled,
+				   before.max_chain_len,
+				   after.max_chain_len);
+			ret = -1;
+		}
+
+		for ( j = i + 1; j < tot && ret == 0; j++ )
+		{
+			ret = ipa_nat_find_ipv4_rule(tbl_hdl, &ipv4_rules[j], &found_hdl);
+
+			if ( ret == 0 && found_hdl != rule_hdls[j] )
+			{
+				IPAERR("Rule %u found as 0x%08X, added as 0x%08X\n",
+					   j, found_hdl, rule_hdls[j]);
+				ret = -1;
+			}
+
+			if ( ret == 0 )
+			{
+				ret = ipa_nat_query_timestamp(tbl_hdl, rule_hdls[j], &time_stamp);
+			}
+		}
+
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &after, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( after.tot_chains || after.tot_expn_ents_filled )
+	{
+		IPAERR("Lists left behind in an empty table\n");
+		ret = -1;
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test035.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table, or clear the one there is
+	2. Add more rules than fit in one stale callback batch (rules
+	   are added with a zero time stamp)
+	3. Collect stale rules against thresholds either side of the
+	   24 bit wrap, and check all or none are found
+	4. Check a callback returning non-zero stops the collection
+	5. Collect and delete the stale rules, and check the table is empty
+	6. Delete ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_RULES 100
+#define MAX_TRIES (20 * NUM_RULES)
+
+typedef struct
+{
+	u32* rule_hdls;
+	u32  num_found;
+	u32  num_calls;
+	int  stop;
+	int  bad;
+} stale_found;
+
+static int note_stale(
+	const ipa_nat_rule_time_stamp* stale,
+	uint32_t                       num_stale,
+	void*                          arb_data_ptr)
+{
+	stale_found* sf_ptr = (stale_found*) arb_data_ptr;
+
+	u32 i, j;
+
+	for ( i = 0; i < num_stale; i++ )
+	{
+		for ( j = 0; j < NUM_RULES; j++ )
+		{
+			if ( sf_ptr->rule_hdls[j] == stale[i].rule_hdl )
+			{
+				break;
+			}
+		}
+
+		if ( j == NUM_RULES || stale[i].time_stamp != 0 )
+		{
+			IPAERR("Unexpected stale rule_hdl(0x%08X) time_stamp(0x%06X)\n",
+				   stale[i].rule_hdl, stale[i].time_stamp);
+			sf_ptr->bad++;
+		}
+	}
+
+	sf_ptr->num_found += num_stale;
+	sf_ptr->num_calls++;
+
+	return sf_ptr->stop;
+}
+
+static int collect(
+	u32          tbl_hdl,
+	u32          older_than,
+	bool         del_stale,
+	int          stop,
+	stale_found* sf_ptr)
+{
+	u32* rule_hdls = sf_ptr->rule_hdls;
+
+	int ret;
+
+	memset(sf_ptr, 0, sizeof(*sf_ptr));
+
+	sf_ptr->rule_hdls = rule_hdls;
+	sf_ptr->stop      = stop;
+
+	ret = ipa_nat_collect_stale(tbl_hdl, older_than, del_stale, note_stale, sf_ptr);
+
+	IPADBG("older_than(0x%06X) found(%u) in %u calls\n",
+		   older_than, sf_ptr->num_found, sf_ptr->num_calls);
+
+	return ( ret || sf_ptr->bad ) ? -1 : 0;
+}
+
+int ipa_nat_test035(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule  ipv4_rule;
+	ipa_nati_tbl_stats stats, istats;
+	stale_found        sf;
+
+	u32 rule_hdls[NUM_RULES];
+	u32 i, tries;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	/*
+	 * An earlier test may have left the table full...
+	 */
+	ret = ipa_nati_clear_ipv4_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * A small table can't take every random rule, what with hash
+	 * collisions, so those it refuses are replaced by others...
+	 */
+	for ( i = 0, tries = 0; i < NUM_RULES && tries < MAX_TRIES; tries++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+		ipv4_rule.protocol     = IPPROTO_UDP;
+		ipv4_rule.public_port  = RAN_PORT;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[i]) == 0 )
+		{
+			i++;
+		}
+	}
+
+	CHECK_ERR_TBL_STOP(i != NUM_RULES, tbl_hdl);
+
+	sf.rule_hdls = rule_hdls;
+
+	/*
+	 * Nothing is older than its own time stamp...
+	 */
+	ret = collect(tbl_hdl, 0, false, 0, &sf);
+	CHECK_ERR_TBL_STOP(ret || sf.num_found, tbl_hdl);
+
+	/*
+	 * ...nor than a time stamp more than half the 24 bit range
+	 * ahead, since that one is taken to be behind after a wrap...
+	 */
+	ret = collect(tbl_hdl, 0x800000, false, 0, &sf);
+	CHECK_ERR_TBL_STOP(ret || sf.num_found, tbl_hdl);
+
+	/*
+	 * ...but everything is older than a time stamp up to half the
+	 * range ahead.
+	 */
+	ret = collect(tbl_hdl, 0x7FFFFF, false, 0, &sf);
+	CHECK_ERR_TBL_STOP(ret || sf.num_found != NUM_RULES || sf.num_calls < 2, tbl_hdl);
+
+	ret = collect(tbl_hdl, 1, false, 1, &sf);
+	CHECK_ERR_TBL_STOP(ret || sf.num_found == NUM_RULES || sf.num_calls != 1, tbl_hdl);
+
+	ret = collect(tbl_hdl, 1, true, 0, &sf);
+	CHECK_ERR_TBL_STOP(ret || sf.num_found != NUM_RULES, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &stats, &istats);
+	CHECK_ERR_TBL_STOP(ret || stats.tot_base_ents_filled || stats.tot_expn_ents_filled, tbl_hdl);
+
+	ret = collect(tbl_hdl, 1, true, 0, &sf);
+	CHECK_ERR_TBL_STOP(ret || sf.num_found, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test036.c
+
+	@brief
+	Verify the following scenario:
+	1. Fill an array of rule records with random enable bits,
+	   protocols and time stamps, many of the latter close to the
+	   24 bit wrap either side of a reference
+	2. Check the record scan kernel agrees with the scalar one, and
+	   with the rule fields, for every scan type and block length
+	3. Add ipv4 table and rules
+	4. Query changed time stamps with a new shadow, a few at a time,
+	   until every rule has been reported once
+	5. Query again and check nothing changed
+	6. Delete the rules and ipv4 table
+*/
+/*=========================================================================*/
+
+#include <errno.h>
+
+#include "ipa_nat_test.h"
+
+#define NUM_RECS  1024
+#define NUM_RULES 50
+#define MAX_FOUND 16
+
+static const uint32_t ts_deltas[] =
+{
+	0, 1, 0xFFFFFF, 0x7FFFFF, 0x800000, 0x800001, 0x7FFFFE,
+};
+
+static bool expect(
+	const struct ipa_nat_rule* rule_ptr,
+	ipa_nati_scan_type         type,
+	uint32_t                   ref,
+	uint32_t                   shadow)
+{
+	uint32_t d = (ref - rule_ptr->time_stamp) & 0xFFFFFF;
+
+	if ( ! rule_ptr->enable || rule_ptr->protocol == IPAHAL_NAT_INVALID_PROTOCOL )
+	{
+		return false;
+	}
+
+	switch ( type )
+	{
+	case NATI_SCAN_CHANGED:
+		return rule_ptr->time_stamp != shadow;
+	case NATI_SCAN_STALE:
+		return d != 0 && d < 0x800000;
+	default:
+		return true;
+	}
+}
+
+static int check_kernel(void)
+{
+	struct ipa_nat_rule* recs;
+	uint32_t*            shadow;
+
+	uint32_t ref = 0xFFFFF0;
+	uint32_t base, num, type, vec, sca, want, i;
+
+	int ret = 0;
+
+	recs   = calloc(NUM_RECS, sizeof(struct ipa_nat_rule));
+	shadow = calloc(NUM_RECS, sizeof(uint32_t));
+
+	if ( ! recs || ! shadow )
+	{
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	for ( i = 0; i < NUM_RECS; i++ )
+	{
+		recs[i].private_ip = rand();
+		recs[i].ip_chksum  = rand();
+		recs[i].rsvd1      = rand();
+		recs[i].redirect   = rand();
+		recs[i].enable     = (rand() % 4) != 0;
+		recs[i].protocol   = (rand() % 8) ? IPPROTO_UDP : IPAHAL_NAT_INVALID_PROTOCOL;
+
+		if ( rand() % 2 )
+		{
+			recs[i].time_stamp =
+				ref - ts_deltas[rand() % array_sz(ts_deltas)];
+		}
+		else
+		{
+			recs[i].time_stamp = rand();
+		}
+
+		shadow[i] = (rand() % 2) ? recs[i].time_stamp : (uint32_t) rand() & 0xFFFFFF;
+	}
+
+	IPADBG("Scan kernel is %s\n", ipa_nati_scan_isa());
+
+	for ( type = NATI_SCAN_LIVE; type <= NATI_SCAN_STALE && ! ret; type++ )
+	{
+		for ( base = 0; base < NUM_RECS && ! ret; base += num )
+		{
+			num = 1 + rand() % 32;
+			num = ( base + num > NUM_RECS ) ? NUM_RECS - base : num;
+
+			ipa_nati_scan_force_scalar(false);
+
+			vec = ipa_nati_scan_recs(
+				&recs[base], num, (ipa_nati_scan_type) type, ref, &shadow[base]);
+
+			ipa_nati_scan_force_scalar(true);
+
+			sca = ipa_nati_scan_recs(
+				&recs[base], num, (ipa_nati_scan_type) type, ref, &shadow[base]);
+
+			for ( want = i = 0; i < num; i++ )
+			{
+				want |= (uint32_t) expect(
+					&recs[base + i], (ipa_nati_scan_type) type, ref, shadow[base + i]) << i;
+			}
+
+			if ( vec != want || sca != want )
+			{
+				IPAERR("type(%u) base(%u) num(%u): vector(0x%08X) scalar(0x%08X) want(0x%08X)\n",
+					   type, base, num, vec, sca, want);
+				ret = -1;
+			}
+		}
+	}
+
+	ipa_nati_scan_force_scalar(false);
+
+bail:
+	free(recs);
+	free(shadow);
+
+	return ret;
+}
+
+int ipa_nat_test036(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule       ipv4_rule;
+	ipa_nat_rule_time_stamp found[MAX_FOUND];
+	ipa_nat_ts_shadow*      shadow = NULL;
+
+	u32 rule_hdls[NUM_RULES];
+	u32 seen[NUM_RULES];
+	u32 num_found, tot_found, i, j;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = check_kernel();
+	CHECK_ERR(ret);
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	for ( i = 0; i < NUM_RULES; i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	/*
+	 * A new shadow has every rule changed, and those that don't fit
+	 * come back next time...
+	 */
+	memset(seen, 0, sizeof(seen));
+
+	tot_found = 0;
+
+	do
+	{
+		ret = ipa_nat_query_changed_timestamps(
+			tbl_hdl, &shadow, found, MAX_FOUND, &num_found);
+
+		CHECK_ERR_TBL_ACTION(ret && ret != -ENOSPC, tbl_hdl, goto bail);
+
+		for ( i = 0; i < num_found; i++ )
+		{
+			for ( j = 0; j < NUM_RULES && rule_hdls[j] != found[i].rule_hdl; j++ );
+
+			CHECK_ERR_TBL_ACTION(j == NUM_RULES || seen[j]++, tbl_hdl, goto bail);
+		}
+
+		tot_found += num_found;
+
+	} while ( ret == -ENOSPC && tot_found <= NUM_RULES );
+
+	IPADBG("%u changed rules found\n", tot_found);
+
+	CHECK_ERR_TBL_ACTION(tot_found != NUM_RULES, tbl_hdl, goto bail);
+
+	ret = ipa_nat_query_changed_timestamps(
+		tbl_hdl, &shadow, found, MAX_FOUND, &num_found);
+	CHECK_ERR_TBL_ACTION(ret || num_found, tbl_hdl, goto bail);
+
+	ipa_nat_free_ts_shadow(shadow);
+
+	for ( i = 0; i < NUM_RULES; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+
+bail:
+	ipa_nat_free_ts_shadow(shadow);
+
+	if ( sep )
+	{
+		ipa_nat_del_ipv4_tbl(tbl_hdl);
+	}
+
+	return -1;
+}
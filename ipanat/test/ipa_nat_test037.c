@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test037.c
+
+	@brief
+	Verify the following scenario:
+	1. Add a hybrid ipv6ct table too large for SRAM
+	2. Add rules until the table moves to DDR
+	3. Query and delete a few rules by the handles given before the
+	   move
+	4. Delete rules until the table moves back to SRAM
+	5. Query and delete the rest, then delete the ipv6ct table
+
+	Run on its own (-d), nothing else holds SRAM and the table must be
+	hybrid, whatever the mode.  Sharing the run's ipv4 table, SRAM is
+	usually taken (the ipv4 table is put there if it fits, even in DDR
+	mode), the ipv6ct table is simply put in DDR, and only the adds,
+	queries and deletes are checked.
+*/
+/*=========================================================================*/
+
+#include <errno.h>
+
+#include "ipa_nat_test.h"
+#include "ipa_ipv6ct.h"
+
+#define NUM_ENTRIES 1000
+
+static void make_rule(
+	ipa_ipv6ct_rule* rule_ptr,
+	u32              i)
+{
+	memset(rule_ptr, 0, sizeof(*rule_ptr));
+
+	rule_ptr->src_ipv6_lsb       = ((uint64_t) RAN_ADDR << 32) | i;
+	rule_ptr->src_ipv6_msb       = 0x20010DB800000000ULL;
+	rule_ptr->dest_ipv6_lsb      = ((uint64_t) RAN_ADDR << 32) | RAN_ADDR;
+	rule_ptr->dest_ipv6_msb      = 0x20010DB800010000ULL;
+	rule_ptr->src_port           = RAN_PORT;
+	rule_ptr->dest_port          = RAN_PORT;
+	rule_ptr->protocol           = IPPROTO_TCP;
+	rule_ptr->direction_settings = IPA_IPV6CT_DIRECTION_ALLOW_ALL;
+}
+
+int ipa_nat_test037(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	ipa_ipv6ct_switch_stats stats;
+	ipa_ipv6ct_rule         rule;
+
+	u32  rule_hdls[NUM_ENTRIES];
+	bool deleted[NUM_ENTRIES];
+	u32  v6_tbl_hdl = 0;
+	u32  time_stamp;
+	u32  num_added, i;
+
+	int ret;
+
+	UNUSED(nat_mem_type);
+	UNUSED(pub_ip_add);
+	UNUSED(total_entries);
+	UNUSED(tbl_hdl);
+	UNUSED(arb_data_ptr);
+
+	IPADBG("In\n");
+
+	ret = ipa_ipv6ct_add_tbl_ext(NUM_ENTRIES, "HYBRID", &v6_tbl_hdl);
+	CHECK_ERR(ret);
+
+	ret = ipa_ipv6ct_get_switch_stats(v6_tbl_hdl, &stats);
+	CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+	IPADBG("ipv6ct table is %s in %s\n",
+		   stats.hybrid ? "hybrid" : "not hybrid",
+		   stats.in_sram ? "SRAM" : "DDR");
+
+	/*
+	 * A fall back to DDR only would otherwise go unnoticed...
+	 */
+	CHECK_ERR_V6_STOP(sep && ! (stats.hybrid && stats.in_sram), v6_tbl_hdl);
+
+	memset(deleted, 0, sizeof(deleted));
+
+	/*
+	 * Keep adding until the table moves to DDR or, when it was never
+	 * hybrid, a good number of rules are in...
+	 */
+	for ( num_added = 0; num_added < NUM_ENTRIES / 2; num_added++ )
+	{
+		make_rule(&rule, num_added);
+
+		ret = ipa_ipv6ct_add_rule(v6_tbl_hdl, &rule, &rule_hdls[num_added]);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+		ret = ipa_ipv6ct_get_switch_stats(v6_tbl_hdl, &stats);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+		if ( stats.to_ddr_pass )
+		{
+			num_added++;
+			break;
+		}
+	}
+
+	IPADBG("%u rules added, table in %s\n", num_added, stats.in_sram ? "SRAM" : "DDR");
+
+	CHECK_ERR_V6_STOP(stats.num_rules != num_added, v6_tbl_hdl);
+	CHECK_ERR_V6_STOP(stats.to_ddr_fail || stats.to_sram_fail, v6_tbl_hdl);
+	CHECK_ERR_V6_STOP(stats.hybrid && stats.in_sram, v6_tbl_hdl);
+
+	/*
+	 * Every handle still works, including those handed out while in
+	 * SRAM...
+	 */
+	for ( i = 0; i < num_added; i++ )
+	{
+		ret = ipa_ipv6ct_query_timestamp(v6_tbl_hdl, rule_hdls[i], &time_stamp);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+	}
+
+	/*
+	 * Delete from the front until the table is back in SRAM...
+	 */
+	for ( i = 0; i < num_added; i++ )
+	{
+		ret = ipa_ipv6ct_del_rule(v6_tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+		deleted[i] = true;
+
+		ret = ipa_ipv6ct_get_switch_stats(v6_tbl_hdl, &stats);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+		if ( stats.to_sram_pass )
+		{
+			break;
+		}
+	}
+
+	IPADBG("table in %s with %u rules\n", stats.in_sram ? "SRAM" : "DDR", stats.num_rules);
+
+	CHECK_ERR_V6_STOP(stats.hybrid && ! stats.in_sram, v6_tbl_hdl);
+	CHECK_ERR_V6_STOP(stats.hybrid && stats.to_sram_pass != 1, v6_tbl_hdl);
+
+	/*
+	 * ...and the remaining handles survived the second move too
+	 */
+	for ( i = 0; i < num_added; i++ )
+	{
+		if ( deleted[i] )
+		{
+			/* Only a stable handle is known to be gone once deleted */
+			if ( stats.hybrid )
+			{
+				ret = ipa_ipv6ct_query_timestamp(v6_tbl_hdl, rule_hdls[i], &time_stamp);
+				CHECK_ERR_V6_STOP(ret == 0, v6_tbl_hdl);
+			}
+			continue;
+		}
+
+		ret = ipa_ipv6ct_query_timestamp(v6_tbl_hdl, rule_hdls[i], &time_stamp);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+		ret = ipa_ipv6ct_del_rule(v6_tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+	}
+
+	ret = ipa_ipv6ct_get_switch_stats(v6_tbl_hdl, &stats);
+	CHECK_ERR_V6_STOP(ret || stats.num_rules, v6_tbl_hdl);
+
+	ret = ipa_ipv6ct_del_tbl(v6_tbl_hdl);
+	CHECK_ERR(ret);
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test038.c
+
+	@brief
+	Verify the following scenario:
+	1. Add a hybrid ipv6ct table
+	2. Add more rules than SRAM holds with one ipa_ipv6ct_add_rules()
+	3. Read their time stamps with ipa_ipv6ct_query_timestamps(), and
+	   check them against ipa_ipv6ct_query_timestamp()
+	4. Delete half the rules, plus one of them twice, with
+	   ipa_ipv6ct_del_rules(), and check only the repeat failed
+	5. Delete the rest the same way, then delete the ipv6ct table
+*/
+/*=========================================================================*/
+
+#include <errno.h>
+
+#include "ipa_nat_test.h"
+#include "ipa_ipv6ct.h"
+
+#define NUM_ENTRIES 1000
+#define NUM_RULES   300
+
+int ipa_nat_test038(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	ipa_ipv6ct_switch_stats stats;
+	ipa_ipv6ct_rule         rules[NUM_RULES];
+
+	u32 rule_hdls[NUM_RULES + 1];
+	u32 time_stamps[NUM_RULES];
+	u32 v6_tbl_hdl = 0;
+	u32 time_stamp;
+	u32 i;
+
+	int ret;
+
+	UNUSED(nat_mem_type);
+	UNUSED(pub_ip_add);
+	UNUSED(total_entries);
+	UNUSED(tbl_hdl);
+	UNUSED(sep);
+	UNUSED(arb_data_ptr);
+
+	IPADBG("In\n");
+
+	ret = ipa_ipv6ct_add_tbl_ext(NUM_ENTRIES, "HYBRID", &v6_tbl_hdl);
+	CHECK_ERR(ret);
+
+	for ( i = 0; i < NUM_RULES; i++ )
+	{
+		memset(&rules[i], 0, sizeof(rules[i]));
+
+		rules[i].src_ipv6_lsb       = ((uint64_t) RAN_ADDR << 32) | i;
+		rules[i].src_ipv6_msb       = 0x20010DB800000000ULL;
+		rules[i].dest_ipv6_lsb      = ((uint64_t) RAN_ADDR << 32) | RAN_ADDR;
+		rules[i].dest_ipv6_msb      = 0x20010DB800010000ULL;
+		rules[i].src_port           = RAN_PORT;
+		rules[i].dest_port          = RAN_PORT;
+		rules[i].protocol           = (i % 2) ? IPPROTO_TCP : IPPROTO_UDP;
+		rules[i].direction_settings = IPA_IPV6CT_DIRECTION_ALLOW_ALL;
+	}
+
+	ret = ipa_ipv6ct_add_rules(v6_tbl_hdl, rules, NUM_RULES, rule_hdls);
+	CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+	for ( i = 0; i < NUM_RULES; i++ )
+	{
+		CHECK_ERR_V6_STOP(rule_hdls[i] == 0, v6_tbl_hdl);
+	}
+
+	ret = ipa_ipv6ct_get_switch_stats(v6_tbl_hdl, &stats);
+	CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+	IPADBG("%u rules in %s, %u moves to DDR\n",
+		   stats.num_rules, stats.in_sram ? "SRAM" : "DDR", stats.to_ddr_pass);
+
+	CHECK_ERR_V6_STOP(stats.num_rules != NUM_RULES, v6_tbl_hdl);
+
+	ret = ipa_ipv6ct_query_timestamps(v6_tbl_hdl, rule_hdls, NUM_RULES, time_stamps);
+	CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+	for ( i = 0; i < NUM_RULES; i++ )
+	{
+		ret = ipa_ipv6ct_query_timestamp(v6_tbl_hdl, rule_hdls[i], &time_stamp);
+		CHECK_ERR_V6_STOP(ret || time_stamp != time_stamps[i], v6_tbl_hdl);
+	}
+
+	/*
+	 * A stable handle is known to be gone once deleted, hence the
+	 * repeat can only be relied on to fail in a hybrid table...
+	 */
+	if ( stats.hybrid )
+	{
+		rule_hdls[NUM_RULES] = rule_hdls[0];
+
+		ret = ipa_ipv6ct_del_rules(v6_tbl_hdl, rule_hdls, NUM_RULES / 2);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+		ret = ipa_ipv6ct_del_rules(v6_tbl_hdl, &rule_hdls[NUM_RULES / 2], NUM_RULES / 2 + 1);
+		CHECK_ERR_V6_STOP(ret == 0, v6_tbl_hdl);
+	}
+	else
+	{
+		ret = ipa_ipv6ct_del_rules(v6_tbl_hdl, rule_hdls, NUM_RULES);
+		CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+	}
+
+	ret = ipa_ipv6ct_get_switch_stats(v6_tbl_hdl, &stats);
+	CHECK_ERR_V6_STOP(ret, v6_tbl_hdl);
+
+	IPADBG("%u rules in %s, %u moves to SRAM\n",
+		   stats.num_rules, stats.in_sram ? "SRAM" : "DDR", stats.to_sram_pass);
+
+	CHECK_ERR_V6_STOP(stats.num_rules, v6_tbl_hdl);
+	CHECK_ERR_V6_STOP(stats.to_ddr_fail || stats.to_sram_fail, v6_tbl_hdl);
+	CHECK_ERR_V6_STOP(stats.hybrid && ! stats.in_sram, v6_tbl_hdl);
+
+	ret = ipa_ipv6ct_del_tbl(v6_tbl_hdl);
+	CHECK_ERR(ret);
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test039.c
+
+	@brief
+	Verify the following scenario:
+	1. With no linger, nested clock votes reach the kernel once, and
+	   the last devote releases the clock at once
+	2. A devote without a vote is refused
+	3. With a linger period, a vote following a devote inside the
+	   period shares the vote already held
+	4. Once the period has passed, the lease releases the clock by
+	   itself
+*/
+/*=========================================================================*/
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "ipa_nat_test.h"
+
+#define LINGER_MS 50
+
+static int check_lease(void)
+{
+	ipa_nat_vote_stats before, after;
+
+	int ret;
+
+	ret = ipa_nat_set_vote_linger(0);
+	CHECK_ERR(ret);
+
+	ret = ipa_nat_get_vote_stats(&before);
+	CHECK_ERR(ret);
+
+	CHECK_ERR(before.holders || before.voted);
+
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE);
+	CHECK_ERR(ret);
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE);
+	CHECK_ERR(ret);
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE);
+	CHECK_ERR(ret);
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE);
+	CHECK_ERR(ret);
+
+	ret = ipa_nat_get_vote_stats(&after);
+	CHECK_ERR(ret);
+
+	CHECK_ERR(after.ioctls - before.ioctls != 2);
+	CHECK_ERR(after.votes_avoided - before.votes_avoided != 1);
+	CHECK_ERR(after.holders || after.voted);
+
+	CHECK_ERR(ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != -EINVAL);
+
+	/*
+	 * Now a burst, with time to spare between its operations...
+	 */
+	ret = ipa_nat_set_vote_linger(LINGER_MS);
+	CHECK_ERR(ret);
+
+	before = after;
+
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE);
+	CHECK_ERR(ret);
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE);
+	CHECK_ERR(ret);
+
+	usleep(LINGER_MS * 1000 / 5);
+
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_VOTE);
+	CHECK_ERR(ret);
+	ret = ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE);
+	CHECK_ERR(ret);
+
+	ret = ipa_nat_get_vote_stats(&after);
+	CHECK_ERR(ret);
+
+	IPADBG("ioctls(%llu) avoided(%llu)\n",
+		   (unsigned long long) (after.ioctls - before.ioctls),
+		   (unsigned long long) (after.votes_avoided - before.votes_avoided));
+
+	CHECK_ERR(after.ioctls - before.ioctls != 1);
+	CHECK_ERR(after.votes_avoided - before.votes_avoided != 1);
+	CHECK_ERR(after.holders || ! after.voted);
+
+	/*
+	 * ...and the quiet after it
+	 */
+	usleep(LINGER_MS * 1000 * 4);
+
+	ret = ipa_nat_get_vote_stats(&after);
+	CHECK_ERR(ret);
+
+	CHECK_ERR(after.ioctls - before.ioctls != 2);
+	CHECK_ERR(after.expiries - before.expiries != 1);
+	CHECK_ERR(after.voted);
+
+	return 0;
+}
+
+int ipa_nat_test039(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int ret;
+
+	UNUSED(nat_mem_type);
+	UNUSED(pub_ip_add);
+	UNUSED(total_entries);
+	UNUSED(tbl_hdl);
+	UNUSED(sep);
+	UNUSED(arb_data_ptr);
+
+	IPADBG("In\n");
+
+	ret = check_lease();
+
+	/*
+	 * Leave the lease as the other tests expect it
+	 */
+	ipa_nat_set_vote_linger(0);
+
+	CHECK_ERR(ret);
+
+	IPADBG("Out\n");
+
+	return 0;
+}
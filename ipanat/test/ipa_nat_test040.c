@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test040.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add two lists of two rules, headed in neighbouring base table
+	   slots H and H + 1
+	3. Delete the first list's head, and compact one rule, which
+	   leaves the compaction cursor on slot H + 1
+	4. Delete the second list's head, and compact the whole table,
+	   checking that the list at the cursor's starting slot is pulled
+	   once, and that every rule left is still found by its handle
+	5. Delete ipv4 table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define PUBLIC_PORT 0x2345
+#define OTHER_PORTS 0x4000
+#define MAX_PROBES  256
+#define MAX_MOVES   64
+
+typedef struct
+{
+	u32 target_ip;
+	u16 target_port;
+	u16 public_port;
+	u16 index;
+	u16 table_entries;
+} rule_place;
+
+static void make_rule(
+	ipa_nat_ipv4_rule* rule_ptr,
+	u32                target_ip,
+	u32                private_ip,
+	u16                target_port,
+	u16                public_port)
+{
+	memset(rule_ptr, 0, sizeof(ipa_nat_ipv4_rule));
+
+	rule_ptr->target_ip    = target_ip;
+	rule_ptr->target_port  = target_port;
+	rule_ptr->private_ip   = private_ip;
+	rule_ptr->private_port = target_port ^ 0x0F0F;
+	rule_ptr->protocol     = IPPROTO_UDP;
+	rule_ptr->public_port  = public_port;
+}
+
+static int find_place(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	rule_place*          rp_ptr   = (rule_place*) arb_data_ptr;
+	struct ipa_nat_rule* rule_ptr = (struct ipa_nat_rule*) record_ptr;
+
+	UNUSED(rule_hdl);
+	UNUSED(meta_record_ptr);
+	UNUSED(meta_record_index);
+
+	rp_ptr->table_entries = table_ptr->table_entries;
+
+	if ( rule_ptr->protocol    == IPPROTO_UDP           &&
+		 rule_ptr->target_ip   == rp_ptr->target_ip     &&
+		 rule_ptr->target_port == rp_ptr->target_port   &&
+		 rule_ptr->public_port == rp_ptr->public_port )
+	{
+		rp_ptr->index = record_index;
+	}
+
+	return 0;
+}
+
+/*
+ * Adds a rule just long enough to see which table slot it gets...
+ */
+static int place_rule(
+	u32                tbl_hdl,
+	ipa_nat_ipv4_rule* rule_ptr,
+	rule_place*        rp_ptr)
+{
+	u32 rule_hdl;
+
+	int ret;
+
+	memset(rp_ptr, 0, sizeof(rule_place));
+
+	rp_ptr->target_ip   = rule_ptr->target_ip;
+	rp_ptr->target_port = rule_ptr->target_port;
+	rp_ptr->public_port = rule_ptr->public_port;
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, rule_ptr, &rule_hdl);
+
+	if ( ret == 0 )
+	{
+		ret = ipa_nati_walk_ipv4_tbl(tbl_hdl, USE_NAT_TABLE, find_place, rp_ptr);
+
+		ret |= ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdl);
+	}
+
+	return ret;
+}
+
+int ipa_nat_test040(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	/*
+	 * [0] and [1] make the list at H, [2] and [3] the one at H + 1
+	 */
+	ipa_nat_ipv4_rule  ipv4_rules[4];
+	ipa_nati_tbl_stats before, after, istats;
+	rule_place         place_h, place_h1;
+
+	u32 rule_hdls[4];
+	u32 target_ip, found_hdl, time_stamp, num_moved, first_moved;
+	u16 port_h = 0, port_h1 = 0;
+	u32 i;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	target_ip = RAN_ADDR;
+
+	/*
+	 * Only the target port differs from probe to probe, and the base
+	 * table slot is the target port xor'd with the rest of the
+	 * tuple's hash, so flipping the target port's bits that tell H
+	 * from H + 1 moves a rule from one to the other...
+	 */
+	for ( i = 1; i < MAX_PROBES; i++ )
+	{
+		make_rule(&ipv4_rules[0], target_ip, pub_ip_add, i, PUBLIC_PORT);
+
+		ret = place_rule(tbl_hdl, &ipv4_rules[0], &place_h);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		if ( place_h.index == 0 || place_h.index + 1 >= place_h.table_entries )
+		{
+			continue;
+		}
+
+		port_h  = i;
+		port_h1 = i ^ (place_h.index ^ (place_h.index + 1));
+
+		make_rule(&ipv4_rules[2], target_ip, pub_ip_add, port_h1, PUBLIC_PORT);
+
+		ret = place_rule(tbl_hdl, &ipv4_rules[2], &place_h1);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		if ( place_h1.index == place_h.index + 1 )
+		{
+			break;
+		}
+	}
+
+	IPADBG("Lists at %u and %u\n", place_h.index, place_h1.index);
+
+	CHECK_ERR_TBL_STOP(i == MAX_PROBES, tbl_hdl);
+
+	/*
+	 * See ipa_nat_test032.c for why a rule's partner shares its
+	 * bucket...
+	 */
+	make_rule(&ipv4_rules[0], target_ip, pub_ip_add,
+			  port_h, PUBLIC_PORT);
+	make_rule(&ipv4_rules[1], target_ip, pub_ip_add,
+			  port_h ^ OTHER_PORTS, PUBLIC_PORT ^ OTHER_PORTS);
+	make_rule(&ipv4_rules[2], target_ip, pub_ip_add,
+			  port_h1, PUBLIC_PORT);
+	make_rule(&ipv4_rules[3], target_ip, pub_ip_add,
+			  port_h1 ^ OTHER_PORTS, PUBLIC_PORT ^ OTHER_PORTS);
+
+	/*
+	 * Whatever else the table has to pull goes first, so the moves
+	 * below are ours...
+	 */
+	ret = ipa_nat_compact_ipv4_tbl(tbl_hdl, MAX_MOVES, &num_moved);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < 4; i++ )
+	{
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rules[i], &rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[0]);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_compact_ipv4_tbl(tbl_hdl, 1, &first_moved);
+	CHECK_ERR_TBL_STOP(ret || first_moved > 1, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[2]);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &before, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * A table that doesn't compact (see _smCompactTbl()) moved
+	 * nothing the first time either...
+	 */
+	ret = ipa_nat_compact_ipv4_tbl(tbl_hdl, MAX_MOVES, &num_moved);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &after, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPADBG("Compaction moved %u, then %u\n", first_moved, num_moved);
+
+	if ( num_moved != first_moved
+		 ||
+		 after.tot_expn_ents_filled + num_moved != before.tot_expn_ents_filled )
+	{
+		IPAERR("Compaction moved %u, expansion entries %u -> %u\n",
+			   num_moved,
+			   before.tot_expn_ents_filled,
+			   after.tot_expn_ents_filled);
+		ret = -1;
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 1; i < 4; i += 2 )
+	{
+		ret = ipa_nat_find_ipv4_rule(tbl_hdl, &ipv4_rules[i], &found_hdl);
+		CHECK_ERR_TBL_STOP(ret || found_hdl != rule_hdls[i], tbl_hdl);
+
+		ret = ipa_nat_query_timestamp(tbl_hdl, rule_hdls[i], &time_stamp);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -309,7 +309,7 @@ _dispUsage(
 	const char* progNamePtr )
 {
 	printf(
-		"Usage: %s [-d -r N -i N -e N -m mt]\n"
+		"Usage: %s [-d -r N -i N -e N -m mt -l N -s N]\n"
 		"Where:\n"
 		"  -d     Each test is discrete (create table, add rules, destroy table)\n"
 		"         If not specified, only one table create and destroy for all tests\n"
@@ -318,7 +318,10 @@ _dispUsage(
 		"  -e N   Where N is the number of entries in the NAT\n"
 		"  -m mt  Where mt is the type of memory to use for the NAT\n"
 		"         Legal mt's: DDR, SRAM, or HYBRID (ie. use SRAM and DDR)\n"
-		"  -g M-N Run tests M through N only\n",
+		"  -g M-N Run tests M through N only\n"
+		"  -l N   Where N is the log level (0 err, 1 warn, 2 info, 3 debug)\n"
+		"  -s N   Run against the simulated IPA driver rather than the kernel,\n"
+		"         where N is the SRAM size (in bytes) it's to report for NAT\n",
 		progNamePtr);
 
 	fflush(stdout);
@@ -351,6 +354,21 @@ static NatTests nt_array[] = {
 	NAT_TEST_ENTRY(ipa_nat_test023, IPA_NAT_TEST_PRE_COND_TE, 0),
 	NAT_TEST_ENTRY(ipa_nat_test024, IPA_NAT_TEST_PRE_COND_TE, 0),
 	NAT_TEST_ENTRY(ipa_nat_test025, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test026, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test027, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test028, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test029, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test030, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test031, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test032, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test033, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test034, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test035, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test036, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test037, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test038, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test039, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test040, IPA_NAT_TEST_PRE_COND_TE, 0),
 	/*
 	 * Add new tests just above this comment. Keep the following two
 	 * at the end...
@@ -386,7 +404,7 @@ int main(
 
 	IPADBG("Testing user space nat driver\n");
 
-	while ( (c = getopt(argc, argv, "dr:i:e:m:h:g:?")) != -1 )
+	while ( (c = getopt(argc, argv, "dr:i:e:m:h:g:l:s:?")) != -1 )
 	{
 		switch (c)
 		{
@@ -423,6 +441,18 @@ int main(
 				exit(0);
 			}
 			break;
+		case 'l':
+			ipa_nat_set_log_level((ipa_nat_log_level) atoi(optarg));
+			break;
+		case 's':
+			if ( ipa_nat_set_backend(IPA_NAT_BACKEND_SIM) ||
+				 ipa_nat_sim_set_sram_size(atoi(optarg)) )
+			{
+				fprintf(stderr, "Illegal: -s %s\n", optarg);
+				_dispUsage(basename(argv[0]));
+				exit(0);
+			}
+			break;
 		case '?':
 		default:
 			_dispUsage(basename(argv[0]));